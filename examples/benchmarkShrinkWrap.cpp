@@ -0,0 +1,581 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/*
+ * Measures what a reconstruction costs end to end: runs shrinkWrap over the
+ * matrix of image sizes, synthetic objects and parameter sets and reports
+ * per configuration the time per cycle, the time to reach given errors, the
+ * rate of convergence, the final error and the peak memory.
+ *
+ * Every configuration is run --warmup times without measuring, which fills
+ * the frame buffer pool and the caches, followed by --repetitions measured
+ * runs, which are summarized by their median and interquartile range. For
+ * stable numbers fix the number of threads with --threads and pin them,
+ * either with --numa-node or with OMP_PROC_BIND=close OMP_PLACES=cores, and
+ * avoid frequency scaling. The console output of shrinkWrap is suppressed
+ * while measuring.
+ *
+ * Usage: benchmarkShrinkWrap [--option=value ...]
+ *   --sizes=128,256  image widths and heights
+ *   --objects=atoms,checkerboard,rectangle,circle  synthetic objects
+ *   --betas=0.9      HIO feedback parameters
+ *   --hio-cycles=20  HIO iterations per shrink-wrap cycle
+ *   --cutoffs=0.2    relative intensity cut-offs for the mask update
+ *   --cycles=20      maximum number of shrink-wrap cycles
+ *   --targets=1e-3,1e-4,1e-5  errors for which the time to reach them is
+ *                    reported. The smallest one also stops shrinkWrap
+ *   --warmup=1       unmeasured runs per configuration
+ *   --repetitions=5  measured runs per configuration
+ *   --threads=0      OpenMP threads, 0 keeps the default
+ *   --numa-node=-1   pin the benchmark to the CPUs of this NUMA node. Then
+ *                    shrinkWrap uses one thread per CPU of the node
+ *                    instead of --threads
+ *   --csv=file       one line of summarized results per configuration
+ *   --json=file      summarized results and all samples
+ * All lists are separated by commas. Every combination of size, object,
+ * beta, HIO cycles and cut-off is one configuration.
+ */
+
+#include <algorithm>        // std::sort, std::min_element
+#include <chrono>
+#include <cmath>            // log10, NAN
+#include <cstdlib>          // strtod, strtoul
+#include <cstring>          // memcpy
+#include <fstream>
+#include <iomanip>          // setw, setprecision
+#include <iostream>
+#include <limits>           // numeric_limits
+#include <sstream>
+#include <string>
+#include <vector>
+#include <omp.h>            // omp_set_num_threads
+#include <sys/resource.h>   // getrusage
+
+#include "algorithms/shrinkWrap.hpp"
+#include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
+#include "createTestData/createAtomCluster.hpp"
+#include "createTestData/createCheckerboard.hpp"
+#include "createTestData/createCircularSection.hpp"
+#include "createTestData/createRectangle.hpp"
+
+
+namespace examples
+{
+
+
+    struct BenchmarkOptions
+    {
+        std::vector<unsigned> sizes { 128, 256 };
+        std::vector<std::string> objects { "atoms", "checkerboard", "rectangle", "circle" };
+        std::vector<double> betas { 0.9 };
+        std::vector<unsigned> hioCycles { 20 };
+        std::vector<double> cutoffs { 0.2 };
+        unsigned nCycles       = 20;
+        std::vector<double> targets { 1e-3, 1e-4, 1e-5 };
+        unsigned nWarmup       = 1;
+        unsigned nRepetitions  = 5;
+        unsigned nThreads      = 0;
+        int numaNode           = -1;
+        std::string csvFile;
+        std::string jsonFile;
+    };
+
+    std::vector<std::string> splitList( std::string const & rList )
+    {
+        std::vector<std::string> items;
+        std::istringstream list( rList );
+        std::string item;
+        while ( std::getline( list, item, ',' ) )
+            items.push_back( item );
+        return items;
+    }
+
+    template< class T >
+    std::vector<T> parseNumberList( std::string const & rList )
+    {
+        std::vector<T> numbers;
+        for ( auto const & item : splitList( rList ) )
+            numbers.push_back( (T) strtod( item.c_str(), NULL ) );
+        return numbers;
+    }
+
+    /**
+     * Parses arguments of the form --key=value. Returns false on unknown
+     * arguments or inconsistent values.
+     */
+    bool parseOptions( int argc, char ** argv, BenchmarkOptions & rOptions )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            std::string const arg = argv[i];
+            auto const iEqual = arg.find( '=' );
+            if ( arg.compare( 0, 2, "--" ) != 0 or iEqual == std::string::npos )
+                return false;
+            std::string const key   = arg.substr( 2, iEqual-2 );
+            std::string const value = arg.substr( iEqual+1 );
+            char const * const v    = value.c_str();
+
+            if      ( key == "sizes"       ) rOptions.sizes        = parseNumberList<unsigned>( value );
+            else if ( key == "objects"     ) rOptions.objects      = splitList( value );
+            else if ( key == "betas"       ) rOptions.betas        = parseNumberList<double>( value );
+            else if ( key == "hio-cycles"  ) rOptions.hioCycles    = parseNumberList<unsigned>( value );
+            else if ( key == "cutoffs"     ) rOptions.cutoffs      = parseNumberList<double>( value );
+            else if ( key == "cycles"      ) rOptions.nCycles      = strtoul( v, NULL, 10 );
+            else if ( key == "targets"     ) rOptions.targets      = parseNumberList<double>( value );
+            else if ( key == "warmup"      ) rOptions.nWarmup      = strtoul( v, NULL, 10 );
+            else if ( key == "repetitions" ) rOptions.nRepetitions = strtoul( v, NULL, 10 );
+            else if ( key == "threads"     ) rOptions.nThreads     = strtoul( v, NULL, 10 );
+            else if ( key == "numa-node"   ) rOptions.numaNode     = strtol( v, NULL, 10 );
+            else if ( key == "csv"         ) rOptions.csvFile      = value;
+            else if ( key == "json"        ) rOptions.jsonFile     = value;
+            else
+                return false;
+        }
+
+        for ( auto const & object : rOptions.objects )
+        {
+            if ( object != "atoms" and object != "checkerboard" and
+                 object != "rectangle" and object != "circle" )
+                return false;
+        }
+        for ( auto const & target : rOptions.targets )
+        {
+            if ( not ( target > 0 ) )
+                return false;
+        }
+        return not rOptions.sizes.empty() and not rOptions.objects.empty() and
+               not rOptions.betas.empty() and not rOptions.hioCycles.empty() and
+               not rOptions.cutoffs.empty() and not rOptions.targets.empty() and
+               rOptions.nCycles > 0 and rOptions.nRepetitions > 0;
+    }
+
+    /**
+     * Returns the modulus of the diffraction pattern of the given object,
+     * i.e. the input of shrinkWrap
+     */
+    std::vector<float> createIntensity( std::string const & rObject, unsigned n )
+    {
+        using namespace examples::createTestData;
+
+        float * object = NULL;
+        if      ( rObject == "atoms"        ) object = createAtomCluster( n, n );
+        else if ( rObject == "checkerboard" ) object = createCheckerboard( n, n, 0.1, 0.3, 0 );
+        else if ( rObject == "rectangle"    ) object = createRectangle( n, n, 0.1, 0.3, 0.5, 0.5, 0.3 );
+        else                                  object = createCircularSection( n, n, 0.2 );
+
+        imresh::libs::diffractionIntensity( object, { n, n } );
+        std::vector<float> intensity( object, object + n*n );
+        imresh::libs::freeFrame( object );
+        return intensity;
+    }
+
+    /**
+     * Resets the peak resident set size of this process, so that
+     * getPeakMemory only reports the peak since then. Needs Linux 4.0 or
+     * newer, else the peak since the start of the process is reported.
+     * The buffers cached by the frame buffer pool are freed first, else
+     * the peak would include those of earlier, larger configurations.
+     */
+    void resetPeakMemory( void )
+    {
+        imresh::libs::getFrameBufferPool().trim();
+        std::ofstream clearRefs( "/proc/self/clear_refs" );
+        clearRefs << "5";
+    }
+
+    /**
+     * Returns the peak resident set size in MiB
+     */
+    double getPeakMemory( void )
+    {
+        std::ifstream status( "/proc/self/status" );
+        std::string line;
+        while ( std::getline( status, line ) )
+        {
+            if ( line.compare( 0, 6, "VmHWM:" ) == 0 )
+                return strtod( line.c_str() + 6, NULL ) / 1024.0;
+        }
+        struct rusage usage;
+        getrusage( RUSAGE_SELF, &usage );
+        return usage.ru_maxrss / 1024.0;
+    }
+
+    /**
+     * Measurements of one shrinkWrap run
+     */
+    struct RunSample
+    {
+        double totalSeconds;
+        double secondsPerCycle;
+        unsigned nCycles;
+        double finalError;
+        /* decades of error reduction per second from the first cycle with a
+         * defined error to the last cycle */
+        double convergenceRate;
+        /* for each target, NAN if it wasn't reached */
+        std::vector<double> secondsToTarget;
+    };
+
+    RunSample measureRun
+    (
+        std::vector<float> const & rIntensity,
+        unsigned n,
+        BenchmarkOptions const & rOptions,
+        double rBeta,
+        unsigned rnHioCycles,
+        double rCutoff
+    )
+    {
+        using Clock = std::chrono::steady_clock;
+
+        float * const data = imresh::libs::allocateFrame( n*n );
+        memcpy( data, rIntensity.data(), n*n * sizeof( data[0] ) );
+        double const minTarget = *std::min_element(
+            rOptions.targets.begin(), rOptions.targets.end() );
+
+        std::vector<imresh::algorithms::ShrinkWrapCycle> cycles;
+        cycles.reserve( rOptions.nCycles );
+
+        /* rdbuf( NULL ) sets the bad bit, so that all output is discarded
+         * without being formatted, restoring the buffer clears it again */
+        std::streambuf * const coutBuffer = std::cout.rdbuf( NULL );
+        auto const tStart = Clock::now();
+        imresh::algorithms::shrinkWrap( data, { n, n }, rOptions.nCycles,
+            minTarget, rBeta, 0.04, rCutoff, 3.0, 0.01, rnHioCycles,
+            rOptions.numaNode, &cycles );
+        auto const tEnd = Clock::now();
+        std::cout.rdbuf( coutBuffer );
+        imresh::libs::freeFrame( data );
+
+        RunSample sample;
+        sample.totalSeconds    = std::chrono::duration<double>( tEnd - tStart ).count();
+        sample.nCycles         = cycles.size();
+        sample.secondsPerCycle = NAN;
+        sample.finalError      = NAN;
+        sample.convergenceRate = NAN;
+        if ( not cycles.empty() )
+        {
+            double cycleSeconds = 0;
+            for ( auto const & cycle : cycles )
+                cycleSeconds += cycle.cycleSeconds;
+            sample.secondsPerCycle = cycleSeconds / cycles.size();
+            sample.finalError = cycles.back().error;
+
+            /* the error is NAN as long as the mask is empty */
+            auto first = cycles.begin();
+            while ( first != cycles.end() and not ( first->error > 0 ) )
+                ++first;
+            if ( first != cycles.end() )
+            {
+                double const dt = cycles.back().elapsedSeconds - first->elapsedSeconds;
+                if ( dt > 0 and cycles.back().error > 0 )
+                {
+                    sample.convergenceRate = ( log10( first->error )
+                                             - log10( cycles.back().error ) ) / dt;
+                }
+            }
+        }
+        for ( auto const & target : rOptions.targets )
+        {
+            double seconds = NAN;
+            for ( auto const & cycle : cycles )
+            {
+                if ( cycle.error < target )
+                {
+                    seconds = cycle.elapsedSeconds;
+                    break;
+                }
+            }
+            sample.secondsToTarget.push_back( seconds );
+        }
+        return sample;
+    }
+
+    /**
+     * Median and quartiles, linearly interpolated. If any value is NAN, e.g.
+     * because a target wasn't reached in every repetition, all are NAN.
+     */
+    struct Summary
+    {
+        double median, q1, q3;
+    };
+
+    Summary summarize( std::vector<double> values )
+    {
+        Summary summary { NAN, NAN, NAN };
+        for ( auto const & value : values )
+        {
+            if ( std::isnan( value ) )
+                return summary;
+        }
+        if ( values.empty() )
+            return summary;
+        std::sort( values.begin(), values.end() );
+        auto const quantile = [ &values ]( double p )
+        {
+            double const x = p * ( values.size() - 1 );
+            size_t const i = (size_t) x;
+            if ( i + 1 >= values.size() )
+                return values.back();
+            return values[i] + ( x - i ) * ( values[i+1] - values[i] );
+        };
+        summary.median = quantile( 0.50 );
+        summary.q1     = quantile( 0.25 );
+        summary.q3     = quantile( 0.75 );
+        return summary;
+    }
+
+    /**
+     * Writes NAN as null, because JSON has no representation for it
+     */
+    std::string jsonNumber( double rValue )
+    {
+        if ( std::isnan( rValue ) )
+            return "null";
+        std::ostringstream number;
+        number << std::setprecision( std::numeric_limits<double>::digits10 ) << rValue;
+        return number.str();
+    }
+
+    struct ConfigurationResult
+    {
+        unsigned size;
+        std::string object;
+        double beta;
+        unsigned hioCycles;
+        double cutoff;
+        double peakMemory;
+        std::vector<RunSample> samples;
+    };
+
+    /**
+     * Extracts one measured quantity of all repetitions
+     */
+    template< class T_GETTER >
+    std::vector<double> collect
+    (
+        std::vector<RunSample> const & rSamples,
+        T_GETTER const & rGetter
+    )
+    {
+        std::vector<double> values;
+        for ( auto const & sample : rSamples )
+            values.push_back( rGetter( sample ) );
+        return values;
+    }
+
+    void writeCsv
+    (
+        std::ostream & rOut,
+        BenchmarkOptions const & rOptions,
+        std::vector<ConfigurationResult> const & rResults
+    )
+    {
+        auto const columns = []( std::ostream & out, std::string const & name )
+        {
+            out << "," << name << "Median," << name << "Q1," << name << "Q3";
+        };
+        auto const values = []( std::ostream & out, Summary const & s )
+        {
+            out << "," << s.median << "," << s.q1 << "," << s.q3;
+        };
+
+        rOut << "size,object,beta,hioCycles,cutoff,repetitions,peakMemoryMiB";
+        columns( rOut, "cycles" );
+        columns( rOut, "secondsPerCycle" );
+        columns( rOut, "totalSeconds" );
+        columns( rOut, "finalError" );
+        columns( rOut, "decadesPerSecond" );
+        for ( auto const & target : rOptions.targets )
+        {
+            std::ostringstream name;
+            name << "secondsTo" << target;
+            columns( rOut, name.str() );
+        }
+        rOut << "\n";
+
+        rOut << std::setprecision( 6 );
+        for ( auto const & result : rResults )
+        {
+            auto const & s = result.samples;
+            rOut << result.size << "," << result.object << "," << result.beta << ","
+                 << result.hioCycles << "," << result.cutoff << ","
+                 << s.size() << "," << result.peakMemory;
+            values( rOut, summarize( collect( s, []( RunSample const & x ){ return (double) x.nCycles; } ) ) );
+            values( rOut, summarize( collect( s, []( RunSample const & x ){ return x.secondsPerCycle; } ) ) );
+            values( rOut, summarize( collect( s, []( RunSample const & x ){ return x.totalSeconds; } ) ) );
+            values( rOut, summarize( collect( s, []( RunSample const & x ){ return x.finalError; } ) ) );
+            values( rOut, summarize( collect( s, []( RunSample const & x ){ return x.convergenceRate; } ) ) );
+            for ( size_t iTarget = 0; iTarget < rOptions.targets.size(); ++iTarget )
+            {
+                values( rOut, summarize( collect( s, [iTarget]( RunSample const & x )
+                    { return x.secondsToTarget[ iTarget ]; } ) ) );
+            }
+            rOut << "\n";
+        }
+    }
+
+    void writeJson
+    (
+        std::ostream & rOut,
+        BenchmarkOptions const & rOptions,
+        std::vector<ConfigurationResult> const & rResults
+    )
+    {
+        auto const summary = []( std::vector<double> const & rValues )
+        {
+            auto const s = summarize( rValues );
+            std::ostringstream json;
+            json << "{\"median\":" << jsonNumber( s.median )
+                 << ",\"q1\":"     << jsonNumber( s.q1 )
+                 << ",\"q3\":"     << jsonNumber( s.q3 ) << ",\"samples\":[";
+            for ( size_t i = 0; i < rValues.size(); ++i )
+                json << ( i > 0 ? "," : "" ) << jsonNumber( rValues[i] );
+            json << "]}";
+            return json.str();
+        };
+
+        rOut << "{\"warmup\":" << rOptions.nWarmup
+             << ",\"repetitions\":" << rOptions.nRepetitions
+             << ",\"maxCycles\":" << rOptions.nCycles
+             << ",\"threads\":" << ( rOptions.nThreads > 0 ? rOptions.nThreads : omp_get_max_threads() )
+             << ",\"numaNode\":" << rOptions.numaNode
+             << ",\"configurations\":[";
+        for ( size_t i = 0; i < rResults.size(); ++i )
+        {
+            auto const & result = rResults[i];
+            auto const & s = result.samples;
+            rOut << ( i > 0 ? "," : "" ) << "\n{"
+                 << "\"size\":" << result.size
+                 << ",\"object\":\"" << result.object << "\""
+                 << ",\"beta\":" << jsonNumber( result.beta )
+                 << ",\"hioCycles\":" << result.hioCycles
+                 << ",\"cutoff\":" << jsonNumber( result.cutoff )
+                 << ",\"peakMemoryMiB\":" << jsonNumber( result.peakMemory )
+                 << ",\"cycles\":" << summary( collect( s, []( RunSample const & x ){ return (double) x.nCycles; } ) )
+                 << ",\"secondsPerCycle\":" << summary( collect( s, []( RunSample const & x ){ return x.secondsPerCycle; } ) )
+                 << ",\"totalSeconds\":" << summary( collect( s, []( RunSample const & x ){ return x.totalSeconds; } ) )
+                 << ",\"finalError\":" << summary( collect( s, []( RunSample const & x ){ return x.finalError; } ) )
+                 << ",\"decadesPerSecond\":" << summary( collect( s, []( RunSample const & x ){ return x.convergenceRate; } ) )
+                 << ",\"secondsToTarget\":[";
+            for ( size_t iTarget = 0; iTarget < rOptions.targets.size(); ++iTarget )
+            {
+                rOut << ( iTarget > 0 ? "," : "" )
+                     << "{\"target\":" << jsonNumber( rOptions.targets[ iTarget ] )
+                     << ",\"seconds\":" << summary( collect( s, [iTarget]( RunSample const & x )
+                        { return x.secondsToTarget[ iTarget ]; } ) ) << "}";
+            }
+            rOut << "]}";
+        }
+        rOut << "\n]}\n";
+    }
+
+
+} // namespace examples
+
+
+int main( int argc, char ** argv )
+{
+    using namespace examples;
+
+    BenchmarkOptions options;
+    if ( not parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Invalid arguments. See the head of "
+                  << __FILE__ << " for the usage.\n";
+        return 1;
+    }
+    if ( options.nThreads > 0 )
+        omp_set_num_threads( options.nThreads );
+
+    std::vector<ConfigurationResult> results;
+    std::cout << std::setw(6) << "size" << std::setw(14) << "object"
+              << std::setw(6) << "beta" << std::setw(5) << "hio"
+              << std::setw(7) << "cutoff" << std::setw(8) << "cycles"
+              << std::setw(14) << "s/cycle" << std::setw(14) << "IQR"
+              << std::setw(14) << "final error" << std::setw(12) << "dec/s"
+              << std::setw(10) << "MiB" << "\n";
+    for ( auto const & n : options.sizes )
+    for ( auto const & object : options.objects )
+    {
+        auto const intensity = createIntensity( object, n );
+        for ( auto const & beta : options.betas )
+        for ( auto const & hioCycles : options.hioCycles )
+        for ( auto const & cutoff : options.cutoffs )
+        {
+            ConfigurationResult result;
+            result.size      = n;
+            result.object    = object;
+            result.beta      = beta;
+            result.hioCycles = hioCycles;
+            result.cutoff    = cutoff;
+
+            resetPeakMemory();
+            for ( unsigned i = 0; i < options.nWarmup; ++i )
+                measureRun( intensity, n, options, beta, hioCycles, cutoff );
+            for ( unsigned i = 0; i < options.nRepetitions; ++i )
+            {
+                result.samples.push_back(
+                    measureRun( intensity, n, options, beta, hioCycles, cutoff ) );
+            }
+            result.peakMemory = getPeakMemory();
+
+            auto const & s = result.samples;
+            auto const perCycle = summarize( collect( s, []( RunSample const & x ){ return x.secondsPerCycle; } ) );
+            std::cout << std::setw(6) << n << std::setw(14) << object
+                      << std::setw(6) << beta << std::setw(5) << hioCycles
+                      << std::setw(7) << cutoff
+                      << std::setw(8) << summarize( collect( s, []( RunSample const & x ){ return (double) x.nCycles; } ) ).median
+                      << std::setw(14) << perCycle.median
+                      << std::setw(14) << perCycle.q3 - perCycle.q1
+                      << std::setw(14) << summarize( collect( s, []( RunSample const & x ){ return x.finalError; } ) ).median
+                      << std::setw(12) << summarize( collect( s, []( RunSample const & x ){ return x.convergenceRate; } ) ).median
+                      << std::setw(10) << result.peakMemory << "\n" << std::flush;
+            results.push_back( result );
+        }
+    }
+
+    if ( not options.csvFile.empty() )
+    {
+        std::ofstream csv( options.csvFile );
+        writeCsv( csv, options, results );
+        if ( not csv )
+        {
+            std::cerr << "Could not write " << options.csvFile << "\n";
+            return 1;
+        }
+    }
+    if ( not options.jsonFile.empty() )
+    {
+        std::ofstream json( options.jsonFile );
+        writeJson( json, options, results );
+        if ( not json )
+        {
+            std::cerr << "Could not write " << options.jsonFile << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
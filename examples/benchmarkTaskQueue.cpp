@@ -0,0 +1,376 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Drives the task queue with synthetic diffraction intensities arriving at a
+ * given rate and reports the throughput and end-to-end latencies reached in
+ * the steady state, i.e. after a warm-up phase.
+ *
+ * Usage: benchmarkTaskQueue [--option=value ...]
+ *   --arrival=poisson|constant|bursty  arrival process (default poisson)
+ *   --rate=50        mean number of tasks submitted per second
+ *   --burst=16       tasks submitted at once by the bursty process
+ *   --warmup=5       seconds before the measurement starts
+ *   --duration=30    seconds to measure
+ *   --sizes=128,256,512  image widths and heights, chosen uniformly
+ *   --priorities=1   number of priority levels, chosen uniformly
+ *   --cycles=20      shrink-wrap cycles per task
+ *   --seed=2016      seed for the random generators
+ *   --photons=0      expected photons per frame. If > 0, the intensities are
+ *                    recorded by a simulated detector with Poisson noise,
+ *                    see examples::createTestData::simulateDetector
+ *   --beamstop=0 --saturation=0 --modules=1 --gap=0 --bin=1
+ *                    further parameters of the simulated detector
+ *   --metrics=file   periodically dump the queue metrics as JSON lines
+ */
+
+#include <algorithm>        // std::max
+#include <cmath>            // sqrtf
+#include <atomic>
+#include <chrono>
+#include <cstdint>          // uint64_t
+#include <cstdlib>          // strtod, strtoul
+#include <cstring>          // memcpy
+#include <iomanip>          // setw, setprecision
+#include <iostream>
+#include <random>           // std::mt19937, distributions
+#include <sstream>
+#include <string>
+#include <thread>           // sleep_until
+#include <utility>          // std::pair
+#include <vector>
+#include <sys/resource.h>   // getrusage
+
+#include "io/taskQueue.hpp"
+#include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
+#include "libs/latencyHistogram.hpp"
+#include "createTestData/createAtomCluster.hpp"
+#include "createTestData/createCheckerboard.hpp"
+#include "createTestData/createCircularSection.hpp"
+#include "createTestData/createRectangle.hpp"
+#include "createTestData/simulateDetector.hpp"
+
+
+namespace examples
+{
+
+
+    using Clock = std::chrono::steady_clock;
+
+    struct BenchmarkOptions
+    {
+        std::string arrival    = "poisson";
+        double rate            = 50;
+        unsigned burst         = 16;
+        double warmup          = 5;
+        double duration        = 30;
+        std::vector<unsigned> sizes { 128, 256, 512 };
+        unsigned nPriorities   = 1;
+        unsigned nCycles       = 20;
+        unsigned seed          = 2016;
+        std::string metricsFile;
+        examples::createTestData::DetectorModel detector;
+    };
+
+    /**
+     * Parses arguments of the form --key=value. Returns false on unknown
+     * arguments.
+     */
+    bool parseOptions( int argc, char ** argv, BenchmarkOptions & rOptions )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            std::string const arg = argv[i];
+            auto const iEqual = arg.find( '=' );
+            if ( arg.compare( 0, 2, "--" ) != 0 or iEqual == std::string::npos )
+                return false;
+            std::string const key   = arg.substr( 2, iEqual-2 );
+            std::string const value = arg.substr( iEqual+1 );
+
+            if      ( key == "arrival"    ) rOptions.arrival     = value;
+            else if ( key == "rate"       ) rOptions.rate        = strtod( value.c_str(), NULL );
+            else if ( key == "burst"      ) rOptions.burst       = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "warmup"     ) rOptions.warmup      = strtod( value.c_str(), NULL );
+            else if ( key == "duration"   ) rOptions.duration    = strtod( value.c_str(), NULL );
+            else if ( key == "priorities" ) rOptions.nPriorities = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "cycles"     ) rOptions.nCycles     = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "seed"       ) rOptions.seed        = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "metrics"    ) rOptions.metricsFile = value;
+            else if ( key == "photons"    ) rOptions.detector.fluence        = strtod( value.c_str(), NULL );
+            else if ( key == "beamstop"   ) rOptions.detector.beamstopRadius = strtod( value.c_str(), NULL );
+            else if ( key == "saturation" ) rOptions.detector.saturation     = strtod( value.c_str(), NULL );
+            else if ( key == "modules"    ) rOptions.detector.nModules       = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "gap"        ) rOptions.detector.gapWidth       = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "bin"        ) rOptions.detector.binning        = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "sizes" )
+            {
+                rOptions.sizes.clear();
+                std::istringstream list( value );
+                std::string size;
+                while ( std::getline( list, size, ',' ) )
+                    rOptions.sizes.push_back( strtoul( size.c_str(), NULL, 10 ) );
+            }
+            else
+                return false;
+        }
+        rOptions.detector.seed = rOptions.seed;
+        return rOptions.rate > 0 and rOptions.burst > 0 and
+               rOptions.detector.nModules > 0 and rOptions.detector.binning > 0 and
+               rOptions.nPriorities > 0 and not rOptions.sizes.empty() and
+               ( rOptions.arrival == "poisson" or rOptions.arrival == "constant"
+                 or rOptions.arrival == "bursty" );
+    }
+
+    /**
+     * Diffraction intensity of a synthetic object which is copied for every
+     * submitted task, because the reconstruction works in-place.
+     */
+    struct FrameTemplate
+    {
+        std::pair<unsigned,unsigned> size;
+        std::vector<float> intensity;
+    };
+
+    /**
+     * If the fluence of the detector model is 0, the noise-free intensities
+     * are used directly.
+     */
+    std::vector<FrameTemplate> createFrameTemplates
+    (
+        std::vector<unsigned> const & rSizes,
+        examples::createTestData::DetectorModel const & rDetector
+    )
+    {
+        using namespace examples::createTestData;
+
+        std::vector<FrameTemplate> templates;
+        for ( auto const & n : rSizes )
+        {
+            std::vector<float*> objects {
+                createAtomCluster( n, n ),
+                createCheckerboard( n, n, 0.1, 0.3, 0 ),
+                createRectangle( n, n, 0.1, 0.3, 0.5, 0.5, 0.3 ),
+                createCircularSection( n, n, 0.2 )
+            };
+            for ( auto & object : objects )
+            {
+                FrameTemplate frame;
+                frame.size = { n, n };
+                if ( rDetector.fluence > 0 )
+                {
+                    /* the detector records the centered intensity, of
+                     * which the reconstruction needs the modulus */
+                    imresh::libs::diffractionIntensity( object, frame.size, true );
+                    float * const counts = simulateDetector( object, n, n,
+                        rDetector, templates.size() );
+                    frame.size = { n / rDetector.binning, n / rDetector.binning };
+                    frame.intensity.assign( counts, counts +
+                        frame.size.first * frame.size.second );
+                    for ( auto & value : frame.intensity )
+                        value = sqrtf( value );
+                    undoFftShift( frame.intensity.data(), frame.size.first,
+                                  frame.size.second );
+                    imresh::libs::freeFrame( counts );
+                }
+                else
+                {
+                    imresh::libs::diffractionIntensity( object, frame.size );
+                    frame.intensity.assign( object, object + n*n );
+                }
+                templates.push_back( frame );
+                imresh::libs::freeFrame( object );
+            }
+        }
+        return templates;
+    }
+
+    /**
+     * Returns the consumed CPU time (user + system) in seconds
+     */
+    double getCpuTime( void )
+    {
+        struct rusage usage;
+        getrusage( RUSAGE_SELF, &usage );
+        return usage.ru_utime.tv_sec + 1e-6 * usage.ru_utime.tv_usec
+             + usage.ru_stime.tv_sec + 1e-6 * usage.ru_stime.tv_usec;
+    }
+
+    /**
+     * Returns the peak resident set size in MiB
+     */
+    double getMaxRss( void )
+    {
+        struct rusage usage;
+        getrusage( RUSAGE_SELF, &usage );
+        return usage.ru_maxrss / 1024.0;
+    }
+
+    void printLatency
+    (
+        std::string const & rName,
+        imresh::libs::LatencyHistogram const & rHistogram
+    )
+    {
+        double const nsToMs = 1e-6;
+        std::cout << std::setw(16) << rName << " [ms] : "
+                  << "p50 = "  << std::setw(9) << rHistogram.getPercentile( 50   ) * nsToMs
+                  << ", p90 = "  << std::setw(9) << rHistogram.getPercentile( 90   ) * nsToMs
+                  << ", p99 = "  << std::setw(9) << rHistogram.getPercentile( 99   ) * nsToMs
+                  << ", p99.9 = "<< std::setw(9) << rHistogram.getPercentile( 99.9 ) * nsToMs
+                  << ", max = "  << std::setw(9) << rHistogram.getMax() * nsToMs
+                  << "\n";
+    }
+
+
+} // namespace examples
+
+
+int main( int argc, char ** argv )
+{
+    using namespace examples;
+    using imresh::libs::LatencyHistogram;
+
+    BenchmarkOptions options;
+    if ( not parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Invalid arguments. See the head of "
+                  << __FILE__ << " for the usage.\n";
+        return 1;
+    }
+
+    std::cout << "Creating frame templates ...\n" << std::flush;
+    auto const templates = createFrameTemplates( options.sizes, options.detector );
+
+    imresh::io::taskQueueInit( );
+    imresh::io::taskQueueSetCancelFunc(
+        []( float * mem, std::pair<unsigned,unsigned>, std::string )
+        { imresh::libs::freeFrame( mem ); } );
+    if ( not options.metricsFile.empty() )
+        imresh::io::taskQueueStartMetricsDump( options.metricsFile, std::chrono::seconds(1) );
+
+    /* end-to-end latency, i.e. from the scheduled arrival time to the end of
+     * the write out function, of the tasks submitted while measuring */
+    LatencyHistogram latency;
+    /* how late addTask returned compared to the scheduled arrival time,
+     * i.e. the back pressure of the queue */
+    LatencyHistogram submitDelay;
+    std::atomic<uint64_t> nCompleted( 0 );
+
+    std::mt19937 randomGenerator( options.seed );
+    std::exponential_distribution<double> poissonInterval( options.rate );
+    std::uniform_int_distribution<unsigned> chooseTemplate( 0, templates.size()-1 );
+    std::uniform_int_distribution<int> choosePriority( 0, options.nPriorities-1 );
+
+    auto const toNs = []( Clock::duration const & d )
+    {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>( d ).count();
+    };
+    auto const seconds = []( double const s )
+    {
+        return std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( s ) );
+    };
+
+    auto const tStart        = Clock::now();
+    auto const tMeasureStart = tStart + seconds( options.warmup );
+    auto const tMeasureEnd   = tMeasureStart + seconds( options.duration );
+
+    std::cout << "Submitting tasks (" << options.arrival << ", "
+              << options.rate << " tasks/s) ...\n" << std::flush;
+
+    uint64_t nSubmitted = 0;
+    uint64_t nCompletedAtStart = 0;
+    double cpuTimeAtStart = 0;
+    bool measuring = false;
+    auto tArrival = tStart;
+    while ( tArrival < tMeasureEnd )
+    {
+        std::this_thread::sleep_until( tArrival );
+        if ( not measuring and tArrival >= tMeasureStart )
+        {
+            measuring = true;
+            nCompletedAtStart = nCompleted;
+            cpuTimeAtStart = getCpuTime();
+        }
+
+        unsigned const nTasks = options.arrival == "bursty" ? options.burst : 1;
+        for ( unsigned i = 0; i < nTasks; ++i )
+        {
+            auto const & frame = templates[ chooseTemplate( randomGenerator ) ];
+            auto const nElements = frame.size.first * frame.size.second;
+            float * const data = imresh::libs::allocateFrame( nElements );
+            memcpy( data, frame.intensity.data(), nElements * sizeof( data[0] ) );
+
+            bool const measured = measuring;
+            auto const writeOut = [ tArrival, measured, &latency, &nCompleted, toNs ]
+                ( float * mem, std::pair<unsigned,unsigned>, std::string )
+            {
+                imresh::libs::freeFrame( mem );
+                if ( measured )
+                    latency.record( toNs( Clock::now() - tArrival ) );
+                ++nCompleted;
+            };
+
+            if ( not imresh::io::addTask( data, frame.size, writeOut, "",
+                    options.nCycles, 20, 1e-5, 0.9, 0.04, 0.2, 3.0, 0.01,
+                    choosePriority( randomGenerator ) ) )
+            {
+                imresh::libs::freeFrame( data );
+            }
+            ++nSubmitted;
+            if ( measuring )
+                submitDelay.record( toNs( Clock::now() - tArrival ) );
+        }
+
+        if ( options.arrival == "poisson" )
+            tArrival += seconds( poissonInterval( randomGenerator ) );
+        else
+            tArrival += seconds( nTasks / options.rate );
+    }
+
+    /* throughput in the steady state, i.e. while tasks were still arriving */
+    auto const tSubmitEnd = Clock::now();
+    uint64_t const nCompletedMeasured = nCompleted - nCompletedAtStart;
+    double const measuredTime = std::chrono::duration<double>( tSubmitEnd - tMeasureStart ).count();
+    double const cpuTime = getCpuTime() - cpuTimeAtStart;
+    auto const metrics = imresh::io::taskQueueGetMetrics();
+
+    imresh::io::taskQueueDrain( );
+    imresh::io::taskQueueStopMetricsDump( );
+    imresh::io::taskQueueDeinit( );
+
+    std::cout << "\n"
+              << "submitted tasks       : " << nSubmitted << "\n"
+              << "offered load          : " << options.rate << " tasks/s\n"
+              << "steady state throughput: " << nCompletedMeasured / std::max( measuredTime, 1e-9 ) << " tasks/s\n"
+              << "CPU utilization       : " << cpuTime / std::max( measuredTime, 1e-9 ) << " cores\n"
+              << "peak resident memory  : " << getMaxRss() << " MiB\n"
+              << "queue memory reserved : " << metrics.memoryReserved / 1024.0 / 1024.0 << " MiB\n"
+              << "queue depth at end    : " << metrics.queueDepth << "\n";
+    printLatency( "end-to-end", latency );
+    printLatency( "submit delay", submitDelay );
+    std::cout << "queue metrics: " << imresh::io::toJson( metrics ) << "\n";
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>  // uint64_t
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    /**
+     * Finalizer of SplitMix64, which maps consecutive integers to
+     * statistically independent ones
+     *
+     * The functions in this file are inline, because they are called per
+     * pixel.
+     **/
+    inline uint64_t mixBits( uint64_t x )
+    {
+        x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+        return x ^ ( x >> 31 );
+    }
+
+    /**
+     * Returns the key of an independent random stream, e.g. of one frame
+     * of a dataset.
+     **/
+    inline uint64_t counterStream( uint64_t const rSeed, uint64_t const rStream )
+    {
+        return mixBits( rSeed ^ mixBits( rStream ) );
+    }
+
+    /**
+     * Counter-based random number generator: the rCounter-th uniform number
+     * in (0,1) of the stream rKey. As there is no state, random numbers can
+     * be drawn in parallel and in any order reproducibly.
+     **/
+    inline double counterUniform( uint64_t const rKey, uint64_t const rCounter )
+    {
+        uint64_t const bits = mixBits( rKey + ( rCounter + 1 ) * 0x9E3779B97F4A7C15ull );
+        return ( ( bits >> 11 ) + 0.5 ) * ( 1.0 / ( uint64_t( 1 ) << 53 ) );
+    }
+
+
+} // namespace createTestData
+} // namespace examples
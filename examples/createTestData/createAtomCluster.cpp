@@ -25,12 +25,14 @@
 
 #include "createAtomCluster.hpp"
 
+#include <algorithm>  // std::fill
 #include <iostream>
 #include <vector>
 #include <cassert>
-#include <cstdlib>  // srand, RAND_MAX, rand
-#include <cmath>    // fmin, sqrtf, max
+#include <cmath>    // fmin, sqrtf, max, cos, sin
+#include "libs/frameBuffer.hpp"   // allocateFrame
 #include "libs/gaussian.hpp"
+#include "counterRandom.hpp"
 
 
 namespace examples
@@ -45,23 +47,31 @@ namespace createTestData
     float * createAtomCluster
     (
         const unsigned & Nx,
-        const unsigned & Ny
+        const unsigned & Ny,
+        const float & phi,
+        const float & dx,
+        const float & dy
     )
     {
         assert( Nx > 0 and Ny );
 
         const unsigned nElements = Nx * Ny;
-        float * data = new float[nElements];
+        float * data = imresh::libs::allocateFrame( nElements );
 
-        /* Add random background noise and blur it, so that it isn't pixelwise */
-        srand(4628941);
+        /* Add random background noise and blur it, so that it isn't pixelwise.
+         * The counter-based generator keeps this thread-safe. */
         const float noiseAmplitude = 0.00;
-        for ( unsigned i = 0; i < nElements; ++i )
-            data[i] = 0.7*noiseAmplitude * rand() / (float) RAND_MAX;
-        imresh::libs::gaussianBlur( data, Nx, Ny, 1.5 /*sigma in pixels*/ );
-        /* add more fine grained noise in a second step */
-        for ( unsigned i = 0; i < nElements; ++i )
-            data[i] += 0.3*noiseAmplitude * rand() / (float) RAND_MAX;
+        std::fill( data, data + nElements, 0.0f );
+        if ( noiseAmplitude > 0 )
+        {
+            const uint64_t noiseKey = counterStream( 4628941, 0 );
+            for ( unsigned i = 0; i < nElements; ++i )
+                data[i] = 0.7*noiseAmplitude * counterUniform( noiseKey, i );
+            imresh::libs::gaussianBlur( data, Nx, Ny, 1.5 /*sigma in pixels*/ );
+            /* add more fine grained noise in a second step */
+            for ( unsigned i = 0; i < nElements; ++i )
+                data[i] += 0.3*noiseAmplitude * counterUniform( noiseKey, nElements + i );
+        }
 
         /* choose a radious, so that the atom cluster will fit into the image
          * and will fill it pretty well */
@@ -70,7 +80,7 @@ namespace createTestData
         #else
             const float atomRadius = 1.6;
         #endif
-        #ifndef NDEBUG
+        #ifdef IMRESH_DEBUG
             std::cout << "atomRadius = "<<atomRadius<<" px\n";
         #endif
         /* The centers are given as offsets in multiplies of 2*atomradius
@@ -120,12 +130,18 @@ namespace createTestData
         /* spherical intensity function */
         auto f = []( float r ) { return std::abs(r) < 1.0f ? 1.0f - pow(r,6)
                                                            : 0.0f; };
-        float x = 0;
-        float y = 0;
+        const float cx = 0.5f*Nx;
+        const float cy = 0.5f*Ny;
+        const float cosPhi = std::cos( phi );
+        const float sinPhi = std::sin( phi );
+        float x0 = 0;
+        float y0 = 0;
         for ( auto r : atomCenters )
         {
-            x += r[0] * 2*atomRadius;
-            y += r[1] * 2*atomRadius;
+            x0 += r[0] * 2*atomRadius;
+            y0 += r[1] * 2*atomRadius;
+            const float x = cx + dx*Nx + cosPhi*(x0-cx) - sinPhi*(y0-cy);
+            const float y = cy + dy*Ny + sinPhi*(x0-cx) + cosPhi*(y0-cy);
 
             int ix0 = std::max( (int) 0   , (int) floor(x-atomRadius)-1 );
             int ix1 = std::min( (int) Nx-1, (int) ceil (x+atomRadius)+1 );
@@ -36,12 +36,19 @@ namespace createTestData
      * Create a sample data of two atom clusters
      *
      * @param[in] rSize image dimensions
-     * @return pointer to allocated data. Must be deallocated with delete[]
+     * @param[in] phi rotates the clusters by this angle in radian around the
+     *            image center
+     * @param[in] dx,dy shift the clusters by these fractions of Nx and Ny.
+     *            The defaults give the same clusters as always.
+     * @return pointer to allocated data. Must be deallocated with imresh::libs::freeFrame
      **/
     float* createAtomCluster
     (
         const unsigned & Nx,
-        const unsigned & Ny
+        const unsigned & Ny,
+        const float & phi = 0,
+        const float & dx  = 0,
+        const float & dy  = 0
     );
 
 
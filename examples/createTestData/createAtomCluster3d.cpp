@@ -0,0 +1,128 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "createAtomCluster3d.hpp"
+
+#include <algorithm>  // std::min, std::max
+#include <array>
+#include <cassert>
+#include <cmath>      // sqrt, cos, sin, floor, ceil
+#include <cstddef>    // size_t
+#include <vector>
+#include "libs/frameBuffer.hpp"   // allocateFrame
+#include "counterRandom.hpp"
+
+#ifndef M_PI
+#   define M_PI 3.141592653589793238462643383279502884
+#endif
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    float * createAtomCluster3d
+    (
+        const unsigned & Nx,
+        const unsigned & Ny,
+        const unsigned & Nz,
+        const unsigned & nAtoms,
+        const float & atomRadius,
+        const uint64_t & seed
+    )
+    {
+        assert( Nx > 0 and Ny > 0 and Nz > 0 );
+
+        const float Nmin = std::min( Nx, std::min( Ny, Nz ) );
+        const float radius = atomRadius > 0 ? atomRadius
+                           : std::max( 1.5f, 0.02f * Nmin );
+        const float N[3] = { float( Nx ), float( Ny ), float( Nz ) };
+
+        /* place the atoms, this is cheap compared to rendering */
+        const uint64_t key = counterStream( seed, 0 );
+        uint64_t counter = 0;
+        std::vector< std::array<float,3> > atoms;
+        atoms.reserve( nAtoms );
+        if ( nAtoms > 0 )
+            atoms.push_back( {{ 0.5f*Nx, 0.5f*Ny, 0.5f*Nz }} );
+        while ( atoms.size() < nAtoms )
+        {
+            const unsigned iParent = std::min< size_t >( atoms.size() - 1,
+                atoms.size() * counterUniform( key, counter++ ) );
+            /* uniformly distributed direction */
+            const float cosTheta = 2 * counterUniform( key, counter++ ) - 1;
+            const float sinTheta = sqrt( 1 - cosTheta*cosTheta );
+            const float phi = 2 * M_PI * counterUniform( key, counter++ );
+            const float direction[3] = { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+
+            std::array<float,3> atom = atoms[ iParent ];
+            for ( unsigned k = 0; k < 3; ++k )
+            {
+                atom[k] += 2 * radius * direction[k];
+                /* reflect at the border, so the atoms stay inside */
+                if ( atom[k] < radius )
+                    atom[k] = std::min( N[k] - 1 - radius, 2 * radius - atom[k] );
+                if ( atom[k] > N[k] - 1 - radius )
+                    atom[k] = std::max( radius, 2 * ( N[k] - 1 - radius ) - atom[k] );
+            }
+            atoms.push_back( atom );
+        }
+
+        float * data = imresh::libs::allocateFrame( size_t( Nx ) * Ny * Nz );
+
+        /* spherical intensity function like in createAtomCluster */
+        auto f = []( float r2 ) { return r2 < 1.0f ? 1.0f - r2*r2*r2 : 0.0f; };
+
+        #pragma omp parallel for schedule( dynamic )
+        for ( unsigned iz = 0; iz < Nz; ++iz )
+        {
+            float * const slab = data + size_t( iz ) * Nx * Ny;
+            std::fill( slab, slab + size_t( Nx ) * Ny, 0.0f );
+            for ( auto const & atom : atoms )
+            {
+                const float dz = ( iz - atom[2] ) / radius;
+                if ( dz*dz >= 1 )
+                    continue;
+                const int ix0 = std::max( 0      , (int) floor( atom[0] - radius ) );
+                const int ix1 = std::min( (int) Nx, (int) ceil ( atom[0] + radius ) + 1 );
+                const int iy0 = std::max( 0      , (int) floor( atom[1] - radius ) );
+                const int iy1 = std::min( (int) Ny, (int) ceil ( atom[1] + radius ) + 1 );
+                for ( int iy = iy0; iy < iy1; ++iy )
+                for ( int ix = ix0; ix < ix1; ++ix )
+                {
+                    const float dx = ( ix - atom[0] ) / radius;
+                    const float dy = ( iy - atom[1] ) / radius;
+                    float & voxel = slab[ size_t( iy ) * Nx + ix ];
+                    voxel = std::min( 1.0f, voxel + f( dx*dx + dy*dy + dz*dz ) );
+                }
+            }
+        }
+
+        return data;
+    }
+
+
+} // namespace createTestData
+} // namespace examples
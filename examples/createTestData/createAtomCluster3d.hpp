@@ -0,0 +1,63 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>  // uint64_t
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    /**
+     * Create a volume with a cluster of spherical atoms, the 3D counterpart
+     * of createAtomCluster
+     *
+     * Starting at the center, every further atom is attached in a random
+     * direction to a randomly chosen atom placed before, which yields a
+     * compact, irregular cluster. The positions are drawn from a
+     * counter-based random stream, so the result only depends on the seed.
+     * Afterwards the slabs of constant z are rendered in parallel. The voxel
+     * (ix,iy,iz) is stored at ( iz*Ny + iy )*Nx + ix.
+     *
+     * @param[in] nAtoms number of atoms
+     * @param[in] atomRadius in voxels. 0 chooses 2% of the smallest
+     *            dimension, but at least 1.5 voxels
+     * @return pointer to allocated data. Must be deallocated with imresh::libs::freeFrame
+     **/
+    float * createAtomCluster3d
+    (
+        const unsigned & Nx,
+        const unsigned & Ny,
+        const unsigned & Nz,
+        const unsigned & nAtoms = 200,
+        const float & atomRadius = 0,
+        const uint64_t & seed = 0
+    );
+
+
+} // namespace createTestData
+} // namespace examples
@@ -0,0 +1,93 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "createBox3d.hpp"
+
+#include <cassert>
+#include <cstddef>  // size_t
+#include "rotateCoordinates.hpp"
+#include "libs/frameBuffer.hpp"   // allocateFrame
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    float * createBox3d
+    (
+        unsigned const & Nx,
+        unsigned const & Ny,
+        unsigned const & Nz,
+        float    const & Dx,
+        float    const & Dy,
+        float    const & Dz,
+        float    const & x0,
+        float    const & y0,
+        float    const & z0,
+        float    const & phi,
+        float    const & theta,
+        float    const & psi
+    )
+    {
+        assert( 0.0f <= Dx and Dx <= 1.0f );
+        assert( 0.0f <= Dy and Dy <= 1.0f );
+        assert( 0.0f <= Dz and Dz <= 1.0f );
+        assert( 0.0f <= x0 and x0 <= 1.0f );
+        assert( 0.0f <= y0 and y0 <= 1.0f );
+        assert( 0.0f <= z0 and z0 <= 1.0f );
+
+        float * data = imresh::libs::allocateFrame( size_t( Nx ) * Ny * Nz );
+
+        const float xLow  = ( x0 - Dx/2 ) * Nx;
+        const float xHigh = ( x0 + Dx/2 ) * Nx;
+        const float yLow  = ( y0 - Dy/2 ) * Ny;
+        const float yHigh = ( y0 + Dy/2 ) * Ny;
+        const float zLow  = ( z0 - Dz/2 ) * Nz;
+        const float zHigh = ( z0 + Dz/2 ) * Nz;
+
+        float rotation[9];
+        calcRotationMatrix3d( rotation, phi, theta, psi );
+
+        #pragma omp parallel for schedule( static )
+        for ( unsigned iz = 0; iz < Nz; ++iz )
+        {
+            float * const slab = data + size_t( iz ) * Nx * Ny;
+            for ( unsigned iy = 0; iy < Ny; ++iy )
+            for ( unsigned ix = 0; ix < Nx; ++ix )
+            {
+                float x = ix, y = iy, z = iz;
+                rotateCoordinates3d( x,y,z, x0*Nx, y0*Ny, z0*Nz, rotation );
+                slab[iy*Nx + ix] = x >= xLow and x <= xHigh and
+                                   y >= yLow and y <= yHigh and
+                                   z >= zLow and z <= zHigh;
+            }
+        }
+
+        return data;
+    }
+
+
+} // namespace createTestData
+} // namespace examples
@@ -27,6 +27,7 @@
 
 #include <cmath>   // ceil
 #include "rotateCoordinates.hpp"
+#include "libs/frameBuffer.hpp"   // allocateFrame
 
 
 namespace examples
@@ -44,7 +45,7 @@ namespace createTestData
         float    const & phi
     )
     {
-        float * data = new float[ Nx*Ny ];
+        float * data = imresh::libs::allocateFrame( Nx*Ny );
 
         for ( unsigned iy = 0; iy < Ny; ++iy )
         for ( unsigned ix = 0; ix < Nx; ++ix )
@@ -49,7 +49,7 @@ namespace createTestData
      * @param[in] Dx width  of the rectangles (percentage of Nx) 0 <= Dx <= 1
      * @param[in] Dy height of the rectangles (percentage of Ny) 0 <= Dy <= 1
      * @param[in] phi can be used to rotate the whole pattern
-     * @return pointer to allocated data. Must be deallocated with delete[]
+     * @return pointer to allocated data. Must be deallocated with imresh::libs::freeFrame
      **/
     float * createCheckerboard
     (
@@ -27,6 +27,7 @@
 
 #include <cmath>    // atan2
 #include <cassert>
+#include "libs/frameBuffer.hpp"   // allocateFrame
 
 #ifndef M_PI
 #   define M_PI 3.141592653589793238462643383279502884
@@ -55,7 +56,7 @@ namespace createTestData
         assert( 0.0f <= y0 and y0 <= 1.0f );
         assert( phi0 <= phi1 );
 
-        float * data = new float[ Nx*Ny ];
+        float * data = imresh::libs::allocateFrame( Nx*Ny );
         const unsigned Nmin = ( Nx < Ny ) ? Nx : Ny;
 
         for ( unsigned iy = 0; iy < Ny; ++iy )
@@ -49,7 +49,7 @@ namespace createTestData
      * @param[in] y0 position of circle in relativ coordinates
      * @param[in] Dy height of the slit (percentage of Ny) 0 <= Dy <= 1
      * @param[in] phi can be used to rotate the whole rectangle
-     * @return pointer to allocated data. Must be deallocated with delete[]
+     * @return pointer to allocated data. Must be deallocated with imresh::libs::freeFrame
      **/
     float * createCircularSection
     (
@@ -27,6 +27,7 @@
 
 #include <cassert>
 #include "rotateCoordinates.hpp"
+#include "libs/frameBuffer.hpp"   // allocateFrame
 
 
 namespace examples
@@ -51,7 +52,7 @@ namespace createTestData
         assert( 0.0f <= x0 and x0 <= 1.0f );
         assert( 0.0f <= y0 and y0 <= 1.0f );
 
-        float * data = new float[ Nx*Ny ];
+        float * data = imresh::libs::allocateFrame( Nx*Ny );
 
         const int yLow  = ( y0 - Dy/2 ) * Ny;
         const int yHigh = ( y0 + Dy/2 ) * Ny;
@@ -54,7 +54,7 @@ namespace createTestData
      * @param[in] x0 center of rectangle in relative coordinates
      * @param[in] y0 center of rectangle in relative coordinates
      * @param[in] phi can be used to rotate the whole rectangle
-     * @return pointer to allocated data. Must be deallocated with delete[]
+     * @return pointer to allocated data. Must be deallocated with imresh::libs::freeFrame
      **/
     float * createRectangle
     (
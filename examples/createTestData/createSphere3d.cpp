@@ -0,0 +1,78 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "createSphere3d.hpp"
+
+#include <algorithm>  // std::min
+#include <cassert>
+#include <cstddef>    // size_t
+#include "libs/frameBuffer.hpp"   // allocateFrame
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    float * createSphere3d
+    (
+        unsigned const & Nx,
+        unsigned const & Ny,
+        unsigned const & Nz,
+        float    const & rOuter,
+        float    const & rInner,
+        float    const & x0,
+        float    const & y0,
+        float    const & z0
+    )
+    {
+        assert( 0.0f <= rInner and rInner <= rOuter );
+
+        float * data = imresh::libs::allocateFrame( size_t( Nx ) * Ny * Nz );
+        const unsigned Nmin = std::min( Nx, std::min( Ny, Nz ) );
+
+        #pragma omp parallel for schedule( static )
+        for ( unsigned iz = 0; iz < Nz; ++iz )
+        {
+            float * const slab = data + size_t( iz ) * Nx * Ny;
+            const float z = (float) iz / Nmin - z0;
+            for ( unsigned iy = 0; iy < Ny; ++iy )
+            {
+                const float y = (float) iy / Nmin - y0;
+                #pragma omp simd
+                for ( unsigned ix = 0; ix < Nx; ++ix )
+                {
+                    const float x = (float) ix / Nmin - x0;
+                    const float r2 = x*x + y*y + z*z;
+                    slab[iy*Nx + ix] = r2 <= rOuter*rOuter and r2 >= rInner*rInner;
+                }
+            }
+        }
+
+        return data;
+    }
+
+
+} // namespace createTestData
+} // namespace examples
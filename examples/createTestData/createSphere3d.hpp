@@ -0,0 +1,63 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    /**
+     * Create a volume with a sphere or spherical shell valued 1.0, the 3D
+     * counterpart of createCircularSection
+     *
+     * Radii and center are relative to the smallest dimension, like in
+     * createCircularSection. The slabs of constant z are generated in
+     * parallel. The voxel (ix,iy,iz) is stored at ( iz*Ny + iy )*Nx + ix.
+     *
+     * @param[in] Nx width  of the test volume to produce
+     * @param[in] Ny height of the test volume to produce
+     * @param[in] Nz depth  of the test volume to produce
+     * @param[in] rOuter outer radius
+     * @param[in] rInner inner radius, 0 for a full sphere
+     * @param[in] x0,y0,z0 center in relative coordinates
+     * @return pointer to allocated data. Must be deallocated with imresh::libs::freeFrame
+     **/
+    float * createSphere3d
+    (
+        unsigned const & Nx,
+        unsigned const & Ny,
+        unsigned const & Nz,
+        float    const & rOuter,
+        float    const & rInner = 0,
+        float    const & x0 = 0.5,
+        float    const & y0 = 0.5,
+        float    const & z0 = 0.5
+    );
+
+
+} // namespace createTestData
+} // namespace examples
@@ -48,6 +48,66 @@ namespace createTestData
         y = yCenter + sin(phi) * xTmp + cos(phi) * yTmp;
     }
 
+    void calcRotationMatrix3d
+    (
+        float (& rMatrix)[9],
+        float const & phi,
+        float const & theta,
+        float const & psi
+    )
+    {
+        float const cz = cos(phi  ), sz = sin(phi  );
+        float const cy = cos(theta), sy = sin(theta);
+        float const cx = cos(psi  ), sx = sin(psi  );
+        /* R = Rx(psi) * Ry(theta) * Rz(phi) */
+        rMatrix[0] =  cy*cz;
+        rMatrix[1] = -cy*sz;
+        rMatrix[2] =  sy;
+        rMatrix[3] =  sx*sy*cz + cx*sz;
+        rMatrix[4] = -sx*sy*sz + cx*cz;
+        rMatrix[5] = -sx*cy;
+        rMatrix[6] = -cx*sy*cz + sx*sz;
+        rMatrix[7] =  cx*sy*sz + sx*cz;
+        rMatrix[8] =  cx*cy;
+    }
+
+    void rotateCoordinates3d
+    (
+        float & x,
+        float & y,
+        float & z,
+        float const & xCenter,
+        float const & yCenter,
+        float const & zCenter,
+        float const (& rMatrix)[9]
+    )
+    {
+        float const xTmp = x - xCenter;
+        float const yTmp = y - yCenter;
+        float const zTmp = z - zCenter;
+        x = xCenter + rMatrix[0] * xTmp + rMatrix[1] * yTmp + rMatrix[2] * zTmp;
+        y = yCenter + rMatrix[3] * xTmp + rMatrix[4] * yTmp + rMatrix[5] * zTmp;
+        z = zCenter + rMatrix[6] * xTmp + rMatrix[7] * yTmp + rMatrix[8] * zTmp;
+    }
+
+    void rotateCoordinates3d
+    (
+        float & x,
+        float & y,
+        float & z,
+        float const & xCenter,
+        float const & yCenter,
+        float const & zCenter,
+        float const & phi,
+        float const & theta,
+        float const & psi
+    )
+    {
+        float matrix[9];
+        calcRotationMatrix3d( matrix, phi, theta, psi );
+        rotateCoordinates3d( x, y, z, xCenter, yCenter, zCenter, matrix );
+    }
+
 
 } // namespace createTestData
 } // namespace examples
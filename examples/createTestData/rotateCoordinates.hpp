@@ -40,5 +40,49 @@ namespace createTestData
         float const & phi
     );
 
+    /**
+     * Rotates a point around the z axis by phi, then around the y axis by
+     * theta and then around the x axis by psi, all relative to the center
+     **/
+    void rotateCoordinates3d
+    (
+        float & x,
+        float & y,
+        float & z,
+        float const & xCenter,
+        float const & yCenter,
+        float const & zCenter,
+        float const & phi,
+        float const & theta,
+        float const & psi
+    );
+
+    /**
+     * Calculates the row-major matrix of the rotation of
+     * rotateCoordinates3d, so that the sines and cosines aren't evaluated
+     * again for every voxel of a volume
+     **/
+    void calcRotationMatrix3d
+    (
+        float (& rMatrix)[9],
+        float const & phi,
+        float const & theta,
+        float const & psi
+    );
+
+    /**
+     * @see rotateCoordinates3d, using a matrix of calcRotationMatrix3d
+     **/
+    void rotateCoordinates3d
+    (
+        float & x,
+        float & y,
+        float & z,
+        float const & xCenter,
+        float const & yCenter,
+        float const & zCenter,
+        float const (& rMatrix)[9]
+    );
+
 } // namespace createTestData
 } // namespace examples
@@ -0,0 +1,204 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "simulateDetector.hpp"
+
+#include <algorithm>  // std::min, std::max
+#include <cassert>
+#include <cmath>      // exp, log, sqrt, cos, floor
+#include "libs/frameBuffer.hpp"   // allocateFrame
+#include "counterRandom.hpp"
+
+#ifndef M_PI
+#   define M_PI 3.141592653589793238462643383279502884
+#endif
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    /**
+     * Draws from a Poisson distribution by inversion for small expectations
+     * and from its normal approximation for large ones.
+     **/
+    float samplePoisson( double const rLambda, uint64_t const rKey )
+    {
+        if ( not ( rLambda > 0 ) )
+            return 0;
+        if ( rLambda < 32 )
+        {
+            double const u = counterUniform( rKey, 0 );
+            double p = exp( -rLambda );
+            double cdf = p;
+            unsigned k = 0;
+            /* the limit only guards against rounding of the cdf */
+            while ( u > cdf and k < 256 )
+            {
+                ++k;
+                p *= rLambda / k;
+                cdf += p;
+            }
+            return k;
+        }
+        double const z = sqrt( -2 * log( counterUniform( rKey, 0 ) ) ) *
+                         cos( 2 * M_PI * counterUniform( rKey, 1 ) );
+        return std::max( 0.0, floor( rLambda + sqrt( rLambda ) * z + 0.5 ) );
+    }
+
+    /**
+     * Missing pixels in the full resolution, 1 if missing
+     **/
+    std::vector<uint8_t> createMissingPixels
+    (
+        const unsigned & Nx,
+        const unsigned & Ny,
+        DetectorModel const & rModel
+    )
+    {
+        assert( rModel.nModules > 0 );
+        std::vector<uint8_t> missing( size_t( Nx ) * Ny, 0 );
+
+        /* pixels beyond the last whole module belong to no module */
+        auto const isGap = [&rModel]( unsigned i, unsigned n )
+        {
+            if ( rModel.nModules < 2 or rModel.gapWidth == 0 )
+                return false;
+            unsigned const moduleWidth = ( n - std::min( n,
+                ( rModel.nModules - 1 ) * rModel.gapWidth ) ) / rModel.nModules;
+            unsigned const period = moduleWidth + rModel.gapWidth;
+            return i / period >= rModel.nModules or i % period >= moduleWidth;
+        };
+
+        float const r2 = rModel.beamstopRadius * rModel.beamstopRadius;
+        #pragma omp parallel for
+        for ( unsigned iy = 0; iy < Ny; ++iy )
+        for ( unsigned ix = 0; ix < Nx; ++ix )
+        {
+            float const dx = float( ix ) - Nx/2;
+            float const dy = float( iy ) - Ny/2;
+            missing[ size_t( iy ) * Nx + ix ] = dx*dx + dy*dy < r2 or
+                                                isGap( ix, Nx ) or isGap( iy, Ny );
+        }
+        return missing;
+    }
+
+    std::vector<uint8_t> createDetectorMask
+    (
+        const unsigned & Nx,
+        const unsigned & Ny,
+        DetectorModel const & rModel
+    )
+    {
+        assert( rModel.binning > 0 );
+        unsigned const b  = rModel.binning;
+        unsigned const nx = Nx / b;
+        unsigned const ny = Ny / b;
+
+        auto const missing = createMissingPixels( Nx, Ny, rModel );
+        std::vector<uint8_t> mask( size_t( nx ) * ny, 0 );
+        for ( unsigned iy = 0; iy < ny * b; ++iy )
+        for ( unsigned ix = 0; ix < nx * b; ++ix )
+        {
+            if ( missing[ size_t( iy ) * Nx + ix ] )
+                mask[ size_t( iy / b ) * nx + ix / b ] = 1;
+        }
+        return mask;
+    }
+
+    float * simulateDetector
+    (
+        float const * const & rModulus,
+        const unsigned & Nx,
+        const unsigned & Ny,
+        DetectorModel const & rModel,
+        uint64_t const & rFrameIndex
+    )
+    {
+        assert( rModel.binning > 0 );
+        unsigned const b  = rModel.binning;
+        unsigned const nx = Nx / b;
+        unsigned const ny = Ny / b;
+        size_t const nElements = size_t( Nx ) * Ny;
+
+        auto const missing = createMissingPixels( Nx, Ny, rModel );
+
+        double scale = 1;
+        if ( rModel.fluence > 0 )
+        {
+            double sum = 0;
+            #pragma omp parallel for reduction( + : sum )
+            for ( size_t i = 0; i < nElements; ++i )
+                sum += double( rModulus[i] ) * rModulus[i];
+            scale = sum > 0 ? rModel.fluence / sum : 0;
+        }
+
+        uint64_t const frameKey = counterStream( rModel.seed, rFrameIndex );
+        float * const data = imresh::libs::allocateFrame( size_t( nx ) * ny );
+        /* each output row only depends on its b input rows */
+        #pragma omp parallel for schedule( static )
+        for ( unsigned oy = 0; oy < ny; ++oy )
+        {
+            float * const row = data + size_t( oy ) * nx;
+            std::fill( row, row + nx, 0.0f );
+            for ( unsigned iy = oy * b; iy < ( oy + 1 ) * b; ++iy )
+            for ( unsigned ix = 0; ix < nx * b; ++ix )
+            {
+                size_t const i = size_t( iy ) * Nx + ix;
+                if ( missing[i] )
+                    continue;
+                double const expected = scale * rModulus[i] * rModulus[i];
+                float counts = rModel.fluence > 0 ?
+                    samplePoisson( expected, frameKey + i * 0xD1B54A32D192ED03ull )
+                    : float( expected );
+                if ( rModel.saturation > 0 )
+                    counts = std::min( counts, rModel.saturation );
+                row[ ix / b ] += counts;
+            }
+        }
+        return data;
+    }
+
+    void undoFftShift
+    (
+        float * const & rData,
+        const unsigned & Nx,
+        const unsigned & Ny
+    )
+    {
+        /* the centered index of frequency k is ( k + N/2 ) % N */
+        std::vector<float> centered( rData, rData + size_t( Nx ) * Ny );
+        #pragma omp parallel for schedule( static )
+        for ( unsigned ky = 0; ky < Ny; ++ky )
+        {
+            float const * const row = centered.data() + size_t( ( ky + Ny/2 ) % Ny ) * Nx;
+            for ( unsigned kx = 0; kx < Nx; ++kx )
+                rData[ size_t( ky ) * Nx + kx ] = row[ ( kx + Nx/2 ) % Nx ];
+        }
+    }
+
+
+} // namespace createTestData
+} // namespace examples
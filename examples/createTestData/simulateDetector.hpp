@@ -0,0 +1,126 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>  // uint8_t, uint64_t
+#include <vector>
+
+
+namespace examples
+{
+namespace createTestData
+{
+
+
+    /**
+     * Parameters of the forward model of simulateDetector
+     **/
+    struct DetectorModel
+    {
+        /** expected number of photons in the whole frame. 0 disables the
+         *  photon noise, i.e. the frame is the scaled expectation itself */
+        float fluence;
+        /** pixels closer than this to the frame center are missing */
+        float beamstopRadius;
+        /** counts per pixel are clipped to this, 0 disables saturation */
+        float saturation;
+        /** the detector consists of nModules x nModules modules which are
+         *  separated by gapWidth missing pixels */
+        unsigned nModules;
+        unsigned gapWidth;
+        /** N, i.e. N x N pixels are summed into one. The frame is cropped
+         *  to multiples of N. */
+        unsigned binning;
+        /** together with the frame index it determines the noise */
+        uint64_t seed;
+
+        DetectorModel( void )
+        : fluence( 0 ), beamstopRadius( 0 ), saturation( 0 ), nModules( 1 ),
+          gapWidth( 0 ), binning( 1 ), seed( 0 ) {}
+    };
+
+    /**
+     * Returns the missing pixels of the detector, i.e. the beamstop and the
+     * module gaps, in the resolution of the frames of simulateDetector.
+     *
+     * @return 1 for missing (binned) pixels, else 0. A bin is missing if any
+     *         of its pixels is, because its sum is too low.
+     **/
+    std::vector<uint8_t> createDetectorMask
+    (
+        const unsigned & Nx,
+        const unsigned & Ny,
+        DetectorModel const & rModel
+    );
+
+    /**
+     * Simulates the frame a detector records for the given diffraction
+     * pattern.
+     *
+     * The squared modulus is scaled to the fluence and Poisson distributed
+     * photon counts are drawn for each pixel. Then saturation is applied,
+     * missing pixels are set to 0 and the pixels are binned.
+     *
+     * The random numbers are generated from a counter-based generator keyed
+     * with the seed, frame index and pixel index. So the rows are simulated
+     * in parallel and the result doesn't depend on the number of threads or
+     * the order in which frames are simulated.
+     *
+     * Layout: the input and the returned counts are centered, i.e. the
+     * zero frequency is at ( Nx/2, Ny/2 ), so that the beamstop covers the
+     * central scatter. shrinkWrap and the task queue expect the unshifted
+     * layout with the zero frequency at (0,0), so the counts (or their
+     * square root) have to be passed through undoFftShift before being
+     * reconstructed.
+     *
+     * @param[in] rModulus centered diffraction pattern, e.g. the result of
+     *            imresh::libs::diffractionIntensity with fftshift
+     * @param[in] rFrameIndex selects independent noise for each frame
+     * @return photon counts of ( Nx / binning ) x ( Ny / binning ) pixels.
+     *         Must be deallocated with imresh::libs::freeFrame
+     **/
+    float * simulateDetector
+    (
+        float const * const & rModulus,
+        const unsigned & Nx,
+        const unsigned & Ny,
+        DetectorModel const & rModel,
+        uint64_t const & rFrameIndex = 0
+    );
+
+    /**
+     * Moves the zero frequency of a centered frame from ( Nx/2, Ny/2 ) back
+     * to (0,0), i.e. undoes the fftshift of diffractionIntensity for even
+     * and odd sizes.
+     **/
+    void undoFftShift
+    (
+        float * const & rData,
+        const unsigned & Nx,
+        const unsigned & Ny
+    );
+
+
+} // namespace createTestData
+} // namespace examples
@@ -0,0 +1,460 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/*
+ * Generates a randomized dataset of objects and their diffraction
+ * intensities for training, testing and stress-testing the reconstruction.
+ *
+ * Each frame draws its size, kind of object and the object parameters from
+ * its own counter-based random stream, so a dataset is reproducible for a
+ * given seed regardless of the number of threads. Frames are generated in
+ * parallel batches while the previous batch is written, into one .npy or
+ * .raw stack per size (see imresh::io::openFrameSource):
+ *   <output>/<prefix>_<size>_object.<format>
+ *   <output>/<prefix>_<size>_intensity.<format>
+ * and <output>/<prefix>_index.csv, which lists for each frame its kind,
+ * size, index in the stacks and the object parameters.
+ *
+ * Usage: generateDataset [--option=value ...]
+ *   --frames=1000    number of frames
+ *   --sizes=128,256  image widths and heights
+ *   --weights=1,1    relative frequencies of the sizes, uniform by default
+ *   --kinds=atoms,checkerboard,rectangle,circle  kinds of objects, chosen
+ *                    uniformly
+ *   --seed=2016      seed of the random streams
+ *   --output=.       directory for the files
+ *   --prefix=dataset prefix of the file names
+ *   --format=npy     npy or raw
+ *   --objects=1      0 writes only the intensities
+ *   --shift=1        1 centers the intensities, see
+ *                    imresh::libs::diffractionIntensity, 0 keeps the zero
+ *                    frequency at (0,0), also for the simulated detector
+ *   --batch=256      frames generated in parallel at once
+ *   --photons=0 --beamstop=0 --saturation=0 --modules=1 --gap=0 --bin=1
+ *                    if photons > 0, the intensity files contain the photon
+ *                    counts of a simulated detector instead of the modulus,
+ *                    see examples::createTestData::simulateDetector
+ */
+
+#include <algorithm>        // std::min, std::copy
+#include <chrono>
+#include <cmath>            // M_PI
+#include <cstdint>          // uint64_t
+#include <cstdlib>          // strtod, strtoul
+#include <fstream>
+#include <iomanip>          // setprecision
+#include <iostream>
+#include <map>
+#include <memory>           // std::shared_ptr, std::unique_ptr
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>          // std::pair
+#include <vector>
+
+#include "io/binaryFormats.hpp"
+#include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
+#include "createTestData/counterRandom.hpp"
+#include "createTestData/createAtomCluster.hpp"
+#include "createTestData/createCheckerboard.hpp"
+#include "createTestData/createCircularSection.hpp"
+#include "createTestData/createRectangle.hpp"
+#include "createTestData/simulateDetector.hpp"
+
+
+namespace examples
+{
+
+
+    using Clock = std::chrono::steady_clock;
+
+    struct DatasetOptions
+    {
+        uint64_t nFrames       = 1000;
+        std::vector<unsigned> sizes { 128, 256 };
+        std::vector<double> weights;
+        std::vector<std::string> kinds { "atoms", "checkerboard", "rectangle", "circle" };
+        unsigned seed          = 2016;
+        std::string outputDirectory = ".";
+        std::string prefix     = "dataset";
+        std::string format     = "npy";
+        bool writeObjects      = true;
+        bool fftShift          = true;
+        unsigned batchSize     = 256;
+        examples::createTestData::DetectorModel detector;
+    };
+
+    std::vector<std::string> splitList( std::string const & rList )
+    {
+        std::vector<std::string> items;
+        std::istringstream list( rList );
+        std::string item;
+        while ( std::getline( list, item, ',' ) )
+            items.push_back( item );
+        return items;
+    }
+
+    /**
+     * Parses arguments of the form --key=value. Returns false on unknown
+     * arguments or inconsistent values.
+     */
+    bool parseOptions( int argc, char ** argv, DatasetOptions & rOptions )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            std::string const arg = argv[i];
+            auto const iEqual = arg.find( '=' );
+            if ( arg.compare( 0, 2, "--" ) != 0 or iEqual == std::string::npos )
+                return false;
+            std::string const key   = arg.substr( 2, iEqual-2 );
+            std::string const value = arg.substr( iEqual+1 );
+            char const * const v    = value.c_str();
+
+            if      ( key == "frames"     ) rOptions.nFrames         = strtoull( v, NULL, 10 );
+            else if ( key == "seed"       ) rOptions.seed            = strtoul( v, NULL, 10 );
+            else if ( key == "output"     ) rOptions.outputDirectory = value;
+            else if ( key == "prefix"     ) rOptions.prefix          = value;
+            else if ( key == "format"     ) rOptions.format          = value;
+            else if ( key == "objects"    ) rOptions.writeObjects    = value == "1";
+            else if ( key == "shift"      ) rOptions.fftShift        = value == "1";
+            else if ( key == "batch"      ) rOptions.batchSize       = strtoul( v, NULL, 10 );
+            else if ( key == "kinds"      ) rOptions.kinds           = splitList( value );
+            else if ( key == "photons"    ) rOptions.detector.fluence        = strtod( v, NULL );
+            else if ( key == "beamstop"   ) rOptions.detector.beamstopRadius = strtod( v, NULL );
+            else if ( key == "saturation" ) rOptions.detector.saturation     = strtod( v, NULL );
+            else if ( key == "modules"    ) rOptions.detector.nModules       = strtoul( v, NULL, 10 );
+            else if ( key == "gap"        ) rOptions.detector.gapWidth       = strtoul( v, NULL, 10 );
+            else if ( key == "bin"        ) rOptions.detector.binning        = strtoul( v, NULL, 10 );
+            else if ( key == "sizes" )
+            {
+                rOptions.sizes.clear();
+                for ( auto const & size : splitList( value ) )
+                    rOptions.sizes.push_back( strtoul( size.c_str(), NULL, 10 ) );
+            }
+            else if ( key == "weights" )
+            {
+                rOptions.weights.clear();
+                for ( auto const & weight : splitList( value ) )
+                    rOptions.weights.push_back( strtod( weight.c_str(), NULL ) );
+            }
+            else
+                return false;
+        }
+        if ( rOptions.weights.empty() )
+            rOptions.weights.assign( rOptions.sizes.size(), 1 );
+        rOptions.detector.seed = rOptions.seed;
+
+        for ( auto const & kind : rOptions.kinds )
+        {
+            if ( kind != "atoms" and kind != "checkerboard" and
+                 kind != "rectangle" and kind != "circle" )
+                return false;
+        }
+        for ( auto const & size : rOptions.sizes )
+        {
+            if ( size < rOptions.detector.binning )
+                return false;
+        }
+        return not rOptions.sizes.empty() and not rOptions.kinds.empty() and
+               rOptions.weights.size() == rOptions.sizes.size() and
+               rOptions.batchSize > 0 and rOptions.detector.nModules > 0 and
+               rOptions.detector.binning > 0 and
+               ( rOptions.format == "npy" or rOptions.format == "raw" );
+    }
+
+    /**
+     * Size, kind and parameters of one frame
+     */
+    struct FrameSpec
+    {
+        unsigned size;
+        std::string kind;
+        std::vector<float> parameters;
+        /* index of the frame in the stacks of its size */
+        uint64_t iInStack;
+    };
+
+    /**
+     * Draws the specification of frame rFrame from its random stream
+     */
+    FrameSpec drawFrame( DatasetOptions const & rOptions, uint64_t rFrame )
+    {
+        using examples::createTestData::counterUniform;
+        uint64_t const key = examples::createTestData::counterStream( rOptions.seed, rFrame );
+        unsigned counter = 0;
+        auto const uniform = [&]( double a, double b )
+        {
+            return float( a + ( b - a ) * counterUniform( key, counter++ ) );
+        };
+
+        FrameSpec frame;
+        double totalWeight = 0;
+        for ( auto const & weight : rOptions.weights )
+            totalWeight += weight;
+        double u = uniform( 0, totalWeight );
+        unsigned iSize = 0;
+        while ( iSize + 1 < rOptions.sizes.size() and u >= rOptions.weights[iSize] )
+            u -= rOptions.weights[ iSize++ ];
+        frame.size = rOptions.sizes[ iSize ];
+
+        unsigned const iKind = std::min< unsigned >( rOptions.kinds.size() - 1,
+            uniform( 0, rOptions.kinds.size() ) );
+        frame.kind = rOptions.kinds[ iKind ];
+        if ( frame.kind == "checkerboard" )
+            /* Dx, Dy, phi */
+            frame.parameters = { uniform( 0.03, 0.15 ), uniform( 0.03, 0.15 ),
+                                 uniform( 0, M_PI ) };
+        else if ( frame.kind == "rectangle" )
+            /* Dx, Dy, x0, y0, phi */
+            frame.parameters = { uniform( 0.05, 0.4 ), uniform( 0.05, 0.4 ),
+                                 uniform( 0.35, 0.65 ), uniform( 0.35, 0.65 ),
+                                 uniform( 0, M_PI ) };
+        else if ( frame.kind == "circle" )
+            /* r, x0, y0, phi0, phi1 */
+            frame.parameters = { uniform( 0.05, 0.3 ), uniform( 0.35, 0.65 ),
+                                 uniform( 0.35, 0.65 ), 0, uniform( M_PI, 2*M_PI ) };
+        else
+            /* phi, dx, dy of the atom clusters */
+            frame.parameters = { uniform( 0, 2*M_PI ), uniform( -0.1, 0.1 ),
+                                 uniform( -0.1, 0.1 ) };
+        return frame;
+    }
+
+    float * createObject( FrameSpec const & rFrame )
+    {
+        using namespace examples::createTestData;
+        unsigned const n = rFrame.size;
+        auto const & p = rFrame.parameters;
+        if ( rFrame.kind == "checkerboard" )
+            return createCheckerboard( n, n, p[0], p[1], p[2] );
+        if ( rFrame.kind == "rectangle" )
+            return createRectangle( n, n, p[0], p[1], p[2], p[3], p[4] );
+        if ( rFrame.kind == "circle" )
+            return createCircularSection( n, n, p[0], p[1], p[2], p[3], p[4] );
+        return createAtomCluster( n, n, p[0], p[1], p[2] );
+    }
+
+    /**
+     * Frames of one batch, which are written while the next one is
+     * generated
+     */
+    struct Batch
+    {
+        uint64_t iFirstFrame;
+        std::vector<FrameSpec> frames;
+        std::vector<imresh::libs::FrameBuffer> objects;
+        std::vector<imresh::libs::FrameBuffer> intensities;
+    };
+
+    /**
+     * One stack file per size and content
+     */
+    class StackFiles
+    {
+    public:
+        StackFiles( DatasetOptions const & rOptions, std::string const & rContent )
+        : mOptions( rOptions ), mContent( rContent ) {}
+
+        std::string getFilename( unsigned rSize ) const
+        {
+            return mOptions.outputDirectory + "/" + mOptions.prefix + "_" +
+                   std::to_string( rSize ) + "_" + mContent + "." + mOptions.format;
+        }
+
+        /**
+         * Creates the file and writes the header for rnFrames frames
+         */
+        bool open( unsigned rSize, std::pair<unsigned,unsigned> rFrameSize,
+                   uint64_t rnFrames )
+        {
+            std::unique_ptr<std::ofstream> & file = mFiles[ rSize ];
+            file.reset( new std::ofstream( getFilename( rSize ).c_str(),
+                                           std::ios::binary | std::ios::trunc ) );
+            std::string const header = mOptions.format == "npy" ?
+                imresh::io::makeNpyHeader( rFrameSize.first, rFrameSize.second, rnFrames ) :
+                imresh::io::makeRawHeader( rFrameSize.first, rFrameSize.second, rnFrames );
+            file->write( header.data(), header.size() );
+            return bool( *file );
+        }
+
+        bool write( unsigned rSize, float const * rData, size_t rnElements )
+        {
+            std::ofstream & file = *mFiles.at( rSize );
+            file.write( reinterpret_cast<char const*>( rData ),
+                        rnElements * sizeof( float ) );
+            return bool( file );
+        }
+
+    private:
+        DatasetOptions const & mOptions;
+        std::string mContent;
+        std::map< unsigned, std::unique_ptr<std::ofstream> > mFiles;
+    };
+
+
+} // namespace examples
+
+
+int main( int argc, char ** argv )
+{
+    using namespace examples;
+    using imresh::libs::FrameBuffer;
+
+    DatasetOptions options;
+    if ( not parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Invalid arguments. See the head of "
+                  << __FILE__ << " for the usage.\n";
+        return 1;
+    }
+    auto const start = Clock::now();
+    unsigned const binning = options.detector.fluence > 0 ? options.detector.binning : 1;
+
+    /* The headers need the number of frames per size, so all frames are
+     * drawn up front. The specifications are small compared to the images. */
+    std::vector<FrameSpec> frames( options.nFrames );
+    std::map< unsigned, uint64_t > nFramesPerSize;
+    #pragma omp parallel for
+    for ( uint64_t i = 0; i < options.nFrames; ++i )
+        frames[i] = drawFrame( options, i );
+    for ( auto & frame : frames )
+        frame.iInStack = nFramesPerSize[ frame.size ]++;
+
+    StackFiles objectFiles( options, "object" );
+    StackFiles intensityFiles( options, "intensity" );
+    std::map< unsigned, imresh::libs::DiffractionIntensityPlan > plans;
+    for ( auto const & count : nFramesPerSize )
+    {
+        unsigned const n = count.first;
+        bool ok = intensityFiles.open( n, { n / binning, n / binning }, count.second );
+        if ( options.writeObjects )
+            ok = objectFiles.open( n, { n, n }, count.second ) and ok;
+        if ( not ok )
+        {
+            std::cerr << "Couldn't create the files for size " << n << " in "
+                      << options.outputDirectory << "\n";
+            return 1;
+        }
+        /* measuring pays off for the many frames of a dataset. The detector
+         * is simulated on centered patterns, which are unshifted afterwards
+         * for --shift=0 */
+        plans.emplace( n, imresh::libs::DiffractionIntensityPlan(
+            { n, n }, options.fftShift or options.detector.fluence > 0, true ) );
+    }
+
+    std::ofstream index( ( options.outputDirectory + "/" + options.prefix +
+                           "_index.csv" ).c_str() );
+    index << "frame,kind,size,index,parameters\n";
+
+    bool writeFailed = false;
+    auto const writeBatch = [&]( std::shared_ptr<Batch> const & rBatch )
+    {
+        for ( size_t j = 0; j < rBatch->frames.size(); ++j )
+        {
+            FrameSpec const & frame = rBatch->frames[j];
+            unsigned const n = frame.size;
+            if ( options.writeObjects )
+                writeFailed |= not objectFiles.write( n, rBatch->objects[j].data(),
+                                                      size_t( n ) * n );
+            writeFailed |= not intensityFiles.write( n, rBatch->intensities[j].data(),
+                size_t( n / binning ) * ( n / binning ) );
+
+            index << rBatch->iFirstFrame + j << "," << frame.kind << "," << n
+                  << "," << frame.iInStack << ",";
+            for ( size_t k = 0; k < frame.parameters.size(); ++k )
+                index << ( k > 0 ? " " : "" ) << frame.parameters[k];
+            index << "\n";
+        }
+    };
+
+    std::thread writer;
+    for ( uint64_t iFirst = 0; iFirst < options.nFrames; iFirst += options.batchSize )
+    {
+        auto batch = std::make_shared<Batch>();
+        batch->iFirstFrame = iFirst;
+        batch->frames.assign( frames.begin() + iFirst, frames.begin() +
+            std::min< uint64_t >( options.nFrames, iFirst + options.batchSize ) );
+        size_t const nBatch = batch->frames.size();
+        batch->objects.resize( nBatch );
+        batch->intensities.resize( nBatch );
+
+        #pragma omp parallel for schedule( dynamic )
+        for ( size_t j = 0; j < nBatch; ++j )
+        {
+            unsigned const n = batch->frames[j].size;
+            batch->objects[j] = FrameBuffer::adopt( createObject( batch->frames[j] ) );
+            batch->intensities[j] = FrameBuffer( size_t( n ) * n );
+            std::copy( batch->objects[j].data(), batch->objects[j].data() + n*n,
+                       batch->intensities[j].data() );
+        }
+
+        /* transform all frames of a size in one parallel batch */
+        for ( auto const & plan : plans )
+        {
+            std::vector<float*> pointers;
+            for ( size_t j = 0; j < nBatch; ++j )
+            {
+                if ( batch->frames[j].size == plan.first )
+                    pointers.push_back( batch->intensities[j].data() );
+            }
+            plan.second( pointers.data(), pointers.size() );
+        }
+
+        if ( options.detector.fluence > 0 )
+        {
+            #pragma omp parallel for schedule( dynamic )
+            for ( size_t j = 0; j < nBatch; ++j )
+            {
+                unsigned const n = batch->frames[j].size;
+                batch->intensities[j] = FrameBuffer::adopt(
+                    examples::createTestData::simulateDetector(
+                        batch->intensities[j].data(), n, n, options.detector,
+                        iFirst + j ) );
+                if ( not options.fftShift )
+                {
+                    unsigned const nBinned = n / options.detector.binning;
+                    examples::createTestData::undoFftShift(
+                        batch->intensities[j].data(), nBinned, nBinned );
+                }
+            }
+        }
+
+        if ( writer.joinable() )
+            writer.join();
+        writer = std::thread( writeBatch, batch );
+    }
+    if ( writer.joinable() )
+        writer.join();
+
+    double const seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+    std::cout << std::setprecision( 3 ) << "Generated " << options.nFrames
+              << " frames in " << seconds << " s ("
+              << options.nFrames / seconds << " frames/s)" << std::endl;
+    if ( writeFailed or not index )
+    {
+        std::cerr << "Couldn't write all frames to " << options.outputDirectory << "\n";
+        return 1;
+    }
+    return 0;
+}
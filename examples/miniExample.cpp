@@ -28,6 +28,7 @@
 #include <string>           // std::string
 
 #include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
 #include "algorithms/shrinkWrap.hpp"
 #include "algorithms/cuda/cudaShrinkWrap.h"
 #include "createTestData/createAtomCluster.hpp"
@@ -81,7 +82,7 @@ int main( void )
     std::cout << "Wrote atomClusterOutput to atomClusterOutput.dat\n";
 
 
-    delete[] pAtomCluster;
+    imresh::libs::freeFrame( pAtomCluster );
 
     return 0;
 }
@@ -27,10 +27,11 @@
 #include <vector>
 #include <iostream>
 
-#include "io/taskQueue.cu"
+#include "io/taskQueue.hpp"
 #include "io/readInFuncs/readInFuncs.hpp"
 #include "io/writeOutFuncs/writeOutFuncs.hpp"
 #include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
 #include "createTestData/createAtomCluster.hpp"
 #include "createTestData/createRectangle.hpp"
 #include "createTestData/createCheckerboard.hpp"
@@ -51,7 +52,7 @@ namespace examples
             //std::cout << "size = (" << size.first << "," << size.second << ")\n";
             imresh::io::writeOutFuncs::writeOutPNG( data, size, filename );
 #       endif
-        delete[] data;
+        imresh::libs::freeFrame( const_cast<float*>( data ) );
     }
 
 
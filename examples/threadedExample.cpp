@@ -27,24 +27,16 @@
 #include <string>           // std::string
 #include <sstream>
 
-#include "io/taskQueue.cu"
+#include "io/taskQueue.hpp"
 #include "io/readInFuncs/readInFuncs.hpp"
 #include "io/writeOutFuncs/writeOutFuncs.hpp"
 #include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
 #ifndef USE_SPLASH
 #   include "createTestData/createAtomCluster.hpp"
 #endif
 
 
-
-void dummyWriteOutFunc(
-    float const * const _mem,
-    std::pair<unsigned, unsigned> const _size,
-    std::string const _filename
-)
-{}
-
-
 int main( void )
 {
     // First step is to initialize the library.
@@ -62,9 +54,16 @@ int main( void )
             imageSize
         };
 #   endif
+    // The readers return NULL if the file couldn't be read
+    if ( file.first == NULL )
+    {
+        std::cerr << "Couldn't read the input image\n";
+        imresh::io::taskQueueDeinit( );
+        return 1;
+    }
     // This step is only needed because we have no real images
     imresh::libs::diffractionIntensity( file.first, file.second );
-    delete[] file.first;
+    imresh::libs::freeFrame( file.first );
 
     // Now let's test the PNG in- and output
 #   ifdef USE_PNG
@@ -73,6 +72,11 @@ int main( void )
         {
             // How about the PNG input? BEWARE! This path is dependent on the folder structure!
             file = imresh::io::readInFuncs::readPNG( "../examples/testData/imresh.png" );
+            if ( file.first == NULL )
+            {
+                std::cerr << "Couldn't read ../examples/testData/imresh.png\n";
+                break;
+            }
             // Again, this step is only needed because we have no real images
             imresh::libs::diffractionIntensity( file.first, file.second );
 
@@ -80,7 +84,9 @@ int main( void )
             filename << "imresh_" << std::setw( 2 ) << std::setfill( '0' )
                      << i << "_cycles.png";
             imresh::io::addTask( file.first, file.second,
-                                 dummyWriteOutFunc, //imresh::io::writeOutFuncs::writeOutPNG,
+                                 /* the task owns the image, so it has to
+                                  * be freed by the write out function */
+                                 imresh::io::writeOutFuncs::justFree, //imresh::io::writeOutFuncs::writeOutPNG,
                                  filename.str(),
                                  i /* sets the number of iterations */ );
         }
@@ -91,12 +97,22 @@ int main( void )
         // First read that HDF5 file once again (because the memory is
         // overwritten) BEWARE! This path is dependent on the folder structure!
         file = imresh::io::readInFuncs::readHDF5( "../examples/testData/imresh" );
-        // Again, this step is only needed because we have no real images
-        imresh::libs::diffractionIntensity( file.first, file.second );
-        imresh::io::addTask( file.first,
-                             file.second,
-                             imresh::io::writeOutFuncs::writeOutHDF5,
-                             "imresh_out" );
+        if ( file.first == NULL )
+            std::cerr << "Couldn't read ../examples/testData/imresh\n";
+        else
+        {
+            // Again, this step is only needed because we have no real images
+            imresh::libs::diffractionIntensity( file.first, file.second );
+            imresh::io::addTask( file.first,
+                                 file.second,
+                                 []( float * _mem, std::pair<unsigned,unsigned> _size,
+                                     std::string _filename )
+                                 {
+                                     imresh::io::writeOutFuncs::writeOutHDF5( _mem, _size, _filename );
+                                     imresh::libs::freeFrame( _mem );
+                                 },
+                                 "imresh_out" );
+        }
 #   endif
 
     // The last step is always deinitializing the library.
@@ -330,7 +330,10 @@ namespace cuda
         float rIntensityCutOff,
         float rSigma0,
         float rSigmaChange,
-        unsigned rnHioCycles
+        unsigned rnHioCycles,
+        std::atomic<bool> const * rpAbort,
+        float * rpFinalError,
+        unsigned * rpnCycles
     )
     {
         /* load libraries and functions which we need */
@@ -399,7 +402,10 @@ namespace cuda
                     cudaMemcpyDeviceToDevice, rStream );
 
         /* repeatedly call HIO algorithm and change mask */
-        for ( unsigned iCycleShrinkWrap = 0; iCycleShrinkWrap < rnCycles; ++iCycleShrinkWrap )
+        bool aborted = false;
+        float currentError = 0;
+        unsigned nCyclesRun = 0;
+        for ( unsigned iCycleShrinkWrap = 0; iCycleShrinkWrap < rnCycles and not aborted; ++iCycleShrinkWrap )
         {
             /************************** Update Mask ***************************/
 #           ifdef IMRESH_DEBUG
@@ -420,6 +426,14 @@ namespace cuda
 
             for ( unsigned iHioCycle = 0; iHioCycle < rnHioCycles; ++iHioCycle )
             {
+                /* the kernels are only queued, so polling here doesn't
+                 * stall the stream */
+                if ( rpAbort != NULL and rpAbort->load() )
+                {
+                    aborted = true;
+                    break;
+                }
+
                 /* apply domain constraints to g' to get g */
                 cudaKernelApplyHioDomainConstraints<<<nBlocks,nThreads,0,rStream >>>
                     ( dpgPrevious, dpCurData, dpIsMasked, nElements, rHioBeta );
@@ -433,9 +447,12 @@ namespace cuda
 
                 CUFFT_ERROR( cufftExecC2C( ftPlan, dpCurData, dpCurData, CUFFT_INVERSE ) );
             } // HIO loop
+            if ( aborted )
+                break;
 
             /* check if we are done */
-            const float currentError = calculateHioError( dpCurData /*g'*/, dpIsMasked, nElements, false /* don't invert mask */, rStream );
+            currentError = calculateHioError( dpCurData /*g'*/, dpIsMasked, nElements, false /* don't invert mask */, rStream );
+            ++nCyclesRun;
 #           ifdef IMRESH_DEBUG
                 std::cout << "[Error " << currentError << "/" << rTargetError << "] "
                           << "[Cycle " << iCycleShrinkWrap << "/" << rnCycles-1 << "]"
@@ -446,8 +463,12 @@ namespace cuda
             if ( iCycleShrinkWrap >= rnCycles )
                 break;
         } // shrink wrap loop
-        cudaKernelCopyFromRealPart<<<nBlocks,nThreads,0,rStream>>>( dpIntensity, dpCurData, nElements );
-        CUDA_ERROR( cudaMemcpyAsync( rIntensity, dpIntensity, sizeof(rIntensity[0])*nElements, cudaMemcpyDeviceToHost, rStream ) );
+        /* when aborted, leave the input intact so that it can be resubmitted */
+        if ( not aborted )
+        {
+            cudaKernelCopyFromRealPart<<<nBlocks,nThreads,0,rStream>>>( dpIntensity, dpCurData, nElements );
+            CUDA_ERROR( cudaMemcpyAsync( rIntensity, dpIntensity, sizeof(rIntensity[0])*nElements, cudaMemcpyDeviceToHost, rStream ) );
+        }
 
         /* wait for everything to finish */
         CUDA_ERROR( cudaStreamSynchronize( rStream ) );
@@ -459,7 +480,11 @@ namespace cuda
         CUDA_ERROR( cudaFree( dpIntensity ) );
         CUDA_ERROR( cudaFree( dpIsMasked  ) );
 
-        return 0;
+        if ( rpFinalError != NULL )
+            *rpFinalError = currentError;
+        if ( rpnCycles != NULL )
+            *rpnCycles = nCyclesRun;
+        return aborted ? 1 : 0;
     }
 
 
@@ -25,7 +25,8 @@
 
 #pragma once
 
-#include <cuda_runtime_api.h> // cudaStream_t
+#include <atomic>               // std::atomic
+#include <cuda_runtime_api.h>   // cudaStream_t
 
 
 namespace imresh
@@ -69,8 +70,18 @@ namespace cuda
      *            rSigmaChange * currentSigma.
      * @param[in] rnHioCycles Maximum number of HIO cycles. This is a safety
      *            net to prevent hangs if the algorithm doesn't progress
+     * @param[in] rpAbort if not NULL, this flag is polled before every HIO
+     *            cycle. When it becomes true the reconstruction is stopped
+     *            and rIoData is left untouched, i.e. it still holds the
+     *            input intensity.
+     * @param[out] rpFinalError if not NULL, set to the error after the last
+     *             shrink-wrap cycle
+     * @param[out] rpnCycles if not NULL, set to the number of shrink-wrap
+     *             cycles run, which is less than rnCycles if the target
+     *             error was reached
      *
-     * @return 0 on success, else error or warning codes.
+     * @return 0 on success, 1 if aborted through rpAbort, else error or
+     *         warning codes.
      **/
     int cudaShrinkWrap
     (
@@ -85,7 +96,10 @@ namespace cuda
         float rIntensityCutOff = 0.20,
         float sigma0 = 3.0,
         float rSigmaChange = 0.01,
-        unsigned rnHioCycles = 20
+        unsigned rnHioCycles = 20,
+        std::atomic<bool> const * rpAbort = NULL,
+        float * rpFinalError = NULL,
+        unsigned * rpnCycles = NULL
     );
 
 
@@ -0,0 +1,270 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "detectorPreprocessing.hpp"
+
+#include <algorithm>  // std::max, std::fill, std::copy, std::binary_search
+#include <cmath>      // sqrt
+#include <cstdint>    // uint16_t, uint32_t
+
+
+namespace imresh
+{
+namespace algorithms
+{
+
+
+    DetectorPreprocessor::DetectorPreprocessor
+    (
+        std::pair<unsigned int,unsigned int> const & rSize,
+        DetectorCalibration const & rCalibration
+    )
+    : mSize( rSize ), mOutputSize( 0, 0 ), mnBinning( rCalibration.binning ),
+      mnIgnored( 0 ), mValid( false )
+    {
+        size_t const nPixels = size_t( mSize.first ) * mSize.second;
+        auto const fits = [nPixels]( size_t rnEntries )
+                          { return rnEntries == 0 or rnEntries == nPixels; };
+        if ( nPixels == 0 or mnBinning == 0 or
+             mSize.first < mnBinning or mSize.second < mnBinning or
+             not fits( rCalibration.dark.size() ) or
+             not fits( rCalibration.gain.size() ) or
+             not fits( rCalibration.mask.size() ) )
+            return;
+        mOutputSize = { mSize.first / mnBinning, mSize.second / mnBinning };
+
+        mDark = libs::FrameBuffer( nPixels );
+        mGain = libs::FrameBuffer( nPixels );
+        if ( not mDark or not mGain )
+            return;
+        float * const dark = mDark.data();
+        float * const gain = mGain.data();
+        if ( rCalibration.dark.empty() )
+            std::fill( dark, dark + nPixels, 0.0f );
+        else
+            std::copy( rCalibration.dark.begin(), rCalibration.dark.end(), dark );
+        if ( rCalibration.gain.empty() )
+            std::fill( gain, gain + nPixels, 1.0f );
+        else
+            std::copy( rCalibration.gain.begin(), rCalibration.gain.end(), gain );
+
+        /* hot pixels stand out in the dark frame */
+        float hotThreshold = 0;
+        bool const findHot = rCalibration.hotPixelSigma > 0 and
+                             not rCalibration.dark.empty();
+        if ( findHot )
+        {
+            double sum = 0, sum2 = 0;
+            #pragma omp parallel for reduction( + : sum, sum2 )
+            for ( size_t i = 0; i < nPixels; ++i )
+            {
+                sum  += dark[i];
+                sum2 += double( dark[i] ) * dark[i];
+            }
+            double const mean = sum / nPixels;
+            double const variance = std::max( 0.0, sum2 / nPixels - mean * mean );
+            hotThreshold = mean + rCalibration.hotPixelSigma * std::sqrt( variance );
+        }
+
+        unsigned int nIgnored = 0;
+        #pragma omp parallel for reduction( + : nIgnored )
+        for ( size_t i = 0; i < nPixels; ++i )
+        {
+            bool const masked = not rCalibration.mask.empty() and rCalibration.mask[i] != 0;
+            bool const hot = findHot and dark[i] > hotThreshold;
+            if ( masked or hot )
+                gain[i] = 0;
+            if ( gain[i] == 0 )
+                ++nIgnored;
+        }
+        mnIgnored = nIgnored;
+
+        size_t const nOutputs = size_t( mOutputSize.first ) * mOutputSize.second;
+        if ( mnBinning > 1 )
+        {
+            mBinScale = libs::FrameBuffer( nOutputs );
+            if ( not mBinScale )
+                return;
+        }
+        for ( unsigned int oy = 0; oy < mOutputSize.second; ++oy )
+        for ( unsigned int ox = 0; ox < mOutputSize.first; ++ox )
+        {
+            unsigned int nValid = 0;
+            for ( unsigned int ky = 0; ky < mnBinning; ++ky )
+            for ( unsigned int kx = 0; kx < mnBinning; ++kx )
+            {
+                size_t const i = size_t( oy * mnBinning + ky ) * mSize.first
+                                 + ox * mnBinning + kx;
+                nValid += gain[i] != 0;
+            }
+            size_t const o = size_t( oy ) * mOutputSize.first + ox;
+            if ( mnBinning > 1 )
+                mBinScale.data()[o] = nValid == 0 ? 0.0f :
+                                      float( mnBinning * mnBinning ) / nValid;
+            if ( nValid == 0 )
+                mDeadOutputs.push_back( o );
+        }
+        mValid = true;
+    }
+
+    bool DetectorPreprocessor::isValid( void ) const
+    {
+        return mValid;
+    }
+
+    std::pair<unsigned int,unsigned int> DetectorPreprocessor::getInputSize( void ) const
+    {
+        return mSize;
+    }
+
+    std::pair<unsigned int,unsigned int> DetectorPreprocessor::getOutputSize( void ) const
+    {
+        return mOutputSize;
+    }
+
+    unsigned int DetectorPreprocessor::getIgnoredCount( void ) const
+    {
+        return mnIgnored;
+    }
+
+    template< class T_RAW >
+    void DetectorPreprocessor::processRow
+    (
+        T_RAW const * const rRaw,
+        float * const rModulus,
+        unsigned int const iRow
+    ) const
+    {
+        unsigned int const nx = mOutputSize.first;
+        float * const out = rModulus + size_t( iRow ) * nx;
+
+        if ( mnBinning == 1 )
+        {
+            size_t const offset = size_t( iRow ) * mSize.first;
+            T_RAW const * const raw  = rRaw + offset;
+            float const * const dark = mDark.data() + offset;
+            float const * const gain = mGain.data() + offset;
+            #pragma omp simd
+            for ( unsigned int ix = 0; ix < nx; ++ix )
+            {
+                float const value = ( float( raw[ix] ) - dark[ix] ) * gain[ix];
+                out[ix] = std::sqrt( std::max( value, 0.0f ) );
+            }
+            return;
+        }
+
+        /* Sum the bins row by row. The noise in the dark-corrected values
+         * only gets clipped after summing, so that it averages out. */
+        std::fill( out, out + nx, 0.0f );
+        for ( unsigned int ky = 0; ky < mnBinning; ++ky )
+        {
+            size_t const offset = size_t( iRow * mnBinning + ky ) * mSize.first;
+            T_RAW const * const raw  = rRaw + offset;
+            float const * const dark = mDark.data() + offset;
+            float const * const gain = mGain.data() + offset;
+            for ( unsigned int ox = 0; ox < nx; ++ox )
+            {
+                unsigned int const ix0 = ox * mnBinning;
+                float sum = 0;
+                for ( unsigned int kx = 0; kx < mnBinning; ++kx )
+                    sum += ( float( raw[ ix0 + kx ] ) - dark[ ix0 + kx ] ) * gain[ ix0 + kx ];
+                out[ox] += sum;
+            }
+        }
+        float const * const scale = mBinScale.data() + size_t( iRow ) * nx;
+        #pragma omp simd
+        for ( unsigned int ox = 0; ox < nx; ++ox )
+            out[ox] = std::sqrt( std::max( out[ox] * scale[ox], 0.0f ) );
+    }
+
+    template< class T_RAW >
+    void DetectorPreprocessor::operator()
+    (
+        T_RAW const * const rRaw,
+        float * const rModulus
+    ) const
+    {
+        if ( not mValid )
+            return;
+
+        #pragma omp parallel for schedule( static )
+        for ( unsigned int iRow = 0; iRow < mOutputSize.second; ++iRow )
+            processRow( rRaw, rModulus, iRow );
+
+        /* Dead pixels are rare, so they are filled in afterwards from the
+         * neighbours which got a value, which are all others than dead. */
+        unsigned int const nx = mOutputSize.first;
+        unsigned int const ny = mOutputSize.second;
+        auto const isDead = [this]( unsigned int o )
+        {
+            return std::binary_search( mDeadOutputs.begin(), mDeadOutputs.end(), o );
+        };
+        for ( unsigned int const o : mDeadOutputs )
+        {
+            unsigned int const ox = o % nx;
+            unsigned int const oy = o / nx;
+            float sum = 0;
+            unsigned int nValid = 0;
+            auto const add = [&]( unsigned int rNeighbour )
+            {
+                if ( not isDead( rNeighbour ) )
+                {
+                    sum += rModulus[ rNeighbour ];
+                    ++nValid;
+                }
+            };
+            if ( ox > 0      ) add( o - 1  );
+            if ( ox + 1 < nx ) add( o + 1  );
+            if ( oy > 0      ) add( o - nx );
+            if ( oy + 1 < ny ) add( o + nx );
+            rModulus[o] = nValid == 0 ? 0.0f : sum / nValid;
+        }
+    }
+
+
+    /* explicit instantiations for the pixel types of detectors and of
+     * imresh's own file formats */
+    template void DetectorPreprocessor::operator()<float>
+    (
+        float const * rRaw,
+        float * rModulus
+    ) const;
+    template void DetectorPreprocessor::operator()<double>
+    (
+        double const * rRaw,
+        float * rModulus
+    ) const;
+    template void DetectorPreprocessor::operator()<uint16_t>
+    (
+        uint16_t const * rRaw,
+        float * rModulus
+    ) const;
+    template void DetectorPreprocessor::operator()<uint32_t>
+    (
+        uint32_t const * rRaw,
+        float * rModulus
+    ) const;
+
+
+} // namespace algorithms
+} // namespace imresh
@@ -0,0 +1,140 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>              // uint8_t
+#include <utility>              // std::pair
+#include <vector>               // std::vector
+
+#include "libs/frameBuffer.hpp" // FrameBuffer
+
+
+namespace imresh
+{
+namespace algorithms
+{
+
+
+    /**
+     * Per-pixel calibration of a detector. All arrays are either empty or
+     * have one entry per detector pixel in row-major order.
+     */
+    struct DetectorCalibration
+    {
+        /** subtracted from every frame, e.g. the mean of frames taken
+         *  without beam */
+        std::vector<float> dark;
+        /** the dark-corrected values are multiplied with it (flat field).
+         *  Pixels with a gain of 0 are ignored. */
+        std::vector<float> gain;
+        /** non-zero for pixels to be ignored, e.g. module gaps */
+        std::vector<uint8_t> mask;
+        /** pixels whose dark value is more than this many standard
+         *  deviations above the mean dark value are ignored as hot pixels.
+         *  0 disables the detection. */
+        float hotPixelSigma;
+        /** N, i.e. N x N pixels are summed into one. The frame is cropped
+         *  to multiples of N. */
+        unsigned binning;
+
+        DetectorCalibration( void ) : hotPixelSigma( 0 ), binning( 1 ) {}
+    };
+
+    /**
+     * Turns raw detector frames into the modulus the reconstruction needs
+     * in a single pass: subtracts the dark frame, applies the gain, sums
+     * N x N bins and takes the square root. Negative values, i.e. noise
+     * below the dark level, are clipped to 0.
+     *
+     * Ignored pixels don't contribute, bins are scaled up by the fraction
+     * of ignored pixels in them. Output pixels without any valid input, e.g.
+     * hot pixels without binning, are set to the mean of their valid direct
+     * neighbours.
+     *
+     * Everything which only depends on the calibration is computed once in
+     * the constructor. Copies share these arrays and processing is const,
+     * so one preprocessor can be used by several threads. The rows of a
+     * frame are processed in parallel with OpenMP.
+     */
+    class DetectorPreprocessor
+    {
+    public:
+        /**
+         * @param rSize width and height of the raw frames
+         */
+        DetectorPreprocessor
+        (
+            std::pair<unsigned int,unsigned int> const & rSize,
+            DetectorCalibration const & rCalibration
+        );
+
+        /**
+         * @return false if the sizes of the calibration arrays don't match
+         *         the frame size or the frame is smaller than one bin
+         */
+        bool isValid( void ) const;
+        std::pair<unsigned int,unsigned int> getInputSize( void ) const;
+        std::pair<unsigned int,unsigned int> getOutputSize( void ) const;
+        /**
+         * number of pixels ignored, because they are masked, hot or have a
+         * gain of 0
+         */
+        unsigned int getIgnoredCount( void ) const;
+
+        /**
+         * @param rRaw frame of getInputSize pixels, e.g. uint16_t values of
+         *        a memory mapped file
+         * @param rModulus receives getOutputSize pixels, must not overlap
+         *        with rRaw
+         */
+        template< class T_RAW >
+        void operator()
+        (
+            T_RAW const * rRaw,
+            float * rModulus
+        ) const;
+
+    private:
+        template< class T_RAW >
+        void processRow( T_RAW const * rRaw, float * rModulus, unsigned iRow ) const;
+
+        std::pair<unsigned int,unsigned int> mSize;
+        std::pair<unsigned int,unsigned int> mOutputSize;
+        unsigned int mnBinning;
+        unsigned int mnIgnored;
+        bool mValid;
+        /* 0 if there is no dark frame */
+        libs::FrameBuffer mDark;
+        /* 0 for ignored pixels */
+        libs::FrameBuffer mGain;
+        /* N^2 / number of valid pixels per bin, 0 if there is none. Only
+         * used if binning. */
+        libs::FrameBuffer mBinScale;
+        /* output pixels without any valid input */
+        std::vector<unsigned int> mDeadOutputs;
+    };
+
+
+} // namespace algorithms
+} // namespace imresh
@@ -0,0 +1,154 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "hitFinder.hpp"
+
+#include <algorithm>  // std::min
+#include <cmath>      // sqrt
+
+#include "algorithms/vectorReduce.hpp"  // vectorStatistics
+
+
+namespace imresh
+{
+namespace algorithms
+{
+
+
+    HitFinder::HitFinder
+    (
+        HitFinderParameters const & rParameters
+    )
+    : mParameters( rParameters )
+    {}
+
+    HitFinderParameters const & HitFinder::getParameters( void ) const
+    {
+        return mParameters;
+    }
+
+    HitScore HitFinder::score
+    (
+        float const * rData,
+        std::pair<unsigned int,unsigned int> const & rSize
+    ) const
+    {
+        unsigned int const nx = rSize.first;
+        unsigned int const ny = rSize.second;
+
+        auto const statistics = vectorStatistics( rData, nx * ny,
+                                                  mParameters.peakThreshold );
+        HitScore score;
+        score.integratedIntensity = statistics.sum;
+        score.maxValue            = statistics.max;
+        score.peakCount           = statistics.nAbove;
+        score.radialIntensity     = 0;
+
+        unsigned int const nBins = mParameters.nRadialBins;
+        if ( nBins == 0 )
+            return score;
+
+        /* the zero frequency of a centered diffraction pattern */
+        bool const centered = mParameters.centered;
+        float const cx = nx / 2;
+        float const cy = ny / 2;
+        float const rMin = mParameters.minRadius;
+        float const rMax = mParameters.maxRadius > 0 ? mParameters.maxRadius
+                           : 0.5f * std::min( nx, ny );
+        float const binWidth = ( rMax - rMin ) / nBins;
+
+        std::vector<double> sums( nBins, 0 );
+        std::vector<unsigned int> counts( nBins, 0 );
+        if ( binWidth > 0 )
+        {
+            #pragma omp parallel
+            {
+                std::vector<double> threadSums( nBins, 0 );
+                std::vector<unsigned int> threadCounts( nBins, 0 );
+                #pragma omp for schedule( static )
+                for ( unsigned int iy = 0; iy < ny; ++iy )
+                {
+                    /* in the unshifted layout the neighbours of the zero
+                     * frequency at (0,0) are at the opposite edges */
+                    float const dy = centered ? iy - cy : std::min( iy, ny - iy );
+                    for ( unsigned int ix = 0; ix < nx; ++ix )
+                    {
+                        float const dx = centered ? ix - cx : std::min( ix, nx - ix );
+                        float const r2 = dx*dx + dy*dy;
+                        /* cheap rejection before the square root */
+                        if ( r2 < rMin*rMin or r2 >= rMax*rMax )
+                            continue;
+                        unsigned int const iBin = std::min( nBins - 1,
+                            unsigned( ( sqrt( r2 ) - rMin ) / binWidth ) );
+                        threadSums[iBin] += rData[ size_t( iy ) * nx + ix ];
+                        ++threadCounts[iBin];
+                    }
+                }
+                #pragma omp critical
+                for ( unsigned int i = 0; i < nBins; ++i )
+                {
+                    sums[i]   += threadSums[i];
+                    counts[i] += threadCounts[i];
+                }
+            }
+        }
+
+        double sum = 0;
+        unsigned int count = 0;
+        score.radialProfile.resize( nBins );
+        for ( unsigned int i = 0; i < nBins; ++i )
+        {
+            score.radialProfile[i] = counts[i] > 0 ? sums[i] / counts[i] : 0;
+            sum   += sums[i];
+            count += counts[i];
+        }
+        score.radialIntensity = count > 0 ? sum / count : 0;
+        return score;
+    }
+
+    bool HitFinder::isHit( HitScore const & rScore ) const
+    {
+        HitFinderParameters const & p = mParameters;
+        if ( p.minIntegratedIntensity > 0 and
+             not ( rScore.integratedIntensity >= p.minIntegratedIntensity ) )
+            return false;
+        if ( rScore.peakCount < p.minPeakCount )
+            return false;
+        if ( p.minRadialIntensity > 0 and p.nRadialBins > 0 and
+             not ( rScore.radialIntensity >= p.minRadialIntensity ) )
+            return false;
+        return true;
+    }
+
+    bool HitFinder::operator()
+    (
+        float const * rData,
+        std::pair<unsigned int,unsigned int> const & rSize
+    ) const
+    {
+        return isHit( score( rData, rSize ) );
+    }
+
+
+} // namespace algorithms
+} // namespace imresh
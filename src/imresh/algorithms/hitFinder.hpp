@@ -0,0 +1,133 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <utility>              // std::pair
+#include <vector>               // std::vector
+
+
+namespace imresh
+{
+namespace algorithms
+{
+
+
+    /**
+     * Thresholds of HitFinder. A frame is a hit if it passes all enabled
+     * criteria. The values are in the units of the frames given to
+     * HitFinder::score, i.e. intensities if used with the task queue.
+     */
+    struct HitFinderParameters
+    {
+        /** minimum sum over all pixels, 0 disables this criterion */
+        float minIntegratedIntensity;
+        /** pixels brighter than this are counted as peak pixels */
+        float peakThreshold;
+        /** minimum number of peak pixels, 0 disables this criterion */
+        unsigned minPeakCount;
+        /** the radial profile covers the annulus from minRadius to maxRadius
+         *  in pixels around the zero frequency. A maxRadius of 0 means half
+         *  of the smaller frame side. */
+        float minRadius;
+        float maxRadius;
+        /** false if the zero frequency is at pixel (0,0), i.e. the unshifted
+         *  layout the reconstruction expects, so that distances wrap around
+         *  the frame edges. true if the frame is centered with fftshift and
+         *  the zero frequency is at (nx/2,ny/2). */
+        bool centered;
+        /** number of bins of the radial profile, 0 disables it */
+        unsigned nRadialBins;
+        /** minimum mean intensity in the annulus, 0 disables this
+         *  criterion. Diffraction of a sample reaches out further than the
+         *  central scatter of an empty shot. */
+        float minRadialIntensity;
+
+        HitFinderParameters( void )
+        : minIntegratedIntensity( 0 ), peakThreshold( 0 ), minPeakCount( 0 ),
+          minRadius( 0 ), maxRadius( 0 ), centered( false ), nRadialBins( 0 ),
+          minRadialIntensity( 0 ) {}
+    };
+
+    /**
+     * Features of one frame as computed by HitFinder::score
+     */
+    struct HitScore
+    {
+        float integratedIntensity;
+        float maxValue;
+        /** number of pixels above HitFinderParameters::peakThreshold */
+        unsigned peakCount;
+        /** mean of all pixels in the annulus, 0 if the profile is disabled */
+        float radialIntensity;
+        /** mean intensity per ring from the inner to the outer radius */
+        std::vector<float> radialProfile;
+    };
+
+    /**
+     * Cheap classifier which tells blank frames from hits before they are
+     * reconstructed.
+     *
+     * Integrated intensity, maximum and peak count are computed in one fused
+     * pass (see vectorStatistics). The radial profile needs a second pass
+     * and is only computed if enabled. Scoring is const, so one hit finder
+     * can be used by several threads.
+     */
+    class HitFinder
+    {
+    public:
+        explicit HitFinder
+        (
+            HitFinderParameters const & rParameters = HitFinderParameters()
+        );
+
+        HitFinderParameters const & getParameters( void ) const;
+
+        /**
+         * @param rData frame in row-major order
+         * @param rSize width and height of the frame
+         */
+        HitScore score
+        (
+            float const * rData,
+            std::pair<unsigned int,unsigned int> const & rSize
+        ) const;
+
+        /**
+         * @return true if the score passes all enabled criteria
+         */
+        bool isHit( HitScore const & rScore ) const;
+
+        bool operator()
+        (
+            float const * rData,
+            std::pair<unsigned int,unsigned int> const & rSize
+        ) const;
+
+    private:
+        HitFinderParameters mParameters;
+    };
+
+
+} // namespace algorithms
+} // namespace imresh
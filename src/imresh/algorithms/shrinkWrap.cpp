@@ -28,15 +28,21 @@
 #include <cstddef>    // NULL
 #include <cstring>    // memcpy
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <iomanip>    // setw
+#include <mutex>      // std::unique_lock
 #include <string>
 #include <fstream>
 #include <vector>
 #include <fftw3.h>
+#include <omp.h>      // omp_set_num_threads
+#include "libs/fftwPlannerMutex.hpp" // getFftwPlannerMutex
+#include "libs/frameBuffer.hpp"    // allocateFrame, freeFrame
 #include "libs/gaussian.hpp"
 #include "libs/hybridInputOutput.hpp" // calculateHioError
+#include "libs/threadAffinity.hpp"    // pinThreadToNumaNode, firstTouch
 #include "algorithms/vectorReduce.hpp"
 #include "algorithms/vectorElementwise.hpp"
 
@@ -113,7 +119,13 @@ namespace algorithms
     }
 
 
-    #define DEBUG_SHRINKWRAPP_CPP 1
+    /* the dumps of the initial mask would dominate the run time of small
+     * images, so they are only written for debug builds */
+    #ifdef IMRESH_DEBUG
+    #   define DEBUG_SHRINKWRAPP_CPP 1
+    #else
+    #   define DEBUG_SHRINKWRAPP_CPP 0
+    #endif
 
     int shrinkWrap
     (
@@ -126,9 +138,14 @@ namespace algorithms
         float rIntensityCutOff,
         float rSigma0,
         float rSigmaChange,
-        unsigned rnHioCycles
+        unsigned rnHioCycles,
+        int rNumaNode,
+        std::vector<ShrinkWrapCycle> * rpCycles
     )
     {
+        using Clock = std::chrono::steady_clock;
+        const auto tStart = Clock::now();
+
         if ( rSize.size() != 2 ) return 1;
         const unsigned & Ny = rSize[1];
         const unsigned & Nx = rSize[0];
@@ -153,17 +170,34 @@ namespace algorithms
             nElements *= rSize[i];
         }
 
+        /* the OpenMP team is spawned by the calling thread and therefore
+         * inherits its affinity mask. The team size is a setting of the
+         * calling thread, so it is restored before returning */
+        const int nThreadsBefore = omp_get_max_threads();
+        if ( libs::pinThreadToNumaNode( rNumaNode ) )
+            omp_set_num_threads( libs::getNumaNodeCpus( rNumaNode ).size() );
+
         /* allocate needed memory so that HIO doesn't need to allocate and
-         * deallocate on each call */
-        fftwf_complex * const curData   = fftwf_alloc_complex( nElements );
-        fftwf_complex * const gPrevious = fftwf_alloc_complex( nElements );
-        auto const isMasked = new float[nElements];
+         * deallocate on each call. The frame buffer pool is aligned for
+         * FFTW's SIMD kernels and lets consecutive reconstructions reuse the
+         * arrays. */
+        fftwf_complex * const curData   = reinterpret_cast<fftwf_complex*>(
+            libs::allocateFrame( 2 * size_t( nElements ) ) );
+        fftwf_complex * const gPrevious = reinterpret_cast<fftwf_complex*>(
+            libs::allocateFrame( 2 * size_t( nElements ) ) );
+        float * const isMasked = libs::allocateFrame( nElements );
+        /* place the pages near the threads which will work on them */
+        libs::firstTouch( curData  , nElements * sizeof( curData  [0] ) );
+        libs::firstTouch( gPrevious, nElements * sizeof( gPrevious[0] ) );
+        libs::firstTouch( isMasked , nElements * sizeof( isMasked [0] ) );
 
         /* create fft plans G' to g' and g to G */
+        std::unique_lock<std::mutex> plannerLock( libs::getFftwPlannerMutex() );
         auto toRealSpace = fftwf_plan_dft( rSize.size(),
             (int*) &rSize[0], curData, curData, FFTW_BACKWARD, FFTW_ESTIMATE );
         auto toFreqSpace = fftwf_plan_dft( rSize.size(),
             (int*) &rSize[0], gPrevious, curData, FFTW_FORWARD, FFTW_ESTIMATE );
+        plannerLock.unlock();
 
         /* create first guess for mask from autocorrelation (fourier transform
          * of the intensity @see
@@ -239,6 +273,8 @@ namespace algorithms
         /* repeatedly call HIO algorithm and change mask */
         for ( unsigned iCycleShrinkWrap = 0; iCycleShrinkWrap < rnCycles; ++iCycleShrinkWrap )
         {
+            const auto tCycleStart = Clock::now();
+
             /************************** Update Mask ***************************/
             std::cout << "Update Mask with sigma=" << sigma << "\n";
 
@@ -287,6 +323,13 @@ namespace algorithms
             std::cout << "[Error " << currentError << "/" << rTargetError << "] "
                       << "[Cycle " << iCycleShrinkWrap << "/" << rnCycles-1 << "]"
                       << "\n";
+            if ( rpCycles != NULL )
+            {
+                const auto tCycleEnd = Clock::now();
+                rpCycles->push_back( ShrinkWrapCycle{ currentError,
+                    std::chrono::duration<double>( tCycleEnd - tCycleStart ).count(),
+                    std::chrono::duration<double>( tCycleEnd - tStart ).count() } );
+            }
             if ( rTargetError > 0 && currentError < rTargetError )
                 break;
             if ( iCycleShrinkWrap >= rnCycles )
@@ -296,11 +339,14 @@ namespace algorithms
             rIntensity[i] = curData[i][0];
 
         /* free buffers and plans */
+        plannerLock.lock();
         fftwf_destroy_plan( toFreqSpace );
         fftwf_destroy_plan( toRealSpace );
-        fftwf_free( curData  );
-        fftwf_free( gPrevious);
-        delete[] isMasked;
+        plannerLock.unlock();
+        libs::freeFrame( reinterpret_cast<float*>( curData   ) );
+        libs::freeFrame( reinterpret_cast<float*>( gPrevious ) );
+        libs::freeFrame( isMasked );
+        omp_set_num_threads( nThreadsBefore );
 
         return 0;
     }
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include <cstddef>    // NULL
 #include <vector>
 
 
@@ -33,8 +34,34 @@ namespace imresh
 namespace algorithms
 {
 
+    /**
+     * Progress of one shrink-wrap cycle, i.e. of one mask update followed by
+     * rnHioCycles HIO iterations
+     **/
+    struct ShrinkWrapCycle
+    {
+        /* error after this cycle as returned by calculateHioError */
+        float error;
+        /* wall time needed for this cycle */
+        double cycleSeconds;
+        /* wall time since shrinkWrap was called, i.e. including the
+         * allocations and the initial mask */
+        double elapsedSeconds;
+    };
+
     /**
      * The exact same as @see cudaShrinkWrap
+     *
+     * @param[in] rNumaNode if not negative, the calling thread and with it
+     *            its OpenMP team are pinned to the CPUs of this NUMA node and
+     *            the working arrays are first touched by that team, so that
+     *            they are allocated in local memory. Note that the calling
+     *            thread stays pinned after returning, which is what a worker
+     *            thread dedicated to one node wants. While running, the
+     *            OpenMP team has one thread per CPU of the node, the previous
+     *            omp_set_num_threads setting is restored on return.
+     * @param[out] rpCycles if not NULL, the progress of every executed cycle
+     *             is appended, e.g. for measuring the time to reach an error
      **/
     int shrinkWrap
     (
@@ -47,7 +74,9 @@ namespace algorithms
         float rIntensityCutOff = 0.20,
         float sigma0 = 3.0,
         float rSigmaChange = 0.01,
-        unsigned rnHioCycles = 20
+        unsigned rnHioCycles = 20,
+        int rNumaNode = -1,
+        std::vector<ShrinkWrapCycle> * rpCycles = NULL
     );
 
 
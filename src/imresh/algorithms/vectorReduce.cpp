@@ -102,6 +102,27 @@ namespace algorithms
         return minimum;
     }
 
+    template<class T_PREC>
+    std::pair<T_PREC,T_PREC> vectorMinMax
+    (
+        const T_PREC * const & rData,
+        const unsigned & rnData,
+        const unsigned & rnStride
+    )
+    {
+        assert( rnStride > 0 );
+        T_PREC minimum = std::numeric_limits<T_PREC>::max();
+        T_PREC maximum = std::numeric_limits<T_PREC>::lowest();
+        /* comparisons with NaN are false, so NaNs are skipped */
+        #pragma omp parallel for reduction( min : minimum ) reduction( max : maximum )
+        for ( unsigned i = 0; i < rnData*rnStride; i += rnStride )
+        {
+            minimum = rData[i] < minimum ? rData[i] : minimum;
+            maximum = rData[i] > maximum ? rData[i] : maximum;
+        }
+        return std::make_pair( minimum, maximum );
+    }
+
     template<class T_PREC>
     T_PREC vectorSum
     (
@@ -118,6 +139,33 @@ namespace algorithms
         return sum;
     }
 
+    template<class T_PREC>
+    VectorStatistics<T_PREC> vectorStatistics
+    (
+        const T_PREC * const & rData,
+        const unsigned & rnData,
+        const T_PREC & rThreshold,
+        const unsigned & rnStride
+    )
+    {
+        assert( rnStride > 0 );
+        T_PREC sum = T_PREC(0);
+        T_PREC maximum = std::numeric_limits<T_PREC>::lowest();
+        unsigned nAbove = 0;
+        #pragma omp parallel for reduction( + : sum, nAbove ) reduction( max : maximum )
+        for ( unsigned i = 0; i < rnData*rnStride; i += rnStride )
+        {
+            sum += rData[i];
+            maximum = rData[i] > maximum ? rData[i] : maximum;
+            nAbove += rData[i] > rThreshold;
+        }
+        VectorStatistics<T_PREC> statistics;
+        statistics.sum    = sum;
+        statistics.max    = maximum;
+        statistics.nAbove = nAbove;
+        return statistics;
+    }
+
 
     /* explicitly instantiate needed data types */
 
@@ -175,6 +223,19 @@ namespace algorithms
         const unsigned & rnStride
     );
 
+    template std::pair<float,float> vectorMinMax<float>
+    (
+        const float * const & rData,
+        const unsigned & rnData,
+        const unsigned & rnStride
+    );
+    template std::pair<double,double> vectorMinMax<double>
+    (
+        const double * const & rData,
+        const unsigned & rnData,
+        const unsigned & rnStride
+    );
+
     template float vectorSum<float>
     (
         const float * const & rData,
@@ -188,6 +249,21 @@ namespace algorithms
         const unsigned & rnStride
     );
 
+    template VectorStatistics<float> vectorStatistics<float>
+    (
+        const float * const & rData,
+        const unsigned & rnData,
+        const float & rThreshold,
+        const unsigned & rnStride
+    );
+    template VectorStatistics<double> vectorStatistics<double>
+    (
+        const double * const & rData,
+        const unsigned & rnData,
+        const double & rThreshold,
+        const unsigned & rnStride
+    );
+
 
 } // namespace algorithms
 } // namespace imresh
@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include <utility>    // pair
+
 
 namespace imresh
 {
@@ -70,6 +72,20 @@ namespace algorithms
         const unsigned & rnStride = 1
     );
 
+    /**
+     * Calculates minimum and maximum in one pass. NaN values are ignored.
+     *
+     * @return ( minimum, maximum ), ( max(), lowest() ) of the numeric
+     *         limits if there are no values except NaN
+     **/
+    template<class T>
+    std::pair<T,T> vectorMinMax
+    (
+        const T * const & rData,
+        const unsigned & rnData,
+        const unsigned & rnStride = 1
+    );
+
     template<class T>
     T vectorSum
     (
@@ -78,6 +94,33 @@ namespace algorithms
         const unsigned & rnStride = 1
     );
 
+    /**
+     * Result of vectorStatistics
+     **/
+    template<class T>
+    struct VectorStatistics
+    {
+        T sum;
+        /* lowest() of the numeric limits if there are no values except NaN */
+        T max;
+        /* number of values greater than the threshold */
+        unsigned nAbove;
+    };
+
+    /**
+     * Calculates sum, maximum and the number of values above a threshold in
+     * one pass, e.g. for classifying frames without reading them thrice.
+     * NaN values are ignored by the maximum and count.
+     **/
+    template<class T>
+    VectorStatistics<T> vectorStatistics
+    (
+        const T * const & rData,
+        const unsigned & rnData,
+        const T & rThreshold,
+        const unsigned & rnStride = 1
+    );
+
 
 } // namespace algorithms
 } // namespace imresh
@@ -0,0 +1,515 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/binaryFormats.hpp"
+
+#include <cerrno>                   // errno, EINTR
+#include <cstdio>                   // perror
+#include <cstdlib>                  // strtoull
+#include <cstring>                  // memcmp, memcpy
+#include <fcntl.h>                  // open
+#include <sys/mman.h>               // mmap, munmap, madvise
+#include <sys/stat.h>               // fstat
+#include <sys/uio.h>                // writev
+#include <unistd.h>                 // close
+
+#include "libs/frameBuffer.hpp"     // allocateFrame, freeFrame
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    namespace
+    {
+        char const rawMagic[8] = { 'I','M','R','E','S','H','R','F' };
+        char const npyMagic[6] = { '\x93','N','U','M','P','Y' };
+
+        bool isLittleEndianHost( void )
+        {
+            uint16_t const one = 1;
+            return *reinterpret_cast<uint8_t const*>( &one ) == 1;
+        }
+
+        /**
+         * Reads a little endian integer of sizeof(T) bytes
+         */
+        template< class T >
+        T readLittleEndian( unsigned char const * rData )
+        {
+            T value = 0;
+            for ( size_t i = 0; i < sizeof( T ); ++i )
+                value |= T( rData[i] ) << ( 8 * i );
+            return value;
+        }
+
+        template< class T >
+        void appendLittleEndian( std::string & rOut, T rValue )
+        {
+            for ( size_t i = 0; i < sizeof( T ); ++i )
+                rOut += char( ( rValue >> ( 8 * i ) ) & 0xFF );
+        }
+
+        /**
+         * Checks that the frames described by the layout fit into the file.
+         */
+        bool fitsInto( BinaryLayout const & rLayout, size_t const rnBytes )
+        {
+            if ( rLayout.width == 0 or rLayout.height == 0 or
+                 rLayout.dataOffset > rnBytes )
+                return false;
+            size_t const frameBytes = rLayout.getFrameBytes();
+            return rLayout.nFrames <= ( rnBytes - rLayout.dataOffset ) / frameBytes;
+        }
+
+        /**
+         * Returns the value following 'key': in the header dictionary of
+         * a .npy file, i.e. everything up to the next comma outside of
+         * parentheses or the closing brace.
+         */
+        std::string getNpyValue( std::string const & rHeader, std::string const & rKey )
+        {
+            size_t begin = rHeader.find( "'" + rKey + "'" );
+            if ( begin == std::string::npos )
+                return "";
+            begin = rHeader.find( ':', begin );
+            if ( begin == std::string::npos )
+                return "";
+            ++begin;
+            int depth = 0;
+            size_t end = begin;
+            for ( ; end < rHeader.size(); ++end )
+            {
+                char const c = rHeader[end];
+                if ( c == '(' )
+                    ++depth;
+                else if ( c == ')' )
+                    --depth;
+                else if ( depth == 0 and ( c == ',' or c == '}' ) )
+                    break;
+            }
+            /* strip spaces and quotes */
+            std::string value = rHeader.substr( begin, end - begin );
+            size_t const first = value.find_first_not_of( " '\"" );
+            size_t const last  = value.find_last_not_of( " '\"" );
+            return first == std::string::npos ? "" : value.substr( first, last - first + 1 );
+        }
+    } // anonymous namespace
+
+    size_t getElementSize( ElementType const _type )
+    {
+        switch ( _type )
+        {
+            case ElementType::Float32: return 4;
+            case ElementType::Float64: return 8;
+            case ElementType::UInt16 : return 2;
+            case ElementType::UInt32 : return 4;
+        }
+        return 0;
+    }
+
+    size_t BinaryLayout::getFrameBytes( void ) const
+    {
+        return size_t( width ) * height * getElementSize( type );
+    }
+
+    bool parseRawHeader
+    (
+        void const * const _data,
+        size_t const _nBytes,
+        BinaryLayout & _layout
+    )
+    {
+        auto const data = static_cast<unsigned char const*>( _data );
+        if ( _nBytes < rawHeaderSize or memcmp( data, rawMagic, sizeof( rawMagic ) ) != 0 or
+             readLittleEndian<uint32_t>( data + 8 ) != 1 )
+            return false;
+        uint32_t const type = readLittleEndian<uint32_t>( data + 12 );
+        if ( type > uint32_t( ElementType::UInt32 ) )
+            return false;
+        _layout.dataOffset      = rawHeaderSize;
+        _layout.type            = ElementType( type );
+        _layout.nativeByteOrder = isLittleEndianHost();
+        _layout.width           = readLittleEndian<uint32_t>( data + 16 );
+        _layout.height          = readLittleEndian<uint32_t>( data + 20 );
+        _layout.nFrames         = readLittleEndian<uint64_t>( data + 24 );
+        return fitsInto( _layout, _nBytes );
+    }
+
+    bool parseNpyHeader
+    (
+        void const * const _data,
+        size_t const _nBytes,
+        BinaryLayout & _layout
+    )
+    {
+        auto const data = static_cast<unsigned char const*>( _data );
+        if ( _nBytes < 10 or memcmp( data, npyMagic, sizeof( npyMagic ) ) != 0 )
+            return false;
+        unsigned const majorVersion = data[6];
+        size_t headerStart, headerLength;
+        if ( majorVersion == 1 )
+        {
+            headerStart  = 10;
+            headerLength = readLittleEndian<uint16_t>( data + 8 );
+        }
+        else if ( majorVersion == 2 or majorVersion == 3 )
+        {
+            if ( _nBytes < 12 )
+                return false;
+            headerStart  = 12;
+            headerLength = readLittleEndian<uint32_t>( data + 8 );
+        }
+        else
+            return false;
+        if ( headerStart + headerLength > _nBytes )
+            return false;
+        std::string const header( reinterpret_cast<char const*>( data ) + headerStart,
+                                  headerLength );
+
+        if ( getNpyValue( header, "fortran_order" ) != "False" )
+            return false;
+
+        std::string const descr = getNpyValue( header, "descr" );
+        if ( descr.size() != 3 )
+            return false;
+        std::string const kind = descr.substr( 1 );
+        if      ( kind == "f4" ) _layout.type = ElementType::Float32;
+        else if ( kind == "f8" ) _layout.type = ElementType::Float64;
+        else if ( kind == "u2" ) _layout.type = ElementType::UInt16;
+        else if ( kind == "u4" ) _layout.type = ElementType::UInt32;
+        else
+            return false;
+        if ( descr[0] == '<' )
+            _layout.nativeByteOrder = isLittleEndianHost();
+        else if ( descr[0] == '>' )
+            _layout.nativeByteOrder = not isLittleEndianHost();
+        else if ( descr[0] == '=' )
+            _layout.nativeByteOrder = true;
+        else
+            return false;
+
+        /* e.g. "(512, 512)" or "(100, 512, 512)" */
+        std::string const shape = getNpyValue( header, "shape" );
+        uint64_t dimensions[3];
+        unsigned nDimensions = 0;
+        for ( size_t i = shape.find( '(' ); i != std::string::npos and i < shape.size(); )
+        {
+            char * end = NULL;
+            unsigned long long const value = strtoull( shape.c_str() + i + 1, &end, 10 );
+            if ( end == shape.c_str() + i + 1 )
+                break;
+            if ( nDimensions == 3 )
+                return false;
+            dimensions[ nDimensions++ ] = value;
+            i = shape.find( ',', end - shape.c_str() );
+        }
+        if ( nDimensions == 2 )
+        {
+            _layout.nFrames = 1;
+            _layout.height  = dimensions[0];
+            _layout.width   = dimensions[1];
+        }
+        else if ( nDimensions == 3 )
+        {
+            _layout.nFrames = dimensions[0];
+            _layout.height  = dimensions[1];
+            _layout.width   = dimensions[2];
+        }
+        else
+            return false;
+        _layout.dataOffset = headerStart + headerLength;
+        return fitsInto( _layout, _nBytes );
+    }
+
+    bool parseBinaryHeader
+    (
+        std::string const & _filename,
+        void const * const _data,
+        size_t const _nBytes,
+        BinaryLayout & _layout
+    )
+    {
+        std::string const extension = _filename.substr( _filename.rfind( '.' ) + 1 );
+        if ( extension == "npy" )
+            return parseNpyHeader( _data, _nBytes, _layout );
+        if ( extension == "raw" )
+            return parseRawHeader( _data, _nBytes, _layout );
+        return false;
+    }
+
+    std::string makeRawHeader
+    (
+        uint32_t const _width,
+        uint32_t const _height,
+        uint64_t const _nFrames
+    )
+    {
+        std::string header( rawMagic, sizeof( rawMagic ) );
+        appendLittleEndian<uint32_t>( header, 1 );
+        appendLittleEndian<uint32_t>( header, uint32_t( ElementType::Float32 ) );
+        appendLittleEndian<uint32_t>( header, _width );
+        appendLittleEndian<uint32_t>( header, _height );
+        appendLittleEndian<uint64_t>( header, _nFrames );
+        return header;
+    }
+
+    std::string makeNpyHeader
+    (
+        uint32_t const _width,
+        uint32_t const _height,
+        uint64_t const _nFrames
+    )
+    {
+        std::string dictionary = std::string( "{'descr': '" ) +
+            ( isLittleEndianHost() ? '<' : '>' ) + "f4', 'fortran_order': False, 'shape': (";
+        if ( _nFrames != 1 )
+            dictionary += std::to_string( _nFrames ) + ", ";
+        dictionary += std::to_string( _height ) + ", " + std::to_string( _width ) + "), }";
+        /* pad with spaces and a newline, so that the data is aligned */
+        size_t const headerStart = 10;
+        size_t const length = ( headerStart + dictionary.size() + 1 + 63 ) / 64 * 64 - headerStart;
+        dictionary.resize( length - 1, ' ' );
+        dictionary += '\n';
+
+        std::string header( npyMagic, sizeof( npyMagic ) );
+        header += char( 1 );
+        header += char( 0 );
+        appendLittleEndian<uint16_t>( header, length );
+        return header + dictionary;
+    }
+
+    void convertToFloat
+    (
+        void const * const _source,
+        ElementType const _type,
+        bool const _nativeByteOrder,
+        size_t const _nElements,
+        float * const _destination
+    )
+    {
+        switch ( _type )
+        {
+            case ElementType::Float32:
+            {
+                if ( _nativeByteOrder )
+                {
+                    memcpy( _destination, _source, _nElements * sizeof( float ) );
+                    break;
+                }
+                auto const source = static_cast<uint32_t const*>( _source );
+                for ( size_t i = 0; i < _nElements; ++i )
+                {
+                    uint32_t const swapped = __builtin_bswap32( source[i] );
+                    memcpy( _destination + i, &swapped, sizeof( float ) );
+                }
+                break;
+            }
+            case ElementType::Float64:
+            {
+                auto const source = static_cast<uint64_t const*>( _source );
+                for ( size_t i = 0; i < _nElements; ++i )
+                {
+                    uint64_t const bits = _nativeByteOrder ? source[i] :
+                                          __builtin_bswap64( source[i] );
+                    double value;
+                    memcpy( &value, &bits, sizeof( value ) );
+                    _destination[i] = float( value );
+                }
+                break;
+            }
+            case ElementType::UInt16:
+            {
+                auto const source = static_cast<uint16_t const*>( _source );
+                if ( _nativeByteOrder )
+                {
+                    for ( size_t i = 0; i < _nElements; ++i )
+                        _destination[i] = source[i];
+                    break;
+                }
+                for ( size_t i = 0; i < _nElements; ++i )
+                    _destination[i] = __builtin_bswap16( source[i] );
+                break;
+            }
+            case ElementType::UInt32:
+            {
+                auto const source = static_cast<uint32_t const*>( _source );
+                if ( _nativeByteOrder )
+                {
+                    for ( size_t i = 0; i < _nElements; ++i )
+                        _destination[i] = source[i];
+                    break;
+                }
+                for ( size_t i = 0; i < _nElements; ++i )
+                    _destination[i] = __builtin_bswap32( source[i] );
+                break;
+            }
+        }
+    }
+
+    bool writeBinaryFile
+    (
+        std::string const & _filename,
+        std::string const & _header,
+        void const * const _data,
+        size_t const _nBytes
+    )
+    {
+        int const fd = open( _filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+        if ( fd < 0 )
+        {
+            perror( "imresh::io::writeBinaryFile(): open failed" );
+            return false;
+        }
+        /* header and data in one system call, repeated only if the kernel
+         * writes less than requested */
+        iovec parts[2];
+        parts[0].iov_base = const_cast<char*>( _header.data() );
+        parts[0].iov_len  = _header.size();
+        parts[1].iov_base = const_cast<void*>( _data );
+        parts[1].iov_len  = _nBytes;
+        iovec * part = parts;
+        int nParts = 2;
+        while ( nParts > 0 )
+        {
+            ssize_t nWritten = writev( fd, part, nParts );
+            if ( nWritten < 0 )
+            {
+                if ( errno == EINTR )
+                    continue;
+                perror( "imresh::io::writeBinaryFile(): write failed" );
+                close( fd );
+                return false;
+            }
+            while ( nParts > 0 and size_t( nWritten ) >= part->iov_len )
+            {
+                nWritten -= part->iov_len;
+                ++part;
+                --nParts;
+            }
+            if ( nParts > 0 )
+            {
+                part->iov_base = static_cast<char*>( part->iov_base ) + nWritten;
+                part->iov_len -= nWritten;
+            }
+        }
+        if ( close( fd ) != 0 )
+        {
+            perror( "imresh::io::writeBinaryFile(): close failed" );
+            return false;
+        }
+        return true;
+    }
+
+    MappedFrame::MappedFrame( std::string const & rFilename, size_t const rFrame )
+    : mMapping( NULL ), mnMappedBytes( 0 ), mData( NULL ), mConverted( NULL ),
+      mSize( 0, 0 )
+    {
+        int const fd = open( rFilename.c_str(), O_RDONLY | O_CLOEXEC );
+        struct stat info;
+        if ( fd < 0 or fstat( fd, &info ) != 0 or info.st_size == 0 )
+        {
+            if ( fd >= 0 )
+                close( fd );
+            return;
+        }
+        /* writable but private: the reconstruction may work in place, the
+         * touched pages are copied on write and the file stays unchanged */
+        void * const mapping = mmap( NULL, info.st_size, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE, fd, 0 );
+        close( fd );
+        if ( mapping == MAP_FAILED )
+        {
+            perror( "imresh::io::MappedFrame(): mmap failed" );
+            return;
+        }
+        mMapping     = mapping;
+        mnMappedBytes = info.st_size;
+
+        BinaryLayout layout;
+        if ( not parseBinaryHeader( rFilename, mapping, mnMappedBytes, layout ) or
+             rFrame >= layout.nFrames )
+        {
+            munmap( mMapping, mnMappedBytes );
+            mMapping = NULL;
+            return;
+        }
+        char * const frame = static_cast<char*>( mapping ) + layout.dataOffset +
+                             rFrame * layout.getFrameBytes();
+        size_t const nElements = size_t( layout.width ) * layout.height;
+        mSize = { layout.width, layout.height };
+
+        if ( layout.type == ElementType::Float32 and layout.nativeByteOrder and
+             reinterpret_cast<uintptr_t>( frame ) % alignof( float ) == 0 )
+        {
+            madvise( mapping, mnMappedBytes, MADV_WILLNEED );
+            mData = reinterpret_cast<float*>( frame );
+            return;
+        }
+
+        mConverted = libs::allocateFrame( nElements );
+        if ( mConverted == NULL )
+        {
+            munmap( mMapping, mnMappedBytes );
+            mMapping = NULL;
+            return;
+        }
+        convertToFloat( frame, layout.type, layout.nativeByteOrder, nElements, mConverted );
+        mData = mConverted;
+        munmap( mMapping, mnMappedBytes );
+        mMapping = NULL;
+    }
+
+    MappedFrame::~MappedFrame()
+    {
+        if ( mMapping != NULL )
+            munmap( mMapping, mnMappedBytes );
+        libs::freeFrame( mConverted );
+    }
+
+    bool MappedFrame::isOpen( void ) const
+    {
+        return mData != NULL;
+    }
+
+    bool MappedFrame::isZeroCopy( void ) const
+    {
+        return mData != NULL and mConverted == NULL;
+    }
+
+    float * MappedFrame::getData( void )
+    {
+        return mData;
+    }
+
+    std::pair<unsigned int,unsigned int> MappedFrame::getSize( void ) const
+    {
+        return mSize;
+    }
+
+
+} // namespace io
+} // namespace imresh
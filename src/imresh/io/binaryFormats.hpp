@@ -0,0 +1,190 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint32_t, uint64_t
+#include <string>                   // std::string
+#include <utility>                  // std::pair
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Element types which can be read from binary frame files. Everything
+     * is converted to float for the reconstruction.
+     */
+    enum class ElementType : uint32_t
+    {
+        Float32 = 0,
+        Float64 = 1,
+        UInt16  = 2,
+        UInt32  = 3
+    };
+
+    size_t getElementSize( ElementType _type );
+
+    /**
+     * Where the frames are inside a binary file and how they are stored.
+     * A file holds nFrames frames of width * height elements each, stored
+     * in C order (row after row) one after another starting at dataOffset.
+     */
+    struct BinaryLayout
+    {
+        size_t dataOffset;
+        ElementType type;
+        /** false if the elements have to be byte swapped */
+        bool nativeByteOrder;
+        uint64_t nFrames;
+        uint32_t width;
+        uint32_t height;
+
+        size_t getFrameBytes( void ) const;
+    };
+
+    /**
+     * imresh's own binary format ".raw": a 32 byte header followed by the
+     * frames in little endian.
+     *
+     *   char     magic[8]     "IMRESHRF"
+     *   uint32_t version      1
+     *   uint32_t elementType  see ElementType
+     *   uint32_t width
+     *   uint32_t height
+     *   uint64_t nFrames
+     */
+    constexpr size_t rawHeaderSize = 32;
+
+    /**
+     * Parses the header of a ".raw" file.
+     *
+     * @param _data start of the file
+     * @param _nBytes size of the file, the frames have to fit into it
+     * @return false if it isn't a valid ".raw" file
+     */
+    bool parseRawHeader( void const * _data, size_t _nBytes, BinaryLayout & _layout );
+
+    /**
+     * Parses the header of a NumPy ".npy" file (format version 1 to 3). The
+     * array must be C ordered, of type float32, float64, uint16 or uint32
+     * in either byte order and have the shape (height, width) or (nFrames,
+     * height, width).
+     */
+    bool parseNpyHeader( void const * _data, size_t _nBytes, BinaryLayout & _layout );
+
+    /**
+     * Parses the header depending on the file extension, ".raw" or ".npy".
+     */
+    bool parseBinaryHeader
+    (
+        std::string const & _filename,
+        void const * _data,
+        size_t _nBytes,
+        BinaryLayout & _layout
+    );
+
+    /**
+     * @return header of a ".raw" file with float32 elements
+     */
+    std::string makeRawHeader( uint32_t _width, uint32_t _height, uint64_t _nFrames );
+
+    /**
+     * @return header of a ".npy" file with float32 elements in native byte
+     *         order, padded so that the data starts 64 byte aligned
+     */
+    std::string makeNpyHeader( uint32_t _width, uint32_t _height, uint64_t _nFrames );
+
+    /**
+     * Converts _nElements elements to float in a single pass. The loops
+     * have no branches depending on the data, so they are vectorized.
+     */
+    void convertToFloat
+    (
+        void const * _source,
+        ElementType _type,
+        bool _nativeByteOrder,
+        size_t _nElements,
+        float * _destination
+    );
+
+    /**
+     * Writes the header and then the data with as few and large writes as
+     * possible into a new file.
+     *
+     * @return false on error, reported with perror
+     */
+    bool writeBinaryFile
+    (
+        std::string const & _filename,
+        std::string const & _header,
+        void const * _data,
+        size_t _nBytes
+    );
+
+    /**
+     * A frame of a ".raw" or ".npy" file mapped into memory. If the file
+     * stores float32 in native byte order, the frame is used directly from
+     * the page cache without any copy. The mapping is private, so the
+     * reconstruction may still work in place without changing the file.
+     * Other element types are converted into an own buffer once.
+     *
+     * The object has to live until the reconstruction working on getData
+     * is written out.
+     */
+    class MappedFrame
+    {
+    public:
+        /**
+         * @param rFrame index of the frame for files with several frames
+         */
+        explicit MappedFrame( std::string const & rFilename, size_t rFrame = 0 );
+        ~MappedFrame();
+
+        MappedFrame( MappedFrame const & ) = delete;
+        MappedFrame & operator=( MappedFrame const & ) = delete;
+
+        bool isOpen( void ) const;
+        /**
+         * @return true if getData points directly into the mapped file
+         */
+        bool isZeroCopy( void ) const;
+        float * getData( void );
+        std::pair<unsigned int,unsigned int> getSize( void ) const;
+
+    private:
+        void * mMapping;
+        size_t mnMappedBytes;
+        float * mData;
+        float * mConverted;
+        std::pair<unsigned int,unsigned int> mSize;
+    };
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,207 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/directoryWatcher.hpp"
+
+#include <cerrno>                   // errno, EINTR
+#include <cstdio>                   // perror
+#ifdef IMRESH_DEBUG
+#   include <iostream>              // std::cout, std::endl
+#endif
+#include <poll.h>                   // poll
+#include <sys/eventfd.h>            // eventfd
+#include <sys/inotify.h>            // inotify_init1, inotify_add_watch
+#include <unistd.h>                 // read, write, close
+
+#include "io/readInFuncs/readInFuncs.hpp"   // isSupportedFile
+#include "io/taskQueueMetrics.hpp"          // taskQueueNow
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    DirectoryWatcher::DirectoryWatcher
+    (
+        std::string const & rDirectory,
+        FileFunc rOnFile,
+        size_t rnMaxBacklog,
+        FilterFunc rFilter
+    )
+    : mDirectory( rDirectory ), mOnFile( rOnFile ),
+      mFilter( rFilter ? rFilter : FilterFunc( readInFuncs::isSupportedFile ) ),
+      mnMaxBacklog( rnMaxBacklog ), mInotifyFd( -1 ), mStopFd( -1 ),
+      mStopped( false ), mnDetected( 0 ), mnHandled( 0 ), mnDropped( 0 ),
+      mnOverflows( 0 )
+    {
+        mInotifyFd = inotify_init1( IN_CLOEXEC );
+        mStopFd    = eventfd( 0, EFD_CLOEXEC );
+        if ( mInotifyFd < 0 or mStopFd < 0 )
+        {
+            perror( "imresh::io::DirectoryWatcher(): inotify_init1 or eventfd failed" );
+            return;
+        }
+        /* IN_CLOSE_WRITE: written in place, IN_MOVED_TO: renamed into it */
+        if ( inotify_add_watch( mInotifyFd, rDirectory.c_str(),
+                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR ) < 0 )
+        {
+            perror( "imresh::io::DirectoryWatcher(): inotify_add_watch failed" );
+            close( mInotifyFd );
+            mInotifyFd = -1;
+            return;
+        }
+        mEventThread   = std::thread( &DirectoryWatcher::readEvents, this );
+        mHandlerThread = std::thread( &DirectoryWatcher::handleFiles, this );
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::DirectoryWatcher(): Watching "
+                      << rDirectory << std::endl;
+#       endif
+    }
+
+    DirectoryWatcher::~DirectoryWatcher()
+    {
+        stop();
+        if ( mInotifyFd >= 0 )
+            close( mInotifyFd );
+        if ( mStopFd >= 0 )
+            close( mStopFd );
+    }
+
+    bool DirectoryWatcher::isOpen( void ) const
+    {
+        return mInotifyFd >= 0;
+    }
+
+    void DirectoryWatcher::stop( void )
+    {
+        if ( not isOpen() or mStopped.exchange( true ) )
+            return;
+        uint64_t const one = 1;
+        if ( write( mStopFd, &one, sizeof( one ) ) != sizeof( one ) )
+            perror( "imresh::io::DirectoryWatcher::stop(): write failed" );
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mBacklogChanged.notify_all();
+        }
+        mEventThread.join();
+        mHandlerThread.join();
+    }
+
+    void DirectoryWatcher::readEvents( void )
+    {
+        /* big enough for a few hundred events per read, so that bursts are
+         * taken from the kernel queue quickly */
+        alignas( inotify_event ) char buffer[ 64 * 1024 ];
+        pollfd fds[2] = { { mInotifyFd, POLLIN, 0 }, { mStopFd, POLLIN, 0 } };
+
+        while ( not mStopped )
+        {
+            if ( poll( fds, 2, -1 ) < 0 )
+            {
+                if ( errno == EINTR )
+                    continue;
+                perror( "imresh::io::DirectoryWatcher::readEvents(): poll failed" );
+                break;
+            }
+            if ( fds[1].revents != 0 )
+                break;
+
+            ssize_t const nBytes = read( mInotifyFd, buffer, sizeof( buffer ) );
+            if ( nBytes <= 0 )
+                continue;
+
+            int64_t const now = taskQueueNow();
+            std::lock_guard<std::mutex> lock( mMutex );
+            for ( char * p = buffer; p < buffer + nBytes; )
+            {
+                inotify_event const * const event =
+                    reinterpret_cast<inotify_event const*>( p );
+                p += sizeof( inotify_event ) + event->len;
+
+                if ( event->mask & IN_Q_OVERFLOW )
+                {
+                    ++mnOverflows;
+                    continue;
+                }
+                if ( event->len == 0 or ( event->mask & IN_ISDIR ) )
+                    continue;
+                std::string const path = mDirectory + "/" + event->name;
+                if ( not mFilter( path ) )
+                    continue;
+
+                ++mnDetected;
+                mBacklog.emplace_back( path, now );
+                if ( mnMaxBacklog > 0 and mBacklog.size() > mnMaxBacklog )
+                {
+                    mBacklog.pop_front();
+                    ++mnDropped;
+                }
+            }
+            mBacklogChanged.notify_all();
+        }
+    }
+
+    void DirectoryWatcher::handleFiles( void )
+    {
+        while ( true )
+        {
+            std::pair<std::string,int64_t> file;
+            {
+                std::unique_lock<std::mutex> lock( mMutex );
+                mBacklogChanged.wait( lock, [this]{
+                    return mStopped or not mBacklog.empty(); } );
+                if ( mStopped )
+                    break;
+                file = std::move( mBacklog.front() );
+                mBacklog.pop_front();
+            }
+            mLag.record( taskQueueNow() - file.second );
+            mOnFile( file.first );
+            ++mnHandled;
+        }
+    }
+
+    DirectoryWatcherStatistics DirectoryWatcher::getStatistics( void ) const
+    {
+        double const nsToMs = 1e-6;
+        DirectoryWatcherStatistics statistics;
+        statistics.nDetected  = mnDetected;
+        statistics.nHandled   = mnHandled;
+        statistics.nDropped   = mnDropped;
+        statistics.nOverflows = mnOverflows;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            statistics.backlog = mBacklog.size();
+        }
+        statistics.lagP50 = mLag.getPercentile( 50 ) * nsToMs;
+        statistics.lagP99 = mLag.getPercentile( 99 ) * nsToMs;
+        statistics.lagMax = mLag.getMax() * nsToMs;
+        return statistics;
+    }
+
+
+} // namespace io
+} // namespace imresh
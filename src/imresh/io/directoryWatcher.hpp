@@ -0,0 +1,153 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>                   // std::atomic
+#include <condition_variable>       // std::condition_variable
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint64_t, int64_t
+#include <deque>                    // std::deque
+#include <functional>               // std::function
+#include <mutex>                    // std::mutex
+#include <string>                   // std::string
+#include <thread>                   // std::thread
+#include <utility>                  // std::pair
+
+#include "libs/latencyHistogram.hpp"
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Counters of a DirectoryWatcher. The lag is the time between a file
+     * being completed and being handed to the callback, in milliseconds.
+     */
+    struct DirectoryWatcherStatistics
+    {
+        uint64_t nDetected;
+        uint64_t nHandled;
+        /**
+         * files which were skipped, because the backlog was full
+         */
+        uint64_t nDropped;
+        /**
+         * times the kernel event queue overflowed, events were lost then
+         */
+        uint64_t nOverflows;
+        uint64_t backlog;
+        double lagP50;
+        double lagP99;
+        double lagMax;
+    };
+
+    /**
+     * Watches a directory with inotify and calls a function for every file
+     * which was completely written into it, i.e. which was closed after
+     * writing or renamed into the directory. Writers which create a file
+     * under a temporary name and rename it afterwards should use a name
+     * the filter rejects for the temporary file.
+     *
+     * Events are read by one thread and queued, the callback is called from
+     * a second thread, so bursts of files don't overflow the kernel event
+     * queue while the callback blocks, e.g. in addTask. To bound the lag of
+     * online processing, the oldest queued files are dropped when more than
+     * rnMaxBacklog files are waiting. Subdirectories are not watched.
+     */
+    class DirectoryWatcher
+    {
+    public:
+        typedef std::function<void(std::string const &)> FileFunc;
+        typedef std::function<bool(std::string const &)> FilterFunc;
+
+        /**
+         * Starts watching. Check isOpen afterwards.
+         *
+         * @param rOnFile called with the path (directory + "/" + name) of
+         *        every completed file passing the filter
+         * @param rnMaxBacklog 0 never drops files
+         * @param rFilter defaults to readInFuncs::isSupportedFile
+         */
+        DirectoryWatcher
+        (
+            std::string const & rDirectory,
+            FileFunc rOnFile,
+            size_t rnMaxBacklog = 64,
+            FilterFunc rFilter = FilterFunc()
+        );
+        /**
+         * Calls stop
+         */
+        ~DirectoryWatcher();
+
+        DirectoryWatcher( DirectoryWatcher const & ) = delete;
+        DirectoryWatcher & operator=( DirectoryWatcher const & ) = delete;
+
+        bool isOpen( void ) const;
+        /**
+         * Stops watching and waits for a running callback to return. Files
+         * still in the backlog are not handed to the callback anymore.
+         */
+        void stop( void );
+
+        DirectoryWatcherStatistics getStatistics( void ) const;
+
+    private:
+        void readEvents( void );
+        void handleFiles( void );
+
+        std::string mDirectory;
+        FileFunc    mOnFile;
+        FilterFunc  mFilter;
+        size_t      mnMaxBacklog;
+        int         mInotifyFd;
+        /**
+         * eventfd to wake up the event thread when stopping
+         */
+        int         mStopFd;
+        std::atomic<bool> mStopped;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mBacklogChanged;
+        /**
+         * path and detection time, see taskQueueNow
+         */
+        std::deque< std::pair<std::string,int64_t> > mBacklog;
+        std::atomic<uint64_t> mnDetected;
+        std::atomic<uint64_t> mnHandled;
+        std::atomic<uint64_t> mnDropped;
+        std::atomic<uint64_t> mnOverflows;
+        libs::LatencyHistogram mLag;
+
+        std::thread mEventThread;
+        std::thread mHandlerThread;
+    };
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,69 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/frameHeader.hpp"
+
+#include <string>                   // std::to_string
+#include <utility>                  // std::make_pair
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    bool addFrameTask
+    (
+        float * _h_mem,
+        FrameHeader const & _header,
+        WriteOutFunc _writeOutFunc,
+        WriteOutFunc _cancelFunc
+    )
+    {
+        return addTask(
+            _h_mem,
+            std::make_pair( _header.width, _header.height ),
+            _writeOutFunc,
+            std::to_string( _header.frameId ),
+            _header.numberOfCycles    != 0 ? _header.numberOfCycles
+                                           : defaultNumberOfCycles,
+            _header.numberOfHIOCycles != 0 ? _header.numberOfHIOCycles
+                                           : defaultNumberOfHIOCycles,
+            _header.targetError != 0 ? _header.targetError : defaultTargetError,
+            _header.HIOBeta     != 0 ? _header.HIOBeta     : defaultHIOBeta,
+            _header.intensityCutOffAutoCorel != 0 ?
+                _header.intensityCutOffAutoCorel : defaultIntensityCutOffAutoCorel,
+            _header.intensityCutOff != 0 ? _header.intensityCutOff
+                                         : defaultIntensityCutOff,
+            _header.sigma0      != 0 ? _header.sigma0      : defaultSigma0,
+            _header.sigmaChange != 0 ? _header.sigmaChange : defaultSigmaChange,
+            _header.priority,
+            _cancelFunc
+        );
+    }
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,101 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>                  // uint32_t, uint64_t, int32_t
+
+#include "io/taskQueue.hpp"         // WriteOutFunc
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Outcome of a frame sent back to the submitter
+     */
+    enum class FrameStatus : int32_t
+    {
+        /** reconstructed, the data follows the header */
+        Ok        = 0,
+        /** cancelled or aborted in the task queue */
+        Cancelled = 1,
+        /** not accepted by the task queue, e.g. because of the memory budget */
+        Rejected  = 2,
+        /** malformed header, e.g. no pixels or too many of them */
+        Invalid   = 3
+    };
+
+    /**
+     * Describes a frame handed to imresh by another process, e.g. through a
+     * SharedMemoryRing or the socket of imresh-server. The shrink-wrap
+     * parameters are only meaningful for submitted frames, a value of 0
+     * selects the default of imresh::io::addTask. Results carry the header
+     * of their input with the status set.
+     */
+    struct FrameHeader
+    {
+        /**
+         * chosen freely by the submitter to match results to frames
+         */
+        uint64_t frameId;
+        uint32_t width;
+        uint32_t height;
+        /**
+         * see FrameStatus
+         */
+        int32_t status;
+        int32_t priority;
+        uint32_t numberOfCycles;
+        uint32_t numberOfHIOCycles;
+        float targetError;
+        float HIOBeta;
+        float intensityCutOffAutoCorel;
+        float intensityCutOff;
+        float sigma0;
+        float sigmaChange;
+    };
+
+    /**
+     * Calls addTask with the parameters from the header, where 0 selects
+     * the default.
+     *
+     * @param _h_mem intensity of width * height pixels
+     * @param _cancelFunc called if the task gets cancelled or aborted
+     * @return the return value of addTask
+     */
+    bool addFrameTask
+    (
+        float * _h_mem,
+        FrameHeader const & _header,
+        WriteOutFunc _writeOutFunc,
+        WriteOutFunc _cancelFunc
+    );
+
+
+} // namespace io
+} // namespace imresh
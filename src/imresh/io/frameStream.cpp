@@ -0,0 +1,457 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/frameStream.hpp"
+
+#include <cstdint>                  // uintptr_t
+#include <cstring>                  // memcpy
+#include <fcntl.h>                  // open
+#ifdef USE_SPLASH
+#   include <iostream>              // std::cerr
+#   include <splash/splash.h>
+#endif
+#include <sys/mman.h>               // mmap, munmap, madvise
+#include <sys/stat.h>               // fstat
+#include <unistd.h>                 // close, sysconf
+
+#include "io/binaryFormats.hpp"             // BinaryLayout, convertToFloat
+#include "io/readInFuncs/readInFuncs.hpp"   // readFile
+#include "libs/frameBuffer.hpp"             // allocateFrame, freeFrame
+#ifdef USE_TIFF
+#   include "io/tiffFrameSource.hpp"        // TiffFrameSource
+#endif
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    namespace
+    {
+        /**
+         * All frames of a ".raw" or ".npy" file, read from a read-only
+         * mapping. The kernel is told to read the next frame while the
+         * current one is converted.
+         */
+        class BinaryStackSource : public FrameSource
+        {
+        public:
+            explicit BinaryStackSource( std::string const & rFilename )
+            : mMapping( NULL ), mnBytes( 0 )
+            {
+                int const fd = open( rFilename.c_str(), O_RDONLY | O_CLOEXEC );
+                struct stat info;
+                if ( fd < 0 or fstat( fd, &info ) != 0 or info.st_size == 0 )
+                {
+                    if ( fd >= 0 )
+                        close( fd );
+                    return;
+                }
+                void * const mapping = mmap( NULL, info.st_size, PROT_READ,
+                                             MAP_PRIVATE, fd, 0 );
+                close( fd );
+                if ( mapping == MAP_FAILED )
+                    return;
+                mnBytes = info.st_size;
+                if ( not parseBinaryHeader( rFilename, mapping, mnBytes, mLayout ) )
+                {
+                    munmap( mapping, mnBytes );
+                    return;
+                }
+                madvise( mapping, mnBytes, MADV_SEQUENTIAL );
+                mMapping = static_cast<char*>( mapping );
+            }
+
+            ~BinaryStackSource()
+            {
+                if ( mMapping != NULL )
+                    munmap( mMapping, mnBytes );
+            }
+
+            bool isOpen( void ) const { return mMapping != NULL; }
+
+            uint64_t getFrameCount( void ) const override
+            {
+                return mLayout.nFrames;
+            }
+
+            std::pair<unsigned int,unsigned int> getFrameSize( uint64_t ) const override
+            {
+                return { mLayout.width, mLayout.height };
+            }
+
+            size_t getMaxElements( void ) const override
+            {
+                return size_t( mLayout.width ) * mLayout.height;
+            }
+
+            bool readFrame( uint64_t const rIndex, float * const rDestination ) override
+            {
+                char const * const frame = getFrame( rIndex );
+                if ( frame == NULL )
+                    return false;
+                convertToFloat( frame, mLayout.type, mLayout.nativeByteOrder,
+                                getMaxElements(), rDestination );
+                return true;
+            }
+
+            void const * mapFrame( uint64_t const rIndex, ElementType & rType ) override
+            {
+                char const * const frame = getFrame( rIndex );
+                if ( frame == NULL or not mLayout.nativeByteOrder or
+                     reinterpret_cast<uintptr_t>( frame ) % getElementSize( mLayout.type ) != 0 )
+                    return NULL;
+                rType = mLayout.type;
+                return frame;
+            }
+
+        private:
+            /**
+             * Returns the frame in the mapping and tells the kernel to read
+             * the next one
+             */
+            char const * getFrame( uint64_t const rIndex )
+            {
+                if ( rIndex >= mLayout.nFrames )
+                    return NULL;
+                size_t const frameBytes = mLayout.getFrameBytes();
+                size_t const offset = mLayout.dataOffset + rIndex * frameBytes;
+                if ( rIndex + 1 < mLayout.nFrames )
+                {
+                    /* madvise needs a page aligned start */
+                    size_t const pageSize = sysconf( _SC_PAGESIZE );
+                    size_t const next = ( offset + frameBytes ) / pageSize * pageSize;
+                    madvise( mMapping + next, frameBytes + pageSize, MADV_WILLNEED );
+                }
+                return mMapping + offset;
+            }
+
+            char * mMapping;
+            size_t mnBytes;
+            BinaryLayout mLayout;
+        };
+
+        /**
+         * One frame read completely when opening
+         */
+        class SingleFileSource : public FrameSource
+        {
+        public:
+            explicit SingleFileSource( std::string const & rFilename )
+            : mFile( readInFuncs::readFile( rFilename ) )
+            {}
+
+            ~SingleFileSource()
+            {
+                libs::freeFrame( mFile.first );
+            }
+
+            bool isOpen( void ) const
+            {
+                return mFile.first != NULL and getMaxElements() > 0;
+            }
+
+            uint64_t getFrameCount( void ) const override { return 1; }
+
+            std::pair<unsigned int,unsigned int> getFrameSize( uint64_t ) const override
+            {
+                return mFile.second;
+            }
+
+            size_t getMaxElements( void ) const override
+            {
+                return size_t( mFile.second.first ) * mFile.second.second;
+            }
+
+            bool readFrame( uint64_t const rIndex, float * const rDestination ) override
+            {
+                if ( rIndex != 0 )
+                    return false;
+                memcpy( rDestination, mFile.first, sizeof( float ) * getMaxElements() );
+                return true;
+            }
+
+        private:
+            std::pair<float*,std::pair<unsigned int,unsigned int>> mFile;
+        };
+
+#       ifdef USE_SPLASH
+        /**
+         * Every dataset of every iteration in a file written by libSplash
+         */
+        class SplashSource : public FrameSource
+        {
+        public:
+            explicit SplashSource( std::string const & rFilename )
+            : mCollector( 0 ), mnMaxElements( 0 ), mIsOpen( false )
+            {
+                splash::DataCollector::FileCreationAttr fCAttr;
+                splash::DataCollector::initFileCreationAttr( fCAttr );
+                fCAttr.fileAccType = splash::DataCollector::FAT_READ;
+                /* libSplash reports errors, e.g. of a truncated file, by
+                 * throwing. The source is left unopened then. */
+                try
+                {
+                    /* libSplash appends the suffix itself */
+                    std::string const suffix = "_0_0_0.h5";
+                    mCollector.open( rFilename.substr( 0, rFilename.size() -
+                                                       suffix.size() ).c_str(), fCAttr );
+                    mIsOpen = true;
+
+                    size_t nIds = 0;
+                    mCollector.getEntryIDs( NULL, &nIds );
+                    std::vector<int32_t> ids( nIds );
+                    if ( nIds > 0 )
+                        mCollector.getEntryIDs( ids.data(), &nIds );
+                    for ( auto const id : ids )
+                    {
+                        size_t nEntries = 0;
+                        mCollector.getEntriesForID( id, NULL, &nEntries );
+                        std::vector<splash::DataCollector::DCEntry> entries( nEntries );
+                        if ( nEntries > 0 )
+                            mCollector.getEntriesForID( id, entries.data(), &nEntries );
+                        for ( auto const & entry : entries )
+                        {
+                            splash::Dimensions dim;
+                            mCollector.read( id, entry.name.c_str(), dim, NULL );
+                            if ( dim.getScalarSize() == 0 )
+                                continue;
+                            /* stored as width x height x 1, see writeOutHDF5 */
+                            mFrames.push_back( { id, entry.name, { unsigned( dim[0] ),
+                                                 unsigned( dim.getScalarSize() / dim[0] ) } } );
+                            mnMaxElements = std::max( mnMaxElements, dim.getScalarSize() );
+                        }
+                    }
+                }
+                catch ( splash::DCException const & e )
+                {
+                    std::cerr << "imresh::io::openFrameSource: Couldn't read "
+                              << rFilename << ": " << e.what() << std::endl;
+                    mFrames.clear();
+                    mnMaxElements = 0;
+                }
+            }
+
+            ~SplashSource()
+            {
+                if ( not mIsOpen )
+                    return;
+                try
+                {
+                    mCollector.close();
+                }
+                catch ( splash::DCException const & )
+                {
+                    /* the file was only read */
+                }
+            }
+
+            bool isOpen( void ) const { return not mFrames.empty(); }
+
+            uint64_t getFrameCount( void ) const override { return mFrames.size(); }
+
+            std::pair<unsigned int,unsigned int> getFrameSize( uint64_t const rIndex ) const override
+            {
+                return mFrames.at( rIndex ).size;
+            }
+
+            size_t getMaxElements( void ) const override { return mnMaxElements; }
+
+            bool readFrame( uint64_t const rIndex, float * const rDestination ) override
+            {
+                if ( rIndex >= mFrames.size() )
+                    return false;
+                splash::Dimensions dim;
+                try
+                {
+                    mCollector.read( mFrames[ rIndex ].id, mFrames[ rIndex ].name.c_str(),
+                                     dim, rDestination );
+                }
+                catch ( splash::DCException const & )
+                {
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            struct SplashFrame
+            {
+                int32_t id;
+                std::string name;
+                std::pair<unsigned int,unsigned int> size;
+            };
+
+            splash::SerialDataCollector mCollector;
+            std::vector<SplashFrame> mFrames;
+            size_t mnMaxElements;
+            bool mIsOpen;
+        };
+#       endif
+
+        /**
+         * Returns NULL if the source couldn't be opened
+         */
+        template<class T_Source>
+        std::unique_ptr<FrameSource> openSource( std::string const & rFilename )
+        {
+            std::unique_ptr<T_Source> source( new T_Source( rFilename ) );
+            if ( not source->isOpen() )
+                return NULL;
+            return std::unique_ptr<FrameSource>( source.release() );
+        }
+
+        bool endsWith( std::string const & rString, std::string const & rSuffix )
+        {
+            return rString.size() >= rSuffix.size() and
+                   rString.compare( rString.size() - rSuffix.size(),
+                                    rSuffix.size(), rSuffix ) == 0;
+        }
+    } // anonymous namespace
+
+    std::unique_ptr<FrameSource> openFrameSource( std::string const & _filename )
+    {
+        if ( endsWith( _filename, ".raw" ) or endsWith( _filename, ".npy" ) )
+            return openSource<BinaryStackSource>( _filename );
+#       ifdef USE_TIFF
+            if ( endsWith( _filename, ".tif" ) or endsWith( _filename, ".tiff" ) )
+                return openSource<TiffFrameSource>( _filename );
+#       endif
+#       ifdef USE_SPLASH
+            if ( endsWith( _filename, "_0_0_0.h5" ) )
+                return openSource<SplashSource>( _filename );
+#       endif
+        return openSource<SingleFileSource>( _filename );
+    }
+
+    FrameStream::FrameStream
+    (
+        std::unique_ptr<FrameSource> rSource,
+        unsigned int const rnBuffers
+    )
+    : mSource( std::move( rSource ) ), mStop( false ), mFinished( false ),
+      mStatistics()
+    {
+        /* taken from the frame buffer pool, so that consecutive streams of
+         * equally sized frames don't allocate again */
+        size_t const nElements = mSource->getMaxElements();
+        for ( unsigned int i = 0; i < rnBuffers; ++i )
+        {
+            mBuffers.push_back( libs::allocateFrame( nElements ) );
+            mFree.push_back( mBuffers.back() );
+        }
+        mPrefetcher = std::thread( &FrameStream::prefetch, this );
+    }
+
+    FrameStream::~FrameStream()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mStop = true;
+            mChanged.notify_all();
+        }
+        mPrefetcher.join();
+        for ( auto buffer : mBuffers )
+            libs::freeFrame( buffer );
+    }
+
+    uint64_t FrameStream::getFrameCount( void ) const
+    {
+        return mSource->getFrameCount();
+    }
+
+    void FrameStream::prefetch( void )
+    {
+        uint64_t const nFrames = mSource->getFrameCount();
+        for ( uint64_t i = 0; i < nFrames; ++i )
+        {
+            float * buffer;
+            {
+                std::unique_lock<std::mutex> lock( mMutex );
+                if ( mFree.empty() and not mStop )
+                {
+                    ++mStatistics.nPrefetcherWaits;
+                    mChanged.wait( lock, [this]{ return mStop or not mFree.empty(); } );
+                }
+                if ( mStop )
+                    break;
+                buffer = mFree.front();
+                mFree.pop_front();
+            }
+
+            /* the actual I/O is done without holding the lock */
+            bool const success = mSource->readFrame( i, buffer );
+
+            std::lock_guard<std::mutex> lock( mMutex );
+            if ( success )
+            {
+                mReady.push_back( { buffer, mSource->getFrameSize( i ), i } );
+                ++mStatistics.nRead;
+            }
+            else
+            {
+                mFree.push_back( buffer );
+                ++mStatistics.nFailed;
+            }
+            mChanged.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lock( mMutex );
+        mFinished = true;
+        mChanged.notify_all();
+    }
+
+    bool FrameStream::next( Frame & rFrame )
+    {
+        std::unique_lock<std::mutex> lock( mMutex );
+        if ( mReady.empty() and not mFinished )
+        {
+            ++mStatistics.nConsumerWaits;
+            mChanged.wait( lock, [this]{ return mFinished or not mReady.empty(); } );
+        }
+        if ( mReady.empty() )
+            return false;
+        rFrame = mReady.front();
+        mReady.pop_front();
+        return true;
+    }
+
+    void FrameStream::release( float * const rData )
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mFree.push_back( rData );
+        mChanged.notify_all();
+    }
+
+    FrameStreamStatistics FrameStream::getStatistics( void ) const
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        return mStatistics;
+    }
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,179 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <condition_variable>       // std::condition_variable
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint64_t
+#include <deque>                    // std::deque
+#include <memory>                   // std::unique_ptr
+#include <mutex>                    // std::mutex
+#include <string>                   // std::string
+#include <thread>                   // std::thread
+#include <utility>                  // std::pair
+#include <vector>                   // std::vector
+
+#include "io/binaryFormats.hpp"     // ElementType
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Random access to the frames of a container, e.g. a stack of frames in
+     * one file. Only used by one thread at a time.
+     */
+    class FrameSource
+    {
+    public:
+        virtual ~FrameSource() {}
+
+        virtual uint64_t getFrameCount( void ) const = 0;
+        virtual std::pair<unsigned int,unsigned int> getFrameSize( uint64_t rIndex ) const = 0;
+        /**
+         * @return maximum number of pixels of all frames
+         */
+        virtual size_t getMaxElements( void ) const = 0;
+        /**
+         * Reads and converts a frame into rDestination, which has room for
+         * getMaxElements floats.
+         */
+        virtual bool readFrame( uint64_t rIndex, float * rDestination ) = 0;
+        /**
+         * Gives direct access to a frame as stored, so that it can be
+         * converted in the same pass as it is processed, e.g. by
+         * PreprocessedFrameSource. Only possible for some sources, e.g.
+         * memory mapped files in native byte order.
+         *
+         * @param[out] rType element type of the returned frame
+         * @return NULL if not possible, else the frame, which is valid until
+         *         the next call of mapFrame or readFrame
+         */
+        virtual void const * mapFrame( uint64_t /* rIndex */, ElementType & /* rType */ )
+        {
+            return NULL;
+        }
+    };
+
+    /**
+     * Opens a container depending on the file extension:
+     *   - ".raw" and ".npy" with several frames along the first axis
+     *   - HDF5 files ("_0_0_0.h5", if built with USE_SPLASH), every dataset
+     *     of every iteration is a frame
+     *   - TIFF files (".tif", ".tiff", if built with USE_TIFF), every page
+     *     is a frame
+     *   - all other files readable by readInFuncs::readFile as one frame
+     *
+     * @return NULL if the file can't be read
+     */
+    std::unique_ptr<FrameSource> openFrameSource( std::string const & _filename );
+
+    /**
+     * A frame handed out by FrameStream::next
+     */
+    struct Frame
+    {
+        float * data;
+        std::pair<unsigned int,unsigned int> size;
+        uint64_t index;
+    };
+
+    struct FrameStreamStatistics
+    {
+        uint64_t nRead;
+        uint64_t nFailed;
+        /**
+         * calls of next which had to wait for I/O
+         */
+        uint64_t nConsumerWaits;
+        /**
+         * times the prefetcher waited for a buffer to be released
+         */
+        uint64_t nPrefetcherWaits;
+    };
+
+    /**
+     * Iterates the frames of a FrameSource in order. A background thread
+     * reads ahead into a fixed number of buffers, so that reading overlaps
+     * with the reconstruction of the previous frames. The buffers have to
+     * be given back with release, e.g. in the write out function of the
+     * task. The number of buffers thereby also bounds the number of frames
+     * in flight.
+     *
+     * Frames which can't be read are skipped and counted as failed.
+     */
+    class FrameStream
+    {
+    public:
+        /**
+         * @param rnBuffers number of frames which can be read ahead or be
+         *        in use at the same time
+         */
+        explicit FrameStream( std::unique_ptr<FrameSource> rSource, unsigned int rnBuffers = 8 );
+        /**
+         * Stops reading ahead. All buffers have to be released before.
+         */
+        ~FrameStream();
+
+        FrameStream( FrameStream const & ) = delete;
+        FrameStream & operator=( FrameStream const & ) = delete;
+
+        uint64_t getFrameCount( void ) const;
+        /**
+         * Waits for the next frame.
+         *
+         * @return false if all frames were handed out
+         */
+        bool next( Frame & rFrame );
+        /**
+         * Gives the buffer of a frame back for reading ahead. Thread-safe.
+         */
+        void release( float * rData );
+
+        FrameStreamStatistics getStatistics( void ) const;
+
+    private:
+        void prefetch( void );
+
+        std::unique_ptr<FrameSource> mSource;
+        std::vector<float*> mBuffers;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mChanged;
+        std::deque<float*> mFree;
+        std::deque<Frame> mReady;
+        bool mStop;
+        bool mFinished;
+        FrameStreamStatistics mStatistics;
+
+        std::thread mPrefetcher;
+    };
+
+
+} // namespace io
+} // namespace imresh
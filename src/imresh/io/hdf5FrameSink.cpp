@@ -0,0 +1,307 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/hdf5FrameSink.hpp"
+
+#ifdef USE_SPLASH
+
+#include <algorithm>                // std::max
+#include <iostream>                 // std::cerr
+#include <sys/stat.h>               // stat
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    namespace
+    {
+        char const * const datasetName = "reconstruction";
+    } // anonymous namespace
+
+    HDF5FrameSink::HDF5FrameSink
+    (
+        std::string const & rFilename,
+        size_t const rnFramesPerFlush,
+        std::chrono::milliseconds const rFlushDelay,
+        size_t const rnMaxQueuedBytes
+    )
+    : mFilename( rFilename ), mnFramesPerFlush( std::max( rnFramesPerFlush, size_t( 1 ) ) ),
+      mFlushDelay( rFlushDelay ), mnMaxQueuedBytes( rnMaxQueuedBytes ),
+      mCollector( 0 ), mIsOpen( false ), mFailed( false ), mnQueuedBytes( 0 ), mnUnflushed( 0 ),
+      mnNextId( 0 ), mFlushRequested( false ), mStop( false )
+    {
+        struct stat info;
+        bool const exists = stat( ( mFilename + "_0_0_0.h5" ).c_str(), &info ) == 0;
+
+        splash::DataCollector::FileCreationAttr fCAttr;
+        splash::DataCollector::initFileCreationAttr( fCAttr );
+        fCAttr.fileAccType = exists ? splash::DataCollector::FAT_WRITE
+                                    : splash::DataCollector::FAT_CREATE;
+        try
+        {
+            mCollector.open( mFilename.c_str(), fCAttr );
+            if ( exists )
+            {
+                size_t nIds = 0;
+                mCollector.getEntryIDs( NULL, &nIds );
+                std::vector<int32_t> ids( nIds );
+                if ( nIds > 0 )
+                    mCollector.getEntryIDs( ids.data(), &nIds );
+                for ( auto const id : ids )
+                    mnNextId = std::max( mnNextId, id + 1 );
+            }
+        }
+        catch ( splash::DCException const & e )
+        {
+            std::cerr << "imresh::io::HDF5FrameSink: Couldn't open "
+                      << mFilename << "_0_0_0.h5: " << e.what() << std::endl;
+            return;
+        }
+        mIsOpen = true;
+        mWriter = std::thread( &HDF5FrameSink::writeLoop, this );
+    }
+
+    HDF5FrameSink::~HDF5FrameSink()
+    {
+        if ( not mIsOpen )
+            return;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mStop = true;
+            mChanged.notify_all();
+        }
+        mWriter.join();
+        try
+        {
+            mCollector.close();
+        }
+        catch ( splash::DCException const & e )
+        {
+            fail( e.what() );
+        }
+    }
+
+    bool HDF5FrameSink::isOpen( void ) const
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        return mIsOpen and not mFailed;
+    }
+
+    uint64_t HDF5FrameSink::write
+    (
+        float const * const rData,
+        std::pair<unsigned int,unsigned int> const rSize,
+        std::string const & rName,
+        TaskResult const & rResult,
+        FlushedFunc rOnFlushed
+    )
+    {
+        size_t const nElements = size_t( rSize.first ) * rSize.second;
+        QueuedFrame frame;
+        frame.data.assign( rData, rData + nElements );
+        frame.size      = rSize;
+        frame.name      = rName;
+        frame.result    = rResult;
+        frame.onFlushed = std::move( rOnFlushed );
+
+        std::unique_lock<std::mutex> lock( mMutex );
+        /* a single frame larger than the limit is still accepted */
+        mChanged.wait( lock, [&]{ return mFailed or mQueue.empty() or
+            mnQueuedBytes + sizeof( float ) * nElements <= mnMaxQueuedBytes; } );
+        int32_t const id = mnNextId++;
+        if ( mFailed or not mIsOpen )
+            return id;
+        frame.id = id;
+        mnQueuedBytes += sizeof( float ) * nElements;
+        ++mnUnflushed;
+        mQueue.push_back( std::move( frame ) );
+        mChanged.notify_all();
+        return id;
+    }
+
+    WriteOutFunc HDF5FrameSink::getWriteOutFunc( void )
+    {
+        return [this]( float * _mem, std::pair<unsigned int,unsigned int> _size,
+                       std::string _filename )
+        {
+            write( _mem, _size, _filename, taskQueueGetCurrentResult() );
+        };
+    }
+
+    void HDF5FrameSink::flush( void )
+    {
+        std::unique_lock<std::mutex> lock( mMutex );
+        mFlushRequested = true;
+        mChanged.notify_all();
+        mChanged.wait( lock, [this]{ return mnUnflushed == 0; } );
+    }
+
+    uint64_t HDF5FrameSink::getFrameCount( void ) const
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        return mnNextId;
+    }
+
+    void HDF5FrameSink::writeFrame( QueuedFrame const & rFrame )
+    {
+        splash::ColTypeFloat cTFloat;
+        splash::ColTypeUInt32 cTUInt32;
+        splash::Dimensions const size( rFrame.size.first, rFrame.size.second, 1 );
+        mCollector.write( rFrame.id, cTFloat, 2, splash::Selection( size ),
+                          datasetName, rFrame.data.data() );
+
+        splash::ColTypeString cTName( std::max( rFrame.name.size(), size_t( 1 ) ) );
+        mCollector.writeAttribute( rFrame.id, cTName, datasetName, "name",
+                                   rFrame.name.c_str() );
+
+        TaskResult const & result = rFrame.result;
+        mCollector.writeAttribute( rFrame.id, cTFloat , datasetName, "finalError"              , &result.finalError );
+        mCollector.writeAttribute( rFrame.id, cTUInt32, datasetName, "numberOfCyclesRun"       , &result.numberOfCyclesRun );
+        mCollector.writeAttribute( rFrame.id, cTUInt32, datasetName, "numberOfCycles"          , &result.numberOfCycles );
+        mCollector.writeAttribute( rFrame.id, cTUInt32, datasetName, "numberOfHIOCycles"       , &result.numberOfHIOCycles );
+        mCollector.writeAttribute( rFrame.id, cTFloat , datasetName, "targetError"             , &result.targetError );
+        mCollector.writeAttribute( rFrame.id, cTFloat , datasetName, "HIOBeta"                 , &result.HIOBeta );
+        mCollector.writeAttribute( rFrame.id, cTFloat , datasetName, "intensityCutOffAutoCorel", &result.intensityCutOffAutoCorel );
+        mCollector.writeAttribute( rFrame.id, cTFloat , datasetName, "intensityCutOff"         , &result.intensityCutOff );
+        mCollector.writeAttribute( rFrame.id, cTFloat , datasetName, "sigma0"                  , &result.sigma0 );
+        mCollector.writeAttribute( rFrame.id, cTFloat , datasetName, "sigmaChange"             , &result.sigmaChange );
+    }
+
+    void HDF5FrameSink::fail( std::string const & rWhat )
+    {
+        std::cerr << "imresh::io::HDF5FrameSink: Couldn't write "
+                  << mFilename << "_0_0_0.h5: " << rWhat << std::endl;
+        std::lock_guard<std::mutex> lock( mMutex );
+        mFailed = true;
+    }
+
+    void HDF5FrameSink::writeLoop( void )
+    {
+        using Clock = std::chrono::steady_clock;
+        std::vector<FlushedFunc> unflushed;
+        auto lastWrite = Clock::now();
+
+        std::unique_lock<std::mutex> lock( mMutex );
+        while ( true )
+        {
+            mChanged.wait_for( lock, mFlushDelay, [this]
+                { return mStop or mFlushRequested or not mQueue.empty(); } );
+
+            /* After a failure the frames are discarded without calling
+             * their callbacks, because they aren't in the file. They still
+             * count as flushed, so that flush doesn't wait forever. */
+            if ( mFailed )
+            {
+                mnUnflushed -= mQueue.size() + unflushed.size();
+                mQueue.clear();
+                mnQueuedBytes = 0;
+                unflushed.clear();
+                mFlushRequested = false;
+                mChanged.notify_all();
+                if ( mStop )
+                    return;
+                continue;
+            }
+
+            if ( not mQueue.empty() )
+            {
+                QueuedFrame frame = std::move( mQueue.front() );
+                mQueue.pop_front();
+                lock.unlock();
+
+                bool written = true;
+                try
+                {
+                    writeFrame( frame );
+                }
+                catch ( splash::DCException const & e )
+                {
+                    fail( e.what() );
+                    written = false;
+                }
+                lastWrite = Clock::now();
+
+                lock.lock();
+                mnQueuedBytes -= sizeof( float ) * frame.data.size();
+                if ( written )
+                    unflushed.push_back( std::move( frame.onFlushed ) );
+                else
+                    --mnUnflushed;
+                mChanged.notify_all();
+                if ( not written )
+                    continue;
+            }
+
+            bool const idle = mQueue.empty() and ( mStop or mFlushRequested or
+                              Clock::now() - lastWrite >= mFlushDelay );
+            if ( not unflushed.empty() and
+                 ( unflushed.size() >= mnFramesPerFlush or idle ) )
+            {
+                lock.unlock();
+                /* libSplash has no flush, closing writes everything */
+                bool flushed = true;
+                try
+                {
+                    mCollector.close();
+                    splash::DataCollector::FileCreationAttr fCAttr;
+                    splash::DataCollector::initFileCreationAttr( fCAttr );
+                    fCAttr.fileAccType = splash::DataCollector::FAT_WRITE;
+                    mCollector.open( mFilename.c_str(), fCAttr );
+                }
+                catch ( splash::DCException const & e )
+                {
+                    fail( e.what() );
+                    flushed = false;
+                }
+
+                if ( flushed )
+                {
+                    for ( auto const & onFlushed : unflushed )
+                        if ( onFlushed )
+                            onFlushed();
+                }
+
+                lock.lock();
+                mnUnflushed -= unflushed.size();
+                unflushed.clear();
+                mChanged.notify_all();
+            }
+
+            if ( mQueue.empty() and unflushed.empty() )
+            {
+                mFlushRequested = false;
+                if ( mStop )
+                    return;
+            }
+        }
+    }
+
+
+} // namespace io
+} // namespace imresh
+
+#endif
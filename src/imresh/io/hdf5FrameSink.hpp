@@ -0,0 +1,181 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifdef USE_SPLASH
+
+#include <chrono>                   // std::chrono::milliseconds
+#include <condition_variable>       // std::condition_variable
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint64_t, int32_t
+#include <deque>                    // std::deque
+#include <functional>               // std::function
+#include <mutex>                    // std::mutex
+#include <string>                   // std::string
+#include <thread>                   // std::thread
+#include <utility>                  // std::pair
+#include <vector>                   // std::vector
+
+#include <splash/splash.h>
+
+#include "io/taskQueue.hpp"         // WriteOutFunc, TaskResult
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Appends reconstructions to one HDF5 file instead of writing a file
+     * per image, which for thousands of frames per run strains the file
+     * system metadata and slows down reading them afterwards.
+     *
+     * Frame i is stored as dataset "reconstruction" of iteration i in the
+     * same layout writeOutHDF5 uses, so the file can be read frame by frame
+     * with openFrameSource. Its attributes hold the name given to write,
+     * the final error, the number of cycles run and all shrink-wrap
+     * parameters, see TaskResult. An existing file is appended to.
+     *
+     * The frames are copied and written by a background thread. The file
+     * is flushed (closed and opened again, as libSplash has no flush) after
+     * every rnFramesPerFlush frames or when no frame arrived for
+     * rFlushDelay, so a crash loses at most the frames since the last
+     * flush. Their callbacks are called after the flush.
+     *
+     * If writing or flushing fails, e.g. because the disk is full, the sink
+     * stops writing and isOpen returns false. The frames not flushed until
+     * then and all frames given to write afterwards are discarded without
+     * calling their callbacks.
+     */
+    class HDF5FrameSink
+    {
+    public:
+        typedef std::function<void(void)> FlushedFunc;
+
+        /**
+         * @param rFilename without the "_0_0_0.h5" libSplash appends
+         * @param rnMaxQueuedBytes write blocks while this many bytes are
+         *        waiting to be written
+         */
+        explicit HDF5FrameSink
+        (
+            std::string const & rFilename,
+            size_t rnFramesPerFlush = 64,
+            std::chrono::milliseconds rFlushDelay = std::chrono::milliseconds( 1000 ),
+            size_t rnMaxQueuedBytes = size_t( 256 ) << 20
+        );
+        /**
+         * Writes and flushes all queued frames
+         */
+        ~HDF5FrameSink();
+
+        HDF5FrameSink( HDF5FrameSink const & ) = delete;
+        HDF5FrameSink & operator=( HDF5FrameSink const & ) = delete;
+
+        /**
+         * @return false if the file couldn't be opened or writing to it
+         *         failed
+         */
+        bool isOpen( void ) const;
+
+        /**
+         * Copies the image into the write queue.
+         *
+         * @param rOnFlushed if set, called from the writing thread once the
+         *        frame is flushed to the file
+         * @return index of the frame in the file
+         */
+        uint64_t write
+        (
+            float const * rData,
+            std::pair<unsigned int,unsigned int> rSize,
+            std::string const & rName,
+            TaskResult const & rResult,
+            FlushedFunc rOnFlushed = FlushedFunc()
+        );
+
+        /**
+         * Returns a write out function for addTask, which appends the image
+         * together with taskQueueGetCurrentResult. Like the functions in
+         * writeOutFuncs it doesn't free the memory.
+         */
+        WriteOutFunc getWriteOutFunc( void );
+
+        /**
+         * Waits until all frames given to write are flushed
+         */
+        void flush( void );
+
+        uint64_t getFrameCount( void ) const;
+
+    private:
+        struct QueuedFrame
+        {
+            int32_t id;
+            std::vector<float> data;
+            std::pair<unsigned int,unsigned int> size;
+            std::string name;
+            TaskResult result;
+            FlushedFunc onFlushed;
+        };
+
+        void writeLoop( void );
+        void writeFrame( QueuedFrame const & rFrame );
+        /* reports the error and marks the sink as failed */
+        void fail( std::string const & rWhat );
+
+        std::string const mFilename;
+        size_t const mnFramesPerFlush;
+        std::chrono::milliseconds const mFlushDelay;
+        size_t const mnMaxQueuedBytes;
+        splash::SerialDataCollector mCollector;
+        bool mIsOpen;
+        /**
+         * set by the writing thread if libSplash threw, guarded by mMutex
+         */
+        bool mFailed;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mChanged;
+        std::deque<QueuedFrame> mQueue;
+        size_t mnQueuedBytes;
+        /**
+         * frames given to write which aren't flushed yet
+         */
+        size_t mnUnflushed;
+        int32_t mnNextId;
+        bool mFlushRequested;
+        bool mStop;
+
+        std::thread mWriter;
+    };
+
+
+} // namespace io
+} // namespace imresh
+
+#endif
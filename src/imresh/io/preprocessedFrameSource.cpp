@@ -0,0 +1,176 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "io/preprocessedFrameSource.hpp"
+
+#include <cstdint>                          // uint16_t, uint32_t
+#include <utility>                          // std::move
+#include <vector>                           // std::vector
+#ifdef IMRESH_DEBUG
+#   include <iostream>                      // std::cout, std::endl
+#endif
+
+#include "io/readInFuncs/readInFuncs.hpp"   // readFile
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    namespace
+    {
+        /**
+         * Reads one calibration file into rValues
+         */
+        template< class T >
+        bool readCalibrationFile
+        (
+            std::string const & rFilename,
+            std::vector<T> & rValues,
+            std::pair<unsigned int,unsigned int> & rSize
+        )
+        {
+            if ( rFilename.empty() )
+                return true;
+            auto const file = readInFuncs::readFile( rFilename );
+            if ( file.first == NULL or
+                 ( rSize.first != 0 and file.second != rSize ) )
+            {
+#               ifdef IMRESH_DEBUG
+                    std::cout << "imresh::io::readDetectorCalibration(): "
+                              << "Couldn't read " << rFilename << " or its "
+                              << "size differs." << std::endl;
+#               endif
+                libs::freeFrame( file.first );
+                return false;
+            }
+            rSize = file.second;
+            size_t const nPixels = size_t( rSize.first ) * rSize.second;
+            rValues.resize( nPixels );
+            for ( size_t i = 0; i < nPixels; ++i )
+                rValues[i] = T( file.first[i] );
+            libs::freeFrame( file.first );
+            return true;
+        }
+    } // anonymous namespace
+
+
+    bool readDetectorCalibration
+    (
+        std::string const & _darkFilename,
+        std::string const & _gainFilename,
+        std::string const & _maskFilename,
+        algorithms::DetectorCalibration & _calibration,
+        std::pair<unsigned int,unsigned int> & _size
+    )
+    {
+        _size = { 0, 0 };
+        std::vector<float> mask;
+        if ( not readCalibrationFile( _darkFilename, _calibration.dark, _size ) or
+             not readCalibrationFile( _gainFilename, _calibration.gain, _size ) or
+             not readCalibrationFile( _maskFilename, mask, _size ) )
+            return false;
+        _calibration.mask.assign( mask.size(), 0 );
+        for ( size_t i = 0; i < mask.size(); ++i )
+            _calibration.mask[i] = mask[i] != 0;
+        return true;
+    }
+
+
+    PreprocessedFrameSource::PreprocessedFrameSource
+    (
+        std::unique_ptr<FrameSource> rSource,
+        algorithms::DetectorPreprocessor const & rPreprocessor
+    )
+    : mSource( std::move( rSource ) ), mPreprocessor( rPreprocessor ),
+      mnMapped( 0 )
+    {}
+
+    uint64_t PreprocessedFrameSource::getFrameCount( void ) const
+    {
+        return mSource->getFrameCount();
+    }
+
+    std::pair<unsigned int,unsigned int>
+    PreprocessedFrameSource::getFrameSize( uint64_t ) const
+    {
+        return mPreprocessor.getOutputSize();
+    }
+
+    size_t PreprocessedFrameSource::getMaxElements( void ) const
+    {
+        auto const size = mPreprocessor.getOutputSize();
+        return size_t( size.first ) * size.second;
+    }
+
+    bool PreprocessedFrameSource::readFrame
+    (
+        uint64_t const rIndex,
+        float * const rDestination
+    )
+    {
+        if ( not mPreprocessor.isValid() or rIndex >= getFrameCount() or
+             mSource->getFrameSize( rIndex ) != mPreprocessor.getInputSize() )
+            return false;
+
+        ElementType type;
+        void const * const frame = mSource->mapFrame( rIndex, type );
+        if ( frame != NULL )
+        {
+            ++mnMapped;
+            switch ( type )
+            {
+                case ElementType::Float32:
+                    mPreprocessor( static_cast<float    const*>( frame ), rDestination );
+                    return true;
+                case ElementType::Float64:
+                    mPreprocessor( static_cast<double   const*>( frame ), rDestination );
+                    return true;
+                case ElementType::UInt16:
+                    mPreprocessor( static_cast<uint16_t const*>( frame ), rDestination );
+                    return true;
+                case ElementType::UInt32:
+                    mPreprocessor( static_cast<uint32_t const*>( frame ), rDestination );
+                    return true;
+            }
+            --mnMapped;
+        }
+
+        if ( not mScratch )
+            mScratch = libs::FrameBuffer( mSource->getMaxElements() );
+        if ( not mScratch or not mSource->readFrame( rIndex, mScratch.data() ) )
+            return false;
+        mPreprocessor( static_cast<float const*>( mScratch.data() ), rDestination );
+        return true;
+    }
+
+    uint64_t PreprocessedFrameSource::getMappedCount( void ) const
+    {
+        return mnMapped;
+    }
+
+
+} // namespace io
+} // namespace imresh
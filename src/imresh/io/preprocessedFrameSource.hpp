@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>                          // size_t
+#include <cstdint>                          // uint64_t
+#include <memory>                           // std::unique_ptr
+#include <string>                           // std::string
+#include <utility>                          // std::pair
+
+#include "algorithms/detectorPreprocessing.hpp" // DetectorCalibration, DetectorPreprocessor
+#include "io/frameStream.hpp"               // FrameSource
+#include "libs/frameBuffer.hpp"             // FrameBuffer
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Reads the calibration arrays from files readable by
+     * readInFuncs::readFile, e.g. the averaged dark frame as ".npy". Empty
+     * filenames are skipped. Mask files mark ignored pixels with values
+     * other than 0.
+     *
+     * @param[out] rSize size of the calibration frames
+     * @return false if a file can't be read or the sizes differ
+     */
+    bool readDetectorCalibration
+    (
+        std::string const & _darkFilename,
+        std::string const & _gainFilename,
+        std::string const & _maskFilename,
+        algorithms::DetectorCalibration & _calibration,
+        std::pair<unsigned int,unsigned int> & _size
+    );
+
+    /**
+     * Hands out the frames of another source after detector preprocessing,
+     * i.e. dark and gain corrected, binned and as modulus.
+     *
+     * Frames the inner source can map (see FrameSource::mapFrame), e.g.
+     * ".raw" and ".npy" stacks of uint16 values, are converted and
+     * preprocessed in a single pass from the file mapping. All others are
+     * read into a scratch buffer first.
+     */
+    class PreprocessedFrameSource : public FrameSource
+    {
+    public:
+        /**
+         * @param rPreprocessor only frames of its input size can be read,
+         *        others fail
+         */
+        PreprocessedFrameSource
+        (
+            std::unique_ptr<FrameSource> rSource,
+            algorithms::DetectorPreprocessor const & rPreprocessor
+        );
+
+        uint64_t getFrameCount( void ) const override;
+        std::pair<unsigned int,unsigned int> getFrameSize( uint64_t rIndex ) const override;
+        size_t getMaxElements( void ) const override;
+        bool readFrame( uint64_t rIndex, float * rDestination ) override;
+
+        /**
+         * number of frames which were preprocessed directly from the mapping
+         */
+        uint64_t getMappedCount( void ) const;
+
+    private:
+        std::unique_ptr<FrameSource> const mSource;
+        algorithms::DetectorPreprocessor const mPreprocessor;
+        /* raw frame if it can't be mapped, allocated on first use */
+        libs::FrameBuffer mScratch;
+        uint64_t mnMapped;
+    };
+
+
+} // namespace io
+} // namespace imresh
@@ -23,10 +23,15 @@
  */
 
 
-#include <algorithm>            // std::count_if
-#include <fstream>              // open
+#include <cstdint>              // uint64_t
+#include <cstdlib>              // std::strtof
+#include <cstring>              // memchr
+#include <fcntl.h>              // open
 #include <iostream>             // std::cout
-#include <list>                 // std::list
+#include <sys/mman.h>           // mmap, munmap, madvise
+#include <sys/stat.h>           // fstat
+#include <unistd.h>             // close
+#include <vector>               // std::vector
 #ifdef USE_PNG
 #   include <pngwriter.h>
 #   include <stdio.h>
@@ -40,6 +45,11 @@
 #include <cassert>
 
 #include "io/readInFuncs/readInFuncs.hpp"
+#include "io/binaryFormats.hpp"     // parseBinaryHeader, convertToFloat
+#include "libs/frameBuffer.hpp"     // allocateFrame, freeFrame
+#ifdef USE_TIFF
+#   include "io/tiffFrameSource.hpp"    // TiffFrameSource
+#endif
 
 
 namespace imresh
@@ -50,59 +60,326 @@ namespace readInFuncs
 {
 
 
+    namespace
+    {
+        inline bool isDelimiter( char const c )
+        {
+            return c == ' ' or c == '\t' or c == ',' or c == '\r';
+        }
+
+        /* powers of ten exactly representable as float */
+        float const exactPowersOfTen[11] = {
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+        };
+
+        /**
+         * Parses a decimal number spanning exactly [rBegin,rEnd).
+         *
+         * Numbers whose mantissa fits into the 24 bits of a float and whose
+         * power of ten is at most 1e10, i.e. both are exactly representable
+         * as float, are converted with one float multiplication or division,
+         * which is rounded only once (Clinger's fast path). Everything else,
+         * e.g. "nan" or long mantissas, falls back to strtof.
+         *
+         * @return false if the token is no number
+         */
+        bool parseFloat
+        (
+            char const * const rBegin,
+            char const * const rEnd,
+            float & rValue
+        )
+        {
+            char const * p = rBegin;
+            bool const negative = p < rEnd and *p == '-';
+            if ( p < rEnd and ( *p == '-' or *p == '+' ) )
+                ++p;
+
+            uint64_t mantissa = 0;
+            int nDigits   = 0;
+            int exponent  = 0;
+            bool anyDigit = false;
+            bool exact    = true;
+            bool afterPoint = false;
+            for ( ; p < rEnd; ++p )
+            {
+                if ( *p == '.' and not afterPoint )
+                {
+                    afterPoint = true;
+                    continue;
+                }
+                unsigned const digit = unsigned( *p - '0' );
+                if ( digit > 9 )
+                    break;
+                anyDigit = true;
+                if ( nDigits < 19 )
+                {
+                    mantissa = mantissa * 10 + digit;
+                    if ( mantissa != 0 )
+                        ++nDigits;
+                    if ( afterPoint )
+                        --exponent;
+                }
+                else
+                {
+                    if ( digit != 0 )
+                        exact = false;
+                    if ( not afterPoint )
+                        ++exponent;
+                }
+            }
+            if ( anyDigit and p < rEnd and ( *p == 'e' or *p == 'E' ) )
+            {
+                ++p;
+                bool const negativeExponent = p < rEnd and *p == '-';
+                if ( p < rEnd and ( *p == '-' or *p == '+' ) )
+                    ++p;
+                int value = 0;
+                bool anyExponentDigit = false;
+                for ( ; p < rEnd and unsigned( *p - '0' ) <= 9; ++p )
+                {
+                    if ( value < 100000 )
+                        value = value * 10 + ( *p - '0' );
+                    anyExponentDigit = true;
+                }
+                if ( not anyExponentDigit )
+                    return false;
+                exponent += negativeExponent ? -value : value;
+            }
+
+            if ( anyDigit and p == rEnd and exact and
+                 mantissa <= ( uint64_t( 1 ) << 24 ) and
+                 exponent >= -10 and exponent <= 10 )
+            {
+                float value = float( mantissa );
+                if ( exponent < 0 )
+                    value /= exactPowersOfTen[ -exponent ];
+                else
+                    value *= exactPowersOfTen[ exponent ];
+                rValue = negative ? -value : value;
+                return true;
+            }
+
+            /* slow path, the token has to be null terminated for strtof */
+            std::string const token( rBegin, rEnd );
+            char * tokenEnd = NULL;
+            rValue = std::strtof( token.c_str( ), &tokenEnd );
+            return tokenEnd == token.c_str( ) + token.size( ) and not token.empty( );
+        }
+
+        /**
+         * Parses all numbers in [rBegin,rEnd) into rOut, but at most
+         * rnMaxValues.
+         *
+         * @return number of values in the row or -1 if one is no number
+         */
+        long parseRow
+        (
+            char const * rBegin,
+            char const * const rEnd,
+            float * const rOut,
+            long const rnMaxValues
+        )
+        {
+            long nValues = 0;
+            while ( true )
+            {
+                while ( rBegin < rEnd and isDelimiter( *rBegin ) )
+                    ++rBegin;
+                if ( rBegin == rEnd )
+                    return nValues;
+                char const * tokenEnd = rBegin;
+                while ( tokenEnd < rEnd and not isDelimiter( *tokenEnd ) )
+                    ++tokenEnd;
+                float value;
+                if ( not parseFloat( rBegin, tokenEnd, value ) )
+                    return -1;
+                if ( nValues < rnMaxValues )
+                    rOut[ nValues ] = value;
+                ++nValues;
+                rBegin = tokenEnd;
+            }
+        }
+    } // anonymous namespace
+
     std::pair<float*,std::pair<unsigned int,unsigned int>>
     readTxt(
         std::string const _filename
     )
     {
-        std::ifstream file;
-        file.open( _filename, std::ios::in );
+        std::pair<float*,std::pair<unsigned int,unsigned int>> const failed { NULL, { 0, 0 } };
 
-        if( file.is_open( ) )
+        int const fd = open( _filename.c_str( ), O_RDONLY | O_CLOEXEC );
+        struct stat info;
+        if( fd < 0 or fstat( fd, &info ) != 0 or info.st_size == 0 )
         {
-            std::list<std::string> strList;
-            std::string str;
-            std::getline( file, str );
-
-            // First, determine the length of a line, e.g. the x dimension
-            unsigned int xDim = std::count_if( str.begin( ), str.end( ),
-                [ ]( unsigned char c ){ return std::isspace( c ); } ) + 1;
-
-            // Then go back to the beginning of the file
-            file.seekg( 0, std::ios::beg );
+#           ifdef IMRESH_DEBUG
+                std::cout << "imresh::io::readInFuncs::readTxt(): Error opening file."
+                    << std::endl;
+#           endif
+            if( fd >= 0 )
+            {
+                close( fd );
+            }
+            return failed;
+        }
+        size_t const nBytes = info.st_size;
+        void * const mapping = mmap( NULL, nBytes, PROT_READ, MAP_PRIVATE, fd, 0 );
+        close( fd );
+        if( mapping == MAP_FAILED )
+        {
+#           ifdef IMRESH_DEBUG
+                perror( "imresh::io::readInFuncs::readTxt(): mmap failed" );
+#           endif
+            return failed;
+        }
+        madvise( mapping, nBytes, MADV_SEQUENTIAL | MADV_WILLNEED );
+        char const * const data = static_cast<char const*>( mapping );
+        char const * const end  = data + nBytes;
 
-            // Now iterate through the whole file
-            while( getline( file, str, ' ' ) )
+        // Find the rows, skipping empty ones, e.g. after the last newline
+        std::vector<std::pair<char const*,char const*>> rows;
+        for( char const * p = data; p < end; )
+        {
+            char const * lineEnd = static_cast<char const*>(
+                memchr( p, '\n', end - p ) );
+            if( lineEnd == NULL )
+            {
+                lineEnd = end;
+            }
+            char const * q = p;
+            while( q < lineEnd and isDelimiter( *q ) )
+            {
+                ++q;
+            }
+            if( q < lineEnd )
             {
-                strList.push_back( str );
+                rows.emplace_back( p, lineEnd );
             }
+            p = lineEnd + 1;
+        }
 
-            // Now determine the y dimension
-            unsigned int yDim = strList.size( ) / xDim;
+        // The first row determines the x dimension
+        long const xDim = rows.empty( ) ? 0 :
+            parseRow( rows[0].first, rows[0].second, NULL, 0 );
+        if( xDim <= 0 )
+        {
+            munmap( mapping, nBytes );
+            return failed;
+        }
+        long const yDim = rows.size( );
 
-            // And last, convert and store the list into a array
-            float retArray[strList.size( )];
-            for( unsigned i = 0; i < strList.size( ); i++ )
+        float * const retArray = libs::allocateFrame( xDim * yDim );
+        if( retArray == NULL )
+        {
+            munmap( mapping, nBytes );
+            return failed;
+        }
+        /* index of the first malformed row, yDim if there is none */
+        long firstBadRow = yDim;
+        /* only worth starting threads for larger files */
+        #pragma omp parallel for schedule( static ) reduction( min : firstBadRow ) \
+            if( nBytes > ( 1u << 20 ) )
+        for( long iy = 0; iy < yDim; ++iy )
+        {
+            long const nValues = parseRow( rows[iy].first, rows[iy].second,
+                                           retArray + iy * xDim, xDim );
+            if( nValues != xDim and iy < firstBadRow )
             {
-                retArray[i] = std::stof( strList.front( ) );
-                strList.pop_front( );
+                firstBadRow = iy;
             }
+        }
+        munmap( mapping, nBytes );
 
-            auto ret = std::make_pair( (float*) retArray, std::make_pair( xDim, yDim ) );
+        if( firstBadRow < yDim )
+        {
 #           ifdef IMRESH_DEBUG
-                std::cout << "imresh::io::readInFuncs::readTxt(): Successfully read file."
-                    << std::endl;
+                std::cout << "imresh::io::readInFuncs::readTxt(): Row "
+                    << firstBadRow + 1 << " doesn't contain " << xDim
+                    << " numbers." << std::endl;
 #           endif
-            return ret;
+            libs::freeFrame( retArray );
+            return failed;
         }
-        else
+
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::readInFuncs::readTxt(): Successfully read file."
+                << std::endl;
+#       endif
+        return { retArray, { unsigned( xDim ), unsigned( yDim ) } };
+    }
+
+    namespace
+    {
+        /**
+         * Maps a ".raw" or ".npy" file and converts its first frame
+         */
+        std::pair<float*,std::pair<unsigned int,unsigned int>>
+        readBinary(
+            std::string const & _filename
+        )
         {
-#           ifdef IMRESH_DEBUG
-                std::cout << "imresh::io::readInFuncs::readTxt(): Error opening file."
-                    << std::endl;
-#           endif
-            exit( EXIT_FAILURE );
+            std::pair<float*,std::pair<unsigned int,unsigned int>> const failed { NULL, { 0, 0 } };
+
+            int const fd = open( _filename.c_str( ), O_RDONLY | O_CLOEXEC );
+            struct stat info;
+            if( fd < 0 or fstat( fd, &info ) != 0 or info.st_size == 0 )
+            {
+                if( fd >= 0 )
+                {
+                    close( fd );
+                }
+                return failed;
+            }
+            size_t const nBytes = info.st_size;
+            void * const mapping = mmap( NULL, nBytes, PROT_READ, MAP_PRIVATE, fd, 0 );
+            close( fd );
+            if( mapping == MAP_FAILED )
+            {
+                return failed;
+            }
+            madvise( mapping, nBytes, MADV_SEQUENTIAL );
+
+            BinaryLayout layout;
+            if( not parseBinaryHeader( _filename, mapping, nBytes, layout ) or
+                layout.nFrames == 0 )
+            {
+#               ifdef IMRESH_DEBUG
+                    std::cout << "imresh::io::readInFuncs::readBinary(): Invalid header in "
+                        << _filename << std::endl;
+#               endif
+                munmap( mapping, nBytes );
+                return failed;
+            }
+
+            size_t const nElements = size_t( layout.width ) * layout.height;
+            float * const mem = libs::allocateFrame( nElements );
+            if ( mem == NULL )
+            {
+                munmap( mapping, nBytes );
+                return failed;
+            }
+            convertToFloat( static_cast<char const*>( mapping ) + layout.dataOffset,
+                            layout.type, layout.nativeByteOrder, nElements, mem );
+            munmap( mapping, nBytes );
+            return { mem, { layout.width, layout.height } };
         }
+    } // anonymous namespace
+
+    std::pair<float*,std::pair<unsigned int,unsigned int>>
+    readRaw(
+        std::string const _filename
+    )
+    {
+        return readBinary( _filename );
+    }
+
+    std::pair<float*,std::pair<unsigned int,unsigned int>>
+    readNpy(
+        std::string const _filename
+    )
+    {
+        return readBinary( _filename );
     }
 
 #   ifdef USE_PNG
@@ -127,7 +404,7 @@ namespace readInFuncs
                 return { NULL, { 0, 0 } };
             }
 
-            float* mem = new float[x * y];
+            float* mem = libs::allocateFrame( x * y );
             for( auto i = 0; i < y; i++ )
             {
                 for( auto j = 0; j < x; j++ )
@@ -181,7 +458,7 @@ namespace readInFuncs
                     std::cout << "imresh::io::readInFuncs::readHDF5(): Error opening empty file."
                         << std::endl;
 #               endif
-                exit( EXIT_FAILURE );
+                return { NULL, { 0, 0 } };
             }
             else
             {
@@ -202,7 +479,7 @@ namespace readInFuncs
                     std::cout << "imresh::io::readInFuncs::readHDF5(): Error opening empty file."
                         << std::endl;
 #               endif
-                exit( EXIT_FAILURE );
+                return { NULL, { 0, 0 } };
             }
             else
             {
@@ -220,17 +497,16 @@ namespace readInFuncs
             {
                 delete[] entries;
                 delete[] ids;
-                delete[] mem;
                 sdc.close( );
 #               ifdef IMRESH_DEBUG
                     std::cout << "imresh::io::readInFuncs::readHDF5(): Error opening empty file."
                         << std::endl;
 #               endif
-                exit( EXIT_FAILURE );
+                return { NULL, { 0, 0 } };
             }
             else
             {
-                mem = new float[dim.getScalarSize( )];
+                mem = libs::allocateFrame( dim.getScalarSize( ) );
                 sdc.read( ids[0], first_entry.name.c_str( ), dim, mem );
             }
 
@@ -245,6 +521,90 @@ namespace readInFuncs
         }
 #   endif
 
+#   ifdef USE_TIFF
+        std::pair<float*,std::pair<unsigned int,unsigned int>>
+        readTiff(
+            std::string const _filename
+        )
+        {
+            TiffFrameSource tiff( _filename );
+            if( not tiff.isOpen( ) )
+            {
+#               ifdef IMRESH_DEBUG
+                    std::cout << "imresh::io::readInFuncs::readTiff(): Error opening "
+                        << _filename << std::endl;
+#               endif
+                return { NULL, { 0, 0 } };
+            }
+            auto const size = tiff.getFrameSize( 0 );
+            float * const mem = libs::allocateFrame( size_t( size.first ) * size.second );
+            if( mem == NULL or not tiff.readFrame( 0, mem ) )
+            {
+                libs::freeFrame( mem );
+                return { NULL, { 0, 0 } };
+            }
+            return { mem, size };
+        }
+#   endif
+
+    bool isSupportedFile( std::string const & _filename )
+    {
+        auto const endsWith = [ &_filename ]( std::string const & suffix )
+        {
+            return _filename.size( ) >= suffix.size( ) and
+                   _filename.compare( _filename.size( ) - suffix.size( ),
+                                      suffix.size( ), suffix ) == 0;
+        };
+        return endsWith( ".txt" ) or endsWith( ".raw" ) or endsWith( ".npy" )
+#       ifdef USE_PNG
+            or endsWith( ".png" )
+#       endif
+#       ifdef USE_SPLASH
+            or endsWith( "_0_0_0.h5" )
+#       endif
+#       ifdef USE_TIFF
+            or endsWith( ".tif" ) or endsWith( ".tiff" )
+#       endif
+            ;
+    }
+
+    std::pair<float*,std::pair<unsigned int,unsigned int>>
+    readFile(
+        std::string const & _filename
+    )
+    {
+        if( not isSupportedFile( _filename ) )
+        {
+            return { NULL, { 0, 0 } };
+        }
+        std::string const extension = _filename.substr( _filename.rfind( '.' ) );
+        if( extension == ".raw" or extension == ".npy" )
+        {
+            return readBinary( _filename );
+        }
+#       ifdef USE_PNG
+            if( extension == ".png" )
+            {
+                return readPNG( _filename );
+            }
+#       endif
+#       ifdef USE_SPLASH
+            if( extension == ".h5" )
+            {
+                // libSplash appends the suffix itself
+                return readHDF5( _filename.substr( 0, _filename.size( ) -
+                                                   std::string( "_0_0_0.h5" ).size( ) ) );
+            }
+#       endif
+#       ifdef USE_TIFF
+            if( extension == ".tif" or extension == ".tiff" )
+            {
+                return readTiff( _filename );
+            }
+#       endif
+        return readTxt( _filename );
+    }
+
 
 } // namespace readInFuncs
 } // namespace io
@@ -36,11 +36,22 @@ namespace io
 namespace readInFuncs
 {
 
+    /* None of the readers terminates the program on bad input. They return
+     * NULL and the size { 0, 0 } instead, which callers have to check
+     * before using the image. */
 
     /**
-     * Simple function for reading txt files.
+     * Reads txt files storing their values as a 2D matrix, one row per line
+     * and spaces, tabs or commas as delimiters.
      *
-     * They need to store their values as a 2D matrix with spaces as delimiters.
+     * The file is memory mapped and, if it is larger than 1 MiB, its rows
+     * are parsed in parallel with OpenMP.
+     *
+     * @return pointer to the values allocated with libs::allocateFrame and
+     *         the dimensions. NULL if the file couldn't be read, contains
+     *         something else than numbers or rows of differing lengths.
+     *         Like all images returned by readInFuncs, the memory has to be
+     *         released with libs::freeFrame, e.g. by writeOutFuncs::justFree.
      */
     std::pair<float *, std::pair<unsigned int, unsigned int> >
     readTxt
@@ -48,6 +59,32 @@ namespace readInFuncs
         std::string const _filename
     );
 
+    /**
+     * Reads the first frame of imresh's own binary format, see
+     * imresh::io::rawHeaderSize. The file is memory mapped and copied or
+     * converted in one pass.
+     *
+     * @see readPNG
+     */
+    std::pair<float *, std::pair<unsigned int, unsigned int> >
+    readRaw
+    (
+        std::string const _filename
+    );
+
+    /**
+     * Reads the first frame of a NumPy file with the shape (height, width)
+     * or (nFrames, height, width) and float32, float64, uint16 or uint32
+     * elements. To avoid even the single copy, use imresh::io::MappedFrame.
+     *
+     * @see readRaw
+     */
+    std::pair<float *, std::pair<unsigned int, unsigned int> >
+    readNpy
+    (
+        std::string const _filename
+    );
+
 #   ifdef USE_PNG
         /**
          * Reads date from PNG
@@ -67,6 +104,8 @@ namespace readInFuncs
 
 #   ifdef USE_SPLASH
         /**
+         * Returns NULL if the file or its dataset couldn't be read.
+         *
          * @see readPNG
          **/
         std::pair<float *,std::pair<unsigned int,unsigned int> >
@@ -77,6 +116,40 @@ namespace readInFuncs
 #   endif
 
 
+#   ifdef USE_TIFF
+        /**
+         * Reads the first page of a TIFF file, see TiffFrameSource for the
+         * supported formats.
+         *
+         * @see readPNG
+         **/
+        std::pair<float *,std::pair<unsigned int,unsigned int> >
+        readTiff
+        (
+            std::string const _filename
+        );
+#   endif
+
+
+    /**
+     * @return true if readFile can read this file, i.e. it ends with ".txt",
+     *         ".raw", ".npy" or, depending on the build options, ".png",
+     *         "_0_0_0.h5", ".tif" or ".tiff"
+     */
+    bool isSupportedFile( std::string const & _filename );
+
+    /**
+     * Reads a file with the function matching its extension.
+     *
+     * @see readPNG
+     */
+    std::pair<float *, std::pair<unsigned int, unsigned int> >
+    readFile
+    (
+        std::string const & _filename
+    );
+
+
 } // namespace readInFuncs
 } // namespace io
 } // namespace imresh
@@ -0,0 +1,306 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/resultCache.hpp"
+
+#include <cstdio>                   // std::rename, std::remove
+#include <cstring>                  // memcpy
+#include <fstream>                  // std::ifstream, std::ofstream
+#include <iomanip>                  // setw, setfill
+#include <iterator>                 // std::prev
+#include <sstream>                  // std::ostringstream
+#include <utility>                  // std::move
+
+#include "libs/hash.hpp"            // hash64
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    bool ResultCacheKey::operator==( ResultCacheKey const & rOther ) const
+    {
+        return intensityHash            == rOther.intensityHash            and
+               size                     == rOther.size                     and
+               numberOfCycles           == rOther.numberOfCycles           and
+               numberOfHIOCycles        == rOther.numberOfHIOCycles        and
+               targetError              == rOther.targetError              and
+               HIOBeta                  == rOther.HIOBeta                  and
+               intensityCutOffAutoCorel == rOther.intensityCutOffAutoCorel and
+               intensityCutOff          == rOther.intensityCutOff          and
+               sigma0                   == rOther.sigma0                   and
+               sigmaChange              == rOther.sigmaChange;
+    }
+
+    uint64_t ResultCacheKey::hash( void ) const
+    {
+        /* copy into a packed buffer, because the padding of the struct is
+         * undefined */
+        unsigned int const integers[4] = { size.first, size.second,
+                                           numberOfCycles, numberOfHIOCycles };
+        float const floats[6] = { targetError, HIOBeta, intensityCutOffAutoCorel,
+                                  intensityCutOff, sigma0, sigmaChange };
+        char buffer[ sizeof( integers ) + sizeof( floats ) ];
+        memcpy( buffer, integers, sizeof( integers ) );
+        memcpy( buffer + sizeof( integers ), floats, sizeof( floats ) );
+        return imresh::libs::hash64( buffer, sizeof( buffer ), intensityHash );
+    }
+
+
+    /* identifies the spill files and their version */
+    static char const spillFileMagic[8] = { 'I','M','R','E','S','H','R','1' };
+
+
+    ResultCache::ResultCache
+    (
+        size_t const rMaxMemory,
+        std::string const & rSpillDirectory
+    )
+    : mMaxMemory( rMaxMemory ),
+      mSpillDirectory( rSpillDirectory )
+    {
+        memset( &mStatistics, 0, sizeof( mStatistics ) );
+    }
+
+    std::string ResultCache::getSpillFilename( ResultCacheKey const & rKey ) const
+    {
+        std::ostringstream filename;
+        filename << mSpillDirectory << "/" << std::hex << std::setw(16)
+                 << std::setfill('0') << rKey.hash() << ".imresh-cache";
+        return filename.str();
+    }
+
+    bool ResultCache::readSpilled
+    (
+        ResultCacheKey const & rKey,
+        std::vector<float> & rResult
+    ) const
+    {
+        if ( mSpillDirectory.empty() )
+            return false;
+
+        std::ifstream file( getSpillFilename( rKey ), std::ios::in | std::ios::binary );
+        if ( not file.is_open() )
+            return false;
+
+        char magic[ sizeof( spillFileMagic ) ];
+        ResultCacheKey key;
+        uint64_t nElements = 0;
+        file.read( magic, sizeof( magic ) );
+        file.read( (char*) &key, sizeof( key ) );
+        file.read( (char*) &nElements, sizeof( nElements ) );
+        if ( not file or memcmp( magic, spillFileMagic, sizeof( magic ) ) != 0 or
+             not ( key == rKey ) or
+             nElements != uint64_t( rKey.size.first ) * rKey.size.second )
+        {
+            return false;
+        }
+
+        rResult.resize( nElements );
+        file.read( (char*) rResult.data(), nElements * sizeof( rResult[0] ) );
+        return (bool) file;
+    }
+
+    bool ResultCache::writeSpilled( Entry const & rEntry ) const
+    {
+        if ( mSpillDirectory.empty() )
+            return false;
+
+        /* write to a temporary file first, so that a concurrent reader or a
+         * crash never leaves a truncated file with the final name */
+        auto const filename = getSpillFilename( rEntry.key );
+        auto const tmpFilename = filename + ".tmp";
+        std::ofstream file( tmpFilename, std::ios::out | std::ios::binary | std::ios::trunc );
+        if ( not file.is_open() )
+            return false;
+
+        uint64_t const nElements = rEntry.result.size();
+        file.write( spillFileMagic, sizeof( spillFileMagic ) );
+        file.write( (char const *) &rEntry.key, sizeof( rEntry.key ) );
+        file.write( (char const *) &nElements, sizeof( nElements ) );
+        file.write( (char const *) rEntry.result.data(), nElements * sizeof( rEntry.result[0] ) );
+        file.close();
+
+        if ( file and std::rename( tmpFilename.c_str(), filename.c_str() ) == 0 )
+            return true;
+        std::remove( tmpFilename.c_str() );
+        return false;
+    }
+
+    void ResultCache::insertLocked
+    (
+        Entry && rEntry,
+        std::list<Entry> & rEvicted
+    )
+    {
+        size_t const nBytes = rEntry.result.size() * sizeof( rEntry.result[0] );
+        if ( nBytes > mMaxMemory )
+            return;
+
+        uint64_t const hash = rEntry.key.hash();
+        auto itIndex = mIndex.find( hash );
+        if ( itIndex != mIndex.end() )
+        {
+            /* replace a colliding key, which is astronomically unlikely */
+            mStatistics.memoryUsed -= itIndex->second->result.size() * sizeof( float );
+            mEntries.erase( itIndex->second );
+            mIndex.erase( itIndex );
+        }
+
+        while ( not mEntries.empty() and mStatistics.memoryUsed + nBytes > mMaxMemory )
+        {
+            auto const itOldest = std::prev( mEntries.end() );
+            mStatistics.memoryUsed -= itOldest->result.size() * sizeof( float );
+            ++mStatistics.nEvictions;
+            mIndex.erase( itOldest->key.hash() );
+            rEvicted.splice( rEvicted.end(), mEntries, itOldest );
+        }
+
+        mEntries.push_front( std::move( rEntry ) );
+        mIndex[ hash ] = mEntries.begin();
+        mStatistics.memoryUsed += nBytes;
+    }
+
+    bool ResultCache::lookup
+    (
+        ResultCacheKey const & rKey,
+        float * const rpResult
+    )
+    {
+        size_t const nElements = size_t( rKey.size.first ) * rKey.size.second;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            auto itIndex = mIndex.find( rKey.hash() );
+            if ( itIndex != mIndex.end() and itIndex->second->key == rKey )
+            {
+                /* move to the front, i.e. mark as most recently used */
+                mEntries.splice( mEntries.begin(), mEntries, itIndex->second );
+                memcpy( rpResult, mEntries.front().result.data(), nElements * sizeof( rpResult[0] ) );
+                ++mStatistics.nMemoryHits;
+                return true;
+            }
+        }
+
+        /* read from disk without holding the lock */
+        Entry entry;
+        entry.key = rKey;
+        bool const found = readSpilled( rKey, entry.result );
+        entry.isSpilled = found;
+        if ( found )
+            memcpy( rpResult, entry.result.data(), nElements * sizeof( rpResult[0] ) );
+
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            if ( not found )
+            {
+                ++mStatistics.nMisses;
+                return false;
+            }
+            ++mStatistics.nDiskHits;
+            insertLocked( std::move( entry ), evicted );
+        }
+        for ( auto const & evictedEntry : evicted )
+            if ( not evictedEntry.isSpilled )
+                writeSpilled( evictedEntry );
+        return true;
+    }
+
+    bool ResultCache::contains( ResultCacheKey const & rKey )
+    {
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            auto itIndex = mIndex.find( rKey.hash() );
+            if ( itIndex != mIndex.end() and itIndex->second->key == rKey )
+                return true;
+        }
+        if ( mSpillDirectory.empty() )
+            return false;
+
+        /* only check the header, the data is read by lookup */
+        std::ifstream file( getSpillFilename( rKey ), std::ios::in | std::ios::binary );
+        char magic[ sizeof( spillFileMagic ) ];
+        ResultCacheKey key;
+        file.read( magic, sizeof( magic ) );
+        file.read( (char*) &key, sizeof( key ) );
+        return file and memcmp( magic, spillFileMagic, sizeof( magic ) ) == 0
+               and key == rKey;
+    }
+
+    void ResultCache::insert
+    (
+        ResultCacheKey const & rKey,
+        float const * const rpResult
+    )
+    {
+        size_t const nElements = size_t( rKey.size.first ) * rKey.size.second;
+
+        /* copy without holding the lock */
+        Entry entry;
+        entry.key = rKey;
+        entry.result.assign( rpResult, rpResult + nElements );
+
+        auto const isCached = [&]
+        {
+            auto itIndex = mIndex.find( rKey.hash() );
+            return itIndex != mIndex.end() and itIndex->second->key == rKey;
+        };
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            if ( isCached() )
+                return;
+        }
+        /* write through without holding the lock, so that the result
+         * survives a restart even if it is never evicted */
+        entry.isSpilled = writeSpilled( entry );
+
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            if ( isCached() )
+                return;
+            insertLocked( std::move( entry ), evicted );
+            ++mStatistics.nInsertions;
+        }
+        /* results which couldn't be written on insert are tried again */
+        for ( auto const & evictedEntry : evicted )
+            if ( not evictedEntry.isSpilled )
+                writeSpilled( evictedEntry );
+    }
+
+    ResultCacheStatistics ResultCache::getStatistics( void )
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        auto statistics = mStatistics;
+        uint64_t const nHits = statistics.nMemoryHits + statistics.nDiskHits;
+        uint64_t const nLookups = nHits + statistics.nMisses;
+        statistics.hitRate = nLookups > 0 ? (double) nHits / nLookups : 0;
+        return statistics;
+    }
+
+
+} // namespace io
+} // namespace imresh
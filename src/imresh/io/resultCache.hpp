@@ -0,0 +1,179 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint64_t
+#include <list>                     // std::list
+#include <mutex>                    // std::mutex
+#include <string>                   // std::string
+#include <unordered_map>            // std::unordered_map
+#include <utility>                  // std::pair
+#include <vector>                   // std::vector
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Identifies a reconstruction by its input and all parameters which
+     * influence the result.
+     */
+    struct ResultCacheKey
+    {
+        /**
+         * hash of the input intensity, see imresh::libs::hash64
+         */
+        uint64_t intensityHash;
+        std::pair<unsigned int,unsigned int> size;
+        unsigned int numberOfCycles;
+        unsigned int numberOfHIOCycles;
+        float targetError;
+        float HIOBeta;
+        float intensityCutOffAutoCorel;
+        float intensityCutOff;
+        float sigma0;
+        float sigmaChange;
+
+        bool operator==( ResultCacheKey const & rOther ) const;
+        /**
+         * Combines all members to one hash, which is also used as filename
+         * when spilling to disk.
+         */
+        uint64_t hash( void ) const;
+    };
+
+    /**
+     * Hit and miss counters of a ResultCache
+     */
+    struct ResultCacheStatistics
+    {
+        uint64_t nMemoryHits;
+        uint64_t nDiskHits;
+        uint64_t nMisses;
+        uint64_t nInsertions;
+        uint64_t nEvictions;
+        /**
+         * Bytes of all results currently held in memory
+         */
+        size_t memoryUsed;
+        /**
+         * (nMemoryHits + nDiskHits) / ( nMemoryHits + nDiskHits + nMisses )
+         */
+        double hitRate;
+    };
+
+    /**
+     * Thread-safe least recently used cache for reconstructed images.
+     *
+     * If the results in memory exceed the given size, the least recently
+     * used ones are evicted. If a spill directory is given, every inserted
+     * result is also written to it, and a lookup which misses the memory
+     * checks the directory before giving up. Because the files are named
+     * after the key, all results survive restarts or crashes of the
+     * process. The directory is never cleaned up by this class.
+     */
+    class ResultCache
+    {
+    public:
+        /**
+         * @param[in] rMaxMemory maximum bytes of results held in memory
+         * @param[in] rSpillDirectory existing directory to write the results
+         *            to. Empty to disable spilling.
+         */
+        ResultCache
+        (
+            size_t const rMaxMemory,
+            std::string const & rSpillDirectory = ""
+        );
+
+        /**
+         * Copies the result for rKey to rpResult if it is cached.
+         *
+         * @param[out] rpResult must hold rKey.size.first*rKey.size.second
+         *             elements. It is only written to on a hit.
+         * @return true on a hit
+         */
+        bool lookup
+        (
+            ResultCacheKey const & rKey,
+            float * const rpResult
+        );
+
+        /**
+         * Returns true if the result for rKey is held in memory or in the
+         * spill directory. Neither the statistics nor the order of
+         * eviction are changed. A later lookup can still miss, because
+         * the entry may be evicted in between.
+         */
+        bool contains( ResultCacheKey const & rKey );
+
+        /**
+         * Stores a copy of the result and writes it to the spill directory.
+         * Does nothing if the key is already cached. A result alone larger
+         * than the memory limit is only written to the spill directory.
+         */
+        void insert
+        (
+            ResultCacheKey const & rKey,
+            float const * const rpResult
+        );
+
+        ResultCacheStatistics getStatistics( void );
+
+    private:
+        struct Entry
+        {
+            ResultCacheKey key;
+            std::vector<float> result;
+            /* true if the result is in the spill directory */
+            bool isSpilled = false;
+        };
+
+        std::string getSpillFilename( ResultCacheKey const & rKey ) const;
+        bool readSpilled( ResultCacheKey const & rKey, std::vector<float> & rResult ) const;
+        /* returns true if the result was written */
+        bool writeSpilled( Entry const & rEntry ) const;
+        /* not thread-safe! call with mMutex locked. Evicted entries are
+         * moved to rEvicted, so that those which aren't spilled yet can be
+         * written after unlocking */
+        void insertLocked( Entry && rEntry, std::list<Entry> & rEvicted );
+
+        size_t const mMaxMemory;
+        std::string const mSpillDirectory;
+        std::mutex mMutex;
+        /* most recently used entries first */
+        std::list<Entry> mEntries;
+        /* maps ResultCacheKey::hash to the entry */
+        std::unordered_map< uint64_t, std::list<Entry>::iterator > mIndex;
+        ResultCacheStatistics mStatistics;
+    };
+
+
+} // namespace io
+} // namespace imresh
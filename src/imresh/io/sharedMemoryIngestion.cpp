@@ -0,0 +1,230 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/sharedMemoryIngestion.hpp"
+
+#include <chrono>                   // std::chrono::seconds
+#include <condition_variable>       // std::condition_variable
+#include <cstdint>                  // uint64_t
+#include <cstring>                  // memcpy
+#include <cuda_runtime_api.h>       // cudaHostRegister
+#ifdef IMRESH_DEBUG
+#   include <iostream>              // std::cout, std::endl
+#endif
+#include <memory>                   // std::unique_ptr
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <string>                   // std::string
+#include <thread>                   // std::thread
+#include <utility>                  // std::pair
+
+#include "io/frameHeader.hpp"       // FrameHeader, addFrameTask
+#include "io/sharedMemoryRing.hpp"
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    std::unique_ptr<SharedMemoryRing> inputRing;
+    std::unique_ptr<SharedMemoryRing> resultRing;
+    std::thread ingestionThread;
+    /**
+     * Input slots which were handed to the task queue and not yet released
+     */
+    unsigned int nFramesInFlight = 0;
+    /**
+     * set when ingestionLoop read everything from the closed input ring
+     */
+    bool ingestionFinished = false;
+    /**
+     * results written so far, to detect that the result ring is stuck
+     */
+    uint64_t nFramesFinished = 0;
+    std::mutex framesInFlightMutex;
+    std::condition_variable framesInFlightChanged;
+    bool slotMemoryRegistered = false;
+
+    /**
+     * Sends a result for an input slot and gives the input slot back.
+     * Data is only copied for FrameStatus::Ok.
+     */
+    void finishFrame
+    (
+        int const _inputSlot,
+        float const * const _result,
+        FrameStatus const _status
+    )
+    {
+        FrameHeader header = inputRing->getHeader( _inputSlot );
+        header.status = static_cast<int32_t>( _status );
+
+        int const resultSlot = resultRing->acquireWrite( );
+        /* only fails if the result ring was closed, i.e. nobody waits for
+         * the result anymore */
+        if ( resultSlot >= 0 )
+        {
+            if ( _status == FrameStatus::Ok )
+            {
+                memcpy( resultRing->getData( resultSlot ), _result,
+                        sizeof( float ) * header.width * header.height );
+            }
+            resultRing->publish( resultSlot, header );
+        }
+        inputRing->release( _inputSlot );
+
+        std::lock_guard<std::mutex> lock( framesInFlightMutex );
+        --nFramesInFlight;
+        ++nFramesFinished;
+        framesInFlightChanged.notify_all( );
+    }
+
+    void ingestionLoop( void )
+    {
+        size_t const maxElements = inputRing->getMaxElements( );
+        /* runs until the input ring is closed and all frames published
+         * before were read, so that every one of them gets a result */
+        while ( true )
+        {
+            int const slot = inputRing->acquireRead( );
+            if ( slot < 0 )
+            {
+                if ( inputRing->isClosed( ) )
+                    break;
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock( framesInFlightMutex );
+                ++nFramesInFlight;
+            }
+
+            FrameHeader const & header = inputRing->getHeader( slot );
+            size_t const nElements = size_t( header.width ) * header.height;
+            if ( nElements == 0 or nElements > maxElements )
+            {
+                finishFrame( slot, NULL, FrameStatus::Invalid );
+                continue;
+            }
+
+            auto writeOut = [slot]( float * _mem,
+                                    std::pair<unsigned int,unsigned int>,
+                                    std::string )
+            {
+                finishFrame( slot, _mem, FrameStatus::Ok );
+            };
+            auto cancel = [slot]( float *,
+                                  std::pair<unsigned int,unsigned int>,
+                                  std::string )
+            {
+                finishFrame( slot, NULL, FrameStatus::Cancelled );
+            };
+
+            bool const accepted = addFrameTask( inputRing->getData( slot ),
+                                                header, writeOut, cancel );
+            if ( not accepted )
+                finishFrame( slot, NULL, FrameStatus::Rejected );
+        }
+
+        std::lock_guard<std::mutex> lock( framesInFlightMutex );
+        ingestionFinished = true;
+        framesInFlightChanged.notify_all( );
+    }
+
+    bool sharedMemoryIngestionStart
+    (
+        std::string const & _inputRing,
+        std::string const & _resultRing,
+        unsigned int _nSlots,
+        size_t _maxElements
+    )
+    {
+        if ( inputRing )
+            return false;
+
+        inputRing.reset( new SharedMemoryRing( _inputRing, _nSlots, _maxElements ) );
+        resultRing.reset( new SharedMemoryRing( _resultRing, _nSlots, _maxElements ) );
+        if ( not inputRing->isOpen( ) or not resultRing->isOpen( ) )
+        {
+            inputRing.reset( );
+            resultRing.reset( );
+            return false;
+        }
+
+        /* Page-lock the input slots, so that the copies to the GPU can be
+         * done with DMA directly from the shared memory. Not fatal if it
+         * fails, e.g. because of RLIMIT_MEMLOCK. */
+        slotMemoryRegistered = cudaHostRegister(
+            inputRing->getSlotMemory( ), inputRing->getSlotMemorySize( ),
+            cudaHostRegisterPortable ) == cudaSuccess;
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::sharedMemoryIngestionStart(): "
+                      << ( slotMemoryRegistered ? "Registered" : "Couldn't register" )
+                      << " input slots as pinned memory" << std::endl;
+#       endif
+
+        ingestionFinished = false;
+        ingestionThread = std::thread( ingestionLoop );
+        return true;
+    }
+
+    void sharedMemoryIngestionStop( void )
+    {
+        if ( not inputRing )
+            return;
+
+        /* the frames already published are still read and answered */
+        inputRing->close( );
+        {
+            /* If the acquisition process stopped reading results, workers
+             * block on the full result ring and with them the ingestion
+             * thread in addTask. Closing it lets them go on. */
+            std::unique_lock<std::mutex> lock( framesInFlightMutex );
+            auto const isDone = []{ return ingestionFinished and nFramesInFlight == 0; };
+            uint64_t nFinishedBefore = nFramesFinished;
+            while ( not framesInFlightChanged.wait_for( lock,
+                        std::chrono::seconds( 10 ), isDone ) )
+            {
+                if ( nFramesFinished == nFinishedBefore )
+                {
+                    resultRing->close( );
+                    framesInFlightChanged.wait( lock, isDone );
+                    break;
+                }
+                nFinishedBefore = nFramesFinished;
+            }
+        }
+        ingestionThread.join( );
+
+        if ( slotMemoryRegistered )
+            cudaHostUnregister( inputRing->getSlotMemory( ) );
+        slotMemoryRegistered = false;
+        resultRing.reset( );
+        inputRing.reset( );
+    }
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,78 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>                  // size_t
+#include <string>                   // std::string
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Creates an input and a result SharedMemoryRing and starts a thread
+     * which hands every frame published to the input ring to addTask. The
+     * reconstruction runs directly on the shared memory, i.e. frames are not
+     * copied on the way in. Finished reconstructions are copied into the
+     * result ring together with the header of their input frame. Cancelled,
+     * aborted or rejected frames get a result header with the according
+     * FrameStatus and no data.
+     *
+     * The acquisition process attaches to both rings with the single
+     * argument SharedMemoryRing constructor, publishes to the input ring and
+     * reads from the result ring. It has to keep reading results, because
+     * the input slots are only given back after their result was written.
+     *
+     * taskQueueInit has to be called before.
+     *
+     * @param _inputRing shm name of the input ring, e.g. "/imresh-input"
+     * @param _resultRing shm name of the result ring
+     * @param _nSlots number of slots per ring
+     * @param _maxElements maximum number of pixels per frame
+     * @return false if the rings couldn't be created or the ingestion is
+     *         already running
+     */
+    bool sharedMemoryIngestionStart
+    (
+        std::string const & _inputRing,
+        std::string const & _resultRing,
+        unsigned int _nSlots,
+        size_t _maxElements
+    );
+
+    /**
+     * Closes the input ring, waits until all frames published to it were
+     * read and answered and then closes and removes both rings. If no
+     * result could be written for 10 s, because the acquisition process
+     * doesn't read them anymore, the remaining results are dropped.
+     */
+    void sharedMemoryIngestionStop( void );
+
+
+} // namespace io
+} // namespace imresh
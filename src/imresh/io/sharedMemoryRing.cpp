@@ -0,0 +1,411 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/sharedMemoryRing.hpp"
+
+#include <chrono>                   // std::chrono
+#include <climits>                  // INT_MAX
+#include <cstdio>                   // perror
+#include <cstring>                  // memcpy, memcmp
+#include <fcntl.h>                  // O_CREAT, O_RDWR, O_EXCL
+#include <iostream>
+#include <linux/futex.h>            // FUTEX_WAIT, FUTEX_WAKE
+#include <new>                      // placement new
+#include <sys/mman.h>               // shm_open, shm_unlink, mmap, munmap
+#include <sys/stat.h>               // fstat
+#include <sys/syscall.h>            // SYS_futex
+#include <time.h>                   // timespec
+#include <unistd.h>                 // ftruncate, close, syscall
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    namespace
+    {
+        char const ringMagic[8] = { 'I','M','R','E','S','H','Q','1' };
+        constexpr size_t pageSize = 4096;
+
+        enum SlotState : uint32_t
+        {
+            SLOT_FREE    = 0,
+            SLOT_WRITING = 1,
+            SLOT_READY   = 2,
+            SLOT_READING = 3
+        };
+
+        /**
+         * Lies at the start of each slot, the frame data follows at
+         * slotDataOffset.
+         */
+        struct SlotControl
+        {
+            std::atomic<uint32_t> state;
+            FrameHeader header;
+        };
+        constexpr size_t slotDataOffset = 128;
+        static_assert( sizeof( SlotControl ) <= slotDataOffset,
+                       "Slot header doesn't fit in front of the data" );
+        /* the futex words are plain 32-bit integers shared between
+         * processes, which only works for lock-free atomics */
+        static_assert( sizeof( std::atomic<uint32_t> ) == sizeof( uint32_t ),
+                       "std::atomic<uint32_t> can't be used as futex word" );
+
+        size_t roundUp( size_t const rValue, size_t const rMultiple )
+        {
+            return ( rValue + rMultiple - 1 ) / rMultiple * rMultiple;
+        }
+
+        /**
+         * Sleeps until *rpWord != rExpected, a wake up or the timeout.
+         * Not FUTEX_PRIVATE, because the word is shared between processes.
+         */
+        void futexWait
+        (
+            std::atomic<uint32_t> * const rpWord,
+            uint32_t const rExpected,
+            std::chrono::nanoseconds const rTimeout
+        )
+        {
+            timespec ts;
+            ts.tv_sec  = rTimeout.count() / 1000000000;
+            ts.tv_nsec = rTimeout.count() % 1000000000;
+            syscall( SYS_futex, reinterpret_cast<uint32_t*>( rpWord ),
+                     FUTEX_WAIT, rExpected, &ts, NULL, 0 );
+        }
+
+        void futexWakeAll( std::atomic<uint32_t> * const rpWord )
+        {
+            syscall( SYS_futex, reinterpret_cast<uint32_t*>( rpWord ),
+                     FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+        }
+    } // anonymous namespace
+
+
+    struct SharedMemoryRing::RingHeader
+    {
+        char magic[8];
+        uint32_t nSlots;
+        uint64_t nMaxElements;
+        uint64_t slotStride;
+        std::atomic<uint32_t> closed;
+        /**
+         * futex words, incremented after every publish or release
+         */
+        std::atomic<uint32_t> dataSequence;
+        std::atomic<uint32_t> spaceSequence;
+        /**
+         * Only changed by the producer or consumer process respectively,
+         * while holding mWriteMutex or mReadMutex
+         */
+        uint64_t writeCursor;
+        uint64_t readCursor;
+    };
+
+    namespace
+    {
+        /**
+         * Waits until rIsDone returns true. Returns false on timeout or if
+         * rIsClosed returns true before that.
+         */
+        template< class T_IsDone, class T_IsClosed >
+        bool waitOnSequence
+        (
+            std::atomic<uint32_t> & rSequence,
+            T_IsDone rIsDone,
+            T_IsClosed rIsClosed,
+            int const rTimeoutMs
+        )
+        {
+            using Clock = std::chrono::steady_clock;
+            auto const deadline = Clock::now() +
+                                  std::chrono::milliseconds( rTimeoutMs );
+            while ( true )
+            {
+                /* read the sequence before checking, so that a publish in
+                 * between lets the futex wait return immediately */
+                uint32_t const sequence = rSequence.load();
+                if ( rIsDone() )
+                    return true;
+                if ( rIsClosed() )
+                    return false;
+                /* wake up regularly in case the other process died without
+                 * closing the ring */
+                std::chrono::nanoseconds timeout = std::chrono::seconds( 1 );
+                if ( rTimeoutMs >= 0 )
+                {
+                    auto const remaining = deadline - Clock::now();
+                    if ( remaining <= Clock::duration::zero() )
+                        return false;
+                    if ( remaining < timeout )
+                        timeout = remaining;
+                }
+                futexWait( &rSequence, sequence, timeout );
+            }
+        }
+    } // anonymous namespace
+
+
+    SharedMemoryRing::SharedMemoryRing
+    (
+        std::string const & rName,
+        unsigned int const rnSlots,
+        size_t const rnMaxElements
+    )
+    : mName( rName ), mIsOwner( true ), mMapping( NULL ), mnMappedBytes( 0 ),
+      mHeader( NULL ), mSlots( NULL )
+    {
+        static_assert( sizeof( RingHeader ) <= pageSize,
+                       "Ring header doesn't fit in front of the slots" );
+        size_t const slotStride = roundUp( slotDataOffset +
+                                  rnMaxElements * sizeof( float ), pageSize );
+        size_t const nBytes = pageSize + rnSlots * slotStride;
+
+        shm_unlink( rName.c_str() );
+        int const fd = shm_open( rName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+        if ( fd < 0 )
+        {
+            perror( "imresh::io::SharedMemoryRing(): shm_open failed" );
+            return;
+        }
+        if ( ftruncate( fd, nBytes ) != 0 )
+        {
+            perror( "imresh::io::SharedMemoryRing(): ftruncate failed" );
+            ::close( fd );
+            shm_unlink( rName.c_str() );
+            return;
+        }
+        map( fd, nBytes );
+        ::close( fd );
+        if ( mMapping == NULL )
+        {
+            shm_unlink( rName.c_str() );
+            return;
+        }
+
+        /* ftruncate zero-fills, so all slots already are SLOT_FREE */
+        mHeader = new( mMapping ) RingHeader;
+        mHeader->nSlots       = rnSlots;
+        mHeader->nMaxElements = rnMaxElements;
+        mHeader->slotStride   = slotStride;
+        mHeader->closed       = 0;
+        mHeader->dataSequence  = 0;
+        mHeader->spaceSequence = 0;
+        mHeader->writeCursor  = 0;
+        mHeader->readCursor   = 0;
+        for ( unsigned int i = 0; i < rnSlots; ++i )
+            new( mSlots + i * slotStride ) SlotControl();
+        /* the magic is written last, so that attaching processes never see
+         * a half initialized ring */
+        std::atomic_thread_fence( std::memory_order_release );
+        memcpy( mHeader->magic, ringMagic, sizeof( ringMagic ) );
+
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::SharedMemoryRing(): Created " << rName
+                      << " with " << rnSlots << " slots of "
+                      << rnMaxElements << " elements" << std::endl;
+#       endif
+    }
+
+    SharedMemoryRing::SharedMemoryRing( std::string const & rName )
+    : mName( rName ), mIsOwner( false ), mMapping( NULL ), mnMappedBytes( 0 ),
+      mHeader( NULL ), mSlots( NULL )
+    {
+        int const fd = shm_open( rName.c_str(), O_RDWR, 0 );
+        if ( fd < 0 )
+        {
+            perror( "imresh::io::SharedMemoryRing(): shm_open failed" );
+            return;
+        }
+        struct stat info;
+        if ( fstat( fd, &info ) != 0 or size_t( info.st_size ) < pageSize )
+        {
+            std::cerr << "imresh::io::SharedMemoryRing(): " << rName
+                      << " is too small to be a ring" << std::endl;
+            ::close( fd );
+            return;
+        }
+        map( fd, info.st_size );
+        ::close( fd );
+        if ( mMapping == NULL )
+            return;
+
+        RingHeader * const header = static_cast<RingHeader*>( mMapping );
+        if ( memcmp( header->magic, ringMagic, sizeof( ringMagic ) ) != 0 or
+             pageSize + header->nSlots * header->slotStride > mnMappedBytes )
+        {
+            std::cerr << "imresh::io::SharedMemoryRing(): " << rName
+                      << " is not a valid ring" << std::endl;
+            munmap( mMapping, mnMappedBytes );
+            mMapping = NULL;
+            mSlots   = NULL;
+            return;
+        }
+        std::atomic_thread_fence( std::memory_order_acquire );
+        mHeader = header;
+    }
+
+    SharedMemoryRing::~SharedMemoryRing()
+    {
+        if ( mHeader != NULL and mIsOwner )
+            close();
+        if ( mMapping != NULL )
+            munmap( mMapping, mnMappedBytes );
+        if ( mIsOwner )
+            shm_unlink( mName.c_str() );
+    }
+
+    void SharedMemoryRing::map( int const rFd, size_t const rnBytes )
+    {
+        void * const p = mmap( NULL, rnBytes, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, rFd, 0 );
+        if ( p == MAP_FAILED )
+        {
+            perror( "imresh::io::SharedMemoryRing::map(): mmap failed" );
+            return;
+        }
+        mMapping     = p;
+        mnMappedBytes = rnBytes;
+        mSlots       = static_cast<char*>( p ) + pageSize;
+    }
+
+    bool SharedMemoryRing::isOpen( void ) const
+    {
+        return mHeader != NULL;
+    }
+
+    int SharedMemoryRing::acquireWrite( int const rTimeoutMs )
+    {
+        std::lock_guard<std::mutex> lock( mWriteMutex );
+        int const slot = mHeader->writeCursor % mHeader->nSlots;
+        auto & state = reinterpret_cast<SlotControl*>(
+                       mSlots + slot * mHeader->slotStride )->state;
+
+        if ( not waitOnSequence( mHeader->spaceSequence,
+                [&]{ return state.load() == SLOT_FREE; },
+                [&]{ return mHeader->closed.load() != 0; },
+                rTimeoutMs ) )
+            return -1;
+        if ( mHeader->closed.load() != 0 )
+            return -1;
+
+        state.store( SLOT_WRITING );
+        ++mHeader->writeCursor;
+        return slot;
+    }
+
+    void SharedMemoryRing::publish
+    (
+        int const rSlot,
+        FrameHeader const & rHeader
+    )
+    {
+        auto control = reinterpret_cast<SlotControl*>(
+                       mSlots + rSlot * mHeader->slotStride );
+        control->header = rHeader;
+        control->state.store( SLOT_READY, std::memory_order_release );
+        mHeader->dataSequence.fetch_add( 1 );
+        futexWakeAll( &mHeader->dataSequence );
+    }
+
+    int SharedMemoryRing::acquireRead( int const rTimeoutMs )
+    {
+        std::lock_guard<std::mutex> lock( mReadMutex );
+        int const slot = mHeader->readCursor % mHeader->nSlots;
+        auto & state = reinterpret_cast<SlotControl*>(
+                       mSlots + slot * mHeader->slotStride )->state;
+
+        /* frames published before closing are still handed out */
+        if ( not waitOnSequence( mHeader->dataSequence,
+                [&]{ return state.load( std::memory_order_acquire ) == SLOT_READY; },
+                [&]{ return mHeader->closed.load() != 0; },
+                rTimeoutMs ) )
+            return -1;
+
+        state.store( SLOT_READING );
+        ++mHeader->readCursor;
+        return slot;
+    }
+
+    void SharedMemoryRing::release( int const rSlot )
+    {
+        auto control = reinterpret_cast<SlotControl*>(
+                       mSlots + rSlot * mHeader->slotStride );
+        control->state.store( SLOT_FREE, std::memory_order_release );
+        mHeader->spaceSequence.fetch_add( 1 );
+        futexWakeAll( &mHeader->spaceSequence );
+    }
+
+    FrameHeader & SharedMemoryRing::getHeader( int const rSlot )
+    {
+        return reinterpret_cast<SlotControl*>(
+               mSlots + rSlot * mHeader->slotStride )->header;
+    }
+
+    float * SharedMemoryRing::getData( int const rSlot )
+    {
+        return reinterpret_cast<float*>(
+               mSlots + rSlot * mHeader->slotStride + slotDataOffset );
+    }
+
+    void SharedMemoryRing::close( void )
+    {
+        mHeader->closed.store( 1 );
+        mHeader->dataSequence.fetch_add( 1 );
+        mHeader->spaceSequence.fetch_add( 1 );
+        futexWakeAll( &mHeader->dataSequence );
+        futexWakeAll( &mHeader->spaceSequence );
+    }
+
+    bool SharedMemoryRing::isClosed( void ) const
+    {
+        return mHeader->closed.load() != 0;
+    }
+
+    unsigned int SharedMemoryRing::getSlotCount( void ) const
+    {
+        return mHeader->nSlots;
+    }
+
+    size_t SharedMemoryRing::getMaxElements( void ) const
+    {
+        return mHeader->nMaxElements;
+    }
+
+    void * SharedMemoryRing::getSlotMemory( void ) const
+    {
+        return mSlots;
+    }
+
+    size_t SharedMemoryRing::getSlotMemorySize( void ) const
+    {
+        return size_t( mHeader->nSlots ) * mHeader->slotStride;
+    }
+
+
+} // namespace io
+} // namespace imresh
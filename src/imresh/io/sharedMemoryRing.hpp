@@ -0,0 +1,160 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>                   // std::atomic
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint32_t, uint64_t
+#include <mutex>                    // std::mutex
+#include <string>                   // std::string
+
+#include "io/frameHeader.hpp"       // FrameHeader
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Fixed size ring of frame slots inside POSIX shared memory for handing
+     * frames from one process to another on the same host without copying.
+     *
+     * Each slot goes through free -> writing -> ready -> reading -> free.
+     * Producers and consumers claim slots strictly in ring order, but slots
+     * may be given back out of order, e.g. when reconstructions finish in a
+     * different order than they were started. Waiting is done with futexes
+     * on counters in the shared memory, so a blocked side doesn't spin.
+     *
+     * Only one process may produce and one process may consume, but inside
+     * these processes any number of threads may do so.
+     */
+    class SharedMemoryRing
+    {
+    public:
+        /**
+         * Creates a new ring under the given shm name (e.g. "/imresh-input"),
+         * replacing an old one with the same name. The ring is unlinked again
+         * when this object is destroyed.
+         *
+         * @param rnSlots number of slots in the ring
+         * @param rnMaxElements maximum number of floats per frame
+         *
+         * Check isOpen afterwards, errors are printed with perror.
+         */
+        SharedMemoryRing
+        (
+            std::string const & rName,
+            unsigned int rnSlots,
+            size_t rnMaxElements
+        );
+        /**
+         * Attaches to a ring created by another process. Check isOpen
+         * afterwards.
+         */
+        explicit SharedMemoryRing( std::string const & rName );
+        ~SharedMemoryRing();
+
+        /**
+         * @return false if creating or attaching failed. No other method may
+         *         be called in that case.
+         */
+        bool isOpen( void ) const;
+
+        SharedMemoryRing( SharedMemoryRing const & ) = delete;
+        SharedMemoryRing & operator=( SharedMemoryRing const & ) = delete;
+
+        /**
+         * Claims the next slot for writing. Blocks until it is free.
+         *
+         * @param rTimeoutMs maximum time to wait, negative waits forever
+         * @return slot index or -1 on timeout or if the ring was closed
+         */
+        int acquireWrite( int rTimeoutMs = -1 );
+        /**
+         * Makes a slot claimed with acquireWrite visible to the consumer.
+         * The header is copied into the slot, the data must already have
+         * been written to getData( slot ).
+         */
+        void publish( int rSlot, FrameHeader const & rHeader );
+        /**
+         * Claims the next published slot for reading. Blocks until there is
+         * one.
+         *
+         * @param rTimeoutMs maximum time to wait, negative waits forever
+         * @return slot index or -1 on timeout or if the ring was closed and
+         *         everything was read
+         */
+        int acquireRead( int rTimeoutMs = -1 );
+        /**
+         * Gives a slot claimed with acquireRead back to the producer.
+         */
+        void release( int rSlot );
+
+        FrameHeader & getHeader( int rSlot );
+        float * getData( int rSlot );
+
+        /**
+         * Wakes up all waiting threads of both processes and makes further
+         * acquireWrite calls fail. Already published frames can still be read.
+         */
+        void close( void );
+        bool isClosed( void ) const;
+
+        unsigned int getSlotCount( void ) const;
+        size_t getMaxElements( void ) const;
+        /**
+         * Start and length of all slots, e.g. for pinning them with
+         * cudaHostRegister.
+         */
+        void * getSlotMemory( void ) const;
+        size_t getSlotMemorySize( void ) const;
+
+    private:
+        struct RingHeader;
+
+        /**
+         * Maps the shared memory object and sets the member pointers
+         */
+        void map( int rFd, size_t rnBytes );
+
+        std::string  mName;
+        bool         mIsOwner;
+        void *       mMapping;
+        size_t       mnMappedBytes;
+        RingHeader * mHeader;
+        char *       mSlots;
+        /**
+         * Serializes the threads of this process when claiming slots, so
+         * that the cursors in shared memory only need a single writer.
+         */
+        std::mutex   mWriteMutex;
+        std::mutex   mReadMutex;
+    };
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,178 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/socketProtocol.hpp"
+
+#include <cerrno>                   // errno, EINTR
+#include <cstdio>                   // perror
+#include <cstring>                  // strncpy, memset
+#include <sys/socket.h>             // socket, bind, listen, connect, send, recv
+#include <sys/un.h>                 // sockaddr_un
+#include <unistd.h>                 // close, unlink
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    bool sendAll( int _fd, void const * _data, size_t _nBytes )
+    {
+        char const * p = static_cast<char const*>( _data );
+        while ( _nBytes > 0 )
+        {
+            ssize_t const nSent = send( _fd, p, _nBytes, MSG_NOSIGNAL );
+            if ( nSent < 0 )
+            {
+                if ( errno == EINTR )
+                    continue;
+                return false;
+            }
+            p       += nSent;
+            _nBytes -= nSent;
+        }
+        return true;
+    }
+
+    bool receiveAll( int _fd, void * _data, size_t _nBytes )
+    {
+        char * p = static_cast<char*>( _data );
+        while ( _nBytes > 0 )
+        {
+            ssize_t const nReceived = recv( _fd, p, _nBytes, 0 );
+            if ( nReceived < 0 and errno == EINTR )
+                continue;
+            if ( nReceived <= 0 )
+                return false;
+            p       += nReceived;
+            _nBytes -= nReceived;
+        }
+        return true;
+    }
+
+    bool messageHasData( SocketMessageHeader const & _header )
+    {
+        return _header.type == uint32_t( SocketMessageType::Submit ) or
+               _header.frame.status == int32_t( FrameStatus::Ok );
+    }
+
+    bool sendFrameMessage
+    (
+        int _fd,
+        SocketMessageType _type,
+        FrameHeader const & _frame,
+        float const * _data
+    )
+    {
+        SocketMessageHeader header;
+        memset( &header, 0, sizeof( header ) );
+        header.magic = socketProtocolMagic;
+        header.type  = uint32_t( _type );
+        header.frame = _frame;
+        if ( not sendAll( _fd, &header, sizeof( header ) ) )
+            return false;
+        if ( not messageHasData( header ) )
+            return true;
+        return sendAll( _fd, _data, sizeof( float ) *
+                        size_t( _frame.width ) * _frame.height );
+    }
+
+    bool receiveMessageHeader( int _fd, SocketMessageHeader & _header )
+    {
+        if ( not receiveAll( _fd, &_header, sizeof( _header ) ) )
+            return false;
+        return _header.magic == socketProtocolMagic;
+    }
+
+    namespace
+    {
+        bool makeAddress( std::string const & _path, sockaddr_un & _address )
+        {
+            memset( &_address, 0, sizeof( _address ) );
+            _address.sun_family = AF_UNIX;
+            if ( _path.size() >= sizeof( _address.sun_path ) )
+            {
+                errno = ENAMETOOLONG;
+                return false;
+            }
+            strncpy( _address.sun_path, _path.c_str(),
+                     sizeof( _address.sun_path ) - 1 );
+            return true;
+        }
+    } // anonymous namespace
+
+    int listenUnixSocket( std::string const & _path )
+    {
+        sockaddr_un address;
+        if ( not makeAddress( _path, address ) )
+        {
+            perror( "imresh::io::listenUnixSocket(): invalid path" );
+            return -1;
+        }
+        int const fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if ( fd < 0 )
+        {
+            perror( "imresh::io::listenUnixSocket(): socket failed" );
+            return -1;
+        }
+        unlink( _path.c_str() );
+        if ( bind( fd, reinterpret_cast<sockaddr*>( &address ),
+                   sizeof( address ) ) != 0 or
+             listen( fd, SOMAXCONN ) != 0 )
+        {
+            perror( "imresh::io::listenUnixSocket(): bind or listen failed" );
+            close( fd );
+            return -1;
+        }
+        return fd;
+    }
+
+    int connectUnixSocket( std::string const & _path )
+    {
+        sockaddr_un address;
+        if ( not makeAddress( _path, address ) )
+        {
+            perror( "imresh::io::connectUnixSocket(): invalid path" );
+            return -1;
+        }
+        int const fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if ( fd < 0 )
+        {
+            perror( "imresh::io::connectUnixSocket(): socket failed" );
+            return -1;
+        }
+        if ( connect( fd, reinterpret_cast<sockaddr*>( &address ),
+                      sizeof( address ) ) != 0 )
+        {
+            perror( "imresh::io::connectUnixSocket(): connect failed" );
+            close( fd );
+            return -1;
+        }
+        return fd;
+    }
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,129 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint32_t
+#include <string>                   // std::string
+#include <vector>                   // std::vector
+
+#include "io/frameHeader.hpp"       // FrameHeader
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Binary protocol spoken by imresh-server on its frame socket. Every
+     * message is a SocketMessageHeader, followed by width * height floats
+     * for submitted frames and for results with FrameStatus::Ok. As the
+     * protocol is only meant for UNIX domain sockets, everything is sent in
+     * the native byte order without padding adjustments.
+     *
+     * Clients may send any number of frames without waiting for results.
+     * Results are sent back as soon as they are finished, i.e. not
+     * necessarily in submission order. A client may shutdown the writing
+     * half of its socket after the last frame and still receive the
+     * outstanding results.
+     */
+    struct SocketMessageHeader
+    {
+        /**
+         * socketProtocolMagic, to detect clients speaking something else
+         */
+        uint32_t magic;
+        /**
+         * see SocketMessageType
+         */
+        uint32_t type;
+        FrameHeader frame;
+    };
+
+    constexpr uint32_t socketProtocolMagic = 0x31524d49; // "IMR1"
+
+    enum class SocketMessageType : uint32_t
+    {
+        Submit = 1,
+        Result = 2
+    };
+
+    /**
+     * Loops until all bytes are written. Doesn't raise SIGPIPE.
+     *
+     * @return false if the connection was closed or broke
+     */
+    bool sendAll( int _fd, void const * _data, size_t _nBytes );
+
+    /**
+     * Loops until all bytes are read.
+     *
+     * @return false on end of file or error
+     */
+    bool receiveAll( int _fd, void * _data, size_t _nBytes );
+
+    /**
+     * Sends a header and, if it is a submitted frame or a successful result,
+     * the data of width * height floats.
+     */
+    bool sendFrameMessage
+    (
+        int _fd,
+        SocketMessageType _type,
+        FrameHeader const & _frame,
+        float const * _data
+    );
+
+    /**
+     * Receives a message header and checks its magic. Data following the
+     * header has to be read by the caller with receiveAll.
+     *
+     * @return false on end of file, error or wrong magic
+     */
+    bool receiveMessageHeader( int _fd, SocketMessageHeader & _header );
+
+    /**
+     * @return true if a message with this header is followed by data
+     */
+    bool messageHasData( SocketMessageHeader const & _header );
+
+    /**
+     * Creates a listening UNIX domain socket, replacing an existing socket
+     * file at that path.
+     *
+     * @return file descriptor or -1 on error (reported with perror)
+     */
+    int listenUnixSocket( std::string const & _path );
+
+    /**
+     * @return connected file descriptor or -1 on error
+     */
+    int connectUnixSocket( std::string const & _path );
+
+
+} // namespace io
+} // namespace imresh
@@ -22,18 +22,31 @@
  * SOFTWARE.
  */
 
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::milliseconds
+#include <condition_variable>       // std::condition_variable
+#include <cstdint>                  // int64_t
 #include <functional>               // std::function
 #ifdef IMRESH_DEBUG
 #   include <iostream>              // std::cout, std::endl
 #endif
+#include <limits>                   // std::numeric_limits
 #include <list>                     // std::list
-#include <mutex>                    // std::mutex
+#include <memory>                   // std::shared_ptr
+#include <mutex>                    // std::mutex, std::unique_lock
 #include <thread>                   // std::thread
 #include <utility>                  // std::pair
 #include <cassert>
+#include <omp.h>                    // omp_set_num_threads
 
+#include "io/taskQueue.hpp"
+#include "io/taskQueueMetrics.hpp"      // taskQueueCounters
+#include "io/resultCache.hpp"           // ResultCache
+#include "algorithms/hitFinder.hpp"     // HitFinder
+#include "libs/hash.hpp"                // hash64
 #include "algorithms/cuda/cudaShrinkWrap.h"
 #include "libs/cudacommon.h"        // CUDA_ERROR
+#include "libs/threadAffinity.hpp"  // pinThreadToNumaNode, getNumaNodeOfAddress
 
 namespace imresh
 {
@@ -41,53 +54,377 @@ namespace io
 {
 
     /**
-     * Struct containing a CUDA stream with it's associated device.
+     * Struct containing a CUDA stream with it's associated device and the
+     * NUMA node that device is attached to (-1 if unknown).
      */
     struct stream
     {
         int device;
+        int numaNode;
         cudaStream_t str;
     };
 
     /**
-     * Mutex to coordinate device usage.
+     * Struct containing all arguments given to addTask.
+     */
+    struct task
+    {
+        float* h_mem;
+        std::pair<unsigned int,unsigned int> size;
+        WriteOutFunc writeOutFunc;
+        std::string filename;
+        unsigned int numberOfCycles;
+        unsigned int numberOfHIOCycles;
+        float targetError;
+        float HIOBeta;
+        float intensityCutOffAutoCorel;
+        float intensityCutOff;
+        float sigma0;
+        float sigmaChange;
+        int priority;
+        /**
+         * Overrides the global cancelFunc if set
+         */
+        WriteOutFunc cancelFunc;
+        /**
+         * NUMA node the pages of h_mem reside on, -1 if unknown.
+         */
+        int numaNode;
+        /**
+         * Time of the addTask call, see taskQueueNow
+         */
+        int64_t submitTime;
+        /**
+         * Memory reserved for this task, see estimateTaskMemory. Only the
+         * input if the result was already cached when the task was added.
+         */
+        size_t memoryEstimate;
+        /**
+         * Set if the result cache was enabled when the task was added.
+         * The key is calculated there, because it needs the unmodified
+         * input.
+         */
+        bool hasCacheKey;
+        ResultCacheKey cacheKey;
+    };
+
+    /**
+     * Struct containing the state of a worker thread. There is exactly one
+     * worker per stream.
+     */
+    struct worker
+    {
+        stream strm;
+        /**
+         * Polled by the running reconstruction, see taskQueueAbortRunning.
+         */
+        std::atomic<bool> abort;
+        bool busy;
+        std::thread thread;
+    };
+
+    /**
+     * Mutex guarding all of the following lists and states.
      */
     std::mutex mtx;
+    /**
+     * Notified whenever a task was added, started or finished and when the
+     * accepting or stopping state changed.
+     */
+    std::condition_variable taskQueueChanged;
     /**
      * List where all streams are stored as imresh::io::stream structs.
      */
     std::list<stream> streamList;
     /**
-     * List to store all created threads.
+     * List of all workers. A list is used, because workers can't be moved.
+     */
+    std::list<worker> workerList;
+    /**
+     * Tasks waiting for a worker (FIFO).
      */
-    std::list<std::thread> threadPool;
+    std::list<task> taskList;
     /**
-     * Maximum size of the thread pool.
+     * Maximum number of tasks waiting in taskList before addTask blocks.
      *
      * This is determined while imresh::io::fillStreamList() as the number of
      * available streams.
      */
-    unsigned int threadPoolMaxSize = 0;
+    unsigned int taskListMaxSize = 0;
+    /**
+     * Number of tasks currently processed by workers.
+     */
+    unsigned int nRunningTasks = 0;
+    /**
+     * False after taskQueueStopAccepting until the next taskQueueInit.
+     */
+    bool acceptingTasks = false;
+    /**
+     * Tells the workers to return as soon as taskList is empty.
+     */
+    bool stopWorkers = false;
+    /**
+     * Called for tasks which are cancelled or aborted.
+     */
+    WriteOutFunc cancelFunc;
+    /**
+     * Memory limit for all queued and running tasks in bytes, 0 if unlimited
+     */
+    size_t memoryBudget = 0;
+    AdmissionPolicy admissionPolicy = AdmissionPolicy::Block;
+    /**
+     * Sum of memoryEstimate over all queued and running tasks
+     */
+    size_t memoryReserved = 0;
+    /**
+     * Cache of reconstructed images, NULL if disabled. Workers hold a copy
+     * of the pointer while using it, so that it can be replaced anytime.
+     */
+    std::shared_ptr<ResultCache> resultCache;
+    /**
+     * Classifies frames in addTask, NULL if disabled. Copied like resultCache.
+     */
+    std::shared_ptr<imresh::algorithms::HitFinder> hitFinder;
+    HitPolicy hitPolicy = HitPolicy::Drop;
+    /**
+     * Result of the task whose write out function the current worker
+     * thread is calling
+     */
+    thread_local TaskResult currentResult;
+
+    /**
+     * Returns the key identifying the result of a task in the result cache.
+     */
+    ResultCacheKey makeResultCacheKey( task const & _task )
+    {
+        ResultCacheKey key;
+        key.intensityHash = imresh::libs::hash64( _task.h_mem,
+            size_t( _task.size.first ) * _task.size.second * sizeof( float ) );
+        key.size = _task.size;
+        key.numberOfCycles = _task.numberOfCycles;
+        key.numberOfHIOCycles = _task.numberOfHIOCycles;
+        key.targetError = _task.targetError;
+        key.HIOBeta = _task.HIOBeta;
+        key.intensityCutOffAutoCorel = _task.intensityCutOffAutoCorel;
+        key.intensityCutOff = _task.intensityCutOff;
+        key.sigma0 = _task.sigma0;
+        key.sigmaChange = _task.sigmaChange;
+        return key;
+    }
+
+    /**
+     * Returns the bytes needed for the input image of a task
+     */
+    size_t getInputMemory( std::pair<unsigned int,unsigned int> const _size )
+    {
+        return size_t( _size.first ) * _size.second * sizeof( float );
+    }
+
+    /**
+     * Releases the memory reserved by a task. Must be called with mtx locked.
+     */
+    void releaseTaskMemory( task const & _task, bool const _wasRunning )
+    {
+        memoryReserved -= _task.memoryEstimate;
+        taskQueueCounters.memoryReserved = memoryReserved;
+        taskQueueCounters.memoryUsed -= _wasRunning ? _task.memoryEstimate
+                                                    : getInputMemory( _task.size );
+    }
+
+    /**
+     * Calls the cancel function of the task or else the global one if set.
+     */
+    void notifyCancelled( task const & _task )
+    {
+        mtx.lock( );
+        auto func = _task.cancelFunc ? _task.cancelFunc : cancelFunc;
+        mtx.unlock( );
+        if( func )
+        {
+            func( _task.h_mem, _task.size, _task.filename );
+        }
+    }
 
     /**
-     * Function to add a image processing task to the queue.
+     * Runs a reconstruction task on the stream of the given worker.
      *
-     * This is called from taskQueue::addTask() as a thread to prevent blocking
-     * and to ensure that all streams are filled with work. It selects the least
-     * recently used stream from the streamList and fills it with new work (FIFO).
+     * If the result cache is enabled and contains the result for the same
+     * input and parameters, the reconstruction is skipped.
      *
      * A mutex ensures the correct work balancing over the CUDA streams.
      * However, this mutex doesn't include the call to the write out function.
      * If you need your write out function to be thread safe, you'll have to
      * use your own lock mechanisms inside of this function.
+     */
+    void processTask(
+        worker & _worker,
+        task const & _task,
+        std::shared_ptr<ResultCache> const & _resultCache
+    )
+    {
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::processTask(): Calling shrink-wrap on device "
+                << _worker.strm.device << "." << std::endl;
+#       endif
+
+        auto & counters = taskQueueCounters;
+        int64_t const startTime = taskQueueNow( );
+        counters.queueWait.record( startTime - _task.submitTime );
+
+        // The key has to be calculated before the input gets overwritten
+        ResultCacheKey cacheKey;
+        bool cacheHit = false;
+        if( _resultCache )
+        {
+            cacheKey = _task.hasCacheKey ? _task.cacheKey : makeResultCacheKey( _task );
+            cacheHit = _resultCache->lookup( cacheKey, _task.h_mem );
+            if( cacheHit )
+            {
+                ++counters.nCacheHits;
+            }
+            else
+            {
+                ++counters.nCacheMisses;
+            }
+        }
+
+        // Call shrinkWrap in the selected stream on the selected device.
+        TaskResult result;
+        result.finalError = std::numeric_limits<float>::quiet_NaN( );
+        result.numberOfCyclesRun = 0;
+        int const ret = cacheHit ? 0 :
+            imresh::algorithms::cuda::cudaShrinkWrap( _task.h_mem,
+                                              _task.size.first,
+                                              _task.size.second,
+                                              _worker.strm.str,
+                                              _task.numberOfCycles,
+                                              _task.targetError,
+                                              _task.HIOBeta,
+                                              _task.intensityCutOffAutoCorel,
+                                              _task.intensityCutOff,
+                                              _task.sigma0,
+                                              _task.sigmaChange,
+                                              _task.numberOfHIOCycles,
+                                              &_worker.abort,
+                                              &result.finalError,
+                                              &result.numberOfCyclesRun );
+
+        int64_t const reconstructedTime = taskQueueNow( );
+        counters.reconstruction.record( reconstructedTime - startTime );
+
+        if( ret == 1 )
+        {
+            ++counters.nAborted;
+#           ifdef IMRESH_DEBUG
+                std::cout << "imresh::io::processTask(): Reconstruction aborted ("
+                    << _task.filename << ")." << std::endl;
+#           endif
+            notifyCancelled( _task );
+            return;
+        }
+
+        if( _resultCache and not cacheHit )
+        {
+            _resultCache->insert( cacheKey, _task.h_mem );
+        }
+
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::processTask(): CUDA work finished. Calling write out function."
+                << std::endl;
+#       endif
+
+        result.numberOfCycles           = _task.numberOfCycles;
+        result.numberOfHIOCycles        = _task.numberOfHIOCycles;
+        result.targetError              = _task.targetError;
+        result.HIOBeta                  = _task.HIOBeta;
+        result.intensityCutOffAutoCorel = _task.intensityCutOffAutoCorel;
+        result.intensityCutOff          = _task.intensityCutOff;
+        result.sigma0                   = _task.sigma0;
+        result.sigmaChange              = _task.sigmaChange;
+        currentResult = result;
+
+        _task.writeOutFunc( _task.h_mem, _task.size, _task.filename );
+
+        counters.writeOut.record( taskQueueNow( ) - reconstructedTime );
+        ++counters.nCompleted;
+    }
+
+    /**
+     * Main loop of a worker thread.
      *
-     * @see addTask
+     * The worker pins itself, and with it its OpenMP team, to the NUMA node
+     * of its device. Then it repeatedly takes a task from the task list until
+     * it is told to stop and the list is empty. Of the tasks with the highest
+     * priority, it takes the oldest one whose memory resides on its node, or
+     * else the oldest one.
      */
-    void addTaskAsync(
+    void workerLoop( worker * const _worker )
+    {
+        if( imresh::libs::pinThreadToNumaNode( _worker->strm.numaNode ) )
+        {
+            omp_set_num_threads( imresh::libs::getNumaNodeCpus( _worker->strm.numaNode ).size( ) );
+        }
+        CUDA_ERROR( cudaSetDevice( _worker->strm.device ) );
+
+        std::unique_lock<std::mutex> lock( mtx );
+        while( true )
+        {
+            taskQueueChanged.wait( lock, [ ]{ return not taskList.empty( ) or stopWorkers; } );
+            if( taskList.empty( ) )
+            {
+                break;
+            }
+
+            auto const isLocal = [ _worker ]( task const & t )
+            {
+                return t.numaNode >= 0 and t.numaNode == _worker->strm.numaNode;
+            };
+            auto itTask = taskList.begin( );
+            for( auto it = taskList.begin( ); it != taskList.end( ); ++it )
+            {
+                if( it->priority > itTask->priority or
+                    ( it->priority == itTask->priority and isLocal( *it )
+                      and not isLocal( *itTask ) ) )
+                {
+                    itTask = it;
+                }
+            }
+            task const currentTask = *itTask;
+            auto const currentResultCache = resultCache;
+            taskList.erase( itTask );
+            ++nRunningTasks;
+            _worker->abort = false;
+            _worker->busy = true;
+            ++taskQueueCounters.nStarted;
+            taskQueueCounters.queueDepth = taskList.size( );
+            taskQueueCounters.memoryUsed += currentTask.memoryEstimate
+                                          - getInputMemory( currentTask.size );
+            taskQueueCounters.nRunning = nRunningTasks;
+            // Wakes up addTask calls waiting for free space
+            taskQueueChanged.notify_all( );
+            lock.unlock( );
+
+            processTask( *_worker, currentTask, currentResultCache );
+
+            lock.lock( );
+            _worker->busy = false;
+            --nRunningTasks;
+            taskQueueCounters.nRunning = nRunningTasks;
+            releaseTaskMemory( currentTask, true );
+            // Wakes up taskQueueDrain and addTask calls waiting for memory
+            taskQueueChanged.notify_all( );
+        }
+
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::workerLoop(): Worker on device "
+                << _worker->strm.device << " stopped." << std::endl;
+#       endif
+    }
+
+    bool addTask(
         float* _h_mem,
         std::pair<unsigned int,unsigned int> _size,
-        std::function<void(float*,std::pair<unsigned int,unsigned int>,
-            std::string)> _writeOutFunc,
+        WriteOutFunc _writeOutFunc,
         std::string _filename,
         unsigned int _numberOfCycles,
         unsigned int _numberOfHIOCycles,
@@ -96,103 +433,272 @@ namespace io
         float _intensityCutOffAutoCorel,
         float _intensityCutOff,
         float _sigma0,
-        float _sigmaChange
+        float _sigmaChange,
+        int _priority,
+        WriteOutFunc _cancelFunc
     )
     {
-        // Lock the mutex so no other thread intermediatly changes the device
-        // selection
+        assert( taskListMaxSize > 0 and "Did you make a call to taskQueueInit?" );
+
+        task newTask;
+        newTask.h_mem = _h_mem;
+        newTask.size = _size;
+        newTask.writeOutFunc = _writeOutFunc;
+        newTask.filename = _filename;
+        newTask.numberOfCycles = _numberOfCycles;
+        newTask.numberOfHIOCycles = _numberOfHIOCycles;
+        newTask.targetError = _targetError;
+        newTask.HIOBeta = _HIOBeta;
+        newTask.intensityCutOffAutoCorel = _intensityCutOffAutoCorel;
+        newTask.intensityCutOff = _intensityCutOff;
+        newTask.sigma0 = _sigma0;
+        newTask.sigmaChange = _sigmaChange;
+        newTask.priority = _priority;
+        newTask.cancelFunc = _cancelFunc;
+
         mtx.lock( );
-        // Get the next device and stream to use
-        auto strm = streamList.front( );
-        streamList.pop_front( );
-        streamList.push_back( strm );
-        mtx.unlock();
-        auto device = strm.device;
-        auto str = strm.str;
+        std::shared_ptr<imresh::algorithms::HitFinder> currentHitFinder;
+        if( acceptingTasks )
+        {
+            currentHitFinder = hitFinder;
+        }
+        /* without a cancel function a dropped frame would be lost, so it's
+         * deprioritized instead */
+        auto const currentHitPolicy = _cancelFunc or cancelFunc ? hitPolicy
+                                    : HitPolicy::Deprioritize;
+        auto const currentResultCache = resultCache;
+        mtx.unlock( );
+        // Done without the lock, because it reads the whole image
+        if( currentHitFinder and not (*currentHitFinder)( _h_mem, _size ) )
+        {
+            if( currentHitPolicy == HitPolicy::Drop )
+            {
+#               ifdef IMRESH_DEBUG
+                    std::cout << "imresh::io::addTask(): Dropped blank frame "
+                        << _filename << "." << std::endl;
+#               endif
+                ++taskQueueCounters.nBlankDropped;
+                notifyCancelled( newTask );
+                return true;
+            }
+            ++taskQueueCounters.nBlankDeprioritized;
+            newTask.priority = std::numeric_limits<int>::min( );
+        }
 
-        // Select device and copy memory
-        CUDA_ERROR( cudaSetDevice( device ) );
+        // Done before locking, because it's a system call
+        newTask.numaNode = imresh::libs::getNumaNodeOfAddress( _h_mem );
+        newTask.submitTime = taskQueueNow( );
+        newTask.memoryEstimate = estimateTaskMemory( _size );
+        /* a cached result never touches the GPU, so only the input is
+         * reserved. If it gets evicted until the task runs, the budget is
+         * exceeded by the working set of this one task. */
+        newTask.hasCacheKey = (bool) currentResultCache;
+        if( currentResultCache )
+        {
+            newTask.cacheKey = makeResultCacheKey( newTask );
+            if( currentResultCache->contains( newTask.cacheKey ) )
+            {
+                newTask.memoryEstimate = getInputMemory( _size );
+            }
+        }
 
-#       ifdef IMRESH_DEBUG
-            std::cout << "imresh::io::addTaskAsync(): Mutex locked, device and stream selected. Calling shrink-wrap."
-                << std::endl;
-#       endif
+        std::unique_lock<std::mutex> lock( mtx );
 
-        // Call shrinkWrap in the selected stream on the selected device.
-        imresh::algorithms::cuda::cudaShrinkWrap( _h_mem,
-                                              _size.first,
-                                              _size.second,
-                                              str,
-                                              _numberOfCycles,
-                                              _targetError,
-                                              _HIOBeta,
-                                              _intensityCutOffAutoCorel,
-                                              _intensityCutOff,
-                                              _sigma0,
-                                              _sigmaChange,
-                                              _numberOfHIOCycles );
+        auto const fitsIntoBudget = [ &newTask ]
+        {
+            return memoryBudget == 0 or
+                   memoryReserved + newTask.memoryEstimate <= memoryBudget;
+        };
+        bool const exceedsBudget = memoryBudget > 0 and
+                                   newTask.memoryEstimate > memoryBudget;
+        if( exceedsBudget or ( admissionPolicy == AdmissionPolicy::Reject
+                               and not fitsIntoBudget( ) ) )
+        {
+#           ifdef IMRESH_DEBUG
+                std::cout << "imresh::io::addTask(): Memory budget exhausted. Rejected "
+                    << _filename << "." << std::endl;
+#           endif
+            ++taskQueueCounters.nRejected;
+            return false;
+        }
 
 #       ifdef IMRESH_DEBUG
-            std::cout << "imresh::io::addTaskAsync(): CUDA work finished, mutex unlocked. Calling write out function."
-                << std::endl;
+            if( acceptingTasks and ( taskList.size( ) >= taskListMaxSize
+                                     or not fitsIntoBudget( ) ) )
+            {
+                std::cout << "imresh::io::addTask(): Too many waiting tasks or not enough memory. Waiting for a worker."
+                    << std::endl;
+            }
 #       endif
+        taskQueueChanged.wait( lock, [ &fitsIntoBudget ]
+        {
+            return not acceptingTasks or
+                   ( taskList.size( ) < taskListMaxSize and fitsIntoBudget( ) );
+        } );
+
+        if( not acceptingTasks )
+        {
+#           ifdef IMRESH_DEBUG
+                std::cout << "imresh::io::addTask(): Queue doesn't accept new tasks. Rejected "
+                    << _filename << "." << std::endl;
+#           endif
+            ++taskQueueCounters.nRejected;
+            return false;
+        }
 
-        _writeOutFunc( _h_mem, _size, _filename );
+        memoryReserved += newTask.memoryEstimate;
+        taskQueueCounters.memoryReserved = memoryReserved;
+        taskQueueCounters.memoryUsed += getInputMemory( _size );
+        taskList.push_back( newTask );
+        ++taskQueueCounters.nSubmitted;
+        taskQueueCounters.queueDepth = taskList.size( );
+        taskQueueChanged.notify_all( );
+        return true;
     }
 
-    void addTask(
-        float* _h_mem,
-        std::pair<unsigned int,unsigned int> _size,
-        std::function<void(float*,std::pair<unsigned int,unsigned int>,
-            std::string)> _writeOutFunc,
-        std::string _filename,
-        unsigned int _numberOfCycles = 20,
-        unsigned int _numberOfHIOCycles = 20,
-        float _targetError = 0.00001f,
-        float _HIOBeta = 0.9f,
-        float _intensityCutOffAutoCorel = 0.04f,
-        float _intensityCutOff = 0.2f,
-        float _sigma0 = 3.0f,
-        float _sigmaChange = 0.01f
+    size_t estimateTaskMemory( std::pair<unsigned int,unsigned int> _size )
+    {
+        size_t const nElements = size_t( _size.first ) * _size.second;
+        return getInputMemory( _size )
+               /* dpCurData and dpgPrevious (complex), dpIntensity and
+                * dpIsMasked (real), see cudaShrinkWrap */
+               + nElements * ( 2 * 2 * sizeof( float ) + 2 * sizeof( float ) )
+               /* cuFFT needs at most one complex array as C2C workspace */
+               + nElements * 2 * sizeof( float );
+    }
+
+    void taskQueueSetMemoryBudget(
+        size_t _bytes,
+        AdmissionPolicy _policy
     )
     {
-        assert( threadPoolMaxSize > 0 and "Did you make a call to taskQueueInit?" );
+        std::lock_guard<std::mutex> lock( mtx );
+        memoryBudget = _bytes;
+        admissionPolicy = _policy;
+        taskQueueCounters.memoryBudget = _bytes;
+        // A larger budget may let waiting addTask calls through
+        taskQueueChanged.notify_all( );
+    }
+
+    void taskQueueEnableResultCache(
+        size_t _maxMemory,
+        std::string const & _spillDirectory
+    )
+    {
+        auto const cache = std::make_shared<ResultCache>( _maxMemory, _spillDirectory );
+        std::lock_guard<std::mutex> lock( mtx );
+        resultCache = cache;
+    }
+
+    void taskQueueDisableResultCache( )
+    {
+        std::lock_guard<std::mutex> lock( mtx );
+        resultCache.reset( );
+    }
+
+    void taskQueueEnableHitFinder(
+        imresh::algorithms::HitFinderParameters const & _parameters,
+        HitPolicy _policy
+    )
+    {
+        auto const finder = std::make_shared<imresh::algorithms::HitFinder>( _parameters );
+        std::lock_guard<std::mutex> lock( mtx );
+        hitFinder = finder;
+        hitPolicy = _policy;
+    }
+
+    void taskQueueDisableHitFinder( )
+    {
+        std::lock_guard<std::mutex> lock( mtx );
+        hitFinder.reset( );
+    }
 
-        while( threadPool.size( ) >= threadPoolMaxSize )
+    ResultCacheStatistics taskQueueGetResultCacheStatistics( )
+    {
+        mtx.lock( );
+        auto const cache = resultCache;
+        mtx.unlock( );
+
+        ResultCacheStatistics statistics = ResultCacheStatistics( );
+        if( cache )
         {
-#           ifdef IMRESH_DEBUG
-                std::cout << "imresh::io::addTask(): Too many active threads. Waiting for one of them to finish."
-                    << std::endl;
-#           endif
-            if ( threadPool.front().joinable() )
-                threadPool.front( ).join( );
-            else
-            {
-#               ifdef IMRESH_DEBUG
-                    std::cout << "[Warning] " << __FILE__ << " line " << __LINE__
-                              << ": a thread from the thread pool is not joinable!\n";
-#               endif
-            }
-            threadPool.pop_front( );
+            statistics = cache->getStatistics( );
+        }
+        return statistics;
+    }
+
+    TaskResult taskQueueGetCurrentResult( )
+    {
+        return currentResult;
+    }
+
+    void taskQueueSetCancelFunc( WriteOutFunc _cancelFunc )
+    {
+        std::lock_guard<std::mutex> lock( mtx );
+        cancelFunc = _cancelFunc;
+    }
+
+    void taskQueueStopAccepting( )
+    {
+        std::lock_guard<std::mutex> lock( mtx );
+        acceptingTasks = false;
+        // Wakes up blocked addTask calls, so that they can return false
+        taskQueueChanged.notify_all( );
+    }
+
+    bool taskQueueDrain( std::chrono::milliseconds _timeout )
+    {
+        taskQueueStopAccepting( );
+        std::unique_lock<std::mutex> lock( mtx );
+        return taskQueueChanged.wait_for( lock, _timeout,
+            [ ]{ return taskList.empty( ) and nRunningTasks == 0; } );
+    }
+
+    void taskQueueDrain( )
+    {
+        taskQueueStopAccepting( );
+        std::unique_lock<std::mutex> lock( mtx );
+        taskQueueChanged.wait( lock,
+            [ ]{ return taskList.empty( ) and nRunningTasks == 0; } );
+    }
+
+    unsigned int taskQueueCancelPending( )
+    {
+        std::list<task> cancelledTasks;
+        mtx.lock( );
+        cancelledTasks.swap( taskList );
+        taskQueueCounters.queueDepth = 0;
+        taskQueueCounters.nCancelled += cancelledTasks.size( );
+        for( auto const & cancelledTask : cancelledTasks )
+        {
+            releaseTaskMemory( cancelledTask, false );
         }
+        // Wakes up addTask calls waiting for free space and taskQueueDrain
+        taskQueueChanged.notify_all( );
+        mtx.unlock( );
 
 #       ifdef IMRESH_DEBUG
-            std::cout << "imresh::io::addTask(): Creating working thread."
-                << std::endl;
+            std::cout << "imresh::io::taskQueueCancelPending(): Cancelling "
+                << cancelledTasks.size( ) << " tasks." << std::endl;
 #       endif
 
-        threadPool.push_back( std::thread( addTaskAsync, _h_mem,
-                                                         _size,
-                                                         _writeOutFunc,
-                                                         _filename,
-                                                         _numberOfCycles,
-                                                         _numberOfHIOCycles,
-                                                         _targetError,
-                                                         _HIOBeta,
-                                                         _intensityCutOffAutoCorel,
-                                                         _intensityCutOff,
-                                                         _sigma0,
-                                                         _sigmaChange ) );
+        for( auto const & cancelledTask : cancelledTasks )
+        {
+            notifyCancelled( cancelledTask );
+        }
+        return cancelledTasks.size( );
+    }
+
+    void taskQueueAbortRunning( )
+    {
+        std::lock_guard<std::mutex> lock( mtx );
+        for( auto & wrk : workerList )
+        {
+            if( wrk.busy )
+            {
+                wrk.abort = true;
+            }
+        }
     }
 
     /**
@@ -235,15 +741,27 @@ namespace io
                 }
 #           endif
 
+            char pciBusId[32];
+            int numaNode = -1;
+            if( cudaDeviceGetPCIBusId( pciBusId, sizeof( pciBusId ), i ) == cudaSuccess )
+            {
+                numaNode = imresh::libs::getNumaNodeOfPciDevice( pciBusId );
+            }
+
+            // Streams are always created on the current device
+            CUDA_ERROR( cudaSetDevice( i ) );
+
             for( int j = 0; j < prop.multiProcessorCount; j++ )
             {
                 stream str;
                 str.device = i;
+                str.numaNode = numaNode;
                 CUDA_ERROR( cudaStreamCreate( &str.str ) );
                 streamList.push_back( str );
 #               ifdef IMRESH_DEBUG
                     std::cout << "imresh::io::fillStreamList(): Created stream "
-                        << j << " on device " << i << std::endl;
+                        << j << " on device " << i << " (NUMA node "
+                        << numaNode << ")" << std::endl;
 #               endif
             }
         }
@@ -257,7 +775,22 @@ namespace io
 
     void taskQueueInit( )
     {
-        threadPoolMaxSize = fillStreamList( );
+        taskListMaxSize = fillStreamList( );
+        taskQueueResetMetrics( );
+
+        std::lock_guard<std::mutex> lock( mtx );
+        acceptingTasks = true;
+        stopWorkers = false;
+        for( auto const & strm : streamList )
+        {
+            workerList.emplace_back( );
+            auto & wrk = workerList.back( );
+            wrk.strm = strm;
+            wrk.abort = false;
+            wrk.busy = false;
+            wrk.thread = std::thread( workerLoop, &wrk );
+        }
+
 #       ifdef IMRESH_DEBUG
             std::cout << "imresh::io::taskQueueInit(): Finished initilization."
                 << std::endl;
@@ -266,13 +799,19 @@ namespace io
 
     void taskQueueDeinit( )
     {
-        threadPoolMaxSize = 0;
+        taskQueueDrain( );
+
+        mtx.lock( );
+        stopWorkers = true;
+        taskQueueChanged.notify_all( );
+        mtx.unlock( );
 
-        while( threadPool.size( ) > 0 )
+        while( workerList.size( ) > 0 )
         {
-            threadPool.front( ).join( );
-            threadPool.pop_front( );
+            workerList.front( ).thread.join( );
+            workerList.pop_front( );
         }
+        taskListMaxSize = 0;
 
         while( streamList.size( ) > 0 )
         {
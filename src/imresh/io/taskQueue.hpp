@@ -24,10 +24,17 @@
 
 #pragma once
 
+#include <chrono>                   // std::chrono::milliseconds
+#include <cstddef>                  // size_t
 #include <functional>               // std::function
 #include <list>                     // std::list
+#include <string>                   // std::string
 #include <utility>                  // std::pair
 
+#include "io/taskQueueMetrics.hpp"  // taskQueueGetMetrics
+#include "io/resultCache.hpp"       // ResultCacheStatistics
+#include "algorithms/hitFinder.hpp" // HitFinderParameters
+
 
 namespace imresh
 {
@@ -36,9 +43,46 @@ namespace io
 
 
     /**
-     * Calls imresh::io::addTaskAsync() in a thread.
+     * Signature of the functions handling the processed data.
+     *
+     * The arguments are the host memory, its size and the filename given to
+     * addTask.
+     */
+    typedef std::function<void(float*,std::pair<unsigned int,unsigned int>,
+        std::string)> WriteOutFunc;
+
+    /**
+     * Default reconstruction parameters of addTask, shared with the callers
+     * which have to fill in parameters that weren't given
+     */
+    constexpr unsigned int defaultNumberOfCycles          = 20;
+    constexpr unsigned int defaultNumberOfHIOCycles       = 20;
+    constexpr float defaultTargetError                    = 0.00001f;
+    constexpr float defaultHIOBeta                        = 0.9f;
+    constexpr float defaultIntensityCutOffAutoCorel       = 0.04f;
+    constexpr float defaultIntensityCutOff                = 0.2f;
+    constexpr float defaultSigma0                         = 3.0f;
+    constexpr float defaultSigmaChange                    = 0.01f;
+
+    /**
+     * Queues an image for reconstruction.
      *
-     * @param _h_mem Pointer to the image data.
+     * The task will be processed by the next idle worker thread, preferably
+     * one whose device is attached to the NUMA node the image memory resides
+     * on. Workers always start a waiting task with the highest priority.
+     * Among those, a worker takes the oldest one whose memory resides on its
+     * own NUMA node, or else the oldest one. So tasks of equal priority are
+     * only started in the order they were added if they are on the same
+     * node. If as many tasks as there are workers are already waiting, this
+     * call blocks until a worker picks up one of them. If a memory budget is
+     * set (see taskQueueSetMemoryBudget) and the task doesn't fit into it,
+     * this call blocks or returns false depending on the admission policy.
+     * If the hit finder is enabled (see taskQueueEnableHitFinder), blank
+     * frames are classified in the calling thread before any of that.
+     *
+     * @param _h_mem Pointer to the image data. It's used in-place, so images
+     * from readInFuncs or libs::allocateFrame are queued without copying.
+     * The task owns it until the write out or cancel function is called.
      * @param _size Size of the memory to be adressed.
      * @param _writeOutFunc A function pointer (std::function) that will be
      * used to handle the processed data.
@@ -49,27 +93,231 @@ namespace io
      * @param _numberOfHIOCycles Number of iterations to run the initial
      * hybrid input output for.
      * @param _targetError The target error to stop the program when reached.
+     * @param _priority Tasks with higher values are started first.
+     * @param _cancelFunc if set, it is called instead of the function set
+     * with taskQueueSetCancelFunc if this task gets cancelled or aborted.
+     * @return false if the task was not queued, because the queue doesn't
+     * accept new tasks anymore (see taskQueueStopAccepting) or because it
+     * exceeds the memory budget. In that case the memory is still owned by
+     * the caller.
      */
-    void addTask(
+    bool addTask(
         float* _h_mem,
         std::pair<unsigned int,unsigned int> _size,
-        std::function<void(float*,std::pair<unsigned int,unsigned int>,
-            std::string)> _writeOutFunc,
+        WriteOutFunc _writeOutFunc,
         std::string _filename,
-        unsigned int _numberOfCycles = 20,
-        unsigned int _numberOfHIOCycles = 20,
-        float _targetError = 0.00001f,
-        float _HIOBeta = 0.9f,
-        float _intensityCutOffAutoCorel = 0.04f,
-        float _intensityCutOff = 0.2f,
-        float _sigma0 = 3.0f,
-        float _sigmaChange = 0.01f
+        unsigned int _numberOfCycles = defaultNumberOfCycles,
+        unsigned int _numberOfHIOCycles = defaultNumberOfHIOCycles,
+        float _targetError = defaultTargetError,
+        float _HIOBeta = defaultHIOBeta,
+        float _intensityCutOffAutoCorel = defaultIntensityCutOffAutoCorel,
+        float _intensityCutOff = defaultIntensityCutOff,
+        float _sigma0 = defaultSigma0,
+        float _sigmaChange = defaultSigmaChange,
+        int _priority = 0,
+        WriteOutFunc _cancelFunc = WriteOutFunc( )
+    );
+
+    /**
+     * Outcome and parameters of a reconstruction, see
+     * taskQueueGetCurrentResult
+     */
+    struct TaskResult
+    {
+        /**
+         * error after the last shrink-wrap cycle, NaN if the result was
+         * taken from the result cache
+         */
+        float finalError;
+        /**
+         * shrink-wrap cycles run, 0 for cached results
+         */
+        unsigned int numberOfCyclesRun;
+        /* the parameters given to addTask */
+        unsigned int numberOfCycles;
+        unsigned int numberOfHIOCycles;
+        float targetError;
+        float HIOBeta;
+        float intensityCutOffAutoCorel;
+        float intensityCutOff;
+        float sigma0;
+        float sigmaChange;
+    };
+
+    /**
+     * Returns the result of the task whose write out function is being
+     * called. Only valid inside a write out function called by a worker
+     * thread, i.e. it has to be queried before handing the image to another
+     * thread.
+     */
+    TaskResult taskQueueGetCurrentResult( );
+
+    /**
+     * Behavior of addTask if a task doesn't fit into the memory budget
+     */
+    enum class AdmissionPolicy
+    {
+        /** wait until enough running tasks have finished */
+        Block,
+        /** return false immediately */
+        Reject
+    };
+
+    /**
+     * Returns the number of bytes a task of the given image size occupies.
+     *
+     * This is the size of the input image, which is held from addTask until
+     * the write out function returns, plus the four working arrays and the
+     * cuFFT workspace allocated while the task is running. The shrink-wrap
+     * parameters don't change the memory needed.
+     */
+    size_t estimateTaskMemory( std::pair<unsigned int,unsigned int> _size );
+
+    /**
+     * Limits the memory reserved by queued and running tasks.
+     *
+     * Every task reserves estimateTaskMemory( ) bytes in addTask and releases
+     * them after its write out or cancel function has returned. Tasks which
+     * are larger than the whole budget are always rejected. The reserved and
+     * actually used memory are part of taskQueueGetMetrics( ).
+     *
+     * @param _bytes budget in bytes. 0 (the default) means unlimited.
+     * @param _policy what addTask does if the budget is exhausted
+     */
+    void taskQueueSetMemoryBudget(
+        size_t _bytes,
+        AdmissionPolicy _policy = AdmissionPolicy::Block
     );
 
+    /**
+     * Enables caching of reconstructed images.
+     *
+     * addTask hashes the input intensity. Before reconstructing, a worker
+     * looks up the result for that hash together with all shrink-wrap
+     * parameters given to addTask. On a hit the stored result is copied into
+     * the task's memory and the write out function is called without
+     * reconstructing. Tasks whose result is already cached when they are
+     * added only reserve their input against the memory budget.
+     * Calling this again replaces the cache with an empty one.
+     *
+     * @param _maxMemory maximum bytes of results to keep in memory. If
+     * exceeded, the least recently used results are evicted.
+     * @param _spillDirectory if not empty, all results are also written to
+     * this existing directory and looked up there on a miss in memory. The
+     * results in it are reused across restarts and never deleted.
+     */
+    void taskQueueEnableResultCache(
+        size_t _maxMemory,
+        std::string const & _spillDirectory = ""
+    );
+
+    /**
+     * Disables and frees the result cache. Spilled results are kept on disk.
+     */
+    void taskQueueDisableResultCache( );
+
+    /**
+     * What addTask does with frames the hit finder classified as blank
+     */
+    enum class HitPolicy
+    {
+        /** don't queue them. The cancel function is called with the
+         *  unchanged frame in the calling thread and addTask returns true.
+         *  If neither the task nor taskQueueSetCancelFunc provides a cancel
+         *  function, the frame is deprioritized instead, so it isn't lost. */
+        Drop,
+        /** queue them with the lowest possible priority, so they are only
+         *  reconstructed if no hit is waiting */
+        Deprioritize
+    };
+
+    /**
+     * Enables the hit finder, which skips blank frames before the expensive
+     * reconstruction.
+     *
+     * addTask scores every frame with imresh::algorithms::HitFinder. Frames
+     * which don't pass the thresholds are dropped or deprioritized and
+     * counted in taskQueueGetMetrics( ). Calling this again replaces the
+     * thresholds.
+     */
+    void taskQueueEnableHitFinder(
+        imresh::algorithms::HitFinderParameters const & _parameters,
+        HitPolicy _policy = HitPolicy::Drop
+    );
+
+    /**
+     * Disables the hit finder, i.e. all frames are reconstructed.
+     */
+    void taskQueueDisableHitFinder( );
+
+    /**
+     * Returns the hit and miss counters of the current result cache. All
+     * counters are 0 if it is disabled.
+     */
+    ResultCacheStatistics taskQueueGetResultCacheStatistics( );
+
+    /**
+     * Sets the function which is called for every task which was queued but
+     * will not be reconstructed, because it was cancelled with
+     * taskQueueCancelPending or aborted with taskQueueAbortRunning.
+     *
+     * It's called with the same arguments the task's write out function would
+     * have been called with. The memory still holds the unchanged input
+     * intensity, so it can e.g. be persisted and resubmitted later. If no
+     * function is set, the memory of cancelled tasks is left to the caller.
+     * Tasks which were given their own cancel function in addTask call that
+     * one instead.
+     */
+    void taskQueueSetCancelFunc( WriteOutFunc _cancelFunc );
+
+    /**
+     * Stops accepting new tasks.
+     *
+     * Already queued and running tasks will still be processed. Subsequent
+     * and currently blocked calls to addTask return false.
+     */
+    void taskQueueStopAccepting( );
+
+    /**
+     * Stops accepting new tasks and waits until all queued and running tasks
+     * are finished.
+     *
+     * @param _timeout maximum time to wait
+     * @return true if the queue is empty and no task is running anymore,
+     * false if the timeout was reached first.
+     */
+    bool taskQueueDrain( std::chrono::milliseconds _timeout );
+
+    /**
+     * @see taskQueueDrain. Waits without a time limit.
+     */
+    void taskQueueDrain( );
+
+    /**
+     * Removes all tasks which haven't been started yet from the queue.
+     *
+     * The cancel function (see taskQueueSetCancelFunc) is called for each of
+     * them in the calling thread.
+     *
+     * @return number of cancelled tasks
+     */
+    unsigned int taskQueueCancelPending( );
+
+    /**
+     * Asks all running reconstructions to stop.
+     *
+     * This is cooperative, i.e. the reconstructions stop before their next
+     * HIO cycle and then call the cancel function from their worker thread.
+     * It doesn't affect tasks started after this call. Use
+     * taskQueueDrain to wait for the aborted tasks to finish.
+     */
+    void taskQueueAbortRunning( );
+
     /**
      * Initializes the library.
      *
      * This is the _first_ call you should make in order to use this library.
+     * It creates the streams and one worker thread per stream.
      */
     void taskQueueInit( );
 
@@ -77,7 +325,10 @@ namespace io
      * Deinitializes the library.
      *
      * This is the last call you should make in order to clear the library's
-     * members.
+     * members. It stops accepting new tasks, waits for all queued tasks to be
+     * processed and then stops the worker threads. To shut down without
+     * processing all queued tasks, call taskQueueCancelPending and/or
+     * taskQueueAbortRunning beforehand.
      */
     void taskQueueDeinit( );
 
@@ -0,0 +1,231 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/taskQueueMetrics.hpp"
+
+#include <chrono>                   // std::chrono::steady_clock
+#include <condition_variable>       // std::condition_variable
+#include <fstream>                  // std::ofstream
+#include <iostream>                 // std::cout
+#include <mutex>                    // std::mutex, std::unique_lock
+#include <sstream>                  // std::ostringstream
+#include <string>                   // std::string
+#include <thread>                   // std::thread
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    TaskQueueCounters taskQueueCounters;
+
+
+    namespace
+    {
+        /**
+         * State of the thread started by taskQueueStartMetricsDump
+         */
+        std::mutex metricsDumpMutex;
+        std::condition_variable metricsDumpStopped;
+        std::thread metricsDumpThread;
+        bool stopMetricsDump = false;
+
+        LatencySummary summarize( imresh::libs::LatencyHistogram const & _histogram )
+        {
+            double const nsToMs = 1e-6;
+            LatencySummary summary;
+            summary.count = _histogram.getCount( );
+            summary.mean  = _histogram.getMean( ) * nsToMs;
+            summary.p50   = _histogram.getPercentile( 50 ) * nsToMs;
+            summary.p90   = _histogram.getPercentile( 90 ) * nsToMs;
+            summary.p99   = _histogram.getPercentile( 99 ) * nsToMs;
+            summary.max   = _histogram.getMax( ) * nsToMs;
+            return summary;
+        }
+
+        std::ostream & operator<<( std::ostream & rOut, LatencySummary const & _summary )
+        {
+            rOut << "{\"count\":" << _summary.count
+                 << ",\"meanMs\":"  << _summary.mean
+                 << ",\"p50Ms\":"   << _summary.p50
+                 << ",\"p90Ms\":"   << _summary.p90
+                 << ",\"p99Ms\":"   << _summary.p99
+                 << ",\"maxMs\":"   << _summary.max
+                 << "}";
+            return rOut;
+        }
+
+        /**
+         * Writes all members of the snapshot without the enclosing braces
+         */
+        void writeJsonMembers( std::ostream & rOut, TaskQueueMetrics const & _metrics )
+        {
+            rOut << "\"uptime\":"          << _metrics.uptime
+                 << ",\"submitted\":"      << _metrics.nSubmitted
+                 << ",\"rejected\":"       << _metrics.nRejected
+                 << ",\"started\":"        << _metrics.nStarted
+                 << ",\"completed\":"      << _metrics.nCompleted
+                 << ",\"cancelled\":"      << _metrics.nCancelled
+                 << ",\"aborted\":"        << _metrics.nAborted
+                 << ",\"cacheHits\":"      << _metrics.nCacheHits
+                 << ",\"cacheMisses\":"    << _metrics.nCacheMisses
+                 << ",\"blankDropped\":"   << _metrics.nBlankDropped
+                 << ",\"blankDeprioritized\":" << _metrics.nBlankDeprioritized
+                 << ",\"queueDepth\":"     << _metrics.queueDepth
+                 << ",\"running\":"        << _metrics.nRunning
+                 << ",\"tasksPerSecond\":" << _metrics.tasksPerSecond
+                 << ",\"memoryBudget\":"   << _metrics.memoryBudget
+                 << ",\"memoryReserved\":" << _metrics.memoryReserved
+                 << ",\"memoryUsed\":"     << _metrics.memoryUsed
+                 << ",\"queueWait\":"      << _metrics.queueWait
+                 << ",\"reconstruction\":" << _metrics.reconstruction
+                 << ",\"writeOut\":"       << _metrics.writeOut;
+        }
+
+        void metricsDumpLoop(
+            std::string const _filename,
+            std::chrono::milliseconds const _period
+        )
+        {
+            std::ofstream file;
+            if( _filename != "-" )
+            {
+                file.open( _filename, std::ios::out | std::ios::app );
+            }
+            std::ostream & out = _filename == "-" ? std::cout : file;
+
+            auto lastMetrics = taskQueueGetMetrics( );
+            std::unique_lock<std::mutex> lock( metricsDumpMutex );
+            bool stop = false;
+            while( not stop )
+            {
+                stop = metricsDumpStopped.wait_for( lock, _period,
+                    [ ]{ return stopMetricsDump; } );
+
+                auto const metrics = taskQueueGetMetrics( );
+                double const interval = metrics.uptime - lastMetrics.uptime;
+                double const intervalTasksPerSecond = interval > 0 ?
+                    ( metrics.nCompleted - lastMetrics.nCompleted ) / interval : 0;
+                lastMetrics = metrics;
+
+                out << "{";
+                writeJsonMembers( out, metrics );
+                out << ",\"intervalTasksPerSecond\":" << intervalTasksPerSecond
+                    << "}" << std::endl;
+            }
+        }
+    } // anonymous namespace
+
+
+    int64_t taskQueueNow( )
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(
+            steady_clock::now( ).time_since_epoch( ) ).count( );
+    }
+
+    void taskQueueResetMetrics( )
+    {
+        auto & c = taskQueueCounters;
+        c.nSubmitted = 0;
+        c.nRejected  = 0;
+        c.nStarted   = 0;
+        c.nCompleted = 0;
+        c.nCancelled = 0;
+        c.nAborted   = 0;
+        c.nCacheHits   = 0;
+        c.nCacheMisses = 0;
+        c.nBlankDropped       = 0;
+        c.nBlankDeprioritized = 0;
+        c.queueWait.reset( );
+        c.reconstruction.reset( );
+        c.writeOut.reset( );
+        c.startTime = taskQueueNow( );
+    }
+
+    TaskQueueMetrics taskQueueGetMetrics( )
+    {
+        auto const & c = taskQueueCounters;
+        TaskQueueMetrics metrics;
+        metrics.uptime         = ( taskQueueNow( ) - c.startTime ) * 1e-9;
+        metrics.nSubmitted     = c.nSubmitted;
+        metrics.nRejected      = c.nRejected;
+        metrics.nStarted       = c.nStarted;
+        metrics.nCompleted     = c.nCompleted;
+        metrics.nCancelled     = c.nCancelled;
+        metrics.nAborted       = c.nAborted;
+        metrics.nCacheHits     = c.nCacheHits;
+        metrics.nCacheMisses   = c.nCacheMisses;
+        metrics.nBlankDropped       = c.nBlankDropped;
+        metrics.nBlankDeprioritized = c.nBlankDeprioritized;
+        metrics.queueDepth     = c.queueDepth;
+        metrics.nRunning       = c.nRunning;
+        metrics.tasksPerSecond = metrics.uptime > 0 ?
+                                 metrics.nCompleted / metrics.uptime : 0;
+        metrics.memoryBudget   = c.memoryBudget;
+        metrics.memoryReserved = c.memoryReserved;
+        metrics.memoryUsed     = c.memoryUsed;
+        metrics.queueWait      = summarize( c.queueWait );
+        metrics.reconstruction = summarize( c.reconstruction );
+        metrics.writeOut       = summarize( c.writeOut );
+        return metrics;
+    }
+
+    std::string toJson( TaskQueueMetrics const & _metrics )
+    {
+        std::ostringstream json;
+        json << "{";
+        writeJsonMembers( json, _metrics );
+        json << "}";
+        return json.str( );
+    }
+
+    void taskQueueStartMetricsDump(
+        std::string const & _filename,
+        std::chrono::milliseconds _period
+    )
+    {
+        taskQueueStopMetricsDump( );
+        stopMetricsDump = false;
+        metricsDumpThread = std::thread( metricsDumpLoop, _filename, _period );
+    }
+
+    void taskQueueStopMetricsDump( )
+    {
+        if( not metricsDumpThread.joinable( ) )
+        {
+            return;
+        }
+        metricsDumpMutex.lock( );
+        stopMetricsDump = true;
+        metricsDumpMutex.unlock( );
+        metricsDumpStopped.notify_all( );
+        metricsDumpThread.join( );
+    }
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,196 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>                   // std::atomic
+#include <chrono>                   // std::chrono::milliseconds
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint64_t
+#include <string>                   // std::string
+
+#include "libs/latencyHistogram.hpp"
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * Counters and histograms which are updated by the task queue.
+     *
+     * All members can be updated without locking. Durations are recorded in
+     * nanoseconds.
+     */
+    struct TaskQueueCounters
+    {
+        std::atomic<uint64_t> nSubmitted;
+        std::atomic<uint64_t> nRejected;
+        std::atomic<uint64_t> nStarted;
+        std::atomic<uint64_t> nCompleted;
+        std::atomic<uint64_t> nCancelled;
+        std::atomic<uint64_t> nAborted;
+        /**
+         * Lookups in the result cache, see taskQueueEnableResultCache
+         */
+        std::atomic<uint64_t> nCacheHits;
+        std::atomic<uint64_t> nCacheMisses;
+        /**
+         * Frames classified as blank by the hit finder, see
+         * taskQueueEnableHitFinder. Dropped ones were not queued at all,
+         * deprioritized ones are counted as submitted, too.
+         */
+        std::atomic<uint64_t> nBlankDropped;
+        std::atomic<uint64_t> nBlankDeprioritized;
+        /**
+         * Number of tasks waiting for a worker
+         */
+        std::atomic<unsigned> queueDepth;
+        /**
+         * Number of tasks currently processed by a worker
+         */
+        std::atomic<unsigned> nRunning;
+        /**
+         * Time from addTask until a worker starts the task
+         */
+        imresh::libs::LatencyHistogram queueWait;
+        /**
+         * Memory limit set by taskQueueSetMemoryBudget, 0 if unlimited
+         */
+        std::atomic<size_t> memoryBudget;
+        /**
+         * Sum of estimateTaskMemory over all queued and running tasks
+         */
+        std::atomic<size_t> memoryReserved;
+        /**
+         * Memory actually allocated right now, i.e. the input images of all
+         * queued and running tasks plus the working arrays of running tasks
+         */
+        std::atomic<size_t> memoryUsed;
+        /**
+         * Time spent in cudaShrinkWrap
+         */
+        imresh::libs::LatencyHistogram reconstruction;
+        /**
+         * Time spent in the write out function
+         */
+        imresh::libs::LatencyHistogram writeOut;
+        /**
+         * Time of the last reset, i.e. normally of taskQueueInit
+         */
+        std::atomic<int64_t> startTime;
+    };
+
+    extern TaskQueueCounters taskQueueCounters;
+
+    /**
+     * Summary of one latency histogram. All times are in milliseconds.
+     */
+    struct LatencySummary
+    {
+        uint64_t count;
+        double mean;
+        double p50;
+        double p90;
+        double p99;
+        double max;
+    };
+
+    /**
+     * Snapshot of the task queue counters.
+     */
+    struct TaskQueueMetrics
+    {
+        /**
+         * Seconds since taskQueueInit or taskQueueResetMetrics
+         */
+        double uptime;
+        uint64_t nSubmitted;
+        uint64_t nRejected;
+        uint64_t nStarted;
+        uint64_t nCompleted;
+        uint64_t nCancelled;
+        uint64_t nAborted;
+        uint64_t nCacheHits;
+        uint64_t nCacheMisses;
+        uint64_t nBlankDropped;
+        uint64_t nBlankDeprioritized;
+        unsigned queueDepth;
+        unsigned nRunning;
+        /**
+         * Completed tasks per second averaged over the uptime
+         */
+        double tasksPerSecond;
+        size_t memoryBudget;
+        size_t memoryReserved;
+        size_t memoryUsed;
+        LatencySummary queueWait;
+        LatencySummary reconstruction;
+        LatencySummary writeOut;
+    };
+
+    /**
+     * Returns the current time in nanoseconds as used by TaskQueueCounters
+     */
+    int64_t taskQueueNow( );
+
+    /**
+     * Resets all counters and histograms except the current queue depth and
+     * number of running tasks. This is called by taskQueueInit.
+     */
+    void taskQueueResetMetrics( );
+
+    /**
+     * Returns a snapshot of the task queue counters.
+     */
+    TaskQueueMetrics taskQueueGetMetrics( );
+
+    /**
+     * Formats a snapshot as one line of JSON (without trailing newline).
+     */
+    std::string toJson( TaskQueueMetrics const & _metrics );
+
+    /**
+     * Starts a thread which appends a snapshot as JSON line to the given file
+     * every _period. Besides the members of TaskQueueMetrics each line
+     * contains "intervalTasksPerSecond", the throughput since the last line.
+     *
+     * @param _filename file to append to. "-" writes to stdout.
+     */
+    void taskQueueStartMetricsDump(
+        std::string const & _filename,
+        std::chrono::milliseconds _period
+    );
+
+    /**
+     * Stops the thread started by taskQueueStartMetricsDump after writing a
+     * last line.
+     */
+    void taskQueueStopMetricsDump( );
+
+
+} // namespace io
+} // namespace imresh
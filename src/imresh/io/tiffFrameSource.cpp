@@ -0,0 +1,214 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/tiffFrameSource.hpp"
+
+#ifdef USE_TIFF
+
+#include <algorithm>                // std::max, std::min
+#ifdef IMRESH_DEBUG
+#   include <iostream>              // std::cout, std::endl
+#endif
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    namespace
+    {
+        /**
+         * @return false if the sample format isn't supported
+         */
+        bool getElementType( TIFF * const rTiff, ElementType & rType )
+        {
+            uint16_t bitsPerSample = 0, samplesPerPixel = 0, sampleFormat = 0;
+            TIFFGetFieldDefaulted( rTiff, TIFFTAG_BITSPERSAMPLE  , &bitsPerSample   );
+            TIFFGetFieldDefaulted( rTiff, TIFFTAG_SAMPLESPERPIXEL, &samplesPerPixel );
+            TIFFGetFieldDefaulted( rTiff, TIFFTAG_SAMPLEFORMAT   , &sampleFormat    );
+            if ( samplesPerPixel != 1 )
+                return false;
+            if ( sampleFormat == SAMPLEFORMAT_UINT and bitsPerSample == 16 )
+                rType = ElementType::UInt16;
+            else if ( sampleFormat == SAMPLEFORMAT_UINT and bitsPerSample == 32 )
+                rType = ElementType::UInt32;
+            else if ( sampleFormat == SAMPLEFORMAT_IEEEFP and bitsPerSample == 32 )
+                rType = ElementType::Float32;
+            else
+                return false;
+            return true;
+        }
+    } // anonymous namespace
+
+    TiffFrameSource::TiffFrameSource( std::string const & rFilename )
+    : mTiff( NULL ), mnMaxElements( 0 )
+    {
+        /* detectors write lots of private tags, libtiff warns about each */
+        TIFFSetWarningHandler( NULL );
+
+        mTiff = TIFFOpen( rFilename.c_str(), "r" );
+        if ( mTiff == NULL )
+            return;
+
+        /* TIFFReadDirectory moves to the next page without searching it
+         * from the start of the file like TIFFSetDirectory */
+        do
+        {
+            uint32_t width = 0, height = 0;
+            TIFFGetField( mTiff, TIFFTAG_IMAGEWIDTH , &width  );
+            TIFFGetField( mTiff, TIFFTAG_IMAGELENGTH, &height );
+            Page page;
+            page.size = { width, height };
+            if ( width == 0 or height == 0 or not getElementType( mTiff, page.type ) )
+            {
+#               ifdef IMRESH_DEBUG
+                    std::cout << "imresh::io::TiffFrameSource: Page " << mPages.size()
+                              << " of " << rFilename << " has an unsupported format."
+                              << std::endl;
+#               endif
+                mPages.clear();
+                break;
+            }
+            mPages.push_back( page );
+            mnMaxElements = std::max( mnMaxElements, size_t( width ) * height );
+        }
+        while ( TIFFReadDirectory( mTiff ) );
+
+        if ( mPages.empty() or not TIFFSetDirectory( mTiff, 0 ) )
+        {
+            TIFFClose( mTiff );
+            mTiff = NULL;
+            mPages.clear();
+        }
+    }
+
+    TiffFrameSource::~TiffFrameSource()
+    {
+        if ( mTiff != NULL )
+            TIFFClose( mTiff );
+    }
+
+    bool TiffFrameSource::isOpen( void ) const
+    {
+        return mTiff != NULL;
+    }
+
+    uint64_t TiffFrameSource::getFrameCount( void ) const
+    {
+        return mPages.size();
+    }
+
+    std::pair<unsigned int,unsigned int> TiffFrameSource::getFrameSize( uint64_t const rIndex ) const
+    {
+        return mPages.at( rIndex ).size;
+    }
+
+    size_t TiffFrameSource::getMaxElements( void ) const
+    {
+        return mnMaxElements;
+    }
+
+    bool TiffFrameSource::readFrame( uint64_t const rIndex, float * const rDestination )
+    {
+        if ( mTiff == NULL or rIndex >= mPages.size() )
+            return false;
+        uint64_t const current = TIFFCurrentDirectory( mTiff );
+        if ( rIndex == current + 1 )
+        {
+            if ( not TIFFReadDirectory( mTiff ) )
+                return false;
+        }
+        else if ( rIndex != current and not TIFFSetDirectory( mTiff, rIndex ) )
+            return false;
+
+        Page const & page = mPages[ rIndex ];
+        return TIFFIsTiled( mTiff ) ? readTiles( page, rDestination )
+                                    : readStrips( page, rDestination );
+    }
+
+    bool TiffFrameSource::readStrips( Page const & rPage, float * const rDestination )
+    {
+        unsigned int const width  = rPage.size.first;
+        unsigned int const height = rPage.size.second;
+        uint32_t rowsPerStrip = 0;
+        TIFFGetFieldDefaulted( mTiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip );
+        rowsPerStrip = std::min( std::max( rowsPerStrip, uint32_t( 1 ) ), height );
+
+        mBuffer.resize( TIFFStripSize( mTiff ) );
+        size_t const elementSize = getElementSize( rPage.type );
+        for ( unsigned int row = 0; row < height; row += rowsPerStrip )
+        {
+            size_t const nRows = std::min( rowsPerStrip, height - row );
+            size_t const nElements = nRows * width;
+            /* libtiff decompresses and converts to native byte order */
+            tmsize_t const nBytes = TIFFReadEncodedStrip( mTiff, row / rowsPerStrip,
+                                                          mBuffer.data(), mBuffer.size() );
+            if ( nBytes < tmsize_t( nElements * elementSize ) )
+                return false;
+            convertToFloat( mBuffer.data(), rPage.type, true, nElements,
+                            rDestination + size_t( row ) * width );
+        }
+        return true;
+    }
+
+    bool TiffFrameSource::readTiles( Page const & rPage, float * const rDestination )
+    {
+        unsigned int const width  = rPage.size.first;
+        unsigned int const height = rPage.size.second;
+        uint32_t tileWidth = 0, tileHeight = 0;
+        TIFFGetField( mTiff, TIFFTAG_TILEWIDTH , &tileWidth  );
+        TIFFGetField( mTiff, TIFFTAG_TILELENGTH, &tileHeight );
+        if ( tileWidth == 0 or tileHeight == 0 )
+            return false;
+
+        mBuffer.resize( TIFFTileSize( mTiff ) );
+        size_t const elementSize = getElementSize( rPage.type );
+        if ( mBuffer.size() < size_t( tileWidth ) * tileHeight * elementSize )
+            return false;
+        for ( unsigned int y = 0; y < height; y += tileHeight )
+        for ( unsigned int x = 0; x < width; x += tileWidth )
+        {
+            ttile_t const tile = TIFFComputeTile( mTiff, x, y, 0, 0 );
+            if ( TIFFReadEncodedTile( mTiff, tile, mBuffer.data(), mBuffer.size() ) < 0 )
+                return false;
+            /* tiles at the right and bottom border are padded */
+            unsigned int const nColumns = std::min( tileWidth , width  - x );
+            unsigned int const nRows    = std::min( tileHeight, height - y );
+            for ( unsigned int iRow = 0; iRow < nRows; ++iRow )
+            {
+                convertToFloat( mBuffer.data() + size_t( iRow ) * tileWidth * elementSize,
+                                rPage.type, true, nColumns,
+                                rDestination + size_t( y + iRow ) * width + x );
+            }
+        }
+        return true;
+    }
+
+
+} // namespace io
+} // namespace imresh
+
+#endif
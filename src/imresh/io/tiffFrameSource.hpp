@@ -0,0 +1,100 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifdef USE_TIFF
+
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint64_t
+#include <string>                   // std::string
+#include <utility>                  // std::pair
+#include <vector>                   // std::vector
+
+#include <tiffio.h>
+
+#include "io/binaryFormats.hpp"     // ElementType
+#include "io/frameStream.hpp"       // FrameSource
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    /**
+     * The pages of a TIFF file read with libtiff, e.g. from an area
+     * detector. Strip and tile layouts with any compression libtiff
+     * supports are read, as long as a page is grayscale with uint16, uint32
+     * or float32 samples. Pages with other formats make the whole file
+     * invalid. The decoded strips or tiles are converted with
+     * convertToFloat.
+     *
+     * Pages are best read in order, other orders make libtiff search the
+     * page from the start of the file.
+     */
+    class TiffFrameSource : public FrameSource
+    {
+    public:
+        /**
+         * Reads the directories of all pages, check isOpen afterwards
+         */
+        explicit TiffFrameSource( std::string const & rFilename );
+        ~TiffFrameSource();
+
+        TiffFrameSource( TiffFrameSource const & ) = delete;
+        TiffFrameSource & operator=( TiffFrameSource const & ) = delete;
+
+        bool isOpen( void ) const;
+
+        uint64_t getFrameCount( void ) const override;
+        std::pair<unsigned int,unsigned int> getFrameSize( uint64_t rIndex ) const override;
+        size_t getMaxElements( void ) const override;
+        bool readFrame( uint64_t rIndex, float * rDestination ) override;
+
+    private:
+        struct Page
+        {
+            std::pair<unsigned int,unsigned int> size;
+            ElementType type;
+        };
+
+        bool readStrips( Page const & rPage, float * rDestination );
+        bool readTiles( Page const & rPage, float * rDestination );
+
+        TIFF * mTiff;
+        std::vector<Page> mPages;
+        size_t mnMaxElements;
+        /**
+         * decoded strip or tile
+         */
+        std::vector<unsigned char> mBuffer;
+    };
+
+
+} // namespace io
+} // namespace imresh
+
+#endif
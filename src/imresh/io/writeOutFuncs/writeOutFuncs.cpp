@@ -28,19 +28,27 @@
 #   include <iostream>              // std::cout, std::endl
 #endif
 #ifdef USE_PNG
+#   include <png.h>
 #   include <pngwriter.h>
 #endif
 #ifdef USE_SPLASH
 #   include <splash/splash.h>
 #endif
+#include <fstream>                  // std::ofstream
+#include <iomanip>                  // std::setprecision
 #include <string>                   // std::string
 #include <utility>                  // std::pair
 #include <cstddef>                  // NULL
+#include <cstdint>                  // uint8_t, uint16_t
+#include <cstdio>                   // fopen, perror
+#include <vector>                   // std::vector
 #include <sstream>
 #include <cassert>
 
-#include "algorithms/vectorReduce.hpp" // vectorMax
+#include "algorithms/vectorReduce.hpp" // vectorMax, vectorMinMax
 #include "io/writeOutFuncs/writeOutFuncs.hpp"
+#include "io/binaryFormats.hpp"        // writeBinaryFile, make*Header
+#include "libs/frameBuffer.hpp"         // freeFrame
 
 
 namespace imresh
@@ -58,17 +66,60 @@ namespace writeOutFuncs
         std::string const _filename
     )
     {
-        if ( _mem != NULL )
-        {
-            free( _mem );
-            _mem = NULL;
-        }
+        libs::freeFrame( _mem );
 #       ifdef IMRESH_DEBUG
             std::cout << "imresh::io::writeOutFuncs::justFree(): Freeing data ("
                 << _filename << ")." << std::endl;
 #       endif
     }
 
+    void writeOutTxt
+    (
+        float const * const _mem,
+        std::pair<unsigned, unsigned> const _size,
+        std::string const _filename
+    )
+    {
+        std::ofstream file( _filename );
+        /* enough digits to read back the same float */
+        file << std::setprecision( 9 );
+        for( unsigned iy = 0; iy < _size.second; ++iy )
+        {
+            for( unsigned ix = 0; ix < _size.first; ++ix )
+            {
+                file << _mem[ iy * _size.first + ix ]
+                     << ( ix + 1 < _size.first ? ' ' : '\n' );
+            }
+        }
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::writeOutFuncs::writeOutTxt(): "
+                         "Successfully written image data to txt ("
+                      << _filename << ")." << std::endl;
+#       endif
+    }
+
+    void writeOutRaw
+    (
+        float const * const _mem,
+        std::pair<unsigned, unsigned> const _size,
+        std::string const _filename
+    )
+    {
+        writeBinaryFile( _filename, makeRawHeader( _size.first, _size.second, 1 ),
+                         _mem, sizeof( float ) * _size.first * _size.second );
+    }
+
+    void writeOutNpy
+    (
+        float const * const _mem,
+        std::pair<unsigned, unsigned> const _size,
+        std::string const _filename
+    )
+    {
+        writeBinaryFile( _filename, makeNpyHeader( _size.first, _size.second, 1 ),
+                         _mem, sizeof( float ) * _size.first * _size.second );
+    }
+
 #   ifdef USE_PNG
         void writeOutPNG
         (
@@ -106,6 +157,98 @@ namespace writeOutFuncs
         }
 #   endif
 
+#   ifdef USE_PNG
+        void writeOutPNG16
+        (
+            float const * const _mem,
+            std::pair<unsigned,unsigned> const _size,
+            std::string const _filename,
+            PNGOptions const & _options
+        )
+        {
+            auto const & Nx = _size.first;
+            auto const & Ny = _size.second;
+            unsigned const bitDepth = _options.bitDepth == 8 ? 8 : 16;
+            size_t const rowBytes = size_t( Nx ) * bitDepth / 8;
+
+            /* scale to the full range in one pass over the image */
+            auto const minMax = algorithms::vectorMinMax( _mem, Nx * Ny );
+            float const maxValue = bitDepth == 8 ? 255.0f : 65535.0f;
+            float const minimum = minMax.first;
+            float const scale = minMax.second > minMax.first ?
+                                maxValue / ( minMax.second - minMax.first ) : 0.0f;
+
+            std::vector<uint8_t> pixels( rowBytes * Ny );
+            std::vector<png_bytep> rows( Ny );
+            #pragma omp parallel for
+            for ( unsigned iy = 0; iy < Ny; ++iy )
+            {
+                float const * const in = _mem + size_t( iy ) * Nx;
+                uint8_t * const out = &pixels[ iy * rowBytes ];
+                rows[iy] = out;
+                /* NaN fails the first comparison and becomes 0 */
+                if ( bitDepth == 16 )
+                {
+                    for ( unsigned ix = 0; ix < Nx; ++ix )
+                    {
+                        float value = ( in[ix] - minimum ) * scale;
+                        value = value >= 0.0f ? value : 0.0f;
+                        value = value <= maxValue ? value : maxValue;
+                        uint16_t const gray = uint16_t( value + 0.5f );
+                        /* PNG is big endian */
+                        out[ 2*ix   ] = uint8_t( gray >> 8 );
+                        out[ 2*ix+1 ] = uint8_t( gray & 0xFF );
+                    }
+                }
+                else
+                {
+                    for ( unsigned ix = 0; ix < Nx; ++ix )
+                    {
+                        float value = ( in[ix] - minimum ) * scale;
+                        value = value >= 0.0f ? value : 0.0f;
+                        value = value <= maxValue ? value : maxValue;
+                        out[ix] = uint8_t( value + 0.5f );
+                    }
+                }
+            }
+
+            FILE * const file = fopen( _filename.c_str( ), "wb" );
+            if ( file == NULL )
+            {
+                perror( "imresh::io::writeOutFuncs::writeOutPNG16(): fopen" );
+                return;
+            }
+            png_structp png = png_create_write_struct( PNG_LIBPNG_VER_STRING,
+                                                       NULL, NULL, NULL );
+            png_infop info = png == NULL ? NULL : png_create_info_struct( png );
+            /* libpng prints errors and returns with longjmp, no objects
+             * with destructors may be created after this point */
+            if ( info == NULL or setjmp( png_jmpbuf( png ) ) )
+            {
+                png_destroy_write_struct( &png, &info );
+                fclose( file );
+                return;
+            }
+            png_init_io( png, file );
+            png_set_compression_level( png, _options.compressionLevel );
+            if ( _options.filters != 0 )
+                png_set_filter( png, PNG_FILTER_TYPE_BASE, _options.filters );
+            png_set_IHDR( png, info, Nx, Ny, bitDepth, PNG_COLOR_TYPE_GRAY,
+                          PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+                          PNG_FILTER_TYPE_DEFAULT );
+            png_write_info( png, info );
+            png_write_image( png, rows.data( ) );
+            png_write_end( png, NULL );
+            png_destroy_write_struct( &png, &info );
+            fclose( file );
+#           ifdef IMRESH_DEBUG
+                std::cout << "imresh::io::writeOutFuncs::writeOutPNG16(): "
+                             "Successfully written image data to PNG ("
+                          << _filename << ")." << std::endl;
+#           endif
+        }
+#   endif
+
 #   ifdef USE_SPLASH
         void writeOutHDF5
         (
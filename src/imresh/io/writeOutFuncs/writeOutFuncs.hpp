@@ -38,7 +38,9 @@ namespace writeOutFuncs
 
 
     /**
-     * Just free the pointer and delete the memory.
+     * Just releases the memory with libs::freeFrame, i.e. it has to be
+     * allocated with libs::allocateFrame like the memory returned by
+     * readInFuncs.
      *
      * This function only exists for benchmarking purposes, as it's not dependant
      * on the filesystem.
@@ -49,6 +51,35 @@ namespace writeOutFuncs
         std::string const _filname
     );
 
+    /**
+     * Writes the image as a 2D matrix with spaces as delimiters, i.e. in the
+     * format read by readInFuncs::readTxt.
+     */
+    void writeOutTxt(
+        float const * const _mem,
+        std::pair<unsigned, unsigned> const _size,
+        std::string const _filename
+    );
+
+    /**
+     * Writes the image in imresh's own binary format with one large write,
+     * see imresh::io::rawHeaderSize.
+     */
+    void writeOutRaw(
+        float const * const _mem,
+        std::pair<unsigned, unsigned> const _size,
+        std::string const _filename
+    );
+
+    /**
+     * Writes the image as NumPy float32 array of shape (height, width).
+     */
+    void writeOutNpy(
+        float const * const _mem,
+        std::pair<unsigned, unsigned> const _size,
+        std::string const _filename
+    );
+
 #   ifdef USE_PNG
         /**
          * Writes the reconstructed image to a PNG file.
@@ -60,6 +91,42 @@ namespace writeOutFuncs
         );
 #   endif
 
+#   ifdef USE_PNG
+        struct PNGOptions
+        {
+            /**
+             * zlib level from 0 (uncompressed) to 9 (smallest). The lower
+             * levels are a lot faster.
+             */
+            int compressionLevel = 1;
+            /**
+             * Bitwise or of the PNG_FILTER_* flags of libpng, 0 uses the
+             * default of libpng, i.e. tries all filters on every row.
+             */
+            int filters = 0;
+            /**
+             * 16 or 8
+             */
+            unsigned bitDepth = 16;
+        };
+
+        /**
+         * Writes the image as grayscale PNG directly with libpng. The values
+         * are scaled from [minimum, maximum] of the image to the full range
+         * of the bit depth, NaN becomes 0. The rows are converted in
+         * parallel before they are compressed.
+         *
+         * To use it as WriteOutFunc with other options than the default,
+         * bind them with a lambda.
+         */
+        void writeOutPNG16(
+            float const * const _mem,
+            std::pair<unsigned, unsigned> const _size,
+            std::string const _filename,
+            PNGOptions const & _options = PNGOptions( )
+        );
+#   endif
+
 #   ifdef USE_SPLASH
         /**
          * Write out data using HDF5.
@@ -0,0 +1,175 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "io/writerPool.hpp"
+
+#include <algorithm>                // std::max
+#ifdef IMRESH_DEBUG
+#   include <iostream>              // std::cout, std::endl
+#endif
+
+#include "libs/frameBuffer.hpp"     // freeFrame
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    WriterPool::WriterPool
+    (
+        unsigned int const rnThreads,
+        bool const rOrdered,
+        size_t const rnMaxQueued
+    )
+    : mOrdered( rOrdered ), mnMaxQueued( std::max( rnMaxQueued, size_t( 1 ) ) ),
+      mnNextTicket( 0 ), mnNextToStart( 0 ), mnRunning( 0 ), mStop( false ),
+      mStatistics()
+    {
+        for ( unsigned int i = 0; i < std::max( rnThreads, 1u ); ++i )
+            mThreads.emplace_back( &WriterPool::writeLoop, this );
+    }
+
+    WriterPool::~WriterPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mStop = true;
+            mChanged.notify_all();
+        }
+        for ( auto & thread : mThreads )
+            thread.join();
+#       ifdef IMRESH_DEBUG
+            std::cout << "imresh::io::WriterPool::~WriterPool(): "
+                      << mStatistics.nWritten << " written, "
+                      << mStatistics.nSkipped << " skipped." << std::endl;
+#       endif
+    }
+
+    WriterPool::BoundFuncs WriterPool::bind
+    (
+        WriteOutFunc rWriter,
+        RecycleFunc rRecycle
+    )
+    {
+        if ( not rRecycle )
+            rRecycle = []( float * rMem, size_t ){ libs::freeFrame( rMem ); };
+
+        uint64_t ticket;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            ticket = mnNextTicket++;
+        }
+
+        BoundFuncs funcs;
+        funcs.writeOut = [this,ticket,rWriter,rRecycle]( float * _mem,
+            std::pair<unsigned int,unsigned int> _size, std::string _filename )
+        {
+            submit( ticket, Job{ _mem, _size, _filename, rWriter, rRecycle } );
+        };
+        funcs.cancel = [this,ticket,rRecycle]( float * _mem,
+            std::pair<unsigned int,unsigned int> _size, std::string _filename )
+        {
+            submit( ticket, Job{ _mem, _size, _filename, WriteOutFunc(), rRecycle } );
+        };
+        return funcs;
+    }
+
+    void WriterPool::submit( uint64_t const rTicket, Job rJob )
+    {
+        std::unique_lock<std::mutex> lock( mMutex );
+        /* if ordered, the result the writers wait for might be held by a
+         * thread blocked here, so the queue isn't bounded then */
+        auto const hasSpace = [&]
+        {
+            return mOrdered or mQueue.size() < mnMaxQueued;
+        };
+        if ( not hasSpace() )
+        {
+            ++mStatistics.nBlocked;
+            mChanged.wait( lock, hasSpace );
+        }
+        mQueue.emplace( rTicket, std::move( rJob ) );
+        mStatistics.maxQueued = std::max( mStatistics.maxQueued,
+                                          uint64_t( mQueue.size() ) );
+        mChanged.notify_all();
+    }
+
+    bool WriterPool::hasStartableJob( void ) const
+    {
+        if ( mQueue.empty() )
+            return false;
+        /* when stopping, gaps in the order are skipped */
+        return not mOrdered or mStop or mQueue.begin()->first == mnNextToStart;
+    }
+
+    void WriterPool::writeLoop( void )
+    {
+        std::unique_lock<std::mutex> lock( mMutex );
+        while ( true )
+        {
+            mChanged.wait( lock, [this]
+                { return hasStartableJob() or ( mStop and mQueue.empty() ); } );
+            if ( mQueue.empty() )
+                return;
+
+            /* without ordering this is still the oldest result */
+            auto const it = mQueue.begin();
+            Job const job = std::move( it->second );
+            mnNextToStart = std::max( mnNextToStart, it->first + 1 );
+            mQueue.erase( it );
+            ++mnRunning;
+            mChanged.notify_all();
+            lock.unlock();
+
+            if ( job.writer )
+                job.writer( job.mem, job.size, job.filename );
+            job.recycle( job.mem, size_t( job.size.first ) * job.size.second );
+
+            lock.lock();
+            --mnRunning;
+            if ( job.writer )
+                ++mStatistics.nWritten;
+            else
+                ++mStatistics.nSkipped;
+            mChanged.notify_all();
+        }
+    }
+
+    void WriterPool::flush( void )
+    {
+        std::unique_lock<std::mutex> lock( mMutex );
+        mChanged.wait( lock, [this]{ return mQueue.empty() and mnRunning == 0; } );
+    }
+
+    WriterPoolStatistics WriterPool::getStatistics( void ) const
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        return mStatistics;
+    }
+
+
+} // namespace io
+} // namespace imresh
@@ -0,0 +1,176 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <condition_variable>       // std::condition_variable
+#include <cstddef>                  // size_t
+#include <cstdint>                  // uint64_t
+#include <functional>               // std::function
+#include <map>                      // std::map
+#include <mutex>                    // std::mutex
+#include <string>                   // std::string
+#include <thread>                   // std::thread
+#include <utility>                  // std::pair
+#include <vector>                   // std::vector
+
+#include "io/taskQueue.hpp"         // WriteOutFunc
+
+
+namespace imresh
+{
+namespace io
+{
+
+
+    struct WriterPoolStatistics
+    {
+        uint64_t nWritten;
+        /**
+         * results of cancelled tasks, which only had their buffer recycled
+         */
+        uint64_t nSkipped;
+        /**
+         * submissions which had to wait, because the queue was full
+         */
+        uint64_t nBlocked;
+        uint64_t maxQueued;
+    };
+
+    /**
+     * Writes results on dedicated I/O threads, so that the worker threads of
+     * the task queue can start the next reconstruction right away instead of
+     * waiting for e.g. PNG compression. Afterwards the buffer is recycled,
+     * by default with libs::freeFrame, i.e. it returns to the frame buffer
+     * pool and the next image read reuses it.
+     *
+     * Usage:
+     *   auto funcs = writerPool.bind( writeOutFuncs::writeOutPNG );
+     *   if ( not addTask( mem, size, funcs.writeOut, name, ...,
+     *                     funcs.cancel ) )
+     *       funcs.cancel( mem, size, name );
+     *
+     * If ordered, results are written in the order bind was called, i.e.
+     * normally the order the tasks were added in. With more than one thread
+     * the writes are started in that order, but may overlap. Every bound
+     * pair has to be called exactly once, so the order has no gaps.
+     */
+    class WriterPool
+    {
+    public:
+        /**
+         * Called after writing instead of freeing the buffer, with the
+         * buffer and the number of elements of the image.
+         */
+        typedef std::function<void(float*,size_t)> RecycleFunc;
+
+        struct BoundFuncs
+        {
+            WriteOutFunc writeOut;
+            WriteOutFunc cancel;
+        };
+
+        /**
+         * @param rnMaxQueued submissions block while this many results are
+         *        waiting to be written, which bounds the memory held. Not
+         *        used if ordered, because the result which has to be
+         *        written next might be held by a blocked thread. The
+         *        results waiting are then bounded by the tasks in flight.
+         */
+        explicit WriterPool
+        (
+            unsigned int rnThreads = 2,
+            bool rOrdered = false,
+            size_t rnMaxQueued = 64
+        );
+        /**
+         * Writes all queued results. Results bound but never submitted are
+         * not waited for.
+         */
+        ~WriterPool();
+
+        WriterPool( WriterPool const & ) = delete;
+        WriterPool & operator=( WriterPool const & ) = delete;
+
+        /**
+         * @param rWriter writes the result, e.g. writeOutFuncs::writeOutPNG.
+         *        It must not free the buffer.
+         * @param rRecycle defaults to libs::freeFrame, so the results have
+         *        to be allocated with libs::allocateFrame then
+         * @return functions to pass to addTask as write out and cancel
+         *         function. Both only queue the result and return.
+         */
+        BoundFuncs bind( WriteOutFunc rWriter, RecycleFunc rRecycle = RecycleFunc() );
+
+        /**
+         * Waits until every submitted result is written.
+         */
+        void flush( void );
+
+        WriterPoolStatistics getStatistics( void ) const;
+
+    private:
+        struct Job
+        {
+            float * mem;
+            std::pair<unsigned int,unsigned int> size;
+            std::string filename;
+            /**
+             * empty for cancelled results
+             */
+            WriteOutFunc writer;
+            RecycleFunc recycle;
+        };
+
+        void submit( uint64_t rTicket, Job rJob );
+        void writeLoop( void );
+        /**
+         * @return whether a job can be started, must hold mMutex
+         */
+        bool hasStartableJob( void ) const;
+
+        bool const mOrdered;
+        size_t const mnMaxQueued;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mChanged;
+        /**
+         * queued results by ticket, see bind
+         */
+        std::map<uint64_t,Job> mQueue;
+        uint64_t mnNextTicket;
+        /**
+         * ticket to be started next if ordered
+         */
+        uint64_t mnNextToStart;
+        unsigned int mnRunning;
+        bool mStop;
+        WriterPoolStatistics mStatistics;
+
+        std::vector<std::thread> mThreads;
+    };
+
+
+} // namespace io
+} // namespace imresh
@@ -25,9 +25,13 @@
 
 #include "diffractionIntensity.hpp"
 
+#include <algorithm> // std::rotate, std::copy
 #include <cmath>     // sqrtf
 #include <fftw3.h>  // we only need fftw_complex from this and don't want to confuse the compiler if cufftw is being used, so include it here instead of in the header
-#include "libs/vectorIndex.hpp"
+#include <map>
+#include <mutex>
+#include "libs/fftwPlannerMutex.hpp" // getFftwPlannerMutex
+#include "libs/frameBuffer.hpp"     // FrameBuffer
 
 
 namespace imresh
@@ -36,35 +40,165 @@ namespace libs
 {
 
 
-    void diffractionIntensity
+    namespace
+    {
+        /**
+         * Transforms one frame with the r2c plan and writes the norm of the
+         * full, optionally shifted spectrum back into it.
+         *
+         * @param rInput aligned scratch buffer of nx*ny floats for frames whose
+         *        alignment differs from the one the plan was created for.
+         *        Allocated on first use.
+         * @param rSpectrum scratch buffer for ny*(nx/2+1) complex values
+         * @param rParallel process the rows in parallel
+         */
+        void transformFrame
+        (
+            fftwf_plan const & rPlan,
+            std::pair<unsigned int,unsigned int> const & rSize,
+            bool const rFftShift,
+            float * const rIoData,
+            FrameBuffer & rInput,
+            fftwf_complex * const rSpectrum,
+            bool const rParallel
+        )
+        {
+            unsigned int const nx = rSize.first;
+            unsigned int const ny = rSize.second;
+            /* number of complex values per row of the half spectrum */
+            unsigned int const nh = nx/2 + 1;
+
+            float * input = rIoData;
+            /* the plan was created for buffers of libs::allocateFrame, but
+             * new-array execution needs the same SIMD alignment */
+            if ( fftwf_alignment_of( rIoData ) != 0 )
+            {
+                if ( not rInput )
+                    rInput = FrameBuffer( size_t( nx ) * ny );
+                std::copy( rIoData, rIoData + size_t( nx ) * ny, rInput.data() );
+                input = rInput.data();
+            }
+            fftwf_execute_dft_r2c( rPlan, input, rSpectrum );
+
+            #pragma omp parallel for if( rParallel ) schedule( static )
+            for ( unsigned int ky = 0; ky < ny; ++ky )
+            {
+                unsigned int const iyTarget = rFftShift ? ( ky + ny/2 ) % ny : ky;
+                float * const row = rIoData + size_t( iyTarget ) * nx;
+                /* the first nh frequencies are stored, F(-k) = conj(F(k)) gives
+                 * the others from the row of -ky */
+                fftwf_complex const * const stored = rSpectrum + size_t( ky ) * nh;
+                fftwf_complex const * const mirrored =
+                    rSpectrum + size_t( ( ny - ky ) % ny ) * nh;
+                #pragma omp simd
+                for ( unsigned int kx = 0; kx < nh; ++kx )
+                {
+                    float const re = stored[kx][0];
+                    float const im = stored[kx][1];
+                    row[kx] = sqrtf( re*re + im*im );
+                }
+                #pragma omp simd
+                for ( unsigned int kx = nh; kx < nx; ++kx )
+                {
+                    float const re = mirrored[ nx - kx ][0];
+                    float const im = mirrored[ nx - kx ][1];
+                    row[kx] = sqrtf( re*re + im*im );
+                }
+                if ( rFftShift )
+                    std::rotate( row, row + ( nx - nx/2 ), row + nx );
+            }
+        }
+    } // anonymous namespace
+
+    DiffractionIntensityPlan::DiffractionIntensityPlan
     (
-        float * const & rIoData,
-        const std::pair<unsigned int,unsigned int>& rSize
+        std::pair<unsigned int,unsigned int> const & rSize,
+        bool rFftShift,
+        bool rMeasure
     )
+    : mSize( rSize ),
+      mFftShift( rFftShift )
     {
-        unsigned int nElements = rSize.first * rSize.second;
-        /* @ see http://www.fftw.org/doc/Precision.html */
-        auto tmp = new fftwf_complex[nElements];
+        unsigned int const nx = mSize.first;
+        unsigned int const ny = mSize.second;
+        /* FFTW_MEASURE overwrites the arrays, so plan on scratch buffers */
+        FrameBuffer input( size_t( nx ) * ny );
+        FrameBuffer spectrum( 2 * size_t( nx/2 + 1 ) * ny );
 
-        for ( unsigned i = 0; i < nElements; ++i )
+        std::lock_guard<std::mutex> lock( getFftwPlannerMutex() );
+        fftwf_plan const plan = fftwf_plan_dft_r2c_2d( ny, nx, input.data(),
+            reinterpret_cast<fftwf_complex*>( spectrum.data() ),
+            ( rMeasure ? FFTW_MEASURE : FFTW_ESTIMATE ) | FFTW_DESTROY_INPUT );
+        mPlan = std::shared_ptr<void>( plan, []( void * rPlan )
         {
-            tmp[i][0] = rIoData[i];
-            tmp[i][1] = 0;
+            std::lock_guard<std::mutex> planLock( getFftwPlannerMutex() );
+            fftwf_destroy_plan( static_cast<fftwf_plan>( rPlan ) );
+        } );
+    }
+
+    std::pair<unsigned int,unsigned int> DiffractionIntensityPlan::getSize( void ) const
+    {
+        return mSize;
+    }
+
+    bool DiffractionIntensityPlan::getFftShift( void ) const
+    {
+        return mFftShift;
+    }
+
+    void DiffractionIntensityPlan::operator()( float * rIoData ) const
+    {
+        FrameBuffer input;
+        FrameBuffer spectrum( 2 * size_t( mSize.first/2 + 1 ) * mSize.second );
+        transformFrame( static_cast<fftwf_plan>( mPlan.get() ), mSize,
+            mFftShift, rIoData, input,
+            reinterpret_cast<fftwf_complex*>( spectrum.data() ), true );
+    }
+
+    void DiffractionIntensityPlan::operator()
+    (
+        float * const * rIoFrames,
+        unsigned int rnFrames
+    ) const
+    {
+        fftwf_plan const plan = static_cast<fftwf_plan>( mPlan.get() );
+        #pragma omp parallel
+        {
+            /* scratch buffers are reused for all frames of a thread */
+            FrameBuffer input;
+            FrameBuffer spectrum( 2 * size_t( mSize.first/2 + 1 ) * mSize.second );
+            #pragma omp for schedule( dynamic )
+            for ( unsigned int i = 0; i < rnFrames; ++i )
+            {
+                transformFrame( plan, mSize, mFftShift, rIoFrames[i], input,
+                    reinterpret_cast<fftwf_complex*>( spectrum.data() ), false );
+            }
         }
-        fftwf_plan ft = fftwf_plan_dft_2d( rSize.second, rSize.first, tmp, tmp,
-            FFTW_FORWARD, FFTW_ESTIMATE );
-        fftwf_execute( ft );
-        fftwf_destroy_plan( ft );
+    }
+
+    void diffractionIntensity
+    (
+        float * const & rIoData,
+        const std::pair<unsigned int,unsigned int>& rSize,
+        bool rFftShift
+    )
+    {
+        static std::mutex plansMutex;
+        static std::map< std::pair< std::pair<unsigned int,unsigned int>, bool >,
+                         DiffractionIntensityPlan > plans;
 
-        for ( unsigned i = 0; i < nElements; ++i )
+        plansMutex.lock();
+        auto it = plans.find( { rSize, rFftShift } );
+        if ( it == plans.end() )
         {
-            const float & re = tmp[i][0]; /* Re */
-            const float & im = tmp[i][1]; /* Im */
-            const float norm = sqrtf( re*re + im*im );
-            rIoData[ i /*fftShiftIndex(i,rSize)*/ ] = norm;
+            it = plans.emplace( std::make_pair( rSize, rFftShift ),
+                DiffractionIntensityPlan( rSize, rFftShift ) ).first;
         }
+        /* copies share the plan */
+        DiffractionIntensityPlan const plan = it->second;
+        plansMutex.unlock();
 
-        delete[] tmp;
+        plan( rIoData );
     }
 
 
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include <memory>       // std::shared_ptr
 #include <utility>
 
 
@@ -40,10 +41,10 @@ namespace libs
      * @see https://en.wikipedia.org/wiki/Diffraction#General_aperture
      * Because there are different similar applications no constant physical
      * factors will be applied here, instead a simple fourier transform
-     * followed by a squared norm will be used.
+     * followed by a norm will be used.
      *
-     * This function also shifts the frequency, so that frequency 0 is in the
-     * middle like it would be for a normal measurement.
+     * Optionally this function also shifts the frequency, so that frequency
+     * 0 is in the middle like it would be for a normal measurement.
      *
      * E.g. a rectangular box becomes a kind of checkerboard pattern with
      * decreasing maxima intensity:
@@ -60,18 +61,77 @@ namespace libs
      *                           k=0         k=N-1              k=0
      * @endverbatim
      *
+     * The plans are cached per size, so repeated calls only pay for the
+     * transform. For many frames use DiffractionIntensityPlan directly.
+     *
      * @param[in]  rIoData real valued object which is to be transformed
      * @param[out] rIoData real valued diffraction intensity
-     * @param[in]  rDimensions vector containing the dimensions of rIoData.
-     *             the number of dimensions i.e. the size of the vector can be
-     *             anything > 0
+     * @param[in]  rDim width and height of rIoData
+     * @param[in]  rFftShift if true, frequency 0 is moved to the center as
+     *             done by fftShiftIndex
      **/
     void diffractionIntensity
     (
         float * const & rIoData,
-        const std::pair<unsigned int,unsigned int>& rDim
+        const std::pair<unsigned int,unsigned int>& rDim,
+        bool rFftShift = false
     );
 
+    /**
+     * Reusable diffractionIntensity for many frames of the same size, e.g.
+     * when simulating training data.
+     *
+     * The FFTW plan is created once. As objects are real, a real-to-complex
+     * transform computes only half of the spectrum, the other half follows
+     * from its Hermitian symmetry. Norm, expansion to the full spectrum and
+     * the optional shift are done in one pass over the half spectrum.
+     *
+     * Transforms are const and only use scratch buffers of the calling
+     * thread, so one plan can be shared by several threads. Single frames
+     * are processed row-parallel, batches frame-parallel with OpenMP.
+     **/
+    class DiffractionIntensityPlan
+    {
+    public:
+        /**
+         * @param rSize width and height of the frames
+         * @param rFftShift if true, frequency 0 is moved to the center
+         * @param rMeasure if true, FFTW measures the fastest algorithm
+         *        instead of estimating it. This takes up to seconds once,
+         *        but pays off for thousands of frames.
+         **/
+        DiffractionIntensityPlan
+        (
+            std::pair<unsigned int,unsigned int> const & rSize,
+            bool rFftShift = false,
+            bool rMeasure = false
+        );
+
+        std::pair<unsigned int,unsigned int> getSize( void ) const;
+        bool getFftShift( void ) const;
+
+        /**
+         * Transforms one frame of getSize in-place.
+         **/
+        void operator()( float * rIoData ) const;
+
+        /**
+         * Transforms rnFrames frames in-place in parallel.
+         **/
+        void operator()
+        (
+            float * const * rIoFrames,
+            unsigned int rnFrames
+        ) const;
+
+    private:
+        std::pair<unsigned int,unsigned int> mSize;
+        bool mFftShift;
+        /* the fftwf_plan, which is not exposed to keep fftw3.h out of
+         * this header */
+        std::shared_ptr<void> mPlan;
+    };
+
 
 } // namespace libs
 } // namespace imresh
@@ -0,0 +1,303 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "frameBuffer.hpp"
+
+#include <cassert>
+#include <cstdlib>              // posix_memalign, free
+#include <new>                  // placement new
+#include <utility>              // std::swap
+#ifdef IMRESH_DEBUG
+#   include <iostream>          // std::cout, std::endl
+#endif
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    namespace
+    {
+        /**
+         * Stored in the alignment padding in front of every buffer
+         **/
+        struct FrameHeader
+        {
+            FrameBufferPool * pool;
+            size_t nElements;
+            std::atomic<unsigned> nReferences;
+            unsigned sizeClass;
+        };
+        static_assert( sizeof( FrameHeader ) <= frameBufferAlignment,
+                       "The frame header has to fit into the alignment padding" );
+
+        /* smallest size class is 2^minClassExponent bytes */
+        constexpr unsigned minClassExponent = 8;
+        constexpr unsigned nSizeClasses = ( 64 - minClassExponent ) * 4 + 1;
+
+        inline FrameHeader * getHeader( float const * rBuffer )
+        {
+            return reinterpret_cast<FrameHeader*>( const_cast<char*>(
+                reinterpret_cast<char const*>( rBuffer ) - frameBufferAlignment ) );
+        }
+    } // anonymous namespace
+
+
+    FrameBufferPool::FrameBufferPool( size_t const rnMaxCachedBytes )
+    : mnMaxCachedBytes( rnMaxCachedBytes ), mFree( nSizeClasses ),
+      mStatistics{ 0, 0, 0, 0, 0, 0 }
+    {}
+
+    FrameBufferPool::~FrameBufferPool()
+    {
+        trim();
+#       ifdef IMRESH_DEBUG
+            if ( mStatistics.nLive != 0 )
+                std::cout << "imresh::libs::FrameBufferPool::~FrameBufferPool(): "
+                          << mStatistics.nLive << " buffers are still in use"
+                          << std::endl;
+#       endif
+    }
+
+    unsigned FrameBufferPool::getSizeClass( size_t const rnBytes )
+    {
+        if ( rnBytes <= ( size_t( 1 ) << minClassExponent ) )
+            return 0;
+        /* Class i holds ( 4 + i % 4 ) * 2^( i / 4 + minClassExponent - 2 )
+         * bytes. The two bits after the most significant one of rnBytes-1
+         * select the quarter step within its power of two. */
+        size_t const n = rnBytes - 1;
+        unsigned const iMsb = 63 - __builtin_clzll( n );
+        unsigned const quarter = ( n >> ( iMsb - 2 ) ) & 3;
+        return ( iMsb - minClassExponent ) * 4 + quarter + 1;
+    }
+
+    size_t FrameBufferPool::getSizeClassBytes( unsigned const rIndex )
+    {
+        return size_t( 4 + rIndex % 4 ) << ( rIndex / 4 + minClassExponent - 2 );
+    }
+
+    float * FrameBufferPool::acquire( size_t const rnElements )
+    {
+        unsigned const sizeClass = getSizeClass( rnElements * sizeof( float ) );
+        size_t const nBytes = getSizeClassBytes( sizeClass );
+        assert( sizeClass < nSizeClasses );
+
+        void * memory = NULL;
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            auto & freeList = mFree[ sizeClass ];
+            if ( not freeList.empty() )
+            {
+                memory = freeList.back();
+                freeList.pop_back();
+                mStatistics.nCached      -= 1;
+                mStatistics.nCachedBytes -= nBytes;
+                mStatistics.nReused      += 1;
+            }
+            else
+                mStatistics.nAllocated   += 1;
+            mStatistics.nLive      += 1;
+            mStatistics.nLiveBytes += nBytes;
+        }
+
+        if ( memory == NULL and
+             posix_memalign( &memory, frameBufferAlignment,
+                             frameBufferAlignment + nBytes ) != 0 )
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mStatistics.nAllocated -= 1;
+            mStatistics.nLive      -= 1;
+            mStatistics.nLiveBytes -= nBytes;
+            return NULL;
+        }
+
+        FrameHeader * const header = new( memory ) FrameHeader;
+        header->pool      = this;
+        header->nElements = rnElements;
+        header->sizeClass = sizeClass;
+        header->nReferences.store( 1, std::memory_order_relaxed );
+        return reinterpret_cast<float*>( static_cast<char*>( memory )
+                                         + frameBufferAlignment );
+    }
+
+    void FrameBufferPool::release( float * const rBuffer )
+    {
+        FrameHeader * const header = getHeader( rBuffer );
+        assert( header->pool == this );
+        size_t const nBytes = getSizeClassBytes( header->sizeClass );
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mStatistics.nLive      -= 1;
+            mStatistics.nLiveBytes -= nBytes;
+            if ( mStatistics.nCachedBytes + nBytes <= mnMaxCachedBytes )
+            {
+                mFree[ header->sizeClass ].push_back( header );
+                mStatistics.nCached      += 1;
+                mStatistics.nCachedBytes += nBytes;
+                return;
+            }
+        }
+        header->~FrameHeader();
+        free( header );
+    }
+
+    void FrameBufferPool::trim( void )
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        for ( auto & freeList : mFree )
+        {
+            for ( void * const memory : freeList )
+            {
+                static_cast<FrameHeader*>( memory )->~FrameHeader();
+                free( memory );
+            }
+            freeList.clear();
+        }
+        mStatistics.nCached      = 0;
+        mStatistics.nCachedBytes = 0;
+    }
+
+    FrameBufferPoolStatistics FrameBufferPool::getStatistics( void ) const
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        return mStatistics;
+    }
+
+
+    FrameBufferPool & getFrameBufferPool( void )
+    {
+        /* never destroyed, because buffers may still be released by other
+         * static objects or detached threads at exit */
+        static FrameBufferPool * const pool = new FrameBufferPool;
+        return *pool;
+    }
+
+    float * allocateFrame( size_t const rnElements )
+    {
+        return getFrameBufferPool().acquire( rnElements );
+    }
+
+    void retainFrame( float * const rBuffer )
+    {
+        assert( rBuffer != NULL );
+        getHeader( rBuffer )->nReferences.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    void freeFrame( float * const rBuffer )
+    {
+        if ( rBuffer == NULL )
+            return;
+        FrameHeader * const header = getHeader( rBuffer );
+        assert( header->nReferences.load() > 0 );
+        if ( header->nReferences.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+            header->pool->release( rBuffer );
+    }
+
+    size_t getFrameElements( float const * const rBuffer )
+    {
+        return getHeader( rBuffer )->nElements;
+    }
+
+    unsigned getFrameUseCount( float const * const rBuffer )
+    {
+        return getHeader( rBuffer )->nReferences.load( std::memory_order_relaxed );
+    }
+
+
+    FrameBuffer::FrameBuffer( void )
+    : mpData( NULL )
+    {}
+
+    FrameBuffer::FrameBuffer
+    (
+        size_t const rnElements,
+        FrameBufferPool & rPool
+    )
+    : mpData( rPool.acquire( rnElements ) )
+    {}
+
+    FrameBuffer::FrameBuffer( FrameBuffer const & rOther )
+    : mpData( rOther.mpData )
+    {
+        if ( mpData != NULL )
+            retainFrame( mpData );
+    }
+
+    FrameBuffer::FrameBuffer( FrameBuffer && rOther )
+    : mpData( rOther.mpData )
+    {
+        rOther.mpData = NULL;
+    }
+
+    FrameBuffer & FrameBuffer::operator=( FrameBuffer rOther )
+    {
+        std::swap( mpData, rOther.mpData );
+        return *this;
+    }
+
+    FrameBuffer::~FrameBuffer()
+    {
+        freeFrame( mpData );
+    }
+
+    FrameBuffer FrameBuffer::adopt( float * const rBuffer )
+    {
+        return FrameBuffer( rBuffer );
+    }
+
+    FrameBuffer FrameBuffer::share( float * const rBuffer )
+    {
+        if ( rBuffer != NULL )
+            retainFrame( rBuffer );
+        return FrameBuffer( rBuffer );
+    }
+
+    float * FrameBuffer::release( void )
+    {
+        float * const buffer = mpData;
+        mpData = NULL;
+        return buffer;
+    }
+
+    void FrameBuffer::reset( void )
+    {
+        freeFrame( mpData );
+        mpData = NULL;
+    }
+
+    size_t FrameBuffer::size( void ) const
+    {
+        return mpData == NULL ? 0 : getFrameElements( mpData );
+    }
+
+    unsigned FrameBuffer::useCount( void ) const
+    {
+        return mpData == NULL ? 0 : getFrameUseCount( mpData );
+    }
+
+
+} // namespace libs
+} // namespace imresh
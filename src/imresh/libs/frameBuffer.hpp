@@ -0,0 +1,218 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>               // std::atomic
+#include <cstddef>              // size_t
+#include <cstdint>              // uint64_t
+#include <mutex>                // std::mutex
+#include <vector>               // std::vector
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    /**
+     * Alignment of all frame buffers in bytes. Enough for AVX-512 and for
+     * FFTW to use its SIMD kernels on the buffers directly.
+     **/
+    constexpr size_t frameBufferAlignment = 64;
+
+    struct FrameBufferPoolStatistics
+    {
+        /** buffers which had to be newly allocated */
+        uint64_t nAllocated;
+        /** buffers which were taken from the free lists */
+        uint64_t nReused;
+        /** buffers currently handed out and their capacity in bytes */
+        uint64_t nLive;
+        uint64_t nLiveBytes;
+        /** free buffers kept for reuse and their capacity in bytes */
+        uint64_t nCached;
+        uint64_t nCachedBytes;
+    };
+
+    /**
+     * Allocates aligned float buffers for images and keeps released ones for
+     * reuse instead of freeing them.
+     *
+     * Requests are rounded up to size classes, four per power of two, so
+     * that a buffer can be reused for any image of nearly the same size
+     * while wasting at most 25% of memory. Every buffer is preceded by a
+     * header holding its size class, a reference count and the pool it
+     * belongs to, meaning a buffer can be released given only its pointer,
+     * see freeFrame. Thread-safe.
+     *
+     * A pool must outlive all of its buffers. Normally the process-wide pool
+     * returned by getFrameBufferPool is used, which is never destroyed.
+     **/
+    class FrameBufferPool
+    {
+    public:
+        /**
+         * @param rnMaxCachedBytes released buffers which would exceed this
+         *        are freed instead of kept
+         **/
+        explicit FrameBufferPool( size_t rnMaxCachedBytes = size_t( 512 ) << 20 );
+        ~FrameBufferPool();
+
+        FrameBufferPool( FrameBufferPool const & ) = delete;
+        FrameBufferPool & operator=( FrameBufferPool const & ) = delete;
+
+        /**
+         * Returns a buffer for at least rnElements floats with a reference
+         * count of 1 or NULL if out of memory.
+         **/
+        float * acquire( size_t rnElements );
+        /**
+         * Frees all cached buffers
+         **/
+        void trim( void );
+
+        FrameBufferPoolStatistics getStatistics( void ) const;
+
+        /**
+         * Returns the size class index of a buffer of rnBytes bytes
+         **/
+        static unsigned getSizeClass( size_t rnBytes );
+        /**
+         * Returns the capacity in bytes of buffers in size class rIndex
+         **/
+        static size_t getSizeClassBytes( unsigned rIndex );
+
+    private:
+        friend void freeFrame( float * );
+
+        void release( float * rBuffer );
+
+        size_t const mnMaxCachedBytes;
+        mutable std::mutex mMutex;
+        /**
+         * free buffers by size class
+         **/
+        std::vector< std::vector<void*> > mFree;
+        FrameBufferPoolStatistics mStatistics;
+    };
+
+    /**
+     * Returns the process-wide pool used by the readers, the frame streams,
+     * the writers and the reconstruction engines.
+     **/
+    FrameBufferPool & getFrameBufferPool( void );
+
+    /**
+     * Shorthand for getFrameBufferPool().acquire( rnElements ).
+     *
+     * This is how all images handed out by the library are allocated. They
+     * can be passed as they are to addTask and have to be released with
+     * freeFrame, e.g. with writeOutFuncs::justFree as the last write out
+     * function, not with delete[] or free.
+     **/
+    float * allocateFrame( size_t rnElements );
+    /**
+     * Adds a reference to a buffer returned by allocateFrame or
+     * FrameBufferPool::acquire
+     **/
+    void retainFrame( float * rBuffer );
+    /**
+     * Removes a reference and returns the buffer to its pool when the last
+     * one is gone. Does nothing for NULL.
+     **/
+    void freeFrame( float * rBuffer );
+    /**
+     * Returns the number of elements the buffer was acquired for
+     **/
+    size_t getFrameElements( float const * rBuffer );
+    /**
+     * Returns the number of references to the buffer
+     **/
+    unsigned getFrameUseCount( float const * rBuffer );
+
+    /**
+     * Reference-counted handle to a frame buffer for code holding images in
+     * containers or sharing them between threads. Copies share the buffer,
+     * which is returned to its pool when the last copy is destroyed.
+     *
+     * Usage with the raw pointer interfaces, e.g. addTask:
+     *   FrameBuffer frame( nx * ny );
+     *   ...
+     *   addTask( frame.data(), size, writeOutFuncs::justFree, name );
+     *   frame.release();   // the reference is now owned by the task
+     **/
+    class FrameBuffer
+    {
+    public:
+        FrameBuffer( void );
+        explicit FrameBuffer
+        (
+            size_t rnElements,
+            FrameBufferPool & rPool = getFrameBufferPool()
+        );
+        FrameBuffer( FrameBuffer const & rOther );
+        FrameBuffer( FrameBuffer && rOther );
+        FrameBuffer & operator=( FrameBuffer rOther );
+        ~FrameBuffer();
+
+        /**
+         * Takes over a reference of a buffer returned by allocateFrame,
+         * FrameBufferPool::acquire or release, without adding one
+         **/
+        static FrameBuffer adopt( float * rBuffer );
+        /**
+         * Adds a reference to the buffer of e.g. a write out function which
+         * isn't the last user of it
+         **/
+        static FrameBuffer share( float * rBuffer );
+
+        /**
+         * Gives up the handle's reference without decrementing it, so that
+         * it has to be freed with freeFrame by whoever the pointer is handed
+         * to. The handle is empty afterwards.
+         **/
+        float * release( void );
+        /**
+         * Drops the reference, the handle is empty afterwards
+         **/
+        void reset( void );
+
+        float * data( void ) const { return mpData; }
+        /**
+         * number of elements the buffer was acquired for, 0 if empty
+         **/
+        size_t size( void ) const;
+        unsigned useCount( void ) const;
+        explicit operator bool( void ) const { return mpData != NULL; }
+
+    private:
+        explicit FrameBuffer( float * rpData ) : mpData( rpData ) {}
+
+        float * mpData;
+    };
+
+
+} // namespace libs
+} // namespace imresh
@@ -0,0 +1,148 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "hash.hpp"
+
+#include <cstring>              // memcpy
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    namespace
+    {
+        uint64_t const prime1 = 0x9E3779B185EBCA87ull;
+        uint64_t const prime2 = 0xC2B2AE3D27D4EB4Full;
+        uint64_t const prime3 = 0x165667B19E3779F9ull;
+        uint64_t const prime4 = 0x85EBCA77C2B2AE63ull;
+        uint64_t const prime5 = 0x27D4EB2F165667C5ull;
+
+        inline uint64_t rotateLeft( uint64_t const x, unsigned const r )
+        {
+            return ( x << r ) | ( x >> ( 64 - r ) );
+        }
+
+        /* memcpy is used for unaligned reads, compilers turn it into a
+         * single load */
+        inline uint64_t read64( unsigned char const * const p )
+        {
+            uint64_t x;
+            memcpy( &x, p, sizeof(x) );
+            return x;
+        }
+
+        inline uint32_t read32( unsigned char const * const p )
+        {
+            uint32_t x;
+            memcpy( &x, p, sizeof(x) );
+            return x;
+        }
+
+        inline uint64_t round( uint64_t acc, uint64_t const input )
+        {
+            acc += input * prime2;
+            acc  = rotateLeft( acc, 31 );
+            return acc * prime1;
+        }
+
+        inline uint64_t mergeRound( uint64_t acc, uint64_t const value )
+        {
+            acc ^= round( 0, value );
+            return acc * prime1 + prime4;
+        }
+    }
+
+
+    uint64_t hash64
+    (
+        void const * const rpData,
+        size_t const rnBytes,
+        uint64_t const rSeed
+    )
+    {
+        auto p = (unsigned char const *) rpData;
+        auto const pEnd = p + rnBytes;
+        uint64_t h;
+
+        if ( rnBytes >= 32 )
+        {
+            uint64_t v1 = rSeed + prime1 + prime2;
+            uint64_t v2 = rSeed + prime2;
+            uint64_t v3 = rSeed;
+            uint64_t v4 = rSeed - prime1;
+            auto const pLimit = pEnd - 32;
+            do
+            {
+                v1 = round( v1, read64( p      ) );
+                v2 = round( v2, read64( p +  8 ) );
+                v3 = round( v3, read64( p + 16 ) );
+                v4 = round( v4, read64( p + 24 ) );
+                p += 32;
+            }
+            while ( p <= pLimit );
+
+            h = rotateLeft( v1, 1 ) + rotateLeft( v2, 7 ) +
+                rotateLeft( v3, 12 ) + rotateLeft( v4, 18 );
+            h = mergeRound( h, v1 );
+            h = mergeRound( h, v2 );
+            h = mergeRound( h, v3 );
+            h = mergeRound( h, v4 );
+        }
+        else
+            h = rSeed + prime5;
+
+        h += (uint64_t) rnBytes;
+
+        for ( ; p + 8 <= pEnd; p += 8 )
+        {
+            h ^= round( 0, read64( p ) );
+            h  = rotateLeft( h, 27 ) * prime1 + prime4;
+        }
+        if ( p + 4 <= pEnd )
+        {
+            h ^= (uint64_t) read32( p ) * prime1;
+            h  = rotateLeft( h, 23 ) * prime2 + prime3;
+            p += 4;
+        }
+        for ( ; p < pEnd; ++p )
+        {
+            h ^= (*p) * prime5;
+            h  = rotateLeft( h, 11 ) * prime1;
+        }
+
+        /* avalanche */
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+
+} // namespace libs
+} // namespace imresh
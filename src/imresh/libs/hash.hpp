@@ -0,0 +1,57 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>              // size_t
+#include <cstdint>              // uint64_t
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    /**
+     * Calculates a 64-bit hash of arbitrary memory.
+     *
+     * The algorithm follows xxHash64, meaning it works on four independent
+     * 64-bit lanes per 32 byte stripe and achieves a throughput near the
+     * memory bandwidth. It is not meant for cryptographic purposes.
+     *
+     * @param[in] rpData memory to hash
+     * @param[in] rnBytes number of bytes to hash
+     * @param[in] rSeed can be used to chain hashes of several memory areas
+     **/
+    uint64_t hash64
+    (
+        void const * const rpData,
+        size_t const rnBytes,
+        uint64_t const rSeed = 0
+    );
+
+
+} // namespace libs
+} // namespace imresh
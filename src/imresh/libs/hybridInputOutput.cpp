@@ -34,9 +34,11 @@
 #include <cassert>
 #include <cfloat>     // FLT_EPSILON
 #include <iostream>
+#include <mutex>      // std::unique_lock
 #include <vector>
 #include <omp.h>      // omp_get_num_procs, omp_set_num_procs
 #include <fftw3.h>
+#include "libs/fftwPlannerMutex.hpp" // getFftwPlannerMutex
 #include "libs/vectorIndex.hpp"
 
 
@@ -163,10 +165,14 @@ namespace libs
         }
 
         /* create and execute fftw plan */
+        std::unique_lock<std::mutex> plannerLock( getFftwPlannerMutex() );
         fftwf_plan planForward = fftwf_plan_dft( rSize.size(), (int*) &rSize[0],
             tmpRandReal, tmpRandReal, FFTW_FORWARD, FFTW_ESTIMATE );
+        plannerLock.unlock();
         fftwf_execute(planForward);
+        plannerLock.lock();
         fftwf_destroy_plan(planForward);
+        plannerLock.unlock();
 
         /* applies phases of fourier transformed real random field to
          * measured input intensity */
@@ -219,10 +225,12 @@ namespace libs
         fftwf_complex * gPrevious = fftwf_alloc_complex( Nx*Ny );
 
         /* create fft plans G' to g' and g to G */
+        std::unique_lock<std::mutex> plannerLock( getFftwPlannerMutex() );
         fftwf_plan toRealSpace = fftwf_plan_dft( rSize.size(),
             (int*) &rSize[0], curData, curData, FFTW_BACKWARD, FFTW_ESTIMATE );
         fftwf_plan toFreqSpace = fftwf_plan_dft( rSize.size(),
             (int*) &rSize[0], curData, curData, FFTW_FORWARD, FFTW_ESTIMATE );
+        plannerLock.unlock();
 
         /* copy intensity and add random phase */
         addRandomPhase( rIoData, curData, rSize, nElements );
@@ -282,8 +290,10 @@ namespace libs
             rIoData[i] = curData[i][0];
 
         /* free buffers and plans */
+        plannerLock.lock();
         fftwf_destroy_plan( toFreqSpace );
         fftwf_destroy_plan( toRealSpace );
+        plannerLock.unlock();
         fftwf_free( curData );
         fftwf_free( gPrevious );
 
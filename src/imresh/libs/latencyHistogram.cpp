@@ -0,0 +1,143 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "latencyHistogram.hpp"
+
+#include <cassert>
+#include <cmath>                // ceil
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    constexpr unsigned LatencyHistogram::mnSubBucketBits;
+    constexpr unsigned LatencyHistogram::mnSubBuckets;
+    constexpr unsigned LatencyHistogram::mnHalfBuckets;
+    constexpr unsigned LatencyHistogram::mnBuckets;
+
+
+    LatencyHistogram::LatencyHistogram( void )
+    {
+        reset();
+    }
+
+    unsigned LatencyHistogram::getBucketIndex( uint64_t rValue )
+    {
+        if ( rValue < mnSubBuckets )
+            return rValue;
+        /* position of the most significant bit */
+        unsigned const iMsb = 63 - __builtin_clzll( rValue );
+        /* after shifting, rValue lies in [mnHalfBuckets,mnSubBuckets) */
+        unsigned const shift = iMsb - ( mnSubBucketBits - 1 );
+        return mnSubBuckets + ( shift - 1 ) * mnHalfBuckets
+               + ( rValue >> shift ) - mnHalfBuckets;
+    }
+
+    uint64_t LatencyHistogram::getBucketUpperBound( unsigned rIndex )
+    {
+        assert( rIndex < mnBuckets );
+        if ( rIndex < mnSubBuckets )
+            return rIndex;
+        unsigned const shift    = ( rIndex - mnSubBuckets ) / mnHalfBuckets + 1;
+        uint64_t const mantissa = ( rIndex - mnSubBuckets ) % mnHalfBuckets
+                                  + mnHalfBuckets;
+        /* written like this to not overflow for the last bucket */
+        return ( mantissa << shift ) + ( ( uint64_t(1) << shift ) - 1 );
+    }
+
+    void LatencyHistogram::record( uint64_t rValue )
+    {
+        mCounts[ getBucketIndex( rValue ) ].fetch_add( 1, std::memory_order_relaxed );
+        mCount.fetch_add( 1, std::memory_order_relaxed );
+        mSum.fetch_add( rValue, std::memory_order_relaxed );
+
+        uint64_t oldMax = mMax.load( std::memory_order_relaxed );
+        while ( rValue > oldMax and not mMax.compare_exchange_weak(
+                oldMax, rValue, std::memory_order_relaxed ) ) {}
+    }
+
+    void LatencyHistogram::reset( void )
+    {
+        for ( unsigned i = 0; i < mnBuckets; ++i )
+            mCounts[i].store( 0, std::memory_order_relaxed );
+        mCount.store( 0, std::memory_order_relaxed );
+        mSum  .store( 0, std::memory_order_relaxed );
+        mMax  .store( 0, std::memory_order_relaxed );
+    }
+
+    uint64_t LatencyHistogram::getCount( void ) const
+    {
+        return mCount.load( std::memory_order_relaxed );
+    }
+
+    uint64_t LatencyHistogram::getMax( void ) const
+    {
+        return mMax.load( std::memory_order_relaxed );
+    }
+
+    double LatencyHistogram::getMean( void ) const
+    {
+        uint64_t const count = getCount();
+        if ( count == 0 )
+            return 0;
+        return (double) mSum.load( std::memory_order_relaxed ) / count;
+    }
+
+    uint64_t LatencyHistogram::getPercentile( double rPercentile ) const
+    {
+        assert( rPercentile >= 0 and rPercentile <= 100 );
+
+        /* sum up the buckets instead of using mCount, so that the result is
+         * consistent even if values are recorded concurrently */
+        uint64_t total = 0;
+        for ( unsigned i = 0; i < mnBuckets; ++i )
+            total += mCounts[i].load( std::memory_order_relaxed );
+        if ( total == 0 )
+            return 0;
+
+        uint64_t rank = (uint64_t) ceil( rPercentile / 100.0 * total );
+        if ( rank == 0 )
+            rank = 1;
+
+        uint64_t cumulated = 0;
+        for ( unsigned i = 0; i < mnBuckets; ++i )
+        {
+            cumulated += mCounts[i].load( std::memory_order_relaxed );
+            if ( cumulated >= rank )
+            {
+                /* the bucket bound may be larger than any recorded value */
+                uint64_t const bound = getBucketUpperBound(i);
+                uint64_t const max   = getMax();
+                return bound < max ? bound : max;
+            }
+        }
+        return getMax();
+    }
+
+
+} // namespace libs
+} // namespace imresh
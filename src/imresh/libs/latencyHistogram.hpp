@@ -0,0 +1,90 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>               // std::atomic
+#include <cstdint>              // uint64_t
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    /**
+     * Lock-free histogram for durations, e.g. in nanoseconds, with a constant
+     * relative resolution like the HDR histogram.
+     *
+     * Values smaller than 2^mnSubBucketBits are counted exactly. Every
+     * larger power of two interval [2^k,2^(k+1)) is divided into
+     * 2^(mnSubBucketBits-1) equally sized buckets, meaning the relative error
+     * of percentiles is at most 2^-(mnSubBucketBits-1) ~ 3%, while all
+     * uint64_t values fit into less than 2000 buckets.
+     *
+     * record can be called from any number of threads concurrently. Readers
+     * may see a slightly inconsistent state while values are being recorded,
+     * which is fine for monitoring purposes.
+     **/
+    class LatencyHistogram
+    {
+    public:
+        static constexpr unsigned mnSubBucketBits = 6;
+        static constexpr unsigned mnSubBuckets    = 1u << mnSubBucketBits;
+        static constexpr unsigned mnHalfBuckets   = mnSubBuckets / 2;
+        static constexpr unsigned mnBuckets       = mnSubBuckets +
+                                    ( 64 - mnSubBucketBits ) * mnHalfBuckets;
+
+        LatencyHistogram( void );
+
+        void record( uint64_t rValue );
+        void reset( void );
+
+        uint64_t getCount( void ) const;
+        uint64_t getMax  ( void ) const;
+        double   getMean ( void ) const;
+        /**
+         * @param[in] rPercentile in [0,100], e.g. 50 for the median
+         * @return upper bound of the bucket containing the requested
+         *         percentile or 0 if nothing was recorded yet
+         **/
+        uint64_t getPercentile( double rPercentile ) const;
+
+        static unsigned getBucketIndex( uint64_t rValue );
+        /**
+         * Returns the largest value which is sorted into bucket rIndex
+         **/
+        static uint64_t getBucketUpperBound( unsigned rIndex );
+
+    private:
+        std::atomic<uint64_t> mCounts[ mnBuckets ];
+        std::atomic<uint64_t> mCount;
+        std::atomic<uint64_t> mSum;
+        std::atomic<uint64_t> mMax;
+    };
+
+
+} // namespace libs
+} // namespace imresh
@@ -0,0 +1,190 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "threadAffinity.hpp"
+
+#include <algorithm>            // std::transform, std::max
+#include <cctype>               // tolower
+#include <cstdint>              // uintptr_t
+#include <cstring>              // memset
+#include <fstream>              // std::ifstream
+#include <sstream>              // std::istringstream
+#include <string>               // std::string, std::stoi
+#include <vector>               // std::vector
+#include <pthread.h>            // pthread_setaffinity_np
+#include <sched.h>              // cpu_set_t, CPU_SET
+#include <sys/syscall.h>        // SYS_move_pages
+#include <unistd.h>             // syscall, sysconf
+#ifdef IMRESH_DEBUG
+#   include <iostream>          // std::cout, std::endl
+#endif
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    namespace
+    {
+        /**
+         * Parses lists like "0-3,8,10-11" as used in /sys into {0,1,2,3,8,10,11}
+         */
+        std::vector<int> parseCpuList( std::string const & rList )
+        {
+            std::vector<int> ids;
+            std::istringstream stream( rList );
+            std::string range;
+            while ( std::getline( stream, range, ',' ) )
+            {
+                if ( range.empty() or not std::isdigit( range[0] ) )
+                    continue;
+                auto const iDash = range.find( '-' );
+                int const first = std::stoi( range.substr( 0, iDash ) );
+                int const last  = iDash == std::string::npos ? first
+                                : std::stoi( range.substr( iDash+1 ) );
+                for ( int i = first; i <= last; ++i )
+                    ids.push_back( i );
+            }
+            return ids;
+        }
+
+        /**
+         * Returns the first line of a (sysfs) file or an empty string on error.
+         */
+        std::string readFirstLine( std::string const & rFilename )
+        {
+            std::ifstream file( rFilename );
+            std::string line;
+            if ( file.is_open() )
+                std::getline( file, line );
+            return line;
+        }
+    } // anonymous namespace
+
+
+    int getNumaNodeCount( void )
+    {
+        auto const nodes = parseCpuList(
+            readFirstLine( "/sys/devices/system/node/online" ) );
+        if ( nodes.empty() )
+            return 1;
+        return *std::max_element( nodes.begin(), nodes.end() ) + 1;
+    }
+
+    std::vector<int> getNumaNodeCpus( int rNode )
+    {
+        std::vector<int> cpus;
+        if ( rNode >= 0 )
+        {
+            cpus = parseCpuList( readFirstLine( "/sys/devices/system/node/node"
+                                 + std::to_string( rNode ) + "/cpulist" ) );
+        }
+        if ( cpus.empty() )
+        {
+            long const nCpus = sysconf( _SC_NPROCESSORS_ONLN );
+            for ( long i = 0; i < nCpus; ++i )
+                cpus.push_back( i );
+        }
+        return cpus;
+    }
+
+    int getNumaNodeOfPciDevice( std::string const & rPciBusId )
+    {
+        std::string busId = rPciBusId;
+        std::transform( busId.begin(), busId.end(), busId.begin(), ::tolower );
+        auto const line = readFirstLine( "/sys/bus/pci/devices/" + busId + "/numa_node" );
+        if ( line.empty() )
+            return -1;
+        /* the kernel writes -1 if the device isn't associated to a node */
+        return std::stoi( line );
+    }
+
+    int getNumaNodeOfAddress( void const * rpAddress )
+    {
+#       ifdef SYS_move_pages
+            if ( rpAddress == NULL )
+                return -1;
+            static long const pageSize = sysconf( _SC_PAGESIZE );
+            void * page = (void*)( (uintptr_t) rpAddress & ~( (uintptr_t) pageSize - 1 ) );
+            int status = -1;
+            /* move_pages with nodes == NULL only queries the node of each
+             * page without moving anything */
+            if ( syscall( SYS_move_pages, 0, 1, &page, NULL, &status, 0 ) != 0 )
+                return -1;
+            return status >= 0 ? status : -1;
+#       else
+            return -1;
+#       endif
+    }
+
+    bool pinThreadToNumaNode( int rNode )
+    {
+        if ( rNode < 0 )
+            return false;
+
+        cpu_set_t cpuSet;
+        CPU_ZERO( &cpuSet );
+        for ( auto const & cpu : getNumaNodeCpus( rNode ) )
+        {
+            /* the IDs come from sysfs and may exceed the fixed size set */
+            if ( cpu >= 0 and cpu < CPU_SETSIZE )
+                CPU_SET( cpu, &cpuSet );
+        }
+
+        int const error = pthread_setaffinity_np( pthread_self(), sizeof( cpuSet ), &cpuSet );
+#       ifdef IMRESH_DEBUG
+            if ( error != 0 )
+            {
+                std::cout << "[Warning] imresh::libs::pinThreadToNumaNode(): "
+                          << "Couldn't pin thread to NUMA node " << rNode
+                          << std::endl;
+            }
+#       endif
+        return error == 0;
+    }
+
+    void firstTouch
+    (
+        void * const & rpData,
+        size_t const & rnBytes
+    )
+    {
+        char * const data = (char*) rpData;
+        /* one chunk per page, so that every page is touched by exactly one
+         * thread of the team */
+        size_t const chunkSize = 4096;
+        size_t const nChunks = ( rnBytes + chunkSize - 1 ) / chunkSize;
+        #pragma omp parallel for schedule( static )
+        for ( size_t i = 0; i < nChunks; ++i )
+        {
+            size_t const offset = i * chunkSize;
+            memset( data + offset, 0, std::min( chunkSize, rnBytes - offset ) );
+        }
+    }
+
+
+} // namespace libs
+} // namespace imresh
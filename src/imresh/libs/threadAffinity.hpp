@@ -0,0 +1,102 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>              // size_t
+#include <string>               // std::string
+#include <vector>               // std::vector
+
+
+namespace imresh
+{
+namespace libs
+{
+
+
+    /**
+     * Returns the number of NUMA nodes of this machine.
+     *
+     * The information is read from /sys/devices/system/node. If that isn't
+     * available, e.g. on a kernel without NUMA support, the whole machine is
+     * treated as one node, i.e. 1 is returned.
+     */
+    int getNumaNodeCount( void );
+
+    /**
+     * Returns the IDs of all CPUs (as used by sched_setaffinity) which belong
+     * to the given NUMA node.
+     *
+     * @param[in] rNode NUMA node to query. If it is negative or the node
+     *            information is not available all online CPUs are returned.
+     */
+    std::vector<int> getNumaNodeCpus( int rNode );
+
+    /**
+     * Returns the NUMA node a PCI device, e.g. a GPU, is attached to.
+     *
+     * @param[in] rPciBusId PCI bus ID as returned by cudaDeviceGetPCIBusId,
+     *            e.g. "0000:03:00.0". Case doesn't matter.
+     * @return NUMA node or -1 if it couldn't be determined
+     */
+    int getNumaNodeOfPciDevice( std::string const & rPciBusId );
+
+    /**
+     * Returns the NUMA node on which the page containing rpAddress resides.
+     *
+     * Note that pages are only assigned to a node on first touch, so for
+     * freshly allocated and not yet written memory -1 is returned.
+     *
+     * @return NUMA node or -1 if it couldn't be determined
+     */
+    int getNumaNodeOfAddress( void const * rpAddress );
+
+    /**
+     * Pins the calling thread to the CPUs of the given NUMA node.
+     *
+     * Threads created afterwards by the calling thread, e.g. the OpenMP team
+     * spawned in its first parallel region, inherit this affinity mask.
+     *
+     * @param[in] rNode NUMA node to pin to. If negative nothing is done.
+     * @return true if the affinity mask could be set
+     */
+    bool pinThreadToNumaNode( int rNode );
+
+    /**
+     * Writes 0 to all bytes using a static OpenMP schedule, i.e. the same
+     * partitioning the elementwise loops of the algorithms use.
+     *
+     * Linux places a page on the node of the thread which first writes to
+     * it, so calling this right after allocating a buffer with new or
+     * fftwf_alloc makes every thread of a pinned OpenMP team work on local
+     * memory afterwards.
+     */
+    void firstTouch
+    (
+        void * const & rpData,
+        size_t const & rnBytes
+    );
+
+} // namespace libs
+} // namespace imresh
@@ -0,0 +1,120 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cassert>
+#include <cmath>        // M_PI, sqrt
+#include <cstddef>      // size_t
+#include <algorithm>    // std::equal, std::min
+#include "libs/frameBuffer.hpp"     // freeFrame
+#include "createTestData/createAtomCluster3d.hpp"
+#include "createTestData/createBox3d.hpp"
+#include "createTestData/createSphere3d.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    size_t countVoxels( float const * const rData, size_t const rnElements )
+    {
+        size_t count = 0;
+        for ( size_t i = 0; i < rnElements; ++i )
+            count += rData[i] != 0;
+        return count;
+    }
+
+    void testCreateTestData3d( void )
+    {
+        using namespace examples::createTestData;
+        using imresh::libs::freeFrame;
+
+        /* unrotated box: ( D*N +- 1 ) voxels per dimension, depending on
+         * whether the borders hit the voxel centers */
+        {
+            unsigned const Nx = 40, Ny = 32, Nz = 24;
+            float const Dx = 0.5, Dy = 0.25, Dz = 0.75;
+            float * const box = createBox3d( Nx, Ny, Nz, Dx, Dy, Dz );
+            size_t const count = countVoxels( box, size_t( Nx ) * Ny * Nz );
+            assert( count >= size_t( ( Dx*Nx - 1 ) * ( Dy*Ny - 1 ) * ( Dz*Nz - 1 ) ) );
+            assert( count <= size_t( ( Dx*Nx + 1 ) * ( Dy*Ny + 1 ) * ( Dz*Nz + 1 ) ) );
+            freeFrame( box );
+        }
+
+        /* spherical shell: set exactly between rInner and rOuter, apart
+         * from rounding at the borders */
+        {
+            unsigned const Nx = 48, Ny = 40, Nz = 32;
+            float const rOuter = 0.4, rInner = 0.25;
+            float * const shell = createSphere3d( Nx, Ny, Nz, rOuter, rInner );
+            unsigned const Nmin = std::min( Nx, std::min( Ny, Nz ) );
+            float const eps = 1e-3f;
+            for ( unsigned iz = 0; iz < Nz; ++iz )
+            for ( unsigned iy = 0; iy < Ny; ++iy )
+            for ( unsigned ix = 0; ix < Nx; ++ix )
+            {
+                float const x = (float) ix / Nmin - 0.5f;
+                float const y = (float) iy / Nmin - 0.5f;
+                float const z = (float) iz / Nmin - 0.5f;
+                float const r = std::sqrt( x*x + y*y + z*z );
+                float const value = shell[ ( size_t( iz ) * Ny + iy ) * Nx + ix ];
+                if ( r > rInner + eps and r < rOuter - eps )
+                    assert( value == 1 );
+                if ( r < rInner - eps or r > rOuter + eps )
+                    assert( value == 0 );
+            }
+            double const expected = 4./3 * M_PI * ( std::pow( rOuter, 3 ) -
+                std::pow( rInner, 3 ) ) * Nmin * Nmin * Nmin;
+            size_t const count = countVoxels( shell, size_t( Nx ) * Ny * Nz );
+            assert( std::abs( count - expected ) < 0.05 * expected );
+            freeFrame( shell );
+        }
+
+        /* atom clusters only depend on the seed */
+        {
+            unsigned const Nx = 32, Ny = 24, Nz = 40;
+            size_t const nElements = size_t( Nx ) * Ny * Nz;
+            float * const a = createAtomCluster3d( Nx, Ny, Nz, 50, 0, 7 );
+            float * const b = createAtomCluster3d( Nx, Ny, Nz, 50, 0, 7 );
+            float * const c = createAtomCluster3d( Nx, Ny, Nz, 50, 0, 8 );
+            assert( countVoxels( a, nElements ) > 0 );
+            assert( std::equal( a, a + nElements, b ) );
+            assert( not std::equal( a, a + nElements, c ) );
+            for ( size_t i = 0; i < nElements; ++i )
+                assert( 0 <= a[i] and a[i] <= 1 );
+            freeFrame( a );
+            freeFrame( b );
+            freeFrame( c );
+        }
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testCreateTestData3d();
+}
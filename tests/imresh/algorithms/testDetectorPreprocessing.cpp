@@ -0,0 +1,199 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <iostream>
+#include <cassert>
+#include <cmath>        // sqrt, fabs
+#include <cstdint>      // uint16_t
+#include <cstdio>       // std::remove
+#include <fstream>
+#include <string>
+#include <vector>
+#include "algorithms/detectorPreprocessing.hpp"
+#include "io/frameStream.hpp"
+#include "io/preprocessedFrameSource.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    bool isClose( float a, float b )
+    {
+        return std::fabs( a - b ) <= 1e-5f * std::max( 1.0f, std::fabs( b ) );
+    }
+
+    void testDetectorPreprocessing( void )
+    {
+        using namespace imresh::algorithms;
+
+        unsigned const nx = 6, ny = 4;
+        std::vector<uint16_t> raw( nx * ny );
+        for ( unsigned i = 0; i < raw.size(); ++i )
+            raw[i] = 100 + 10 * i;
+
+        DetectorCalibration calibration;
+        calibration.dark.assign( nx * ny, 100 );
+        calibration.gain.assign( nx * ny, 2 );
+        /* noise below the dark level is clipped */
+        calibration.dark[1] = 200;
+        /* a hot pixel, far above all other dark values */
+        calibration.dark[ 2*nx + 3 ] = 10000;
+        calibration.hotPixelSigma = 3;
+
+        /* unbinned, the hot pixel is interpolated from its neighbours */
+        {
+            DetectorPreprocessor const preprocessor( { nx, ny }, calibration );
+            assert( preprocessor.isValid() and preprocessor.getIgnoredCount() == 1 );
+            assert( preprocessor.getOutputSize() == std::make_pair( nx, ny ) );
+            std::vector<float> modulus( nx * ny );
+            preprocessor( raw.data(), modulus.data() );
+            for ( unsigned i = 0; i < raw.size(); ++i )
+            {
+                if ( i == 1 or i == 2*nx + 3 )
+                    continue;
+                assert( isClose( modulus[i], std::sqrt( 2.0f * ( raw[i] - 100 ) ) ) );
+            }
+            assert( modulus[1] == 0 );
+            unsigned const hot = 2*nx + 3;
+            float const mean = ( modulus[hot-1] + modulus[hot+1] +
+                                 modulus[hot-nx] + modulus[hot+nx] ) / 4;
+            assert( isClose( modulus[hot], mean ) );
+
+            /* all pixel types give the same result */
+            std::vector<float> rawFloat( raw.begin(), raw.end() );
+            std::vector<float> modulusFloat( nx * ny );
+            preprocessor( rawFloat.data(), modulusFloat.data() );
+            assert( modulusFloat == modulus );
+        }
+
+        /* 2x2 binning, the bin with the ignored pixel is scaled up */
+        {
+            calibration.dark[1] = 100;
+            calibration.binning = 2;
+            DetectorPreprocessor const preprocessor( { nx, ny }, calibration );
+            assert( preprocessor.getOutputSize() == std::make_pair( 3u, 2u ) );
+            std::vector<float> modulus( 3 * 2 );
+            preprocessor( raw.data(), modulus.data() );
+            for ( unsigned oy = 0; oy < 2; ++oy )
+            for ( unsigned ox = 0; ox < 3; ++ox )
+            {
+                float sum = 0;
+                unsigned nValid = 0;
+                for ( unsigned ky = 0; ky < 2; ++ky )
+                for ( unsigned kx = 0; kx < 2; ++kx )
+                {
+                    unsigned const i = ( 2*oy + ky ) * nx + 2*ox + kx;
+                    if ( i == 2*nx + 3 )
+                        continue;
+                    sum += 2.0f * ( raw[i] - 100 );
+                    ++nValid;
+                }
+                assert( isClose( modulus[ oy*3 + ox ], std::sqrt( sum * 4 / nValid ) ) );
+            }
+        }
+
+        /* the calibration has to match the frames */
+        calibration.binning = 1;
+        assert( not DetectorPreprocessor( { nx+1, ny }, calibration ).isValid() );
+        calibration.binning = 5;
+        assert( not DetectorPreprocessor( { nx, ny }, calibration ).isValid() );
+    }
+
+    void testPreprocessedFrameSource( void )
+    {
+        using namespace imresh::algorithms;
+        using namespace imresh::io;
+
+        /* uint16 stack of 3 frames, mapped and preprocessed in one pass */
+        unsigned const nx = 8, ny = 4, nFrames = 3;
+        std::vector<uint16_t> stack( nx * ny * nFrames );
+        for ( unsigned i = 0; i < stack.size(); ++i )
+            stack[i] = i;
+        std::string dictionary = "{'descr': '<u2', 'fortran_order': False, "
+                                 "'shape': (3, 4, 8), }";
+        while ( ( 10 + dictionary.size() + 1 ) % 16 != 0 )
+            dictionary += ' ';
+        dictionary += '\n';
+        std::string header = "\x93NUMPY";
+        header += char( 1 );
+        header += char( 0 );
+        header += char( dictionary.size() & 0xFF );
+        header += char( dictionary.size() >> 8 );
+        std::string const npy = "/tmp/testDetectorPreprocessing.npy";
+        {
+            std::ofstream file( npy, std::ios::binary );
+            file << header << dictionary;
+            file.write( reinterpret_cast<char const*>( stack.data() ),
+                        stack.size() * sizeof( stack[0] ) );
+        }
+
+        DetectorCalibration calibration;
+        calibration.binning = 2;
+        DetectorPreprocessor const preprocessor( { nx, ny }, calibration );
+        PreprocessedFrameSource source( openFrameSource( npy ), preprocessor );
+        assert( source.getFrameCount() == nFrames );
+        assert( source.getFrameSize( 0 ) == std::make_pair( nx/2, ny/2 ) );
+        assert( source.getMaxElements() == nx * ny / 4 );
+
+        std::vector<float> modulus( source.getMaxElements() );
+        assert( source.readFrame( 2, modulus.data() ) );
+        assert( source.getMappedCount() == 1 );
+        unsigned const offset = 2 * nx * ny;
+        float const bin = stack[ offset ] + stack[ offset + 1 ] +
+                          stack[ offset + nx ] + stack[ offset + nx + 1 ];
+        assert( isClose( modulus[0], std::sqrt( bin ) ) );
+        assert( not source.readFrame( nFrames, modulus.data() ) );
+
+        /* other sources are read into a scratch buffer first */
+        std::string const txt = "/tmp/testDetectorPreprocessing.txt";
+        {
+            std::ofstream file( txt );
+            for ( unsigned iy = 0; iy < ny; ++iy )
+            {
+                for ( unsigned ix = 0; ix < nx; ++ix )
+                    file << stack[ offset + iy * nx + ix ] << " ";
+                file << "\n";
+            }
+        }
+        PreprocessedFrameSource txtSource( openFrameSource( txt ), preprocessor );
+        std::vector<float> txtModulus( txtSource.getMaxElements() );
+        assert( txtSource.readFrame( 0, txtModulus.data() ) );
+        assert( txtSource.getMappedCount() == 0 and txtModulus == modulus );
+
+        std::remove( npy.c_str() );
+        std::remove( txt.c_str() );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testDetectorPreprocessing();
+    imresh::tests::testPreprocessedFrameSource();
+}
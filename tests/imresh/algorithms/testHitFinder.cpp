@@ -0,0 +1,156 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cassert>
+#include <vector>
+#include "algorithms/hitFinder.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void testHitFinder( void )
+    {
+        using namespace imresh::algorithms;
+
+        unsigned const nx = 32, ny = 32;
+        /* a blank frame: weak background and scatter at the center */
+        std::vector<float> blank( nx * ny, 0.1f );
+        blank[ ( ny / 2 ) * nx + nx / 2 ] = 50.0f;
+        /* a hit: additionally a ring of speckles at radius 10 */
+        std::vector<float> hit( blank );
+        for ( unsigned i = 0; i < 8; ++i )
+        {
+            unsigned const offsets[8][2] = { { 26, 16 }, { 6, 16 }, { 16, 26 },
+                { 16, 6 }, { 23, 23 }, { 9, 9 }, { 23, 9 }, { 9, 23 } };
+            hit[ offsets[i][1] * nx + offsets[i][0] ] = 20.0f;
+        }
+
+        /* all criteria disabled: everything is a hit. Every pixel is above
+         * the default peak threshold of 0. */
+        {
+            HitFinder const finder;
+            auto const score = finder.score( blank.data(), { nx, ny } );
+            assert( score.peakCount == nx * ny );
+            assert( score.maxValue == 50.0f );
+            assert( score.radialProfile.empty() and score.radialIntensity == 0 );
+            assert( finder( blank.data(), { nx, ny } ) );
+        }
+
+        HitFinderParameters parameters;
+        parameters.peakThreshold = 10.0f;
+
+        /* integrated intensity */
+        {
+            HitFinderParameters p = parameters;
+            p.minIntegratedIntensity = 200.0f;
+            HitFinder const finder( p );
+            auto const blankScore = finder.score( blank.data(), { nx, ny } );
+            auto const hitScore   = finder.score( hit.data(), { nx, ny } );
+            assert( blankScore.integratedIntensity < 200.0f );
+            assert( hitScore.integratedIntensity > 200.0f );
+            assert( not finder.isHit( blankScore ) and finder.isHit( hitScore ) );
+        }
+
+        /* peak count */
+        {
+            HitFinderParameters p = parameters;
+            p.minPeakCount = 5;
+            HitFinder const finder( p );
+            assert( finder.score( blank.data(), { nx, ny } ).peakCount == 1 );
+            assert( finder.score( hit.data(), { nx, ny } ).peakCount == 9 );
+            assert( not finder( blank.data(), { nx, ny } ) );
+            assert( finder( hit.data(), { nx, ny } ) );
+        }
+
+        /* radial profile: the central scatter is outside of the annulus */
+        {
+            HitFinderParameters p = parameters;
+            p.centered = true;
+            p.minRadius = 4;
+            p.nRadialBins = 12;
+            p.minRadialIntensity = 0.2f;
+            HitFinder const finder( p );
+            auto const blankScore = finder.score( blank.data(), { nx, ny } );
+            auto const hitScore   = finder.score( hit.data(), { nx, ny } );
+            assert( blankScore.radialProfile.size() == 12 );
+            for ( auto const & value : blankScore.radialProfile )
+                assert( value > 0.09f and value < 0.11f );
+            assert( blankScore.radialIntensity < 0.11f );
+            assert( hitScore.radialIntensity > 0.2f );
+            /* the speckles at radius 10 and ~9.9 fall into the bins
+             * [9,10) and [10,11) */
+            assert( hitScore.radialProfile[5] > 1.0f );
+            assert( hitScore.radialProfile[6] > 1.0f );
+            assert( hitScore.radialProfile[0] < 0.11f );
+            assert( not finder.isHit( blankScore ) and finder.isHit( hitScore ) );
+        }
+
+        /* radial profile in the unshifted layout: the same frames with the
+         * zero frequency moved to (0,0), i.e. the ring wraps around the edges */
+        {
+            std::vector<float> blankUnshifted( nx * ny ), hitUnshifted( nx * ny );
+            for ( unsigned iy = 0; iy < ny; ++iy )
+            for ( unsigned ix = 0; ix < nx; ++ix )
+            {
+                unsigned const iShifted = ( ( iy + ny/2 ) % ny ) * nx + ( ix + nx/2 ) % nx;
+                blankUnshifted[ iy * nx + ix ] = blank[ iShifted ];
+                hitUnshifted  [ iy * nx + ix ] = hit  [ iShifted ];
+            }
+            assert( blankUnshifted[0] == 50.0f );
+
+            HitFinderParameters p = parameters;
+            p.minRadius = 4;
+            p.nRadialBins = 12;
+            p.minRadialIntensity = 0.2f;
+            HitFinder const finder( p );
+            auto const blankScore = finder.score( blankUnshifted.data(), { nx, ny } );
+            auto const hitScore   = finder.score( hitUnshifted.data(), { nx, ny } );
+            for ( auto const & value : blankScore.radialProfile )
+                assert( value > 0.09f and value < 0.11f );
+            assert( hitScore.radialProfile[5] > 1.0f );
+            assert( hitScore.radialProfile[6] > 1.0f );
+            assert( hitScore.radialProfile[0] < 0.11f );
+            assert( not finder.isHit( blankScore ) and finder.isHit( hitScore ) );
+
+            /* treating the unshifted frame as centered misses the ring */
+            p.centered = true;
+            HitFinder const wrongLayout( p );
+            auto const wrongScore = wrongLayout.score( hitUnshifted.data(), { nx, ny } );
+            assert( wrongScore.radialProfile[5] < 0.11f );
+            assert( wrongScore.radialProfile[6] < 0.11f );
+        }
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testHitFinder();
+}
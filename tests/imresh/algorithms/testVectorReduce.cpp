@@ -64,6 +64,7 @@ namespace algorithms
         assert( vectorMin( pData, 1 ) == pData[0] );
         assert( vectorMax( pData, 1 ) == pData[0] );
         assert( vectorSum( pData, 1 ) == pData[0] );
+        assert( vectorMinMax( pData, 1 ) == std::make_pair( pData[0], pData[0] ) );
         assert( cudaVectorMin( dpData, 1 ) == pData[0] );
         assert( cudaVectorMax( dpData, 1 ) == pData[0] );
         assert( cudaVectorSum( dpData, 1 ) == pData[0] );
@@ -191,6 +192,28 @@ namespace algorithms
         }
 
 
+        /* NaN values are ignored by the fused minimum and maximum */
+        {
+            float const data[5] = { NAN, 2.0f, -1.0f, NAN, 0.5f };
+            float const * const values = data;
+            assert( vectorMinMax( values, 5 ) == std::make_pair( -1.0f, 2.0f ) );
+        }
+
+        /* fused sum, maximum and count above threshold */
+        {
+            float const data[6] = { 1.0f, 3.0f, -2.0f, 0.5f, 4.0f, 0.0f };
+            float const * const values = data;
+            auto const statistics = vectorStatistics( values, 6, 0.75f );
+            assert( statistics.sum == 6.5f );
+            assert( statistics.max == 4.0f );
+            assert( statistics.nAbove == 3 );
+            /* every second value */
+            auto const strided = vectorStatistics( values, 3, 0.75f, 2 );
+            assert( strided.sum == 3.0f );
+            assert( strided.max == 4.0f );
+            assert( strided.nAbove == 2 );
+        }
+
         //for ( unsigned nElements = 2; nElements
 
         CUDA_ERROR( cudaFree( dpData ) );
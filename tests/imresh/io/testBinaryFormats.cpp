@@ -0,0 +1,147 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>       // std::remove
+#include <cstring>      // memcpy
+#include <fstream>
+#include <string>
+#include <vector>
+#include "io/binaryFormats.hpp"
+#include "io/readInFuncs/readInFuncs.hpp"
+#include "io/writeOutFuncs/writeOutFuncs.hpp"
+#include "libs/frameBuffer.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    /**
+     * Writes a .npy file with the given header dictionary and data
+     */
+    void writeNpy( std::string const & rPath, std::string rDictionary, std::string const & rData )
+    {
+        rDictionary += '\n';
+        std::string header = "\x93NUMPY";
+        header += char( 1 );
+        header += char( 0 );
+        header += char( rDictionary.size() & 0xFF );
+        header += char( rDictionary.size() >> 8 );
+        std::ofstream file( rPath, std::ios::binary );
+        file << header << rDictionary << rData;
+    }
+
+    std::vector<float> readBack( std::string const & rPath )
+    {
+        auto const file = io::readInFuncs::readFile( rPath );
+        assert( file.first != NULL );
+        std::vector<float> values( file.first, file.first + file.second.first * file.second.second );
+        imresh::libs::freeFrame( file.first );
+        return values;
+    }
+
+    void testBinaryFormats( void )
+    {
+        using namespace imresh::io;
+
+        unsigned const nx = 37, ny = 21;
+        std::vector<float> image( nx * ny );
+        for ( unsigned i = 0; i < image.size(); ++i )
+            image[i] = 0.25f * i - 3;
+
+        /* round trip through both formats */
+        std::string const raw = "/tmp/testBinaryFormats.raw";
+        std::string const npy = "/tmp/testBinaryFormats.npy";
+        writeOutFuncs::writeOutRaw( image.data(), { nx, ny }, raw );
+        writeOutFuncs::writeOutNpy( image.data(), { nx, ny }, npy );
+        for ( auto const & path : { raw, npy } )
+        {
+            auto const file = readInFuncs::readFile( path );
+            assert( file.first != NULL );
+            assert( file.second.first == nx and file.second.second == ny );
+            assert( std::vector<float>( file.first, file.first + nx * ny ) == image );
+            imresh::libs::freeFrame( file.first );
+        }
+
+        /* the data of written .npy files is 64 byte aligned */
+        std::string const header = makeNpyHeader( nx, ny, 1 );
+        assert( header.size() % 64 == 0 );
+        BinaryLayout layout;
+        std::string const withData = header + std::string( sizeof( float ) * nx * ny, '\0' );
+        assert( parseNpyHeader( withData.data(), withData.size(), layout ) );
+        assert( layout.width == nx and layout.height == ny and layout.nFrames == 1 );
+        /* truncated files are rejected */
+        assert( not parseNpyHeader( withData.data(), withData.size() - 1, layout ) );
+
+        /* zero-copy mapping, changes don't reach the file */
+        {
+            MappedFrame frame( npy );
+            assert( frame.isOpen() and frame.isZeroCopy() );
+            assert( frame.getSize().first == nx and frame.getSize().second == ny );
+            assert( std::vector<float>( frame.getData(), frame.getData() + nx * ny ) == image );
+            frame.getData()[0] = 1000;
+        }
+        assert( readBack( npy ) == image );
+
+        /* other element types and byte orders are converted */
+        {
+            double const values[6] = { 1.5, -2, 3, 4, 5, 6 };
+            writeNpy( npy, "{'descr': '<f8', 'fortran_order': False, 'shape': (2, 3), }",
+                      std::string( reinterpret_cast<char const*>( values ), sizeof( values ) ) );
+            assert( readBack( npy ) == std::vector<float>( { 1.5f, -2, 3, 4, 5, 6 } ) );
+
+            /* big endian uint16, 3 frames of 1x2 */
+            std::string const data( "\x00\x01\x01\x00\x00\x02\x00\x03\x00\x04\x00\x05", 12 );
+            writeNpy( npy, "{'descr': '>u2', 'fortran_order': False, 'shape': (3, 1, 2), }", data );
+            assert( readBack( npy ) == std::vector<float>( { 1, 256 } ) );
+            MappedFrame frame( npy, 2 );
+            assert( frame.isOpen() and not frame.isZeroCopy() );
+            assert( frame.getData()[0] == 4 and frame.getData()[1] == 5 );
+            assert( not MappedFrame( npy, 3 ).isOpen() );
+
+            writeNpy( npy, "{'descr': '<f4', 'fortran_order': True, 'shape': (1, 1), }",
+                      std::string( 4, '\0' ) );
+            assert( readInFuncs::readFile( npy ).first == NULL );
+            writeNpy( npy, "{'descr': '<i4', 'fortran_order': False, 'shape': (1, 1), }",
+                      std::string( 4, '\0' ) );
+            assert( readInFuncs::readFile( npy ).first == NULL );
+        }
+
+        std::remove( raw.c_str() );
+        std::remove( npy.c_str() );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testBinaryFormats();
+}
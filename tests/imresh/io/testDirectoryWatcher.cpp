@@ -0,0 +1,142 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdio>       // std::rename
+#include <cstdlib>      // mkdtemp, system
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "io/directoryWatcher.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void writeFile( std::string const & rPath )
+    {
+        std::ofstream file( rPath );
+        file << "1 2\n3 4\n";
+    }
+
+    /**
+     * Waits at most a few seconds for a condition which depends on another
+     * thread.
+     */
+    template< class T_Predicate >
+    bool waitFor( T_Predicate rPredicate )
+    {
+        for ( int i = 0; i < 500 and not rPredicate(); ++i )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        return rPredicate();
+    }
+
+    void testDirectoryWatcher( void )
+    {
+        using namespace imresh::io;
+
+        char directoryTemplate[] = "/tmp/testDirectoryWatcher-XXXXXX";
+        std::string const directory = mkdtemp( directoryTemplate );
+
+        std::mutex mutex;
+        std::vector<std::string> files;
+        auto const onFile = [&]( std::string const & rPath )
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            files.push_back( rPath );
+        };
+        auto const nFiles = [&]
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            return files.size();
+        };
+
+        /* completed files and renames are reported, others are filtered */
+        {
+            DirectoryWatcher watcher( directory, onFile );
+            assert( watcher.isOpen() );
+            writeFile( directory + "/a.txt" );
+            writeFile( directory + "/.b.tmp" );
+            std::rename( ( directory + "/.b.tmp" ).c_str(),
+                         ( directory + "/b.txt" ).c_str() );
+            writeFile( directory + "/c.dat" );
+            assert( waitFor( [&]{ return nFiles() == 2; } ) );
+            assert( files[0] == directory + "/a.txt" );
+            assert( files[1] == directory + "/b.txt" );
+
+            DirectoryWatcherStatistics const statistics = watcher.getStatistics();
+            assert( statistics.nDetected == 2 );
+            assert( statistics.nHandled  == 2 );
+            assert( statistics.nDropped  == 0 );
+        }
+
+        /* a blocked callback makes the backlog overflow, the oldest files
+         * are dropped */
+        {
+            std::mutex blocked;
+            blocked.lock();
+            unsigned nCalls = 0;
+            DirectoryWatcher watcher( directory, [&]( std::string const & )
+            {
+                std::lock_guard<std::mutex> lock( blocked );
+                ++nCalls;
+            }, 4, []( std::string const & ){ return true; } );
+
+            for ( int i = 0; i < 20; ++i )
+                writeFile( directory + "/burst" + std::to_string( i ) );
+            assert( waitFor( [&]{ return watcher.getStatistics().nDetected == 20; } ) );
+            blocked.unlock();
+            assert( waitFor( [&]{ return watcher.getStatistics().backlog == 0; } ) );
+
+            DirectoryWatcherStatistics const statistics = watcher.getStatistics();
+            /* one file was taken by the blocked callback before the burst
+             * filled the backlog */
+            assert( statistics.nDropped >= 15 );
+            assert( statistics.nHandled + statistics.nDropped == 20 );
+            watcher.stop();
+            assert( nCalls == statistics.nHandled );
+        }
+
+        DirectoryWatcher missing( directory + "/missing", onFile );
+        assert( not missing.isOpen() );
+
+        assert( system( ( "rm -r " + directory ).c_str() ) == 0 );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testDirectoryWatcher();
+}
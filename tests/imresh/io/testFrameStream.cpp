@@ -0,0 +1,115 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>       // std::remove
+#include <string>
+#include <vector>
+#include "io/binaryFormats.hpp"
+#include "io/frameStream.hpp"
+#include "io/writeOutFuncs/writeOutFuncs.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void testFrameStream( void )
+    {
+        using namespace imresh::io;
+
+        /* 5 frames of 3x2, every pixel contains its frame index */
+        unsigned const nx = 3, ny = 2, nFrames = 5;
+        std::vector<float> stack( nx * ny * nFrames );
+        for ( unsigned i = 0; i < stack.size(); ++i )
+            stack[i] = i / ( nx * ny );
+
+        std::string const raw = "/tmp/testFrameStream.raw";
+        std::string const npy = "/tmp/testFrameStream.npy";
+        std::string const header = makeRawHeader( nx, ny, nFrames );
+        assert( writeBinaryFile( raw, header, stack.data(), sizeof( float ) * stack.size() ) );
+        std::string const npyHeader = makeNpyHeader( nx, ny, nFrames );
+        assert( writeBinaryFile( npy, npyHeader, stack.data(), sizeof( float ) * stack.size() ) );
+
+        for ( auto const & path : { raw, npy } )
+        {
+            std::unique_ptr<FrameSource> source = openFrameSource( path );
+            assert( source );
+            assert( source->getFrameCount() == nFrames );
+            assert( source->getMaxElements() == nx * ny );
+
+            /* two buffers for five frames, released out of order */
+            FrameStream stream( std::move( source ), 2 );
+            Frame first, second;
+            assert( stream.next( first ) and stream.next( second ) );
+            assert( first.index == 0 and second.index == 1 );
+            assert( first.size.first == nx and first.size.second == ny );
+            stream.release( second.data );
+
+            std::vector<uint64_t> indices;
+            Frame frame;
+            while ( stream.next( frame ) )
+            {
+                for ( unsigned i = 0; i < nx * ny; ++i )
+                    assert( frame.data[i] == frame.index );
+                indices.push_back( frame.index );
+                stream.release( frame.data );
+                if ( frame.index == 2 )
+                    stream.release( first.data );
+            }
+            assert( indices == std::vector<uint64_t>( { 2, 3, 4 } ) );
+
+            FrameStreamStatistics const statistics = stream.getStatistics();
+            assert( statistics.nRead == nFrames and statistics.nFailed == 0 );
+        }
+
+        /* files with one frame and invalid files */
+        writeOutFuncs::writeOutTxt( stack.data(), { nx, ny }, "/tmp/testFrameStream.txt" );
+        {
+            FrameStream stream( openFrameSource( "/tmp/testFrameStream.txt" ), 1 );
+            Frame frame;
+            assert( stream.next( frame ) and frame.index == 0 );
+            assert( frame.data[0] == 0 );
+            stream.release( frame.data );
+            assert( not stream.next( frame ) );
+        }
+        assert( not openFrameSource( "/tmp/testFrameStream.missing.npy" ) );
+
+        std::remove( raw.c_str() );
+        std::remove( npy.c_str() );
+        std::remove( "/tmp/testFrameStream.txt" );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testFrameStream();
+}
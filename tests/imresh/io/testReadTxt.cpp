@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cmath>        // std::isnan
+#include <cstdio>       // std::remove, snprintf
+#include <cstdlib>      // mkstemp, strtof
+#include <fstream>
+#include <random>
+#include <string>
+#include <unistd.h>     // close
+#include <vector>
+#include "io/readInFuncs/readInFuncs.hpp"
+#include "libs/frameBuffer.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    std::string writeTemporary( std::string const & rContent )
+    {
+        char path[] = "/tmp/testReadTxt-XXXXXX";
+        int const fd = mkstemp( path );
+        assert( fd >= 0 );
+        close( fd );
+        std::ofstream file( path, std::ios::binary );
+        file << rContent;
+        return path;
+    }
+
+    std::pair<float*,std::pair<unsigned,unsigned>> readString( std::string const & rContent )
+    {
+        std::string const path = writeTemporary( rContent );
+        auto const result = io::readInFuncs::readTxt( path );
+        std::remove( path.c_str() );
+        return result;
+    }
+
+    void testReadTxt( void )
+    {
+        /* delimiters, CRLF, trailing whitespace and empty lines */
+        {
+            auto const result = readString( "1 2.5\t-3e2\r\n 4,0.125 , 6  \n\n" );
+            assert( result.first != NULL );
+            assert( result.second.first == 3 and result.second.second == 2 );
+            float const expected[6] = { 1, 2.5f, -300, 4, 0.125f, 6 };
+            for ( int i = 0; i < 6; ++i )
+                assert( result.first[i] == expected[i] );
+            imresh::libs::freeFrame( result.first );
+        }
+        /* special values and numbers needing the slow path */
+        {
+            auto const result = readString( "nan inf -1.00000000000000000000001 1e-40 .5 5. +7\n" );
+            assert( result.first != NULL and result.second.first == 7 );
+            assert( std::isnan( result.first[0] ) );
+            assert( result.first[1] == INFINITY );
+            assert( result.first[2] == -1.0f );
+            assert( result.first[3] == strtof( "1e-40", NULL ) );
+            assert( result.first[4] == 0.5f );
+            assert( result.first[5] == 5.0f );
+            assert( result.first[6] == 7.0f );
+            imresh::libs::freeFrame( result.first );
+        }
+        /* malformed files are rejected */
+        assert( readString( "" ).first == NULL );
+        assert( readString( "1 2 3\n4 5\n" ).first == NULL );
+        assert( readString( "1 2\n3 x\n" ).first == NULL );
+        assert( readString( "1 2\n3 4e\n" ).first == NULL );
+        assert( readString( "1 2-3\n" ).first == NULL );
+        assert( io::readInFuncs::readTxt( "/nonexistent/file.txt" ).first == NULL );
+
+        /* a large file, parsed in parallel, gives the same as strtof */
+        {
+            unsigned const nx = 512, ny = 1024;
+            std::mt19937 generator( 2016 );
+            std::uniform_real_distribution<float> mantissa( -10, 10 );
+            std::uniform_int_distribution<int> exponent( -30, 30 );
+            std::string content;
+            std::vector<float> expected;
+            char buffer[64];
+            for ( unsigned iy = 0; iy < ny; ++iy )
+            {
+                for ( unsigned ix = 0; ix < nx; ++ix )
+                {
+                    float const value = mantissa( generator ) *
+                                        std::pow( 10.0f, exponent( generator ) );
+                    snprintf( buffer, sizeof( buffer ), ix % 2 ? "%.9g" : "%.5f", value );
+                    expected.push_back( strtof( buffer, NULL ) );
+                    content += buffer;
+                    content += ix + 1 < nx ? ' ' : '\n';
+                }
+            }
+            auto const result = readString( content );
+            assert( result.first != NULL );
+            assert( result.second.first == nx and result.second.second == ny );
+            for ( unsigned i = 0; i < nx * ny; ++i )
+                assert( result.first[i] == expected[i] );
+            imresh::libs::freeFrame( result.first );
+        }
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testReadTxt();
+}
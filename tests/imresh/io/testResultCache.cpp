@@ -0,0 +1,146 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>   // mkdtemp, system
+#include <string>
+#include <vector>
+#include "io/resultCache.hpp"
+#include "libs/hash.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    io::ResultCacheKey makeKey( std::vector<float> const & rIntensity, unsigned const nCycles )
+    {
+        io::ResultCacheKey key;
+        key.intensityHash = libs::hash64( rIntensity.data(), rIntensity.size() * sizeof( float ) );
+        key.size = { (unsigned) rIntensity.size(), 1 };
+        key.numberOfCycles = nCycles;
+        key.numberOfHIOCycles = 20;
+        key.targetError = 1e-5f;
+        key.HIOBeta = 0.9f;
+        key.intensityCutOffAutoCorel = 0.04f;
+        key.intensityCutOff = 0.2f;
+        key.sigma0 = 3.0f;
+        key.sigmaChange = 0.01f;
+        return key;
+    }
+
+    void testResultCache( void )
+    {
+        using namespace imresh::io;
+
+        unsigned const nElements = 1000;
+        size_t const resultSize = nElements * sizeof( float );
+        std::vector< std::vector<float> > intensities( 4, std::vector<float>( nElements ) );
+        for ( unsigned i = 0; i < intensities.size(); ++i )
+            for ( unsigned j = 0; j < nElements; ++j )
+                intensities[i][j] = i * nElements + j;
+        std::vector<float> result( nElements );
+
+        /* the same input with other parameters must be a different key */
+        assert( not ( makeKey( intensities[0], 20 ) == makeKey( intensities[0], 21 ) ) );
+        assert( makeKey( intensities[0], 20 ).hash() != makeKey( intensities[0], 21 ).hash() );
+        assert( makeKey( intensities[0], 20 ) == makeKey( intensities[0], 20 ) );
+
+        /* memory only, room for two results */
+        {
+            ResultCache cache( 2 * resultSize );
+            assert( not cache.lookup( makeKey( intensities[0], 20 ), result.data() ) );
+            cache.insert( makeKey( intensities[0], 20 ), intensities[1].data() );
+            assert( cache.lookup( makeKey( intensities[0], 20 ), result.data() ) );
+            assert( result == intensities[1] );
+            assert( not cache.lookup( makeKey( intensities[0], 21 ), result.data() ) );
+
+            cache.insert( makeKey( intensities[1], 20 ), intensities[2].data() );
+            /* makes intensities[1] the least recently used */
+            assert( cache.lookup( makeKey( intensities[0], 20 ), result.data() ) );
+            cache.insert( makeKey( intensities[2], 20 ), intensities[3].data() );
+            assert( not cache.lookup( makeKey( intensities[1], 20 ), result.data() ) );
+            assert( cache.lookup( makeKey( intensities[0], 20 ), result.data() ) );
+            assert( cache.lookup( makeKey( intensities[2], 20 ), result.data() ) );
+            assert( result == intensities[3] );
+            /* contains doesn't count as hit or miss */
+            assert( cache.contains( makeKey( intensities[0], 20 ) ) );
+            assert( not cache.contains( makeKey( intensities[1], 20 ) ) );
+
+            auto const statistics = cache.getStatistics();
+            assert( statistics.nMemoryHits == 4 );
+            assert( statistics.nDiskHits   == 0 );
+            assert( statistics.nMisses     == 3 );
+            assert( statistics.nInsertions == 3 );
+            assert( statistics.nEvictions  == 1 );
+            assert( statistics.memoryUsed  == 2 * resultSize );
+        }
+
+        /* spilling to disk, room for one result in memory */
+        char directoryTemplate[] = "/tmp/testResultCache-XXXXXX";
+        std::string const directory = mkdtemp( directoryTemplate );
+        {
+            ResultCache cache( resultSize, directory );
+            cache.insert( makeKey( intensities[0], 20 ), intensities[1].data() );
+            cache.insert( makeKey( intensities[1], 20 ), intensities[2].data() );
+            assert( cache.lookup( makeKey( intensities[0], 20 ), result.data() ) );
+            assert( result == intensities[1] );
+            assert( cache.getStatistics().nDiskHits == 1 );
+        }
+        /* results on disk survive the cache object */
+        {
+            ResultCache cache( resultSize, directory );
+            assert( cache.contains( makeKey( intensities[1], 20 ) ) );
+            assert( not cache.contains( makeKey( intensities[1], 21 ) ) );
+            assert( cache.lookup( makeKey( intensities[1], 20 ), result.data() ) );
+            assert( result == intensities[2] );
+            assert( not cache.lookup( makeKey( intensities[1], 21 ), result.data() ) );
+        }
+        /* results are written on insert, not only when evicted */
+        {
+            ResultCache cache( 2 * resultSize, directory );
+            cache.insert( makeKey( intensities[3], 20 ), intensities[0].data() );
+            assert( cache.getStatistics().nEvictions == 0 );
+        }
+        {
+            ResultCache cache( resultSize, directory );
+            assert( cache.lookup( makeKey( intensities[3], 20 ), result.data() ) );
+            assert( result == intensities[0] );
+            assert( cache.getStatistics().nDiskHits == 1 );
+        }
+        assert( system( ( "rm -r " + directory ).c_str() ) == 0 );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testResultCache();
+}
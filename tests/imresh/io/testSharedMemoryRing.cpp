@@ -0,0 +1,124 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <sys/wait.h>   // waitpid
+#include <unistd.h>     // fork, getpid, _exit
+#include "io/sharedMemoryRing.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void testSharedMemoryRing( void )
+    {
+        using namespace imresh::io;
+
+        std::string const name = "/imresh-testRing-" + std::to_string( getpid() );
+        unsigned const nSlots    = 4;
+        unsigned const nElements = 1000;
+        unsigned const nFrames   = 50;
+
+        SharedMemoryRing ring( name, nSlots, nElements );
+        assert( ring.isOpen() );
+        assert( ring.getSlotCount() == nSlots );
+        assert( ring.getMaxElements() == nElements );
+        /* nothing published yet */
+        assert( ring.acquireRead( 10 ) == -1 );
+
+        /* the producer runs in another process and blocks on the full ring */
+        pid_t const pid = fork();
+        assert( pid >= 0 );
+        if ( pid == 0 )
+        {
+            SharedMemoryRing producer( name );
+            if ( not producer.isOpen() )
+                _exit( 1 );
+            for ( unsigned iFrame = 0; iFrame < nFrames; ++iFrame )
+            {
+                int const slot = producer.acquireWrite( 10000 );
+                if ( slot < 0 )
+                    _exit( 2 );
+                float * const data = producer.getData( slot );
+                for ( unsigned i = 0; i < nElements; ++i )
+                    data[i] = iFrame + i;
+                FrameHeader header = FrameHeader();
+                header.frameId = iFrame;
+                header.width   = nElements;
+                header.height  = 1;
+                producer.publish( slot, header );
+            }
+            _exit( 0 );
+        }
+
+        /* frames arrive in order, but are released in pairs in reverse */
+        int previousSlot = -1;
+        for ( unsigned iFrame = 0; iFrame < nFrames; ++iFrame )
+        {
+            int const slot = ring.acquireRead( 10000 );
+            assert( slot >= 0 );
+            assert( ring.getHeader( slot ).frameId == iFrame );
+            assert( ring.getHeader( slot ).width == nElements );
+            float const * const data = ring.getData( slot );
+            for ( unsigned i = 0; i < nElements; ++i )
+                assert( data[i] == float( iFrame + i ) );
+
+            if ( previousSlot < 0 )
+                previousSlot = slot;
+            else
+            {
+                ring.release( slot );
+                ring.release( previousSlot );
+                previousSlot = -1;
+            }
+        }
+        int status = 0;
+        assert( waitpid( pid, &status, 0 ) == pid );
+        assert( WIFEXITED( status ) and WEXITSTATUS( status ) == 0 );
+
+        /* closing wakes up readers and makes writing fail */
+        ring.close();
+        assert( ring.isClosed() );
+        assert( ring.acquireRead( -1 ) == -1 );
+        assert( ring.acquireWrite( -1 ) == -1 );
+
+        /* attaching to something which doesn't exist fails */
+        SharedMemoryRing missing( name + "-missing" );
+        assert( not missing.isOpen() );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testSharedMemoryRing();
+}
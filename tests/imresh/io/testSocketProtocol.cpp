@@ -0,0 +1,104 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <sys/socket.h> // socketpair, shutdown
+#include <thread>
+#include <unistd.h>     // close
+#include <vector>
+#include "io/socketProtocol.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void testSocketProtocol( void )
+    {
+        using namespace imresh::io;
+
+        int fds[2];
+        assert( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) == 0 );
+
+        /* large enough to not fit into the socket buffer at once */
+        FrameHeader frame = FrameHeader();
+        frame.frameId        = 42;
+        frame.width          = 512;
+        frame.height         = 300;
+        frame.numberOfCycles = 7;
+        frame.HIOBeta        = 0.8f;
+        std::vector<float> data( frame.width * frame.height );
+        for ( unsigned i = 0; i < data.size(); ++i )
+            data[i] = i;
+
+        std::thread sender( [&]{
+            assert( sendFrameMessage( fds[0], SocketMessageType::Submit, frame, data.data() ) );
+            /* a result with an error status carries no data */
+            FrameHeader rejected = frame;
+            rejected.status = static_cast<int32_t>( FrameStatus::Rejected );
+            assert( sendFrameMessage( fds[0], SocketMessageType::Result, rejected, NULL ) );
+            shutdown( fds[0], SHUT_WR );
+        } );
+
+        SocketMessageHeader message;
+        assert( receiveMessageHeader( fds[1], message ) );
+        assert( message.type == uint32_t( SocketMessageType::Submit ) );
+        assert( message.frame.frameId == 42 );
+        assert( message.frame.width == 512 and message.frame.height == 300 );
+        assert( message.frame.numberOfCycles == 7 );
+        assert( message.frame.HIOBeta == 0.8f );
+        assert( messageHasData( message ) );
+        std::vector<float> received( data.size() );
+        assert( receiveAll( fds[1], received.data(), sizeof( float ) * received.size() ) );
+        assert( received == data );
+
+        assert( receiveMessageHeader( fds[1], message ) );
+        assert( message.type == uint32_t( SocketMessageType::Result ) );
+        assert( message.frame.status == int32_t( FrameStatus::Rejected ) );
+        assert( not messageHasData( message ) );
+
+        /* end of stream */
+        assert( not receiveMessageHeader( fds[1], message ) );
+        sender.join();
+
+        /* garbage is detected by the magic */
+        char garbage[ sizeof( SocketMessageHeader ) ] = { 1, 2, 3 };
+        assert( sendAll( fds[1], garbage, sizeof( garbage ) ) );
+        close( fds[1] );
+        assert( not receiveMessageHeader( fds[0], message ) );
+        close( fds[0] );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testSocketProtocol();
+}
@@ -0,0 +1,174 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <algorithm>    // std::min
+#include <cstdint>      // uint16_t, uint32_t
+#include <cstdio>       // std::remove
+#include <string>
+#include <vector>
+#ifdef USE_TIFF
+#   include <tiffio.h>
+#endif
+#include "io/frameStream.hpp"
+#include "io/readInFuncs/readInFuncs.hpp"
+#include "libs/frameBuffer.hpp"
+
+
+#ifdef USE_TIFF
+namespace imresh
+{
+namespace tests
+{
+
+
+    /**
+     * Writes the current page of rTiff with rows of rRowsPerStrip rows or
+     * with 16x16 tiles if rRowsPerStrip is 0.
+     */
+    template<class T>
+    void writePage
+    (
+        TIFF * const rTiff,
+        std::vector<T> const & rData,
+        unsigned int const rWidth,
+        unsigned int const rHeight,
+        unsigned int const rSampleFormat,
+        unsigned int const rRowsPerStrip
+    )
+    {
+        TIFFSetField( rTiff, TIFFTAG_IMAGEWIDTH, rWidth );
+        TIFFSetField( rTiff, TIFFTAG_IMAGELENGTH, rHeight );
+        TIFFSetField( rTiff, TIFFTAG_BITSPERSAMPLE, 8 * sizeof( T ) );
+        TIFFSetField( rTiff, TIFFTAG_SAMPLESPERPIXEL, 1 );
+        TIFFSetField( rTiff, TIFFTAG_SAMPLEFORMAT, rSampleFormat );
+        TIFFSetField( rTiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK );
+        TIFFSetField( rTiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG );
+        TIFFSetField( rTiff, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE );
+
+        if ( rRowsPerStrip > 0 )
+        {
+            TIFFSetField( rTiff, TIFFTAG_ROWSPERSTRIP, rRowsPerStrip );
+            for ( unsigned int row = 0, strip = 0; row < rHeight; row += rRowsPerStrip, ++strip )
+            {
+                unsigned int const nRows = std::min( rRowsPerStrip, rHeight - row );
+                std::vector<T> stripData( &rData[ row * rWidth ],
+                                          &rData[ row * rWidth ] + nRows * rWidth );
+                TIFFWriteEncodedStrip( rTiff, strip, stripData.data(),
+                                       stripData.size() * sizeof( T ) );
+            }
+        }
+        else
+        {
+            unsigned int const tileSize = 16;
+            TIFFSetField( rTiff, TIFFTAG_TILEWIDTH, tileSize );
+            TIFFSetField( rTiff, TIFFTAG_TILELENGTH, tileSize );
+            for ( unsigned int y = 0; y < rHeight; y += tileSize )
+            for ( unsigned int x = 0; x < rWidth; x += tileSize )
+            {
+                std::vector<T> tile( tileSize * tileSize );
+                for ( unsigned int iy = 0; iy < tileSize and y + iy < rHeight; ++iy )
+                for ( unsigned int ix = 0; ix < tileSize and x + ix < rWidth; ++ix )
+                    tile[ iy * tileSize + ix ] = rData[ ( y + iy ) * rWidth + x + ix ];
+                TIFFWriteEncodedTile( rTiff, TIFFComputeTile( rTiff, x, y, 0, 0 ),
+                                      tile.data(), tile.size() * sizeof( T ) );
+            }
+        }
+        TIFFWriteDirectory( rTiff );
+    }
+
+    void testTiffFrameSource( void )
+    {
+        using namespace imresh::io;
+
+        unsigned int const nx = 37, ny = 21;
+        std::vector<uint16_t> page0( nx * ny );
+        std::vector<float>    page1( nx * ny );
+        std::vector<uint32_t> page2( nx * ny );
+        for ( unsigned int i = 0; i < nx * ny; ++i )
+        {
+            page0[i] = 60000 - 7 * i;
+            page1[i] = 0.25f * i - 3;
+            page2[i] = 100000u * i;
+        }
+
+        std::string const path = "/tmp/testTiffFrameSource.tif";
+        TIFF * tiff = TIFFOpen( path.c_str(), "w" );
+        assert( tiff != NULL );
+        writePage( tiff, page0, nx, ny, SAMPLEFORMAT_UINT, 4 );
+        writePage( tiff, page1, nx, ny, SAMPLEFORMAT_IEEEFP, 0 );
+        writePage( tiff, page2, nx, ny, SAMPLEFORMAT_UINT, ny );
+        TIFFClose( tiff );
+
+        /* readFile returns the first page */
+        assert( readInFuncs::isSupportedFile( path ) );
+        auto const file = readInFuncs::readFile( path );
+        assert( file.first != NULL );
+        assert( file.second.first == nx and file.second.second == ny );
+        for ( unsigned int i = 0; i < nx * ny; ++i )
+            assert( file.first[i] == page0[i] );
+        imresh::libs::freeFrame( file.first );
+
+        /* all pages through the frame stream */
+        FrameStream stream( openFrameSource( path ), 2 );
+        assert( stream.getFrameCount() == 3 );
+        Frame frame;
+        while ( stream.next( frame ) )
+        {
+            assert( frame.size.first == nx and frame.size.second == ny );
+            for ( unsigned int i = 0; i < nx * ny; ++i )
+            {
+                float const expected = frame.index == 0 ? float( page0[i] ) :
+                                       frame.index == 1 ? page1[i] : float( page2[i] );
+                assert( frame.data[i] == expected );
+            }
+            stream.release( frame.data );
+        }
+        assert( stream.getStatistics().nRead == 3 );
+
+        /* 8 bit pages aren't supported */
+        tiff = TIFFOpen( path.c_str(), "w" );
+        writePage( tiff, std::vector<uint8_t>( nx * ny ), nx, ny, SAMPLEFORMAT_UINT, ny );
+        TIFFClose( tiff );
+        assert( readInFuncs::readFile( path ).first == NULL );
+        assert( not openFrameSource( path ) );
+
+        std::remove( path.c_str() );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+#endif
+
+
+int main( void )
+{
+#   ifdef USE_TIFF
+        imresh::tests::testTiffFrameSource();
+#   else
+        std::cout << "Built without USE_TIFF, nothing to test." << std::endl;
+#   endif
+}
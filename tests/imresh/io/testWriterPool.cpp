@@ -0,0 +1,149 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "io/writerPool.hpp"
+#include "libs/frameBuffer.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void testWriterPool( void )
+    {
+        using namespace imresh::io;
+
+        std::pair<unsigned int,unsigned int> const size( 4, 4 );
+        unsigned int const nResults = 50;
+
+        /* results submitted in reverse are written in the bound order */
+        for ( unsigned int nThreads : { 1u, 3u } )
+        {
+            std::mutex mutex;
+            std::vector<std::string> written;
+            std::atomic<unsigned int> nRecycled( 0 );
+            {
+                WriterPool writerPool( nThreads, true, 4 );
+                std::vector<WriterPool::BoundFuncs> funcs;
+                for ( unsigned int i = 0; i < nResults; ++i )
+                    funcs.push_back( writerPool.bind(
+                        [&]( float * _mem, std::pair<unsigned int,unsigned int>,
+                             std::string _filename )
+                        {
+                            assert( _mem[0] == std::stof( _filename ) );
+                            std::lock_guard<std::mutex> lock( mutex );
+                            written.push_back( _filename );
+                        },
+                        [&]( float * _mem, size_t rnElements )
+                        {
+                            assert( rnElements == 16 );
+                            delete[] _mem;
+                            ++nRecycled;
+                        } ) );
+
+                /* submitting from several threads, the last results first */
+                std::vector<std::thread> workers;
+                for ( unsigned int iWorker = 0; iWorker < 4; ++iWorker )
+                    workers.emplace_back( [&,iWorker]
+                    {
+                        for ( int i = nResults - 1 - iWorker; i >= 0; i -= 4 )
+                        {
+                            float * const mem = new float[ 16 ];
+                            mem[0] = i;
+                            if ( i % 10 == 3 )
+                                funcs[i].cancel( mem, size, std::to_string( i ) );
+                            else
+                                funcs[i].writeOut( mem, size, std::to_string( i ) );
+                        }
+                    } );
+                for ( auto & worker : workers )
+                    worker.join();
+                writerPool.flush();
+
+                WriterPoolStatistics const statistics = writerPool.getStatistics();
+                assert( statistics.nWritten == nResults - 5 );
+                assert( statistics.nSkipped == 5 );
+            }
+            assert( nRecycled == nResults );
+            assert( written.size() == nResults - 5 );
+            if ( nThreads == 1 )
+                for ( unsigned int i = 1; i < written.size(); ++i )
+                    assert( std::stoi( written[i-1] ) < std::stoi( written[i] ) );
+        }
+
+        /* unordered, the buffers go back to the frame buffer pool */
+        {
+            using namespace imresh::libs;
+            FrameBufferPoolStatistics const before = getFrameBufferPool().getStatistics();
+            WriterPool writerPool( 2 );
+            std::atomic<unsigned int> nWritten( 0 );
+            for ( unsigned int i = 0; i < nResults; ++i )
+            {
+                float * const mem = allocateFrame( 16 );
+                writerPool.bind( [&]( float *, std::pair<unsigned int,unsigned int>,
+                                      std::string ){ ++nWritten; } )
+                    .writeOut( mem, size, "" );
+                writerPool.flush();
+            }
+            assert( nWritten == nResults );
+            FrameBufferPoolStatistics const after = getFrameBufferPool().getStatistics();
+            assert( after.nReused - before.nReused +
+                    after.nAllocated - before.nAllocated == nResults );
+            assert( after.nAllocated - before.nAllocated <= 1 );
+            assert( after.nLive == before.nLive );
+        }
+
+        /* slow writers block the submissions beyond the queue limit */
+        {
+            WriterPool writerPool( 1, false, 1 );
+            for ( unsigned int i = 0; i < 5; ++i )
+                writerPool.bind( []( float *, std::pair<unsigned int,unsigned int>,
+                                     std::string )
+                    { std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) ); } )
+                    .writeOut( imresh::libs::allocateFrame( 16 ), size, "" );
+            writerPool.flush();
+            WriterPoolStatistics const statistics = writerPool.getStatistics();
+            assert( statistics.nBlocked > 0 and statistics.maxQueued == 1 );
+        }
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testWriterPool();
+}
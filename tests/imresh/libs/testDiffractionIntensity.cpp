@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <algorithm>    // std::copy
+#include <cassert>
+#include <cmath>        // cos, sin, sqrt, fabs
+#include <complex>
+#include <vector>
+#include <utility>      // pair
+#include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
+#include "libs/vectorIndex.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    /**
+     * Norm of the 2D DFT by definition, optionally shifted with
+     * fftShiftIndex
+     */
+    std::vector<float> referenceIntensity
+    (
+        std::vector<float> const & rObject,
+        unsigned const nx,
+        unsigned const ny,
+        bool const rFftShift
+    )
+    {
+        std::vector<float> result( nx * ny );
+        for ( unsigned ky = 0; ky < ny; ++ky )
+        for ( unsigned kx = 0; kx < nx; ++kx )
+        {
+            std::complex<double> sum = 0;
+            for ( unsigned iy = 0; iy < ny; ++iy )
+            for ( unsigned ix = 0; ix < nx; ++ix )
+            {
+                double const phase = -2 * M_PI * ( double( kx * ix ) / nx +
+                                                   double( ky * iy ) / ny );
+                sum += double( rObject[ iy * nx + ix ] ) *
+                       std::complex<double>( cos( phase ), sin( phase ) );
+            }
+            unsigned const i = ky * nx + kx;
+            result[ rFftShift ? libs::fftShiftIndex( i, { ny, nx } ) : i ] =
+                std::abs( sum );
+        }
+        return result;
+    }
+
+    bool isClose( std::vector<float> const & a, float const * b )
+    {
+        for ( unsigned i = 0; i < a.size(); ++i )
+        {
+            if ( std::fabs( a[i] - b[i] ) > 1e-4f * ( 1 + std::fabs( a[i] ) ) )
+                return false;
+        }
+        return true;
+    }
+
+    void testDiffractionIntensity( void )
+    {
+        using namespace imresh::libs;
+
+        /* odd sizes check the Hermitian expansion and the shift */
+        std::vector< std::pair<unsigned,unsigned> > const sizes =
+            { { 8, 6 }, { 7, 5 }, { 6, 1 }, { 1, 3 } };
+        for ( auto const & size : sizes )
+        for ( bool const shift : { false, true } )
+        {
+            unsigned const nx = size.first, ny = size.second;
+            std::vector<float> object( nx * ny );
+            for ( unsigned i = 0; i < object.size(); ++i )
+                object[i] = ( i * 7 ) % 5 + 0.25f * ( i % 3 );
+            auto const expected = referenceIntensity( object, nx, ny, shift );
+
+            /* free function with cached plan, called twice */
+            for ( unsigned iRepetition = 0; iRepetition < 2; ++iRepetition )
+            {
+                std::vector<float> data( object );
+                diffractionIntensity( data.data(), size, shift );
+                assert( isClose( expected, data.data() ) );
+            }
+
+            /* batch, including a frame which isn't aligned like the buffers
+             * the plan was created for */
+            DiffractionIntensityPlan const plan( size, shift );
+            assert( plan.getSize() == size and plan.getFftShift() == shift );
+            unsigned const nFrames = 5;
+            FrameBuffer unaligned( nx * ny + 1 );
+            std::vector<FrameBuffer> frames;
+            std::vector<float*> pointers;
+            for ( unsigned i = 0; i < nFrames; ++i )
+            {
+                frames.push_back( FrameBuffer( nx * ny ) );
+                pointers.push_back( i == 2 ? unaligned.data() + 1 : frames[i].data() );
+                std::copy( object.begin(), object.end(), pointers[i] );
+            }
+            plan( pointers.data(), nFrames );
+            for ( auto const & pointer : pointers )
+                assert( isClose( expected, pointer ) );
+        }
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testDiffractionIntensity();
+}
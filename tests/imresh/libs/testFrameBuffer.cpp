@@ -0,0 +1,152 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <iostream>
+#include <cassert>
+#include <cstdint>   // uintptr_t
+#include <thread>
+#include <utility>   // std::move
+#include <vector>
+#include "libs/frameBuffer.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void testFrameBufferSizeClasses( void )
+    {
+        using imresh::libs::FrameBufferPool;
+
+        /* classes grow monotonically, fit the request and waste at most 25% */
+        unsigned iLastClass = 0;
+        for ( size_t nBytes = 1; nBytes < ( 1u << 22 ); nBytes += 1 + nBytes / 97 )
+        {
+            unsigned const iClass = FrameBufferPool::getSizeClass( nBytes );
+            size_t const nClassBytes = FrameBufferPool::getSizeClassBytes( iClass );
+            assert( iClass >= iLastClass );
+            assert( nBytes <= nClassBytes );
+            if ( iClass > 0 )
+            {
+                assert( nBytes > FrameBufferPool::getSizeClassBytes( iClass - 1 ) );
+                assert( nClassBytes <= nBytes + nBytes / 4 );
+            }
+            iLastClass = iClass;
+        }
+        assert( FrameBufferPool::getSizeClass( 256 ) == 0 );
+        assert( FrameBufferPool::getSizeClass( 257 ) == 1 );
+        assert( FrameBufferPool::getSizeClassBytes( 4 ) == 512 );
+    }
+
+    void testFrameBufferPool( void )
+    {
+        using namespace imresh::libs;
+
+        FrameBufferPool pool( 64 * 1024 );
+        float * const a = pool.acquire( 1000 );
+        assert( reinterpret_cast<uintptr_t>( a ) % frameBufferAlignment == 0 );
+        assert( getFrameElements( a ) == 1000 and getFrameUseCount( a ) == 1 );
+        for ( unsigned i = 0; i < 1000; ++i )
+            a[i] = i;
+        freeFrame( a );
+
+        /* reused for requests of the same size class */
+        float * const b = pool.acquire( 990 );
+        assert( b == a and getFrameElements( b ) == 990 );
+        float * const c = pool.acquire( 990 );
+        assert( c != b );
+        FrameBufferPoolStatistics statistics = pool.getStatistics();
+        assert( statistics.nAllocated == 2 and statistics.nReused == 1 );
+        assert( statistics.nLive == 2 and statistics.nCached == 0 );
+
+        /* the last reference returns the buffer to the pool */
+        retainFrame( b );
+        freeFrame( b );
+        assert( pool.getStatistics().nLive == 2 );
+        freeFrame( b );
+        freeFrame( c );
+        statistics = pool.getStatistics();
+        assert( statistics.nLive == 0 and statistics.nCached == 2 );
+
+        /* buffers beyond the cache limit are freed */
+        freeFrame( pool.acquire( 32 * 1024 ) );
+        assert( pool.getStatistics().nCached == 2 );
+        pool.trim();
+        assert( pool.getStatistics().nCachedBytes == 0 );
+    }
+
+    void testFrameBuffer( void )
+    {
+        using namespace imresh::libs;
+
+        FrameBufferPool pool;
+        {
+            FrameBuffer a( 100, pool );
+            assert( a and a.size() == 100 and a.useCount() == 1 );
+            FrameBuffer b = a;
+            assert( b.data() == a.data() and a.useCount() == 2 );
+            FrameBuffer c = std::move( b );
+            assert( not b and c.useCount() == 2 );
+            c = FrameBuffer();
+            assert( a.useCount() == 1 );
+
+            /* hand the reference to a raw pointer interface and back */
+            float * const raw = a.release();
+            assert( not a and getFrameUseCount( raw ) == 1 );
+            FrameBuffer d = FrameBuffer::share( raw );
+            assert( d.useCount() == 2 );
+            FrameBuffer::adopt( raw ).reset();
+            assert( d.useCount() == 1 and pool.getStatistics().nLive == 1 );
+        }
+        assert( pool.getStatistics().nLive == 0 );
+
+        /* references are counted atomically */
+        {
+            FrameBuffer shared( 16, pool );
+            std::vector<std::thread> threads;
+            for ( unsigned i = 0; i < 4; ++i )
+                threads.emplace_back( [shared]
+                {
+                    for ( unsigned j = 0; j < 10000; ++j )
+                        FrameBuffer copy = shared;
+                } );
+            for ( auto & thread : threads )
+                thread.join();
+            assert( shared.useCount() == 1 );
+        }
+        assert( pool.getStatistics().nLive == 0 );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testFrameBufferSizeClasses();
+    imresh::tests::testFrameBufferPool();
+    imresh::tests::testFrameBuffer();
+}
@@ -0,0 +1,108 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015-2016 Maximilian Knespel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdint>   // uint64_t
+#include <limits>    // numeric_limits
+#include <thread>
+#include <vector>
+#include "libs/latencyHistogram.hpp"
+
+
+namespace imresh
+{
+namespace tests
+{
+
+
+    void testLatencyHistogram( void )
+    {
+        using imresh::libs::LatencyHistogram;
+
+        /* bucket indices must be monotonic and cover all values */
+        unsigned iLastBucket = 0;
+        for ( uint64_t value = 0; value < 100000; ++value )
+        {
+            unsigned const iBucket = LatencyHistogram::getBucketIndex( value );
+            assert( iBucket >= iLastBucket );
+            assert( iBucket <= iLastBucket + 1 );
+            assert( value <= LatencyHistogram::getBucketUpperBound( iBucket ) );
+            iLastBucket = iBucket;
+        }
+        uint64_t const maxValue = std::numeric_limits<uint64_t>::max();
+        assert( LatencyHistogram::getBucketIndex( maxValue ) == LatencyHistogram::mnBuckets-1 );
+        assert( LatencyHistogram::getBucketUpperBound( LatencyHistogram::mnBuckets-1 ) == maxValue );
+
+        /* relative resolution */
+        for ( uint64_t value = 1; value < maxValue / 3; value *= 3 )
+        {
+            uint64_t const bound = LatencyHistogram::getBucketUpperBound(
+                LatencyHistogram::getBucketIndex( value ) );
+            assert( bound >= value );
+            assert( (double) ( bound - value ) / value <= 1.0 / LatencyHistogram::mnHalfBuckets );
+        }
+
+        /* percentiles of 1..1000 */
+        LatencyHistogram histogram;
+        assert( histogram.getPercentile( 50 ) == 0 );
+        for ( uint64_t value = 1; value <= 1000; ++value )
+            histogram.record( value );
+        assert( histogram.getCount() == 1000 );
+        assert( histogram.getMax() == 1000 );
+        assert( histogram.getMean() == 500.5 );
+        assert( histogram.getPercentile( 100 ) == 1000 );
+        auto const median = histogram.getPercentile( 50 );
+        assert( median >= 500 and median <= 500 * ( 1 + 1.0 / LatencyHistogram::mnHalfBuckets ) );
+        auto const p99 = histogram.getPercentile( 99 );
+        assert( p99 >= 990 and p99 <= 1000 );
+
+        /* concurrent recording must not lose counts */
+        histogram.reset();
+        assert( histogram.getCount() == 0 );
+        std::vector<std::thread> threads;
+        for ( unsigned iThread = 0; iThread < 4; ++iThread )
+        {
+            threads.push_back( std::thread( [&histogram,iThread]()
+            {
+                for ( uint64_t i = 0; i < 100000; ++i )
+                    histogram.record( i * ( iThread + 1 ) );
+            } ) );
+        }
+        for ( auto & thread : threads )
+            thread.join();
+        assert( histogram.getCount() == 400000 );
+        assert( histogram.getMax() == 99999 * 4 );
+        assert( histogram.getPercentile( 100 ) == 99999 * 4 );
+    }
+
+
+} // namespace tests
+} // namespace imresh
+
+
+int main( void )
+{
+    imresh::tests::testLatencyHistogram();
+}
@@ -0,0 +1,837 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Reconstructs all given files through the task queue and writes the
+ * results to an output directory. Finished inputs are appended to a
+ * progress file, so an interrupted run (e.g. by SIGINT) can be started
+ * again with the same arguments and skips everything already done.
+ *
+ * Usage: imresh-batch [--option=value ...] input ...
+ *   input is a file, a directory (all supported files in it), a glob
+ *   pattern like 'run42/frame_*.png' or @list.txt with one path per line.
+ *
+ *   --output=.            directory for the results. Each result is named
+ *                         after its input without extension. If inputs
+ *                         share a name, "-2", "-3", ... is appended in the
+ *                         order of the inputs
+ *   --format=png|h5|txt|raw|npy  output format (default png if built with
+ *                         USE_PNG, else txt)
+ *   --png-bits=16         bit depth of PNG output, 16 or 8
+ *   --png-level=1         zlib compression level of PNG output, 0 to 9
+ *   --h5-file=name        with format h5, append all results to
+ *                         <output>/<name>_0_0_0.h5 instead of writing a
+ *                         file per image, see imresh::io::HDF5FrameSink
+ *   --progress=file       progress file (default <output>/imresh-batch.progress)
+ *   --readers=2           threads reading input files in parallel
+ *   --prefetch=8          frames read ahead per multi-frame container
+ *                         (.raw, .npy, HDF5), which bounds the frames of
+ *                         one container in flight. Each frame is written
+ *                         to <name>_<index>.<format> and marked as
+ *                         path#index in the progress file
+ *   --writers=2           threads writing results, so the reconstruction
+ *                         of the next image isn't delayed by the write out
+ *   --ordered=0           1 writes the results in the order of the inputs
+ *   --memory-budget=0     bytes for queued and running tasks, 0 = unlimited
+ *   --object=0            1 if the inputs are objects instead of diffraction
+ *                         intensities, their intensity is computed first
+ *   --dark= --gain= --mask=  calibration files (any readable format) for
+ *                         detector preprocessing of raw frames, see
+ *                         imresh::algorithms::DetectorPreprocessor
+ *   --hot-sigma=0         ignore pixels whose dark value is more than this
+ *                         many standard deviations above the mean
+ *   --bin=1               sum N x N pixels into one before reconstructing
+ *   --hit-min-intensity=0 --hit-peak-threshold=0 --hit-min-peaks=0
+ *   --hit-min-radial=0 --hit-min-radius=0
+ *                         thresholds of the hit finder, see
+ *                         imresh::algorithms::HitFinderParameters. Frames
+ *                         failing one of them are marked as done without
+ *                         being reconstructed. 0 disables a criterion
+ *   --hit-centered=0      1 if the inputs are centered with fftshift, i.e.
+ *                         the radius is measured from the frame center
+ *                         instead of pixel (0,0)
+ *   --watch=0             1 keeps running after the given inputs are done and
+ *                         reconstructs files completed in the input
+ *                         directories later on, until SIGINT
+ *   --max-backlog=64      in watch mode, files waiting to be read beyond this
+ *                         are skipped (oldest first) to bound the lag,
+ *                         0 never skips
+ *   --cycles=20 --hio-cycles=20 --target-error=1e-5 --hio-beta=0.9
+ *   --cutoff-autocorel=0.04 --cutoff=0.2 --sigma0=3 --sigma-change=0.01
+ *                         shrink-wrap parameters, see imresh::io::addTask
+ */
+
+#include <algorithm>        // std::sort
+#include <atomic>
+#include <chrono>
+#include <climits>          // PATH_MAX
+#include <csignal>          // std::signal, SIGINT, SIGTERM
+#include <cstdint>          // uint64_t
+#include <cstdlib>          // strtod, strtoul, strtoull, realpath
+#include <dirent.h>         // opendir, readdir
+#include <fstream>
+#include <functional>       // std::function
+#include <glob.h>           // glob
+#include <iomanip>          // setprecision
+#include <iostream>
+#include <map>
+#include <memory>           // std::unique_ptr
+#include <mutex>
+#include <string>
+#include <sys/stat.h>       // stat, mkdir
+#include <thread>
+#include <unordered_set>
+#include <utility>          // std::pair
+#include <vector>
+
+#include "algorithms/hitFinder.hpp"
+#include "io/directoryWatcher.hpp"
+#include "io/frameStream.hpp"
+#include "io/hdf5FrameSink.hpp"
+#include "io/preprocessedFrameSource.hpp"
+#include "io/readInFuncs/readInFuncs.hpp"
+#include "io/taskQueue.hpp"
+#include "io/taskQueueMetrics.hpp"
+#include "io/writerPool.hpp"
+#include "io/writeOutFuncs/writeOutFuncs.hpp"
+#include "libs/diffractionIntensity.hpp"
+#include "libs/frameBuffer.hpp"
+
+
+namespace tools
+{
+
+
+    using namespace imresh::io;
+
+    struct BatchOptions
+    {
+        std::string outputDirectory = ".";
+#       ifdef USE_PNG
+            std::string format      = "png";
+#       else
+            std::string format      = "txt";
+#       endif
+        unsigned pngBits            = 16;
+        int pngLevel                = 1;
+        std::string h5File;
+        std::string progressFile;
+        unsigned nReaders           = 2;
+        unsigned nPrefetch          = 8;
+        unsigned nWriters           = 2;
+        bool ordered                = false;
+        uint64_t memoryBudget       = 0;
+        bool inputIsObject          = false;
+        std::string darkFile;
+        std::string gainFile;
+        std::string maskFile;
+        float hotPixelSigma         = 0;
+        unsigned binning            = 1;
+        imresh::algorithms::HitFinderParameters hitFinder;
+        bool watch                  = false;
+        size_t maxBacklog           = 64;
+        unsigned nCycles            = defaultNumberOfCycles;
+        unsigned nHIOCycles         = defaultNumberOfHIOCycles;
+        float targetError           = defaultTargetError;
+        float HIOBeta               = defaultHIOBeta;
+        float intensityCutOffAutoCorel = defaultIntensityCutOffAutoCorel;
+        float intensityCutOff       = defaultIntensityCutOff;
+        float sigma0                = defaultSigma0;
+        float sigmaChange           = defaultSigmaChange;
+        std::vector<std::string> inputs;
+    };
+
+    /**
+     * Parses arguments of the form --key=value, everything else is an input.
+     * Returns false on unknown keys or unsupported formats.
+     */
+    bool parseOptions( int argc, char ** argv, BatchOptions & rOptions )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            std::string const arg = argv[i];
+            if ( arg.compare( 0, 2, "--" ) != 0 )
+            {
+                rOptions.inputs.push_back( arg );
+                continue;
+            }
+            auto const iEqual = arg.find( '=' );
+            if ( iEqual == std::string::npos )
+                return false;
+            std::string const key   = arg.substr( 2, iEqual-2 );
+            std::string const value = arg.substr( iEqual+1 );
+            char const * const v    = value.c_str();
+
+            if      ( key == "output"           ) rOptions.outputDirectory = value;
+            else if ( key == "format"           ) rOptions.format          = value;
+            else if ( key == "png-bits"         ) rOptions.pngBits         = strtoul( v, NULL, 10 );
+            else if ( key == "png-level"        ) rOptions.pngLevel        = strtol( v, NULL, 10 );
+            else if ( key == "h5-file"          ) rOptions.h5File          = value;
+            else if ( key == "progress"         ) rOptions.progressFile    = value;
+            else if ( key == "readers"          ) rOptions.nReaders        = strtoul( v, NULL, 10 );
+            else if ( key == "prefetch"         ) rOptions.nPrefetch       = strtoul( v, NULL, 10 );
+            else if ( key == "writers"          ) rOptions.nWriters        = strtoul( v, NULL, 10 );
+            else if ( key == "ordered"          ) rOptions.ordered         = value == "1";
+            else if ( key == "memory-budget"    ) rOptions.memoryBudget    = strtoull( v, NULL, 10 );
+            else if ( key == "object"           ) rOptions.inputIsObject   = value == "1";
+            else if ( key == "dark"             ) rOptions.darkFile        = value;
+            else if ( key == "gain"             ) rOptions.gainFile        = value;
+            else if ( key == "mask"             ) rOptions.maskFile        = value;
+            else if ( key == "hot-sigma"        ) rOptions.hotPixelSigma   = strtod( v, NULL );
+            else if ( key == "bin"              ) rOptions.binning         = strtoul( v, NULL, 10 );
+            else if ( key == "hit-min-intensity" ) rOptions.hitFinder.minIntegratedIntensity = strtod( v, NULL );
+            else if ( key == "hit-peak-threshold" ) rOptions.hitFinder.peakThreshold = strtod( v, NULL );
+            else if ( key == "hit-min-peaks"    ) rOptions.hitFinder.minPeakCount = strtoul( v, NULL, 10 );
+            else if ( key == "hit-min-radial"   ) rOptions.hitFinder.minRadialIntensity = strtod( v, NULL );
+            else if ( key == "hit-min-radius"   ) rOptions.hitFinder.minRadius = strtod( v, NULL );
+            else if ( key == "hit-centered"     ) rOptions.hitFinder.centered = value == "1";
+            else if ( key == "watch"            ) rOptions.watch           = value == "1";
+            else if ( key == "max-backlog"      ) rOptions.maxBacklog      = strtoul( v, NULL, 10 );
+            else if ( key == "cycles"           ) rOptions.nCycles         = strtoul( v, NULL, 10 );
+            else if ( key == "hio-cycles"       ) rOptions.nHIOCycles      = strtoul( v, NULL, 10 );
+            else if ( key == "target-error"     ) rOptions.targetError     = strtod( v, NULL );
+            else if ( key == "hio-beta"         ) rOptions.HIOBeta         = strtod( v, NULL );
+            else if ( key == "cutoff-autocorel" ) rOptions.intensityCutOffAutoCorel = strtod( v, NULL );
+            else if ( key == "cutoff"           ) rOptions.intensityCutOff = strtod( v, NULL );
+            else if ( key == "sigma0"           ) rOptions.sigma0          = strtod( v, NULL );
+            else if ( key == "sigma-change"     ) rOptions.sigmaChange     = strtod( v, NULL );
+            else
+                return false;
+        }
+        if ( rOptions.hitFinder.minRadialIntensity > 0 )
+            rOptions.hitFinder.nRadialBins = 16;
+        if ( rOptions.progressFile.empty() )
+            rOptions.progressFile = rOptions.outputDirectory + "/imresh-batch.progress";
+
+        bool formatSupported = rOptions.format == "txt" or
+                               rOptions.format == "raw" or rOptions.format == "npy";
+#       ifdef USE_PNG
+            formatSupported = formatSupported or rOptions.format == "png";
+#       endif
+#       ifdef USE_SPLASH
+            formatSupported = formatSupported or rOptions.format == "h5";
+#       endif
+        if ( not rOptions.h5File.empty() and rOptions.format != "h5" )
+            return false;
+        if ( ( rOptions.pngBits != 8 and rOptions.pngBits != 16 ) or
+             rOptions.pngLevel < 0 or rOptions.pngLevel > 9 )
+            return false;
+        return formatSupported and rOptions.nReaders > 0 and
+               rOptions.binning > 0 and
+               rOptions.nPrefetch > 0 and rOptions.nWriters > 0 and
+               not rOptions.inputs.empty();
+    }
+
+    bool isDirectory( std::string const & rPath )
+    {
+        struct stat info;
+        return stat( rPath.c_str(), &info ) == 0 and S_ISDIR( info.st_mode );
+    }
+
+    /**
+     * @return true if the output directory is one of the input directories,
+     *         in which case results would be picked up again in watch mode
+     */
+    bool isOutputWatched( BatchOptions const & rOptions )
+    {
+        char outputPath[ PATH_MAX ];
+        if ( realpath( rOptions.outputDirectory.c_str(), outputPath ) == NULL )
+            return false;
+        for ( auto const & input : rOptions.inputs )
+        {
+            char inputPath[ PATH_MAX ];
+            if ( isDirectory( input ) and
+                 realpath( input.c_str(), inputPath ) != NULL and
+                 std::string( inputPath ) == outputPath )
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * Expands directories, glob patterns and @lists to the supported files
+     * they contain. Every file appears only once, in the given order.
+     */
+    std::vector<std::string> collectInputs( std::vector<std::string> const & rInputs )
+    {
+        std::vector<std::string> files;
+        std::unordered_set<std::string> seen;
+        auto const add = [&]( std::string const & rPath )
+        {
+            if ( readInFuncs::isSupportedFile( rPath ) and seen.insert( rPath ).second )
+                files.push_back( rPath );
+        };
+
+        for ( auto const & input : rInputs )
+        {
+            if ( input[0] == '@' )
+            {
+                std::ifstream list( input.substr( 1 ) );
+                if ( not list )
+                    std::cerr << "Couldn't open list " << input.substr( 1 ) << "\n";
+                std::string line;
+                while ( std::getline( list, line ) )
+                    if ( not line.empty() )
+                        add( line );
+            }
+            else if ( isDirectory( input ) )
+            {
+                std::vector<std::string> entries;
+                if ( DIR * const dir = opendir( input.c_str() ) )
+                {
+                    while ( dirent const * const entry = readdir( dir ) )
+                        entries.push_back( input + "/" + entry->d_name );
+                    closedir( dir );
+                }
+                std::sort( entries.begin(), entries.end() );
+                for ( auto const & entry : entries )
+                    add( entry );
+            }
+            else if ( input.find_first_of( "*?[" ) != std::string::npos )
+            {
+                glob_t matches;
+                if ( glob( input.c_str(), 0, NULL, &matches ) == 0 )
+                {
+                    for ( size_t i = 0; i < matches.gl_pathc; ++i )
+                        add( matches.gl_pathv[i] );
+                }
+                globfree( &matches );
+            }
+            else
+                add( input );
+        }
+        return files;
+    }
+
+    /**
+     * Assigns every input a unique output name without extension, so that
+     * e.g. a/img.png and b/img.png or x.raw and x.npy don't overwrite each
+     * other's results. The first input gets the file name without its
+     * extension, later ones with the same name get "-2", "-3", ... appended.
+     * Names are assigned in the order of the first call. main does that for
+     * all collected inputs up front, so resumed runs get the same names.
+     */
+    class OutputNames
+    {
+    public:
+        explicit OutputNames( std::string const & rOutputDirectory )
+        : mOutputDirectory( rOutputDirectory )
+        {}
+
+        /**
+         * Output file name for an input, the extension is replaced with the
+         * output format. For HDF5 libSplash appends "_0_0_0.h5" itself.
+         * Frames of containers get their index appended, if rFrame >= 0.
+         */
+        std::string get
+        (
+            std::string const & rInput,
+            std::string const & rFormat,
+            int64_t const rFrame = -1
+        )
+        {
+            std::string name = mOutputDirectory + "/" + getStem( rInput );
+            if ( rFrame >= 0 )
+                name += "_" + std::to_string( rFrame );
+            if ( rFormat != "h5" )
+                name += "." + rFormat;
+            return name;
+        }
+
+    private:
+        std::string getStem( std::string const & rInput )
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            auto const itAssigned = mStems.find( rInput );
+            if ( itAssigned != mStems.end() )
+                return itAssigned->second;
+
+            std::string name = rInput.substr( rInput.rfind( '/' ) + 1 );
+            std::string const splashSuffix = "_0_0_0.h5";
+            if ( name.size() > splashSuffix.size() and
+                 name.compare( name.size() - splashSuffix.size(),
+                               splashSuffix.size(), splashSuffix ) == 0 )
+                name.resize( name.size() - splashSuffix.size() );
+            else
+                name = name.substr( 0, name.rfind( '.' ) );
+
+            std::string stem = name;
+            for ( unsigned i = 2; not mTaken.insert( stem ).second; ++i )
+                stem = name + "-" + std::to_string( i );
+            if ( stem != name )
+            {
+                std::cerr << "Output name " << name << " is already used, "
+                          << "writing " << rInput << " to " << stem << "\n";
+            }
+            mStems[ rInput ] = stem;
+            return stem;
+        }
+
+        std::string const mOutputDirectory;
+        std::mutex mMutex;
+        std::map<std::string,std::string> mStems;
+        std::unordered_set<std::string> mTaken;
+    };
+
+    WriteOutFunc getWriter( BatchOptions const & rOptions )
+    {
+        std::string const & rFormat = rOptions.format;
+#       ifdef USE_PNG
+            if ( rFormat == "png" )
+            {
+                writeOutFuncs::PNGOptions png;
+                png.bitDepth         = rOptions.pngBits;
+                png.compressionLevel = rOptions.pngLevel;
+                return [png]( float * _mem, std::pair<unsigned int,unsigned int> _size,
+                              std::string _filename )
+                {
+                    writeOutFuncs::writeOutPNG16( _mem, _size, _filename, png );
+                };
+            }
+#       endif
+#       ifdef USE_SPLASH
+            if ( rFormat == "h5" )
+                return writeOutFuncs::writeOutHDF5;
+#       endif
+        if ( rFormat == "raw" )
+            return writeOutFuncs::writeOutRaw;
+        if ( rFormat == "npy" )
+            return writeOutFuncs::writeOutNpy;
+        return writeOutFuncs::writeOutTxt;
+    }
+
+    /**
+     * Appends finished inputs to the progress file. Each line is flushed
+     * right after the result was written, so after a crash at most the
+     * files being written are reconstructed again.
+     */
+    class ProgressFile
+    {
+    public:
+        explicit ProgressFile( std::string const & rPath )
+        {
+            std::ifstream previous( rPath );
+            std::string line;
+            while ( std::getline( previous, line ) )
+                mDone.insert( line );
+            mFile.open( rPath, std::ios::app );
+        }
+
+        bool isOpen( void ) const { return mFile.is_open(); }
+        bool isDone( std::string const & rInput ) const { return mDone.count( rInput ) > 0; }
+        size_t getCount( void ) const { return mDone.size(); }
+
+        void markDone( std::string const & rInput )
+        {
+            std::lock_guard<std::mutex> lock( mMutex );
+            mFile << rInput << std::endl;
+        }
+
+    private:
+        std::unordered_set<std::string> mDone;
+        std::ofstream mFile;
+        std::mutex mMutex;
+    };
+
+    std::atomic<bool> stopRequested( false );
+
+    extern "C" void requestStop( int )
+    {
+        stopRequested = true;
+    }
+
+
+} // namespace tools
+
+
+int main( int argc, char ** argv )
+{
+    using namespace tools;
+    using Clock = std::chrono::steady_clock;
+
+    BatchOptions options;
+    if ( not parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Invalid arguments. See the head of "
+                  << __FILE__ << " for the usage.\n";
+        return 1;
+    }
+    mkdir( options.outputDirectory.c_str(), 0755 );
+    if ( options.watch and isOutputWatched( options ) )
+    {
+        std::cerr << "The output directory can't be watched\n";
+        return 1;
+    }
+
+    /* The watchers are started before the inputs are collected, so files
+     * completed during the initial pass aren't missed. Until everything is
+     * set up, their files are only remembered. Files already collected or
+     * done are skipped. */
+    std::mutex watchedMutex;
+    bool watchedReady = false;
+    std::vector<std::string> watchedEarly;
+    std::unordered_set<std::string> claimed;
+    std::function<bool(std::string const &)> isInputDone;
+    std::function<void(std::string const &)> submitWatched;
+    std::vector< std::unique_ptr<DirectoryWatcher> > watchers;
+    if ( options.watch )
+    {
+        for ( auto const & input : options.inputs )
+        {
+            if ( not isDirectory( input ) )
+                continue;
+            watchers.emplace_back( new DirectoryWatcher( input,
+                [&]( std::string const & rPath )
+                {
+                    std::unique_lock<std::mutex> lock( watchedMutex );
+                    if ( not watchedReady )
+                    {
+                        watchedEarly.push_back( rPath );
+                        return;
+                    }
+                    if ( not claimed.insert( rPath ).second or isInputDone( rPath ) )
+                        return;
+                    lock.unlock();
+                    submitWatched( rPath );
+                }, options.maxBacklog ) );
+            if ( not watchers.back()->isOpen() )
+                return 1;
+        }
+    }
+
+    std::vector<std::string> const files = collectInputs( options.inputs );
+    /* includes the inputs already done, so that the names don't depend on
+     * how far a previous run got */
+    OutputNames outputNames( options.outputDirectory );
+    for ( auto const & file : files )
+        outputNames.get( file, options.format );
+    ProgressFile progress( options.progressFile );
+    if ( not progress.isOpen() )
+    {
+        std::cerr << "Couldn't open progress file " << options.progressFile << "\n";
+        return 1;
+    }
+    std::vector<std::string> todo;
+    for ( auto const & file : files )
+        if ( not progress.isDone( file ) )
+            todo.push_back( file );
+    std::cout << files.size() << " input files, " << files.size() - todo.size()
+              << " already done" << std::endl;
+
+    /* finish the started reconstructions when interrupted, so that the
+     * progress file is accurate */
+    std::signal( SIGINT , requestStop );
+    std::signal( SIGTERM, requestStop );
+
+    /* The preprocessors only depend on the calibration and the frame size,
+     * so they are created once per size and shared by all readers. */
+    using imresh::algorithms::DetectorCalibration;
+    using imresh::algorithms::DetectorPreprocessor;
+    bool const preprocess = not options.darkFile.empty() or
+        not options.gainFile.empty() or not options.maskFile.empty() or
+        options.binning > 1;
+    DetectorCalibration calibration;
+    std::pair<unsigned int,unsigned int> calibrationSize;
+    if ( preprocess and not readDetectorCalibration( options.darkFile,
+             options.gainFile, options.maskFile, calibration, calibrationSize ) )
+    {
+        std::cerr << "Couldn't read the detector calibration\n";
+        return 1;
+    }
+    calibration.hotPixelSigma = options.hotPixelSigma;
+    calibration.binning       = options.binning;
+    std::mutex preprocessorsMutex;
+    std::map< std::pair<unsigned int,unsigned int>, DetectorPreprocessor > preprocessors;
+    auto const getPreprocessor = [&]( std::pair<unsigned int,unsigned int> const & size )
+    {
+        std::lock_guard<std::mutex> lock( preprocessorsMutex );
+        auto it = preprocessors.find( size );
+        if ( it == preprocessors.end() )
+            it = preprocessors.emplace( size, DetectorPreprocessor( size, calibration ) ).first;
+        return it->second;
+    };
+
+    /* blank frames are sorted out before they occupy a worker */
+    auto const & hitParameters = options.hitFinder;
+    bool const findHits = hitParameters.minIntegratedIntensity > 0 or
+        hitParameters.minPeakCount > 0 or hitParameters.minRadialIntensity > 0;
+    imresh::algorithms::HitFinder const hitFinder( hitParameters );
+
+    WriteOutFunc const writer = getWriter( options );
+    WriterPool writerPool( options.nWriters, options.ordered );
+#   ifdef USE_SPLASH
+        std::unique_ptr<HDF5FrameSink> sink;
+        if ( not options.h5File.empty() )
+        {
+            sink.reset( new HDF5FrameSink( options.outputDirectory + "/" + options.h5File ) );
+            if ( not sink->isOpen() )
+                return 1;
+        }
+#   endif
+    /* after all checks which may fail, so that returning early doesn't
+     * leave the workers running */
+    taskQueueInit();
+    if ( options.memoryBudget > 0 )
+        taskQueueSetMemoryBudget( options.memoryBudget );
+
+    std::atomic<unsigned> nDone( 0 ), nFailed( 0 ), nCancelled( 0 ), nBlank( 0 );
+    std::atomic<uint64_t> nPixels( 0 );
+    std::atomic<size_t> iNext( 0 );
+    auto const start = Clock::now();
+
+    /* files handed to submitFile, grows in watch mode */
+    std::atomic<size_t> nTotal( todo.size() );
+
+    /* results are written and their buffers recycled by the writer pool,
+     * the worker threads only queue them */
+    auto const submitTask = [&]( float * const data,
+        std::pair<unsigned int,unsigned int> const size,
+        std::string const & progressName, std::string const & outputName,
+        WriterPool::RecycleFunc const & recycle )
+    {
+        if ( options.inputIsObject )
+            imresh::libs::diffractionIntensity( data, size );
+
+        if ( findHits and not hitFinder( data, size ) )
+        {
+            size_t const nElements = size_t( size.first ) * size.second;
+            if ( recycle )
+                recycle( data, nElements );
+            else
+                imresh::libs::freeFrame( data );
+            progress.markDone( progressName );
+            ++nBlank;
+            return;
+        }
+
+        auto const markDone = [&,progressName]( std::pair<unsigned int,unsigned int> _size )
+        {
+            progress.markDone( progressName );
+            nPixels += uint64_t( _size.first ) * _size.second;
+            ++nDone;
+        };
+
+        WriterPool::BoundFuncs funcs;
+#       ifdef USE_SPLASH
+        if ( sink )
+        {
+            /* the sink copies the image, so it is recycled right away and
+             * marked as done once it is flushed to the file */
+            WriterPool::RecycleFunc const recycleBuffer = recycle ? recycle :
+                []( float * _mem, size_t ){ imresh::libs::freeFrame( _mem ); };
+            funcs.writeOut = [&,progressName,markDone,recycleBuffer]( float * _mem,
+                std::pair<unsigned int,unsigned int> _size, std::string )
+            {
+                sink->write( _mem, _size, progressName, taskQueueGetCurrentResult(),
+                             [markDone,_size]{ markDone( _size ); } );
+                recycleBuffer( _mem, size_t( _size.first ) * _size.second );
+            };
+            funcs.cancel = [recycleBuffer]( float * _mem,
+                std::pair<unsigned int,unsigned int> _size, std::string )
+            {
+                recycleBuffer( _mem, size_t( _size.first ) * _size.second );
+            };
+        }
+        else
+#       endif
+        funcs = writerPool.bind(
+            [&,markDone]( float * _mem,
+                std::pair<unsigned int,unsigned int> _size, std::string _filename )
+            {
+                writer( _mem, _size, _filename );
+                markDone( _size );
+            }, recycle );
+        WriteOutFunc const cancel = funcs.cancel;
+        if ( not addTask( data, size, funcs.writeOut, outputName,
+                          options.nCycles, options.nHIOCycles,
+                          options.targetError, options.HIOBeta,
+                          options.intensityCutOffAutoCorel,
+                          options.intensityCutOff, options.sigma0,
+                          options.sigmaChange, 0,
+                          [&,cancel]( float * _mem,
+                              std::pair<unsigned int,unsigned int> _size,
+                              std::string _filename )
+                          {
+                              cancel( _mem, _size, _filename );
+                              ++nCancelled;
+                          } ) )
+        {
+            funcs.cancel( data, size, outputName );
+            std::cerr << "Task for " << progressName << " was rejected\n";
+            ++nFailed;
+        }
+    };
+
+    auto const submitFile = [&]( std::string const & input )
+    {
+        std::unique_ptr<FrameSource> source = openFrameSource( input );
+        uint64_t const nFrames = source ? source->getFrameCount() : 0;
+        if ( nFrames == 0 or source->getMaxElements() == 0 )
+        {
+            std::cerr << "Couldn't read " << input << "\n";
+            ++nFailed;
+            return;
+        }
+        if ( preprocess )
+        {
+            DetectorPreprocessor const preprocessor = getPreprocessor( source->getFrameSize( 0 ) );
+            if ( not preprocessor.isValid() )
+            {
+                std::cerr << input << " doesn't match the detector calibration\n";
+                ++nFailed;
+                return;
+            }
+            source.reset( new PreprocessedFrameSource( std::move( source ), preprocessor ) );
+        }
+
+        if ( nFrames == 1 )
+        {
+            float * const data = imresh::libs::allocateFrame( source->getMaxElements() );
+            if ( data == NULL or not source->readFrame( 0, data ) )
+            {
+                imresh::libs::freeFrame( data );
+                std::cerr << "Couldn't read " << input << "\n";
+                ++nFailed;
+                return;
+            }
+            submitTask( data, source->getFrameSize( 0 ), input,
+                        outputNames.get( input, options.format ), WriterPool::RecycleFunc() );
+            return;
+        }
+
+        /* The stream is kept alive by the tasks still using its buffers.
+         * Reading the next frames overlaps with the reconstruction. */
+        nTotal += nFrames - 1;
+        std::shared_ptr<FrameStream> stream(
+            new FrameStream( std::move( source ), options.nPrefetch ) );
+        auto const release = [stream]( float * _mem, size_t ){ stream->release( _mem ); };
+        Frame frame;
+        while ( not stopRequested and stream->next( frame ) )
+        {
+            std::string const name = input + "#" + std::to_string( frame.index );
+            if ( progress.isDone( name ) )
+            {
+                stream->release( frame.data );
+                --nTotal;
+                continue;
+            }
+            submitTask( frame.data, frame.size, name,
+                        outputNames.get( input, options.format, frame.index ), release );
+        }
+        FrameStreamStatistics const statistics = stream->getStatistics();
+        nFailed += statistics.nFailed;
+    };
+
+    /* files completed while setting up are read along with the others */
+    {
+        std::lock_guard<std::mutex> lock( watchedMutex );
+        claimed.insert( files.begin(), files.end() );
+        for ( auto const & path : watchedEarly )
+        {
+            if ( claimed.insert( path ).second and not progress.isDone( path ) )
+            {
+                todo.push_back( path );
+                ++nTotal;
+            }
+        }
+        watchedEarly.clear();
+        isInputDone = [&]( std::string const & rPath ){ return progress.isDone( rPath ); };
+        submitWatched = [&]( std::string const & rPath )
+        {
+            ++nTotal;
+            submitFile( rPath );
+        };
+        watchedReady = true;
+    }
+
+    auto const readFiles = [&]
+    {
+        while ( not stopRequested )
+        {
+            size_t const i = iNext++;
+            if ( i >= todo.size() )
+                break;
+            submitFile( todo[i] );
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for ( unsigned i = 0; i < options.nReaders; ++i )
+        readers.emplace_back( readFiles );
+    for ( auto & reader : readers )
+        reader.join();
+
+    if ( options.watch )
+    {
+        if ( not stopRequested )
+            std::cout << "Watching " << watchers.size()
+                      << " directories, stop with Ctrl+C" << std::endl;
+        while ( not stopRequested )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+
+        for ( auto const & watcher : watchers )
+        {
+            watcher->stop();
+            DirectoryWatcherStatistics const statistics = watcher->getStatistics();
+            std::cout << "Watcher: " << statistics.nDetected << " detected, "
+                      << statistics.nDropped << " dropped, "
+                      << statistics.nOverflows << " overflows, lag p50 "
+                      << statistics.lagP50 << " ms, p99 " << statistics.lagP99
+                      << " ms, max " << statistics.lagMax << " ms" << std::endl;
+        }
+    }
+
+    taskQueueDeinit();
+    writerPool.flush();
+#   ifdef USE_SPLASH
+        if ( sink )
+        {
+            sink->flush();
+            /* the frames not in the file aren't marked as done, so they
+             * are reconstructed again by the next run */
+            if ( not sink->isOpen() )
+                std::cerr << "Writing " << options.h5File << " failed\n";
+        }
+#   endif
+    WriterPoolStatistics const writes = writerPool.getStatistics();
+    imresh::libs::FrameBufferPoolStatistics const buffers =
+        imresh::libs::getFrameBufferPool().getStatistics();
+    TaskQueueMetrics const metrics = taskQueueGetMetrics();
+    double const seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+
+    std::cout << std::setprecision( 3 )
+              << ( stopRequested ? "Interrupted" : "Finished" ) << " after "
+              << seconds << " s: " << nDone << " reconstructed, "
+              << nFailed << " failed, " << nCancelled << " cancelled, "
+              << nBlank << " blank, "
+              << nTotal - nDone - nFailed - nCancelled - nBlank << " left\n"
+              << "Throughput: " << nDone / seconds << " files/s, "
+              << nPixels / seconds / 1e6 << " MPixel/s\n"
+              << "Write out: " << writes.maxQueued << " results queued at most, "
+              << buffers.nReused << " buffers reused, "
+              << buffers.nAllocated << " allocated\n"
+              << "Reconstruction time p50 " << metrics.reconstruction.p50
+              << " ms, p99 " << metrics.reconstruction.p99 << " ms" << std::endl;
+    return nFailed == 0 and ( options.watch or not stopRequested ) ? 0 : 1;
+}
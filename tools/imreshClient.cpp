@@ -0,0 +1,201 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Minimal client for imresh-server, e.g. to test a server on localhost.
+ * Sends synthetic diffraction intensities of a disc and waits for all
+ * results, or sends one command to the control socket.
+ *
+ * Usage: imresh-client [--option=value ...]
+ *   --socket=/tmp/imresh.sock  frame socket of the server
+ *   --control=/tmp/imresh-control.sock  control socket of the server
+ *   --command=metrics  send this command to the control socket instead
+ *   --frames=100       number of frames to send
+ *   --size=256         width and height of the frames
+ *   --cycles=0         shrink-wrap cycles, 0 uses the server default
+ *   --priority=0       priority of the frames
+ */
+
+#include <chrono>
+#include <cmath>            // sqrt
+#include <cstdint>          // uint64_t
+#include <cstdlib>          // strtoul, strtol
+#include <iostream>
+#include <string>
+#include <sys/socket.h>     // shutdown
+#include <thread>
+#include <unistd.h>         // close
+#include <vector>
+
+#include "io/frameHeader.hpp"
+#include "io/socketProtocol.hpp"
+#include "libs/diffractionIntensity.hpp"
+
+
+namespace tools
+{
+
+
+    using namespace imresh::io;
+
+    struct ClientOptions
+    {
+        std::string socketPath  = "/tmp/imresh.sock";
+        std::string controlPath = "/tmp/imresh-control.sock";
+        std::string command;
+        unsigned nFrames        = 100;
+        unsigned size           = 256;
+        unsigned nCycles        = 0;
+        int priority            = 0;
+    };
+
+    /**
+     * Parses arguments of the form --key=value. Returns false on unknown
+     * keys or malformed arguments.
+     */
+    bool parseOptions( int argc, char ** argv, ClientOptions & rOptions )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            std::string const arg = argv[i];
+            auto const iEqual = arg.find( '=' );
+            if ( arg.compare( 0, 2, "--" ) != 0 or iEqual == std::string::npos )
+                return false;
+            std::string const key   = arg.substr( 2, iEqual-2 );
+            std::string const value = arg.substr( iEqual+1 );
+
+            if      ( key == "socket"   ) rOptions.socketPath  = value;
+            else if ( key == "control"  ) rOptions.controlPath = value;
+            else if ( key == "command"  ) rOptions.command     = value;
+            else if ( key == "frames"   ) rOptions.nFrames     = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "size"     ) rOptions.size        = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "cycles"   ) rOptions.nCycles     = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "priority" ) rOptions.priority    = strtol( value.c_str(), NULL, 10 );
+            else
+                return false;
+        }
+        return rOptions.size > 0;
+    }
+
+    int sendCommand( ClientOptions const & rOptions )
+    {
+        int const fd = connectUnixSocket( rOptions.controlPath );
+        if ( fd < 0 )
+            return 1;
+        std::string const line = rOptions.command + "\n";
+        sendAll( fd, line.data(), line.size() );
+        shutdown( fd, SHUT_WR );
+        char c;
+        while ( receiveAll( fd, &c, 1 ) )
+            std::cout << c;
+        close( fd );
+        return 0;
+    }
+
+    int sendFrames( ClientOptions const & rOptions )
+    {
+        int const fd = connectUnixSocket( rOptions.socketPath );
+        if ( fd < 0 )
+            return 1;
+
+        unsigned const n = rOptions.size;
+        std::vector<float> object( n * n, 0 );
+        for ( unsigned iy = 0; iy < n; ++iy )
+        for ( unsigned ix = 0; ix < n; ++ix )
+        {
+            float const dx = float( ix ) - n / 2.0f;
+            float const dy = float( iy ) - n / 2.0f;
+            if ( std::sqrt( dx*dx + dy*dy ) < n / 8.0f )
+                object[ iy * n + ix ] = 1;
+        }
+        imresh::libs::diffractionIntensity( object.data(), { n, n } );
+
+        auto const start = std::chrono::steady_clock::now();
+        /* send from another thread, so that results are read while sending
+         * and the server never blocks on a full socket */
+        std::thread sender( [&]{
+            FrameHeader frame = FrameHeader();
+            frame.width          = n;
+            frame.height         = n;
+            frame.priority       = rOptions.priority;
+            frame.numberOfCycles = rOptions.nCycles;
+            for ( unsigned i = 0; i < rOptions.nFrames; ++i )
+            {
+                frame.frameId = i;
+                if ( not sendFrameMessage( fd, SocketMessageType::Submit,
+                                           frame, object.data() ) )
+                    break;
+            }
+            shutdown( fd, SHUT_WR );
+        } );
+
+        unsigned nResults[4] = { 0, 0, 0, 0 };
+        std::vector<float> result;
+        SocketMessageHeader message;
+        unsigned nReceived = 0;
+        while ( nReceived < rOptions.nFrames and
+                receiveMessageHeader( fd, message ) )
+        {
+            if ( messageHasData( message ) )
+            {
+                result.resize( size_t( message.frame.width ) * message.frame.height );
+                if ( not receiveAll( fd, result.data(), sizeof( float ) * result.size() ) )
+                    break;
+            }
+            unsigned const status = message.frame.status;
+            if ( status < 4 )
+                ++nResults[ status ];
+            ++nReceived;
+        }
+        sender.join();
+        close( fd );
+
+        double const seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start ).count();
+        std::cout << "Received " << nReceived << " of " << rOptions.nFrames
+                  << " results in " << seconds << " s ("
+                  << nReceived / seconds << " frames/s): "
+                  << nResults[0] << " ok, " << nResults[1] << " cancelled, "
+                  << nResults[2] << " rejected, " << nResults[3] << " invalid"
+                  << std::endl;
+        return nReceived == rOptions.nFrames ? 0 : 1;
+    }
+
+
+} // namespace tools
+
+
+int main( int argc, char ** argv )
+{
+    tools::ClientOptions options;
+    if ( not tools::parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Invalid arguments. See the head of "
+                  << __FILE__ << " for the usage.\n";
+        return 1;
+    }
+    if ( not options.command.empty() )
+        return tools::sendCommand( options );
+    return tools::sendFrames( options );
+}
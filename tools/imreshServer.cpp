@@ -0,0 +1,410 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Maximilian Knespel, Philipp Trommler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Reconstruction service: accepts frames over a UNIX domain socket, runs
+ * them through the task queue and streams the results back (see
+ * io/socketProtocol.hpp for the protocol). A second socket answers text
+ * commands, one per line:
+ *   metrics   the task queue metrics as one JSON line
+ *   clients   number of connected clients
+ *   cancel    cancels all pending tasks, answers the number cancelled
+ *   abort     aborts the running reconstructions
+ *
+ * Clients are throttled by not reading from their socket while they have
+ * too many frames in flight or while the task queue is full. A client which
+ * doesn't read its results for --send-timeout seconds is disconnected, so
+ * it can't block the workers of the task queue.
+ * SIGINT or SIGTERM shut the server down after all accepted frames are done.
+ *
+ * Usage: imresh-server [--option=value ...]
+ *   --socket=/tmp/imresh.sock           frame socket
+ *   --control=/tmp/imresh-control.sock  control socket
+ *   --max-pixels=16777216  larger frames are answered with status Invalid
+ *   --max-in-flight=16     frames per client submitted but not yet answered
+ *   --memory-budget=0      bytes for queued and running tasks, 0 = unlimited
+ *   --reject=0             1 rejects frames over the budget instead of waiting
+ *   --send-timeout=10      seconds a result may wait for a client to read
+ *   --metrics=file         periodically dump the queue metrics as JSON lines
+ */
+
+#include <cerrno>           // errno
+#include <chrono>
+#include <condition_variable>
+#include <csignal>          // sigset_t, sigwait
+#include <cstdint>          // uint64_t
+#include <cstdlib>          // strtoul, strtoull
+#include <iostream>
+#include <list>
+#include <memory>           // std::shared_ptr
+#include <mutex>
+#include <pthread.h>        // pthread_sigmask
+#include <string>
+#include <sys/socket.h>     // accept, shutdown, setsockopt
+#include <sys/time.h>       // timeval
+#include <thread>
+#include <unistd.h>         // close, unlink
+
+#include "io/frameHeader.hpp"
+#include "io/socketProtocol.hpp"
+#include "io/taskQueue.hpp"
+#include "io/taskQueueMetrics.hpp"
+#include "libs/frameBuffer.hpp"
+
+
+namespace tools
+{
+
+
+    using namespace imresh::io;
+
+    struct ServerOptions
+    {
+        std::string socketPath   = "/tmp/imresh.sock";
+        std::string controlPath  = "/tmp/imresh-control.sock";
+        uint64_t maxPixels       = 16777216;
+        unsigned maxInFlight     = 16;
+        uint64_t memoryBudget    = 0;
+        bool reject              = false;
+        unsigned sendTimeout     = 10;
+        std::string metricsFile;
+    };
+
+    /**
+     * Parses arguments of the form --key=value. Returns false on unknown
+     * keys or malformed arguments.
+     */
+    bool parseOptions( int argc, char ** argv, ServerOptions & rOptions )
+    {
+        for ( int i = 1; i < argc; ++i )
+        {
+            std::string const arg = argv[i];
+            auto const iEqual = arg.find( '=' );
+            if ( arg.compare( 0, 2, "--" ) != 0 or iEqual == std::string::npos )
+                return false;
+            std::string const key   = arg.substr( 2, iEqual-2 );
+            std::string const value = arg.substr( iEqual+1 );
+
+            if      ( key == "socket"        ) rOptions.socketPath   = value;
+            else if ( key == "control"       ) rOptions.controlPath  = value;
+            else if ( key == "max-pixels"    ) rOptions.maxPixels    = strtoull( value.c_str(), NULL, 10 );
+            else if ( key == "max-in-flight" ) rOptions.maxInFlight  = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "memory-budget" ) rOptions.memoryBudget = strtoull( value.c_str(), NULL, 10 );
+            else if ( key == "reject"        ) rOptions.reject       = value == "1";
+            else if ( key == "send-timeout"  ) rOptions.sendTimeout  = strtoul( value.c_str(), NULL, 10 );
+            else if ( key == "metrics"       ) rOptions.metricsFile  = value;
+            else
+                return false;
+        }
+        return rOptions.maxPixels > 0 and rOptions.maxInFlight > 0 and
+               rOptions.sendTimeout > 0;
+    }
+
+    /**
+     * One client on the frame socket. The socket is closed when the last
+     * reference is gone, i.e. after the reader stopped and all results of
+     * this client were sent.
+     */
+    struct Connection
+    {
+        int fd;
+        /**
+         * results are sent from the worker threads of the task queue
+         */
+        std::mutex sendMutex;
+        /**
+         * set after a send failed or timed out. The stream may end in the
+         * middle of a message, so nothing is sent anymore.
+         */
+        bool broken = false;
+        std::mutex inFlightMutex;
+        std::condition_variable inFlightChanged;
+        unsigned nInFlight = 0;
+
+        explicit Connection( int rFd ) : fd( rFd ) {}
+        ~Connection() { close( fd ); }
+    };
+
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsChanged;
+    std::list<std::shared_ptr<Connection>> connections;
+
+    /**
+     * Sends a result unless the connection is already broken. A failed or
+     * timed out send shuts the socket down, which also stops the reader of
+     * that client.
+     */
+    void sendResult
+    (
+        Connection & rConnection,
+        FrameHeader const & rFrame,
+        float const * const rData
+    )
+    {
+        std::lock_guard<std::mutex> lock( rConnection.sendMutex );
+        if ( rConnection.broken )
+            return;
+        if ( not sendFrameMessage( rConnection.fd, SocketMessageType::Result,
+                                   rFrame, rData ) )
+        {
+            rConnection.broken = true;
+            shutdown( rConnection.fd, SHUT_RDWR );
+        }
+    }
+
+    /**
+     * Sends the result or status of a frame, frees its memory and lets the
+     * reader of that client continue if it was throttled.
+     */
+    void finishFrame
+    (
+        std::shared_ptr<Connection> const & rConnection,
+        FrameHeader rFrame,
+        FrameStatus const rStatus,
+        float * const rData
+    )
+    {
+        rFrame.status = static_cast<int32_t>( rStatus );
+        /* failing means the client is gone, the result isn't needed */
+        sendResult( *rConnection, rFrame, rData );
+        imresh::libs::freeFrame( rData );
+
+        std::lock_guard<std::mutex> lock( rConnection->inFlightMutex );
+        --rConnection->nInFlight;
+        rConnection->inFlightChanged.notify_all();
+    }
+
+    void serveClient
+    (
+        std::shared_ptr<Connection> const rConnection,
+        ServerOptions const & rOptions
+    )
+    {
+        SocketMessageHeader message;
+        while ( receiveMessageHeader( rConnection->fd, message ) and
+                message.type == uint32_t( SocketMessageType::Submit ) )
+        {
+            FrameHeader const frame = message.frame;
+            uint64_t const nPixels = uint64_t( frame.width ) * frame.height;
+            if ( nPixels == 0 or nPixels > rOptions.maxPixels )
+            {
+                /* the data can't be skipped reliably, so the connection
+                 * is closed after telling the client why */
+                FrameHeader answer = frame;
+                answer.status = static_cast<int32_t>( FrameStatus::Invalid );
+                sendResult( *rConnection, answer, NULL );
+                break;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock( rConnection->inFlightMutex );
+                rConnection->inFlightChanged.wait( lock, [&]{
+                    return rConnection->nInFlight < rOptions.maxInFlight; } );
+                ++rConnection->nInFlight;
+            }
+
+            /* frames of a run have the same size, so they are received into
+             * recycled buffers */
+            float * const data = imresh::libs::allocateFrame( nPixels );
+            if ( data == NULL or
+                 not receiveAll( rConnection->fd, data, sizeof( float ) * nPixels ) )
+            {
+                imresh::libs::freeFrame( data );
+                std::lock_guard<std::mutex> lock( rConnection->inFlightMutex );
+                --rConnection->nInFlight;
+                break;
+            }
+
+            auto writeOut = [rConnection,frame]( float * _mem,
+                std::pair<unsigned int,unsigned int>, std::string )
+            {
+                finishFrame( rConnection, frame, FrameStatus::Ok, _mem );
+            };
+            auto cancel = [rConnection,frame]( float * _mem,
+                std::pair<unsigned int,unsigned int>, std::string )
+            {
+                finishFrame( rConnection, frame, FrameStatus::Cancelled, _mem );
+            };
+            /* blocks while the task queue is full, which stops reading from
+             * this client and thereby throttles it */
+            if ( not addFrameTask( data, frame, writeOut, cancel ) )
+                finishFrame( rConnection, frame, FrameStatus::Rejected, data );
+        }
+
+        std::lock_guard<std::mutex> lock( connectionsMutex );
+        connections.remove( rConnection );
+        connectionsChanged.notify_all();
+    }
+
+    void acceptClients( int const rListenFd, ServerOptions const & rOptions )
+    {
+        while ( true )
+        {
+            int const fd = accept4( rListenFd, NULL, NULL, SOCK_CLOEXEC );
+            if ( fd < 0 )
+            {
+                if ( errno == EINTR or errno == ECONNABORTED )
+                    continue;
+                /* the listening socket was shut down */
+                break;
+            }
+            /* results are sent from the workers of the task queue, which
+             * must not wait forever for a client not reading them */
+            timeval timeout = { time_t( rOptions.sendTimeout ), 0 };
+            setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof( timeout ) );
+            auto connection = std::make_shared<Connection>( fd );
+            {
+                std::lock_guard<std::mutex> lock( connectionsMutex );
+                connections.push_back( connection );
+            }
+            std::thread( serveClient, connection, std::cref( rOptions ) ).detach();
+        }
+    }
+
+    std::string executeCommand( std::string const & rCommand )
+    {
+        if ( rCommand == "metrics" )
+            return toJson( taskQueueGetMetrics() );
+        if ( rCommand == "clients" )
+        {
+            std::lock_guard<std::mutex> lock( connectionsMutex );
+            return std::to_string( connections.size() );
+        }
+        if ( rCommand == "cancel" )
+            return std::to_string( taskQueueCancelPending() );
+        if ( rCommand == "abort" )
+        {
+            taskQueueAbortRunning();
+            return "ok";
+        }
+        return "unknown command";
+    }
+
+    /**
+     * Answers the commands of one control client after the other. They are
+     * short, so there is no need for a thread per client.
+     */
+    void acceptControlClients( int const rListenFd )
+    {
+        while ( true )
+        {
+            int const fd = accept4( rListenFd, NULL, NULL, SOCK_CLOEXEC );
+            if ( fd < 0 )
+            {
+                if ( errno == EINTR or errno == ECONNABORTED )
+                    continue;
+                break;
+            }
+            /* a stuck control client must not block the others forever */
+            timeval timeout = { 5, 0 };
+            setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof( timeout ) );
+
+            std::string line;
+            char c;
+            while ( receiveAll( fd, &c, 1 ) and line.size() < 256 )
+            {
+                if ( c != '\n' )
+                {
+                    line += c;
+                    continue;
+                }
+                if ( not line.empty() and line.back() == '\r' )
+                    line.pop_back();
+                std::string const answer = executeCommand( line ) + "\n";
+                if ( not sendAll( fd, answer.data(), answer.size() ) )
+                    break;
+                line.clear();
+            }
+            close( fd );
+        }
+    }
+
+
+} // namespace tools
+
+
+int main( int argc, char ** argv )
+{
+    using namespace tools;
+
+    ServerOptions options;
+    if ( not parseOptions( argc, argv, options ) )
+    {
+        std::cerr << "Invalid arguments. See the head of "
+                  << __FILE__ << " for the usage.\n";
+        return 1;
+    }
+
+    /* block the shutdown signals in all threads, main waits for them */
+    sigset_t signals;
+    sigemptyset( &signals );
+    sigaddset( &signals, SIGINT  );
+    sigaddset( &signals, SIGTERM );
+    pthread_sigmask( SIG_BLOCK, &signals, NULL );
+
+    int const listenFd  = listenUnixSocket( options.socketPath );
+    int const controlFd = listenUnixSocket( options.controlPath );
+    if ( listenFd < 0 or controlFd < 0 )
+        return 1;
+
+    taskQueueInit();
+    if ( options.memoryBudget > 0 )
+    {
+        taskQueueSetMemoryBudget( options.memoryBudget, options.reject ?
+            AdmissionPolicy::Reject : AdmissionPolicy::Block );
+    }
+    if ( not options.metricsFile.empty() )
+        taskQueueStartMetricsDump( options.metricsFile, std::chrono::seconds( 1 ) );
+
+    std::thread frameThread( acceptClients, listenFd, std::cref( options ) );
+    std::thread controlThread( acceptControlClients, controlFd );
+    std::cout << "imresh-server: listening on " << options.socketPath
+              << ", control on " << options.controlPath << std::endl;
+
+    int signal = 0;
+    sigwait( &signals, &signal );
+    std::cout << "imresh-server: shutting down" << std::endl;
+
+    /* stop accepting clients, then stop reading from the connected ones */
+    shutdown( listenFd, SHUT_RDWR );
+    frameThread.join();
+    {
+        std::unique_lock<std::mutex> lock( connectionsMutex );
+        for ( auto const & connection : connections )
+            shutdown( connection->fd, SHUT_RD );
+        connectionsChanged.wait( lock, []{ return connections.empty(); } );
+    }
+    /* finishes all accepted frames, sending their results */
+    taskQueueDeinit();
+    if ( not options.metricsFile.empty() )
+        taskQueueStopMetricsDump();
+
+    shutdown( controlFd, SHUT_RDWR );
+    controlThread.join();
+    close( listenFd );
+    close( controlFd );
+    unlink( options.socketPath.c_str() );
+    unlink( options.controlPath.c_str() );
+    return 0;
+}